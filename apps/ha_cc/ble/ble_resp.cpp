@@ -21,8 +21,6 @@ extern "C" {
 #define HA_DEBUG_EN (0)
 #include "ha_debug.h"
 
-extern ble_ack_s ble_ack;
-
 /******************************************************************************
  * Private variables and buffers
  ******************************************************************************/
@@ -96,9 +94,9 @@ void ble_evt_attributes_value(const struct ble_msg_attributes_value_evt_t *msg)
 
     if(msg->handle == 0x13){
         numOfMsg = 0;                      // reset counter
-        ble_ack_timeout_count = 0;
         totalMsgLen = 0;
-        thread_wakeup(ble_thread_ns::ble_thread_pid);
+        msg_ble_thread.type = ha_cc_ns::BLE_MOBILE_RESET;
+        msg_send_int(&msg_ble_thread, ble_thread_ns::ble_thread_pid);
         return;
     }
 
@@ -107,31 +105,43 @@ void ble_evt_attributes_value(const struct ble_msg_attributes_value_evt_t *msg)
 
     if (1 == numOfMsg) {
         if (msg->value.data[0] == ha_ble_ns::BLE_MSG_ACK) { //if message is ACK
-            /* get index, if true wake-up ble_thread */
-            HA_DEBUG(" receive ACK %d\n", ble_ack.packet_index);
             numOfMsg = 0;                      // reset counter
-            ble_ack_timeout_count = 0;
             totalMsgLen = 0;
-            if(ble_ack.need_to_wait_ack == true){
-                thread_wakeup(ble_thread_ns::ble_thread_pid);
+            if (msg->value.len < ha_ble_ns::ble_msg_header_len) {
+                return;
             }
+            /* cumulative ACK, window is handled by ble_thread */
+            msg_ble_thread.type = ha_cc_ns::BLE_MOBILE_ACK;
+            msg_ble_thread.content.value = buf2uint16((uint8_t*) &msg->value.data[1]);
+            HA_DEBUG(" receive ACK %lu\n", msg_ble_thread.content.value);
+            msg_send_int(&msg_ble_thread, ble_thread_ns::ble_thread_pid);
             return;
         } else {                                    // case message is data
+            /* first message MUST have header and GFF length */
+            if (msg->value.len <= ha_ble_ns::ble_msg_header_len) {
+                HA_DEBUG(" first message is too short (%hu), drop it\n", msg->value.len);
+                numOfMsg = 0;
+                totalMsgLen = 0;
+                return;
+            }
             msgLen = msg->value.data[3] + ha_ns::GFF_CMD_SIZE
                     + ha_ns::GFF_LEN_SIZE + 3;      //plus 3 bytes of header
         }
     }
-    usart_queue.add_data((uint8_t*) msg->value.data, msg->value.len);
+    /* detach message header (first 3 bytes of first message), this ISR is the only
+     * producer of usart_queue and MUST not get data from it */
+    if (1 == numOfMsg) {
+        usart_queue.add_data((uint8_t*) &msg->value.data[ha_ble_ns::ble_msg_header_len],
+                msg->value.len - ha_ble_ns::ble_msg_header_len);
+    } else {
+        usart_queue.add_data((uint8_t*) msg->value.data, msg->value.len);
+    }
 
     /* Consider if received data payload as its length */
     if (totalMsgLen == msgLen) {
         HA_DEBUG(" end of packet \n");
         numOfMsg = 0;
         totalMsgLen = 0;
-        /* detach message header */
-        for (uint8_t i = 0; i < 3; i++) {
-            usart_queue.get_data();
-        }
         /* send message to ble_thread */
         msg_ble_thread.type = ha_cc_ns::BLE_CLIENT_WRITE;
         msg_ble_thread.content.ptr = (char*) (&usart_queue);
@@ -17,6 +17,16 @@
 #define ATT_WRITE_ADDR    	(0x08)
 #define ATT_WACK_ADDR       (0x0F)
 
+/*
+ * CC -> Mobile: | BLE_MSG_DATA (1) | packet index (2) | GFF frame | GFF frame | ... |
+ *   up to ble_tx_window packets are in flight, small GFF frames are packed in one
+ *   ATT write up to ble_att_max_len.
+ * Mobile -> CC: | BLE_MSG_ACK (1) | packet index (2) |
+ *   cumulative ACK, all packets up to packet index have been received in order.
+ *   Mobile should drop a packet which is not the next one in order, CC will send
+ *   all packets in flight again (go-back-N) after ble_ack_timeout_ms.
+ */
+
 namespace ha_ble_ns {
 
 enum ble_msg_type_id
@@ -33,6 +43,12 @@ const gpio_ns::gpio_params_t ble_reset_pin_param = {
 };
 
 extern gpio ble_reset_pin;
+
+const uint8_t ble_msg_header_len = 3;
+const uint8_t ble_tx_window = 4;
+const uint8_t ble_att_max_len = 64;
+const uint16_t ble_ack_timeout_ms = 300;
+const uint8_t ble_max_retries = 5;
 }
 
 namespace ble_thread_ns {
@@ -43,11 +59,6 @@ extern cir_queue controller_to_ble_msg_queue;
 
 extern volatile uint16_t ble_ack_timeout_count;
 
-struct ble_ack_s {
-    bool need_to_wait_ack = false;
-    uint16_t packet_index = 0;
-};
-
 /* initial usart3 interrupt */
 void USART3_RxInit(void);
 
@@ -16,6 +16,7 @@ extern "C" {
 #include "thread.h"
 #include "msg.h"
 #include "vtimer.h"
+#include "irq.h"
 }
 
 #include "ha_gff_misc.h"
@@ -27,6 +28,7 @@ extern "C" {
 #include <string.h>
 #include "ble_transaction.h"
 #include "gff_mesg_id.h"
+#include "frame_window.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
@@ -36,9 +38,6 @@ extern "C" {
  * Variables and buffers
  ******************************************************************************/
 
-/* data structure to process ACK from Mobile */
-ble_ack_s ble_ack;
-
 /* ble message queue */
 static const uint16_t ble_message_queue_size = 128;
 static msg_t ble_message_queue[ble_message_queue_size];
@@ -69,6 +68,17 @@ cir_queue controller_to_ble_msg_queue(controller_to_ble_msg_queue_buf,
 // timer 6 timeout
 volatile uint16_t ble_ack_timeout_count = 0;
 
+/* sliding window for sending GFF frames in controller_to_ble_msg_queue to Mobile */
+static void ble_write_packet(uint16_t index, uint8_t *packet, uint16_t frames_len);
+
+static uint16_t ble_packet_sizes[ha_ble_ns::ble_tx_window];
+static uint8_t ble_packet_buf[ha_ble_ns::ble_msg_header_len + ha_ns::GFF_MAX_FRAME_SIZE];
+static frame_window ble_tx_window(&ble_thread_ns::controller_to_ble_msg_queue,
+        ble_packet_sizes, ha_ble_ns::ble_tx_window,
+        ble_packet_buf, ha_ble_ns::ble_att_max_len, ha_ble_ns::ble_msg_header_len,
+        ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE, ha_ble_ns::ble_max_retries,
+        ble_write_packet);
+
 /*******************************************************************************
  * Private functions declare
  ******************************************************************************/
@@ -78,25 +88,42 @@ volatile uint16_t ble_ack_timeout_count = 0;
  */
 static void ble_write_att(uint16_t handle, uint8_t *dataBuf, uint8_t len);
 /**
- * @brief:  process message from controller
+ * @brief:  send messages from controller while window is not full
+ */
+static void receive_msg_from_controller(bool mMoblieConnected);
+
+/**
+ * @brief:  process ACK from Mobile
+ */
+static void receive_ack_from_mobile(uint16_t ackIndex, bool mMoblieConnected);
+
+/**
+ * @brief:  ACK timeout, send packets in flight again
  */
-static void receive_msg_from_controller(cir_queue* mCirQueue, uint16_t msgIndex,
-bool mMoblieConnected);
+static void ack_timeout(bool mMoblieConnected);
 
 /**
- * @brief: thread wait ack from Mobile
+ * @brief: (re)start or stop ACK timer as packets are in flight
  */
-void wait_mobile_ack(uint16_t mSec);
+static void set_ack_timer(void);
+
+/**
+ * @brief:  tell controller whether Mobile wants device changes (is connected)
+ */
+static void subscribe_to_controller(bool subscribed);
 /*******************************************************************************
  * Public functions
  ******************************************************************************/
 
 void ble_timeout_TIM6_ISR(void)
 {
+    msg_t msg;
+
     if (ble_ack_timeout_count > 0) {
         ble_ack_timeout_count--;
         if (ble_ack_timeout_count == 0) {
-            thread_wakeup(ble_thread_ns::ble_thread_pid);
+            msg.type = ha_cc_ns::BLE_ACK_TIMEOUT;
+            msg_send_int(&msg, ble_thread_ns::ble_thread_pid);
         }
     }
 }
@@ -155,9 +182,14 @@ void *ble_transaction(void *arg)
             break;
         case ha_cc_ns::BLE_CLIENT_CONNECT:
             mConnect = true;
+            subscribe_to_controller(true);
             break;
         case ha_cc_ns::BLE_CLIENT_DISCONNECT:
             mConnect = false;
+            subscribe_to_controller(false);
+            /* drop frames in flight and in queue as when Mobile isn't connected */
+            ble_tx_window.reset(true);
+            set_ack_timer();
             ble_cmd_gap_set_mode(gap_general_discoverable,
                     gap_undirected_connectable);
             break;
@@ -200,8 +232,19 @@ void *ble_transaction(void *arg)
             break;
         case ha_ns::GFF_PENDING:
             // Get message from thread Controller, and send to Mobile
-            receive_msg_from_controller((cir_queue *) msg.content.ptr,
-                    ble_ack.packet_index, mConnect);
+            receive_msg_from_controller(mConnect);
+            break;
+        case ha_cc_ns::BLE_MOBILE_ACK:
+            receive_ack_from_mobile((uint16_t) msg.content.value, mConnect);
+            break;
+        case ha_cc_ns::BLE_MOBILE_RESET:
+            HA_DEBUG("--- mobile reset ---\n");
+            /* Mobile has given up packets in flight, continue with new ones */
+            ble_tx_window.reset(false);
+            receive_msg_from_controller(mConnect);
+            break;
+        case ha_cc_ns::BLE_ACK_TIMEOUT:
+            ack_timeout(mConnect);
             break;
         default:
             HA_DEBUG("error\n");
@@ -213,53 +256,100 @@ void *ble_transaction(void *arg)
 }
 
 /**
- * @brief: Receive message from controller thread
+ * @brief: Receive messages from controller thread and send them to Mobile
  */
-void receive_msg_from_controller(cir_queue* mCirQueue, uint16_t msgIndex,
-bool mMoblieConnected)
+void receive_msg_from_controller(bool mMoblieConnected)
 {
-    uint8_t bufLen = mCirQueue->preview_data(false) + ha_ns::GFF_CMD_SIZE
-            + ha_ns::GFF_LEN_SIZE;
-    uint8_t dataBuf[ha_ns::GFF_MAX_FRAME_SIZE];
-
-    uint8_t indexBuf[2];
-    int32_t qBufSize;
-
-    uint162buf(msgIndex, indexBuf);
-    qBufSize = mCirQueue->get_size();
-    HA_DEBUG("len = %d\n", bufLen);HA_DEBUG("qsize = %d\n", qBufSize);
-    if (bufLen <= qBufSize) {
-        mCirQueue->get_data(dataBuf, bufLen);
-        // add header(msg type + index) to message
-        add_hdr_to_ble_msg(ha_ble_ns::BLE_MSG_DATA, indexBuf, dataBuf, bufLen);
-        if (mMoblieConnected) {
-            HA_DEBUG("packet index START\n");
-            ble_write_att(ATT_WRITE_ADDR, dataBuf, bufLen + 3);
-            // sleep to wait ack from mobile
-            if (bufLen >= 27) {
-                wait_mobile_ack(400); // 150ms
-            } else {
-                wait_mobile_ack(300);
-            }
-            ble_ack.packet_index++;
-            ble_ack.need_to_wait_ack = false;
-            HA_DEBUG("packet index END\n");
+    unsigned irq_state;
+
+    if (!mMoblieConnected) {
+        /* nobody to send to */
+        ble_tx_window.reset(true);
+        return;
+    }
+
+    if (ble_tx_window.send() > 0) {
+        HA_DEBUG("in flight %d, next index %d\n", ble_tx_window.get_in_flight(),
+                ble_tx_window.get_next_index());
+        /* TIM6 ISR also decrements the counter */
+        irq_state = disableIRQ();
+        if (ble_ack_timeout_count == 0) {
+            ble_ack_timeout_count = ha_ble_ns::ble_ack_timeout_ms;
         }
+        restoreIRQ(irq_state);
+    }
+}
 
-    } else {
-        HA_DEBUG("Frame error\n");
+/**
+ * @brief: Process cumulative ACK from Mobile
+ */
+void receive_ack_from_mobile(uint16_t ackIndex, bool mMoblieConnected)
+{
+    if (ble_tx_window.ack(ackIndex) < 0) {
+        HA_DEBUG("unexpected ACK %d\n", ackIndex);
+        return;
     }
 
+    set_ack_timer();
+
+    /* window has been opened */
+    receive_msg_from_controller(mMoblieConnected);
+}
+
+/**
+ * @brief: ACK timeout, send packets in flight again (go-back-N)
+ */
+void ack_timeout(bool mMoblieConnected)
+{
+    /* stale timeout, timer has been restarted or all packets have been acked */
+    if (ble_ack_timeout_count != 0 || ble_tx_window.get_in_flight() == 0) {
+        return;
+    }
+
+    if (ble_tx_window.resend() < 0) {
+        HA_NOTIFY("ble: Mobile doesn't respond, packets dropped\n");
+    }
+
+    set_ack_timer();
+    receive_msg_from_controller(mMoblieConnected);
+}
+
+/**
+ * @brief: (re)start or stop ACK timer as packets are in flight
+ */
+void set_ack_timer(void)
+{
+    unsigned irq_state;
+    uint16_t count;
+
+    count = (ble_tx_window.get_in_flight() > 0) ? ha_ble_ns::ble_ack_timeout_ms : 0;
+
+    /* TIM6 ISR also decrements the counter */
+    irq_state = disableIRQ();
+    ble_ack_timeout_count = count;
+    restoreIRQ(irq_state);
 }
 
 /**
- * @brief: thread wait ack from Mobile
+ * @brief: Controller sends changed devices only while Mobile is subscribed
  */
-void wait_mobile_ack(uint16_t mSec)
+void subscribe_to_controller(bool subscribed)
 {
-    ble_ack_timeout_count = mSec;
-    ble_ack.need_to_wait_ack = true;
-    thread_sleep();
+    msg_t msg;
+
+    msg.type = subscribed ? ha_cc_ns::BLE_SUBSCRIBE : ha_cc_ns::BLE_UNSUBSCRIBE;
+    msg_send(&msg, controller_ns::controller_pid, false);
+}
+
+/**
+ * @brief: Add header to a packet and write it to Mobile
+ */
+void ble_write_packet(uint16_t index, uint8_t *packet, uint16_t frames_len)
+{
+    packet[0] = ha_ble_ns::BLE_MSG_DATA;
+    uint162buf(index, &packet[1]);
+
+    ble_write_att(ATT_WRITE_ADDR, packet, frames_len + ha_ble_ns::ble_msg_header_len);
 }
 
 /**
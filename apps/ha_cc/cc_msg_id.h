@@ -19,6 +19,7 @@ enum cc_msg_id: uint16_t {
     ONE_SEC_INTERRUPT,
     NEW_SCENE_TIMEOUT,
     NEW_SCENE_SET_RULE_TIMEOUT,
+    BLE_DIRTY_FLUSH,
 
     /* BLE message */
     BLE_USART_REC,
@@ -26,6 +27,15 @@ enum cc_msg_id: uint16_t {
     BLE_CLIENT_CONNECT,
     BLE_CLIENT_DISCONNECT,
     BLE_CLIENT_WRITE,
+    BLE_MOBILE_ACK,
+    BLE_MOBILE_RESET,
+    BLE_ACK_TIMEOUT,
+    BLE_SUBSCRIBE,
+    BLE_UNSUBSCRIBE,
+
+    /* Storage message */
+    STORAGE_PENDING,
+    STORAGE_CALL,
 };
 
 }
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        action_batch.cpp
+ * @brief       Output stage of scenes.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+extern "C" {
+#include "msg.h"
+}
+
+#include "action_batch.h"
+#include "gff_mesg_id.h"
+#include "common_msg_id.h"
+#include "ha_gff_misc.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace action_batch_ns;
+
+static const uint16_t max_frame_size = ha_ns::GFF_LEN_SIZE + ha_ns::GFF_CMD_SIZE
+        + ha_ns::SET_DEV_MULT_VALS_HEADER_LEN
+        + ha_ns::SET_DEV_MULT_VALS_MAX_RECORDS * ha_ns::SET_DEV_MULT_VALS_RECORD_LEN;
+
+/* group commands are sent first, they are not delayed by windows of nodes */
+static uint32_t node_sort_key(uint32_t device_id)
+{
+    uint16_t node_id = parse_node_deviceid(device_id);
+
+    return is_group_nodeid(node_id) ? node_id : (0x10000 | node_id);
+}
+
+/*----------------------------------------------------------------------------*/
+action_batch::action_batch(action_t *actions, uint16_t max_actions,
+        cir_queue *out_queue, kernel_pid_t *out_pid)
+{
+    this->actions = actions;
+    this->max_actions = max_actions;
+    this->out_queue = out_queue;
+    this->out_pid = out_pid;
+    num_actions = 0;
+    cur_prio = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void action_batch::add(uint32_t device_id, int16_t value)
+{
+    uint16_t count;
+
+    /* conflict, higher priority or last writer wins */
+    for (count = 0; count < num_actions; count++) {
+        if (actions[count].device_id == device_id) {
+            if (cur_prio >= actions[count].prio) {
+                HA_DEBUG("action_batch::add: dev %lx, %hd overrides %hd\n",
+                        device_id, value, actions[count].value);
+                actions[count].value = value;
+                actions[count].prio = cur_prio;
+            }
+            return;
+        }
+    }
+
+    if (num_actions == max_actions) {
+        HA_DEBUG("action_batch::add: batch is full, flush\n");
+        flush();
+    }
+
+    actions[num_actions].device_id = device_id;
+    actions[num_actions].value = value;
+    actions[num_actions].prio = cur_prio;
+    num_actions++;
+}
+
+/*----------------------------------------------------------------------------*/
+void action_batch::flush(void)
+{
+    uint8_t act_gff[max_frame_size];
+    uint16_t count, num_records, frame_size, num_frames = 0;
+    uint16_t node_id;
+    msg_t mesg;
+
+    if (num_actions == 0) {
+        return;
+    }
+
+    sort_by_node();
+
+    count = 0;
+    while (count < num_actions) {
+        /* actions to the same node */
+        node_id = parse_node_deviceid(actions[count].device_id);
+        num_records = 1;
+        while ((count + num_records < num_actions) &&
+                (num_records < ha_ns::SET_DEV_MULT_VALS_MAX_RECORDS) &&
+                (parse_node_deviceid(actions[count + num_records].device_id) == node_id)) {
+            num_records++;
+        }
+
+        /* pack gff frame, SET_DEV_VAL if there is only one action */
+        if (num_records == 1) {
+            act_gff[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_VAL_DATA_LEN;
+            uint162buf(ha_ns::SET_DEV_VAL, &act_gff[ha_ns::GFF_CMD_POS]);
+            uint322buf(actions[count].device_id, &act_gff[ha_ns::GFF_DATA_POS]);
+            uint162buf((uint16_t)actions[count].value, &act_gff[ha_ns::GFF_DATA_POS + 4]);
+        }
+        else {
+            act_gff[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_MULT_VALS_HEADER_LEN
+                    + num_records * ha_ns::SET_DEV_MULT_VALS_RECORD_LEN;
+            uint162buf(ha_ns::SET_DEV_MULT_VALS, &act_gff[ha_ns::GFF_CMD_POS]);
+            act_gff[ha_ns::GFF_DATA_POS] = num_records;
+            for (uint16_t c_rec = 0; c_rec < num_records; c_rec++) {
+                uint8_t *record = &act_gff[ha_ns::GFF_DATA_POS
+                        + ha_ns::SET_DEV_MULT_VALS_HEADER_LEN
+                        + c_rec * ha_ns::SET_DEV_MULT_VALS_RECORD_LEN];
+                uint322buf(actions[count + c_rec].device_id, record);
+                uint162buf((uint16_t)actions[count + c_rec].value, record + 4);
+            }
+        }
+        frame_size = act_gff[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE;
+
+        if (out_queue->get_free() < frame_size) {
+            HA_NOTIFY("action_batch::flush: queue is full, %hu actions dropped\n",
+                    num_actions - count);
+            break;
+        }
+        out_queue->add_data(act_gff, frame_size);
+        num_frames++;
+
+        HA_DEBUG("action_batch::flush: %hu actions to node %hu\n", num_records, node_id);
+        count += num_records;
+    }
+
+    num_actions = 0;
+
+    /* one GFF pending message for the whole batch */
+    if (num_frames > 0) {
+        mesg.type = ha_ns::GFF_PENDING;
+        mesg.content.ptr = (char *)out_queue;
+        msg_send(&mesg, *out_pid, false);
+    }
+}
+
+/*------------------------ Private methods -----------------------------------*/
+void action_batch::sort_by_node(void)
+{
+    uint16_t count, pos;
+    uint32_t key;
+    action_t action;
+
+    /* insertion sort (stable), batch is small */
+    for (count = 1; count < num_actions; count++) {
+        action = actions[count];
+        key = node_sort_key(action.device_id);
+        pos = count;
+        while (pos > 0 && node_sort_key(actions[pos - 1].device_id) > key) {
+            actions[pos] = actions[pos - 1];
+            pos--;
+        }
+        actions[pos] = action;
+    }
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        action_batch.h
+ * @brief       Output stage of scenes.
+ *              Actions produced by rules in one pass of scene processing are collected
+ *              here. When several rules set the same device, the action with the highest
+ *              priority wins (the last one when priorities are equal). On flush, actions
+ *              are grouped by destination node, actions to one node are written to 6LoWPAN
+ *              sender queue as one SET_DEV_MULT_VALS frame (SET_DEV_VAL if there is only
+ *              one), and only one GFF_PENDING message is sent. Actions to a group address
+ *              (see device_id.h) are grouped the same way and written first.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef ACTION_BATCH_H_
+#define ACTION_BATCH_H_
+
+#include <stdint.h>
+
+extern "C" {
+#include "thread.h"
+}
+
+#include "cir_queue.h"
+
+namespace action_batch_ns {
+
+typedef struct action_s {
+    uint32_t device_id;
+    int16_t value;
+    uint8_t prio;
+} action_t;
+
+}
+
+class action_batch {
+public:
+    /**
+     * @brief   constructor, user must allocate buffer for actions.
+     *
+     * @param[in]   actions, buffer of actions.
+     * @param[in]   max_actions, number of actions in the buffer.
+     * @param[in]   out_queue, actions (SET_DEV_VAL GFF frames) will be pushed to this queue.
+     * @param[in]   out_pid, pointer to pid of thread GFF_PENDING message will be sent to.
+     */
+    action_batch(action_batch_ns::action_t *actions, uint16_t max_actions,
+            cir_queue *out_queue, kernel_pid_t *out_pid);
+
+    /**
+     * @brief   Set priority of actions added after this call (e.g. priority of the scene
+     *          being processed).
+     */
+    void set_priority(uint8_t prio) { cur_prio = prio; }
+
+    /**
+     * @brief   Add a SET_DEV_VAL action. Batch is flushed first if it's full.
+     *
+     * @param[in]   device_id,
+     * @param[in]   value,
+     */
+    void add(uint32_t device_id, int16_t value);
+
+    /**
+     * @brief   Push all actions to out_queue, one frame for each node, and send one
+     *          GFF_PENDING message, batch is empty after that.
+     */
+    void flush(void);
+
+    /**
+     * @brief   Get number of actions in batch.
+     */
+    uint16_t get_size(void) { return num_actions; }
+
+private:
+    /**
+     * @brief   Sort actions by node id (group addresses first), actions to the same node
+     *          keep their order.
+     */
+    void sort_by_node(void);
+
+    action_batch_ns::action_t *actions;
+    uint16_t max_actions;
+    uint16_t num_actions;
+    uint8_t cur_prio;
+
+    cir_queue *out_queue;
+    kernel_pid_t *out_pid;
+};
+
+#endif // ACTION_BATCH_H_
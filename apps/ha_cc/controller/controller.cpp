@@ -32,6 +32,7 @@ extern "C" {
 #include "MB1_System.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
+#include "crc16.h"
 
 /*----------------------------- Configurations -------------------------------*/
 #define HA_NOTIFICATION (1)
@@ -58,9 +59,21 @@ static void *controller_func(void *arg);
 /* Device management */
 static const uint16_t controller_max_num_of_devs = 64;
 static ha_device controller_devs_buffer[controller_max_num_of_devs];
+static const uint16_t controller_devs_index_size = 2 * controller_max_num_of_devs; /* power of 2 */
+static id_hash_index_ns::entry_t controller_devs_index_buffer[controller_devs_index_size];
+static timer_wheel_ns::node_t controller_devs_ttl_buffer[controller_max_num_of_devs];
+static uint32_t controller_devs_dirty_buffer[ha_device_mng_ns::NUM_DIRTY_SETS *
+                                            ((controller_max_num_of_devs + 31) / 32)];
+static uint8_t controller_devs_journal_buffer[128];
+static const uint32_t controller_devs_journal_compact_size = 4096; /* in bytes */
+static journal controller_devs_journal(controller_devs_journal_buffer,
+        sizeof(controller_devs_journal_buffer), controller_devs_journal_compact_size, "dev_jnl");
 static const char controller_dev_list_filename[] = "dev_lst";
 static ha_device_mng controller_dev_mng(controller_devs_buffer,
-        controller_max_num_of_devs, controller_dev_list_filename);
+        controller_max_num_of_devs,
+        controller_devs_index_buffer, controller_devs_index_size,
+        controller_devs_ttl_buffer, controller_devs_dirty_buffer,
+        &controller_devs_journal, controller_dev_list_filename);
 
 /* Time to live for every ALIVE messages */
 static const int16_t alive_ttl = 300; /* in second */
@@ -68,9 +81,28 @@ static const int16_t alive_ttl = 300; /* in second */
 /* Time period to save device data */
 static const uint8_t dev_list_save_period = 30; /* in seconds */
 
-/* Scene management */
+/* Scene management, rules of all scenes are in one pool */
+static const uint16_t controller_rule_pool_size = 2 * scene_ns::scene_max_rules;
+static scene_ns::rule_t controller_rules_buffer[controller_rule_pool_size];
+static scene_ns::dev_rule_t controller_dev_rules_buffer[controller_rule_pool_size *
+                                                        scene_ns::rule_max_input];
+static uint16_t controller_time_rules_buffer[controller_rule_pool_size];
+static rule_pool_ns::span_t controller_rule_spans_buffer[scene_mng_ns::max_num_scenes];
+static rule_pool controller_rule_pool(controller_rules_buffer, controller_dev_rules_buffer,
+        controller_time_rules_buffer, controller_rule_pool_size,
+        controller_rule_spans_buffer, scene_mng_ns::max_num_scenes);
+/* at most one entry for each rule in pool */
+static time_sched_ns::entry_t controller_time_sched_buffer[controller_rule_pool_size];
+static time_sched controller_time_sched(controller_time_sched_buffer,
+        controller_rule_pool_size);
+/* actions of one pass of scene processing, at most one for each device */
+static const uint16_t controller_action_batch_size = 64;
+static action_batch_ns::action_t controller_action_batch_buffer[controller_action_batch_size];
+static action_batch controller_action_batch(controller_action_batch_buffer,
+        controller_action_batch_size,
+        &ha_ns::sixlowpan_sender_gff_queue, &ha_ns::sixlowpan_sender_pid);
 static scene_mng controller_scene_mng(&controller_dev_mng, &MB1_rtc,
-        &ha_ns::sixlowpan_sender_pid, &ha_ns::sixlowpan_sender_gff_queue);
+        &controller_action_batch, &controller_rule_pool, &controller_time_sched);
 
 /* State and timeout counter when getting new scene from ble */
 static bool new_scene_state = false;
@@ -88,6 +120,17 @@ static uint8_t new_scene_set_rule_resend_max_count = 1;
 /* Zone management */
 static zone controller_zone_mng;
 
+/* Changed devices are sent to BLE only when Mobile is subscribed (connected),
+ * changes of a device in a flush window are coalesced into its last value */
+static bool ble_subscribed = false;
+static const uint16_t ble_dirty_flush_window_ms = 200;
+static volatile uint16_t ble_dirty_flush_count = 0;
+
+/* Snapshots, a chunk fits one BLE packet */
+static const uint8_t snapshot_max_data_len = ha_ble_ns::ble_att_max_len
+        - ha_ble_ns::ble_msg_header_len - ha_ns::GFF_CMD_SIZE - ha_ns::GFF_LEN_SIZE;
+static uint16_t snapshot_boot_stamp; /* versions from different boots won't match */
+
 /*----------------------------- Controller namespace -------------------------*/
 
 namespace controller_ns {
@@ -95,7 +138,7 @@ namespace controller_ns {
 kernel_pid_t controller_pid;
 
 /* Data Cir_queues */
-cir_queue slp_to_controller_queue(slp_to_controller_queue_buffer,
+frame_ring slp_to_controller_queue(slp_to_controller_queue_buffer,
         slp_to_controller_queue_size);
 cir_queue ble_to_controller_queue(ble_to_controller_queue_buffer,
         ble_to_controller_queue_size);
@@ -123,27 +166,36 @@ void controller_start(void)
 
 /*----------------------------- Static functions -----------------------------*/
 /* Prototypes */
-static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
+static void slp_gff_handler(ha_device_mng *dev_mng,
         scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
         cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
+        kernel_pid_t to_slp_pid, frame_ring *from_slp_queue,
         cir_queue *to_slp_queue);
 
+static void slp_gff_process(uint8_t *gff_frame, ha_device_mng *dev_mng,
+        scene_mng *scene_mng_p);
+
 static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
         cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
+        kernel_pid_t to_slp_pid, frame_ring *from_slp_queue,
         cir_queue *to_slp_queue);
 
 static void save_dev_list_with_1sec(uint8_t save_period,
         ha_device_mng *dev_mng);
 
+static void dev_ttl_with_1sec(ha_device_mng *dev_mng, scene_mng *scene_mng_p,
+        kernel_pid_t to_ble_pid, cir_queue *to_ble_queue);
+
 static void process_scene_with_1sec(rtc_ns::time_t &cur_time,
         scene_mng *scene_mng_p);
 
 static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
         kernel_pid_t ble_pid, cir_queue *to_ble_queue);
 
+static void set_act_scene_name_with_index_to_ble(uint8_t index,
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+
 static void set_inact_scene_name_with_index_to_ble(uint8_t index,
         scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
 
@@ -158,14 +210,38 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
 
 static void new_scene_set_rule_1msTIM_ISR(void);
 
+static void ble_dirty_flush_1msTIM_ISR(void);
+
+static void ble_dirty_flush(ha_device_mng *dev_mng,
+        kernel_pid_t to_ble_pid, cir_queue *to_ble_queue);
+
 static void set_zone_name_to_ble(uint8_t index,
         zone *zone_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
 
+static void pack_rule(uint8_t *buf, uint16_t index, scene_ns::rule_t &a_rule);
+
+static uint32_t snapshot_version(uint32_t counter);
+
+static void set_snapshot_chunk_to_ble(uint8_t *gff_frame, uint16_t cmd_id, uint32_t version,
+        uint8_t chunk_index, uint8_t num_of_chunks, uint8_t data_len,
+        kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+
+static void set_dev_snapshot_to_ble(uint32_t known_version, uint8_t first_chunk,
+        ha_device_mng *dev_mng, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+
+static void set_scene_snapshot_to_ble(char *scene_name, uint32_t known_version,
+        uint8_t first_chunk, scene_mng *scene_mng_p, kernel_pid_t ble_pid,
+        cir_queue *to_ble_queue);
+
+static void set_scene_dir_snapshot_to_ble(uint32_t known_version, uint8_t first_chunk,
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue);
+
 /* Functions */
 static void *controller_func(void *)
 {
     msg_t mesg;
     uint8_t gff_frame[ha_ns::GFF_MAX_FRAME_SIZE];
+    rtc_ns::time_t boot_time;
 
     /* Init message queue */
     msg_init_queue(controller_message_queue, controller_message_queue_size);
@@ -179,10 +255,19 @@ static void *controller_func(void *)
         HA_DEBUG("controller_func: added new_scene_set_rule_1msTIM_ISR to TIM6 int\n");
     }
 
+    /* Assign ble_dirty_flush_1msTIM_ISR to TIM6 */
+    if (MB1_ISRs.subISR_assign(ISRMgr_ns::ISRMgr_TIM6, ble_dirty_flush_1msTIM_ISR) !=
+            ISRMgr_ns::successful) {
+        HA_DEBUG("controller_func: failed to add ble_dirty_flush_1msTIM_ISR to TIM6 int\n");
+    }
+
     /* restore old data */
     controller_dev_mng.restore();
     controller_scene_mng.restore();
 
+    MB1_rtc.get_time(boot_time);
+    snapshot_boot_stamp = (uint16_t) MB1_rtc.time_to_packed(boot_time);
+
     /* Wait for message */
     while (1) {
         msg_receive(&mesg);
@@ -190,10 +275,10 @@ static void *controller_func(void *)
         switch (mesg.type) {
         case ha_cc_ns::SLP_GFF_PENDING:
             HA_DEBUG("controller: SLP_GFF_PENDING\n");
-            slp_gff_handler(gff_frame, &controller_dev_mng,
+            slp_gff_handler(&controller_dev_mng,
                     &controller_scene_mng, ble_thread_ns::ble_thread_pid,
                     NULL, &ble_thread_ns::controller_to_ble_msg_queue,
-                    ha_ns::sixlowpan_sender_pid, (cir_queue *) mesg.content.ptr,
+                    ha_ns::sixlowpan_sender_pid, (frame_ring *) mesg.content.ptr,
                     &ha_ns::sixlowpan_sender_gff_queue);
             break;
 
@@ -210,7 +295,9 @@ static void *controller_func(void *)
         case ha_cc_ns::ONE_SEC_INTERRUPT:
             rtc_ns::time_t cur_time;
             MB1_rtc.get_time(cur_time);
-            controller_dev_mng.dec_all_devs_ttl();
+            dev_ttl_with_1sec(&controller_dev_mng, &controller_scene_mng,
+                    ble_thread_ns::ble_thread_pid,
+                    &ble_thread_ns::controller_to_ble_msg_queue);
             save_dev_list_with_1sec(dev_list_save_period, &controller_dev_mng);
             process_scene_with_1sec(cur_time, &controller_scene_mng);
             new_scene_check_timeout_with_1sec(new_scene_timeout_max_counter,
@@ -226,6 +313,24 @@ static void *controller_func(void *)
                     &ble_thread_ns::controller_to_ble_msg_queue);
             break;
 
+        case ha_cc_ns::BLE_SUBSCRIBE:
+            HA_DEBUG("controller: BLE_SUBSCRIBE\n");
+            /* Mobile gets current values with GET_DEV_SNAPSHOT on connect */
+            controller_dev_mng.clear_dirty_devices(ha_device_mng_ns::DIRTY_BLE);
+            ble_subscribed = true;
+            break;
+
+        case ha_cc_ns::BLE_UNSUBSCRIBE:
+            HA_DEBUG("controller: BLE_UNSUBSCRIBE\n");
+            ble_subscribed = false;
+            ble_dirty_flush_count = 0;
+            break;
+
+        case ha_cc_ns::BLE_DIRTY_FLUSH:
+            ble_dirty_flush(&controller_dev_mng, ble_thread_ns::ble_thread_pid,
+                    &ble_thread_ns::controller_to_ble_msg_queue);
+            break;
+
         default:
             HA_DEBUG("controller: Unknown message %d\n", mesg.type);
             break;
@@ -236,33 +341,40 @@ static void *controller_func(void *)
 }
 
 /*----------------------------------------------------------------------------*/
-static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
+static void slp_gff_handler(ha_device_mng *dev_mng,
         scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
         cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
+        kernel_pid_t to_slp_pid, frame_ring *from_slp_queue,
         cir_queue *to_slp_queue)
 {
-    uint8_t data_len;
+    uint8_t *gff_frame;
+    uint16_t frame_len;
+
+    /* frames are parsed in place, one message may stand for several frames */
+    while ((gff_frame = from_slp_queue->peek(frame_len)) != NULL) {
+        if (frame_len < ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE
+                || frame_len != gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
+                        + ha_ns::GFF_LEN_SIZE) {
+            HA_DEBUG("slp_gff_handler: Err, frame len %hu doesn't match data len\n",
+                    frame_len);
+            from_slp_queue->release();
+            continue;
+        }
+
+        slp_gff_process(gff_frame, dev_mng, scene_mng_p);
+        from_slp_queue->release();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void slp_gff_process(uint8_t *gff_frame, ha_device_mng *dev_mng,
+        scene_mng *scene_mng_p)
+{
     uint16_t cmd_id;
     uint32_t device_id;
     int16_t value, old_value;
-    msg_t mesg;
     ha_device device_rpt;
 
-    /* Check data */
-    data_len = from_slp_queue->preview_data(false);
-    if ((data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE)
-            > from_slp_queue->get_size()) {
-        HA_DEBUG(
-                "slp_gff_handler: Err, data len %hu + cmd_size + len_size != queue_size %ld\n",
-                data_len, from_slp_queue->get_size());
-        return;
-    }
-
-    /* Get data from queue */
-    from_slp_queue->get_data(gff_frame,
-            data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-
     /* parse GFF frame */
     cmd_id = buf2uint16(&gff_frame[ha_ns::GFF_CMD_POS]);
 
@@ -287,14 +399,12 @@ static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         dev_mng->set_dev_val(device_id, value);
         dev_mng->set_dev_ttl(device_id, alive_ttl);
 
-        /* forward to BLE */
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char *) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
-        HA_DEBUG("slp_gff_handler: SET_DEV_VAL forwarded to ble\n");
+        /* changed device will be sent to BLE at the end of flush window */
+        if (ble_subscribed && ble_dirty_flush_count == 0 &&
+                dev_mng->has_dirty_device(ha_device_mng_ns::DIRTY_BLE)) {
+            ble_dirty_flush_count = ble_dirty_flush_window_ms;
+            HA_DEBUG("slp_gff_handler: BLE flush window started\n");
+        }
 
         break;
 
@@ -315,7 +425,7 @@ static void slp_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
 static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         scene_mng *scene_mng_p, kernel_pid_t to_ble_pid,
         cir_queue *from_ble_queue, cir_queue *to_ble_queue,
-        kernel_pid_t to_slp_pid, cir_queue *from_slp_queue,
+        kernel_pid_t to_slp_pid, frame_ring *from_slp_queue,
         cir_queue *to_slp_queue)
 {
     uint8_t data_len;
@@ -385,7 +495,7 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
                 buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS]),
                 (int16_t )buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 4]));
 
-        /* forward to slp */
+        /* forward to slp, device id can also be a group address (see device_id.h) */
         to_slp_queue->add_data(gff_frame,
                 gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
                         + ha_ns::GFF_LEN_SIZE);
@@ -441,33 +551,23 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
 
         /* Get index */
         index = gff_frame[ha_ns::GFF_DATA_POS];
-        if (index != 0xFF && index != 0x00) {
+        if (index == 0xFF) {
+            /* send all active scene names to ble thread */
+            num_scene = scene_mng_p->get_num_of_active_scenes();
+            for (count = 0; count < num_scene; count++) {
+                set_act_scene_name_with_index_to_ble(scene_mng_p->get_active_scene_index(count),
+                        scene_mng_p, to_ble_pid, to_ble_queue);
+            }
+            break;
+        }
+
+        if (index >= scene_mng_ns::max_num_active_scenes) {
             HA_DEBUG("ble_gff_handler: wrong index for active scene (%hu)\n",
                     index);
             break;
         }
 
-        /* Return active scene name */
-        scene_name[0] = '\0';
-        scene_mng_p->get_active_scene(scene_name);
-
-        /* Send back SET_ACT_SCENE_NAME_WITH_INDEXS */
-        gff_frame[ha_ns::GFF_LEN_POS] =
-                ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN;
-        uint162buf(ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS,
-                &gff_frame[ha_ns::GFF_CMD_POS]);
-        gff_frame[ha_ns::GFF_DATA_POS] = 0;
-        memcpy(&gff_frame[ha_ns::GFF_DATA_POS + 1], scene_name, 8);
-
-        to_ble_queue->add_data(gff_frame,
-                gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
-                        + ha_ns::GFF_LEN_SIZE);
-        mesg.type = ha_ns::GFF_PENDING;
-        mesg.content.ptr = (char*) to_ble_queue;
-        msg_send(&mesg, to_ble_pid, false);
-
-        HA_DEBUG("ble_gff_handler: sent active scene name back to ble (%s)\n",
-                scene_name);
+        set_act_scene_name_with_index_to_ble(index, scene_mng_p, to_ble_pid, to_ble_queue);
         break;
 
     case ha_ns::GET_INACT_SCENE_NAME_WITH_INDEXS:
@@ -585,20 +685,61 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
         break;
 
+    case ha_ns::GET_DEV_SNAPSHOT:
+        HA_DEBUG("ble_gff_handler: GET_DEV_SNAPSHOT\n");
+
+        set_dev_snapshot_to_ble(buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS]),
+                gff_frame[ha_ns::GFF_DATA_POS + 4], dev_mng,
+                to_ble_pid, to_ble_queue);
+        break;
+
+    case ha_ns::GET_SCENE_SNAPSHOT:
+        HA_DEBUG("ble_gff_handler: GET_SCENE_SNAPSHOT\n");
+
+        memcpy(scene_name, &gff_frame[ha_ns::GFF_DATA_POS], 8);
+        scene_name[8] = '\0';
+
+        set_scene_snapshot_to_ble(scene_name, buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS + 8]),
+                gff_frame[ha_ns::GFF_DATA_POS + 12], scene_mng_p,
+                to_ble_pid, to_ble_queue);
+        break;
+
+    case ha_ns::GET_SCENE_DIR_SNAPSHOT:
+        HA_DEBUG("ble_gff_handler: GET_SCENE_DIR_SNAPSHOT\n");
+
+        set_scene_dir_snapshot_to_ble(buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS]),
+                gff_frame[ha_ns::GFF_DATA_POS + 4], scene_mng_p,
+                to_ble_pid, to_ble_queue);
+        break;
+
     case ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS:
         HA_DEBUG("ble_gff_handler: SET_ACT_SCENE_NAME_WITH_INDEXS\n");
 
-        /* don't care index */
+        /* index 0 (or 0xFF) is user scene, others run together with it */
+        index = gff_frame[ha_ns::GFF_DATA_POS];
+        if (index == 0xFF) {
+            index = 0;
+        }
         memcpy(scene_name, &gff_frame[ha_ns::GFF_DATA_POS + 1], 8);
-        scene_name[9] = '\0';
+        scene_name[8] = '\0';
 
         /* set active scene and restore */
-        scene_mng_p->set_active_scene(scene_name);
-        scene_mng_p->set_user_scene(scene_name);
-        scene_mng_p->restore_user_scene();
+        if (scene_mng_p->set_active_scene_with_index(index, scene_name) != 0) {
+            HA_DEBUG("ble_gff_handler: can't set active scene %s with index %hu\n",
+                    scene_name, index);
+        }
+        else if (index == 0) {
+            scene_mng_p->set_user_scene(scene_name);
+            scene_mng_p->restore_user_scene();
+        }
 
         /* feedback to ble */
-        scene_mng_p->get_user_scene(scene_name);
+        if (index == 0) {
+            scene_mng_p->get_user_scene(scene_name);
+        }
+        else {
+            scene_mng_p->get_active_scene_with_index(index, scene_name);
+        }
         memcpy(&gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
         to_ble_queue->add_data(gff_frame,
                 gff_frame[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE
@@ -752,8 +893,11 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         }
 
         /* Set num rules */
-        scene_mng_p->get_user_scene_ptr()->set_cur_num_rules(
-                buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 8]));
+        if (scene_mng_p->get_user_scene_ptr()->set_cur_num_rules(
+                buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 8])) != 0) {
+            HA_DEBUG("ble_gff_handler: no room for %hu rules of scene (%s)\n",
+                    buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 8]), scene_name);
+        }
 
         HA_DEBUG("ble_gff_handler: Set num of rules (%hu) to user scene (%s)\n",
                 buf2uint16(&gff_frame[ha_ns::GFF_DATA_POS + 8]), scene_name);
@@ -816,6 +960,11 @@ static void ble_gff_handler(uint8_t *gff_frame, ha_device_mng *dev_mng,
         a_rule.is_active = gff_frame[ha_ns::GFF_DATA_POS + 10];
         a_rule.inputs[0].cond = gff_frame[ha_ns::GFF_DATA_POS + 11];
         switch(a_rule.inputs[0].cond) {
+        case scene_ns::COND_NONE:
+            /* continuation of ACT_SET_DEV_MULT_VALS */
+            a_rule.num_in = 0;
+            break;
+
         case scene_ns::COND_IN_RANGE:
         case scene_ns::COND_IN_RANGE_EVDAY:
             a_rule.inputs[0].time_range.start = buf2uint32(&gff_frame[ha_ns::GFF_DATA_POS + 12]);
@@ -876,6 +1025,46 @@ static void save_dev_list_with_1sec(uint8_t save_period, ha_device_mng *dev_mng)
 
 }
 
+/*----------------------------------------------------------------------------*/
+static void dev_ttl_with_1sec(ha_device_mng *dev_mng, scene_mng *scene_mng_p,
+        kernel_pid_t to_ble_pid, cir_queue *to_ble_queue)
+{
+    uint8_t dev_expired_gff_frame[ha_ns::DEV_EXPIRED_DATA_LEN
+            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    uint32_t device_id;
+    msg_t mesg;
+
+    dev_mng->ttl_tick();
+
+    /* device expired event, scenes will see it as a missing device from now on */
+    while ((device_id = dev_mng->pop_expired_device()) != ha_device_ns::no_device_id) {
+        HA_DEBUG("dev_ttl_with_1sec: device %lx expired\n", device_id);
+
+        /* rules with COND_EXPIRED on this device */
+        scene_mng_p->process_expired(device_id);
+
+        if (!ble_subscribed) {
+            continue;
+        }
+
+        /* pack GFF */
+        dev_expired_gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::DEV_EXPIRED_DATA_LEN;
+        uint162buf(ha_ns::DEV_EXPIRED, &dev_expired_gff_frame[ha_ns::GFF_CMD_POS]);
+        uint322buf(device_id, &dev_expired_gff_frame[ha_ns::GFF_DATA_POS]);
+
+        /* push data to ble_queue */
+        to_ble_queue->add_data(dev_expired_gff_frame,
+                ha_ns::DEV_EXPIRED_DATA_LEN + ha_ns::GFF_CMD_SIZE
+                        + ha_ns::GFF_LEN_SIZE);
+
+        /* pack and send message to ble */
+        mesg.type = ha_ns::GFF_PENDING;
+        mesg.content.ptr = (char *) to_ble_queue;
+
+        msg_send(&mesg, to_ble_pid, false);
+    }
+}
+
 /*----------------------------------------------------------------------------*/
 void controller_list_devices(int argc, char** argv)
 {
@@ -962,6 +1151,42 @@ static void set_dev_with_index_to_ble(uint32_t index, ha_device_mng *dev_mng,
             index, device_id, value);
 }
 
+/*----------------------------------------------------------------------------*/
+static void set_act_scene_name_with_index_to_ble(uint8_t index,
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+{
+    char scene_name[scene_ns::scene_max_name_chars_wout_folders];
+    msg_t mesg;
+    uint8_t set_act_scene_name_windex_gff_frame[ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN
+            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+
+    if (index == scene_mng_ns::no_active_index) {
+        return;
+    }
+
+    scene_name[0] = '\0';
+    scene_mng_p->get_active_scene_with_index(index, scene_name);
+
+    /* pack gff frame and send to ble */
+    set_act_scene_name_windex_gff_frame[ha_ns::GFF_LEN_POS] =
+            ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS_DATA_LEN;
+    uint162buf(ha_ns::SET_ACT_SCENE_NAME_WITH_INDEXS,
+            &set_act_scene_name_windex_gff_frame[ha_ns::GFF_CMD_POS]);
+    set_act_scene_name_windex_gff_frame[ha_ns::GFF_DATA_POS] = index;
+    memcpy(&set_act_scene_name_windex_gff_frame[ha_ns::GFF_DATA_POS + 1],
+            scene_name, 8);
+
+    to_ble_queue->add_data(set_act_scene_name_windex_gff_frame,
+            set_act_scene_name_windex_gff_frame[ha_ns::GFF_LEN_POS]
+                    + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+    mesg.type = ha_ns::GFF_PENDING;
+    mesg.content.ptr = (char*) to_ble_queue;
+    msg_send(&mesg, ble_pid, false);
+
+    HA_DEBUG("ble_gff_handler: sent active scene name back to ble (%hu, %s)\n",
+            index, scene_name);
+}
+
 /*----------------------------------------------------------------------------*/
 static void set_inact_scene_name_with_index_to_ble(uint8_t index,
         scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
@@ -1025,53 +1250,263 @@ static void set_rule_with_index_to_ble(uint16_t index, char *scene_name,
     set_rule_windex_gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_RULE_WITH_INDEXS_DATA_LEN;
     uint162buf(ha_ns::SET_RULE_WITH_INDEXS, &set_rule_windex_gff_frame[ha_ns::GFF_CMD_POS]);
     memcpy(&set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS], scene_name, 8);
-    uint162buf(index, &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 8]);
-    set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 10] = a_rule.is_active ? 1 : 0;
+    pack_rule(&set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 8], index, a_rule);
+
+    to_ble_queue->add_data(set_rule_windex_gff_frame,
+            set_rule_windex_gff_frame[ha_ns::GFF_LEN_POS]
+                    + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+    mesg.type = ha_ns::GFF_PENDING;
+    mesg.content.ptr = (char*) to_ble_queue;
+    msg_send(&mesg, ble_pid, false);
+
+    HA_DEBUG("ble_gff_handler: sent rule with index (%hu) back to ble\n",
+            index);
+}
+
+/*----------------------------------------------------------------------------*/
+static void pack_rule(uint8_t *buf, uint16_t index, scene_ns::rule_t &a_rule)
+{
+    /* | index (2) | active (1) | cond (1) | input (8) | action (1) | device id (4) | value (2) | */
+    uint162buf(index, &buf[0]);
+    buf[2] = a_rule.is_active ? 1 : 0;
+
+    buf[3] = (a_rule.num_in == 0) ? (uint8_t)scene_ns::COND_NONE : a_rule.inputs[0].cond;
+    memset(&buf[4], 0, 8);
+    switch (buf[3]) {
+    case scene_ns::COND_NONE:
+        break;
 
-    set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 11] = a_rule.inputs[0].cond;
-    switch (a_rule.inputs[0].cond) {
     case scene_ns::COND_IN_RANGE:
     case scene_ns::COND_IN_RANGE_EVDAY:
-        uint322buf(a_rule.inputs[0].time_range.start,
-                &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 12]);
-        uint322buf(a_rule.inputs[0].time_range.end,
-                &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 16]);
+        uint322buf(a_rule.inputs[0].time_range.start, &buf[4]);
+        uint322buf(a_rule.inputs[0].time_range.end, &buf[8]);
         break;
 
     default:
-        uint322buf(a_rule.inputs[0].dev_val.device_id,
-                &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 12]);
-        uint162buf(a_rule.inputs[0].dev_val.value,
-                &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 16]);
+        uint322buf(a_rule.inputs[0].dev_val.device_id, &buf[4]);
+        uint162buf(a_rule.inputs[0].dev_val.value, &buf[8]);
         break;
     };
 
-    set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 20] = a_rule.outputs[0].action;
-    uint322buf(a_rule.outputs[0].dev_val.device_id,
-            &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 21]);
-    uint162buf(a_rule.outputs[0].dev_val.value,
-            &set_rule_windex_gff_frame[ha_ns::GFF_DATA_POS + 25]);
+    buf[12] = a_rule.outputs[0].action;
+    uint322buf(a_rule.outputs[0].dev_val.device_id, &buf[13]);
+    uint162buf(a_rule.outputs[0].dev_val.value, &buf[17]);
+}
 
-    to_ble_queue->add_data(set_rule_windex_gff_frame,
-            set_rule_windex_gff_frame[ha_ns::GFF_LEN_POS]
-                    + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
+/*----------------------------------------------------------------------------*/
+static uint32_t snapshot_version(uint32_t counter)
+{
+    return ((uint32_t)snapshot_boot_stamp << 16) | (counter & 0xFFFF);
+}
+
+/*----------------------------------------------------------------------------*/
+static void set_snapshot_chunk_to_ble(uint8_t *gff_frame, uint16_t cmd_id, uint32_t version,
+        uint8_t chunk_index, uint8_t num_of_chunks, uint8_t data_len,
+        kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+{
+    msg_t mesg;
+
+    /* records (and scene name) have been packed by caller */
+    gff_frame[ha_ns::GFF_LEN_POS] = data_len;
+    uint162buf(cmd_id, &gff_frame[ha_ns::GFF_CMD_POS]);
+    uint322buf(version, &gff_frame[ha_ns::GFF_DATA_POS]);
+    gff_frame[ha_ns::GFF_DATA_POS + 4] = chunk_index;
+    gff_frame[ha_ns::GFF_DATA_POS + 5] = num_of_chunks;
+
+    to_ble_queue->add_data(gff_frame,
+            data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
     mesg.type = ha_ns::GFF_PENDING;
     mesg.content.ptr = (char*) to_ble_queue;
     msg_send(&mesg, ble_pid, false);
 
-    HA_DEBUG("ble_gff_handler: sent rule with index (%hu) back to ble\n",
-            index);
+    HA_DEBUG("set_snapshot_chunk_to_ble: sent %x (%lx, %hu/%hu) to ble\n",
+            cmd_id, version, chunk_index, num_of_chunks);
+}
+
+/*----------------------------------------------------------------------------*/
+static void set_dev_snapshot_to_ble(uint32_t known_version, uint8_t first_chunk,
+        ha_device_mng *dev_mng, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+{
+    const uint8_t records_per_chunk = (snapshot_max_data_len - ha_ns::SNAPSHOT_HEADER_LEN)
+            / ha_ns::DEV_SNAPSHOT_RECORD_LEN;
+    uint8_t gff_frame[snapshot_max_data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    uint8_t chunk_index, num_of_chunks, data_len;
+    uint16_t count, num_of_devs;
+    uint32_t version, device_id;
+    int16_t value;
+
+    version = snapshot_version(dev_mng->get_version());
+    if (version == known_version && first_chunk == 0) {
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_DEV_SNAPSHOT, version, 0,
+                ha_ns::SNAPSHOT_NOT_CHANGED, ha_ns::SNAPSHOT_HEADER_LEN, ble_pid, to_ble_queue);
+        return;
+    }
+
+    /* devices are at index 0 .. num_of_devs - 1 after reordering */
+    dev_mng->reorder();
+    num_of_devs = dev_mng->get_current_numofdev();
+    num_of_chunks = (num_of_devs + records_per_chunk - 1) / records_per_chunk;
+    if (num_of_chunks == 0) {
+        num_of_chunks = 1; /* empty devices table */
+    }
+
+    for (chunk_index = first_chunk; chunk_index < num_of_chunks; chunk_index++) {
+        data_len = ha_ns::SNAPSHOT_HEADER_LEN;
+
+        for (count = chunk_index * records_per_chunk;
+                count < num_of_devs && count < (chunk_index + 1) * records_per_chunk;
+                count++) {
+            dev_mng->get_dev_val_with_index(count, device_id, value);
+            uint322buf(device_id, &gff_frame[ha_ns::GFF_DATA_POS + data_len]);
+            uint162buf((uint16_t) value, &gff_frame[ha_ns::GFF_DATA_POS + data_len + 4]);
+            data_len += ha_ns::DEV_SNAPSHOT_RECORD_LEN;
+        }
+
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_DEV_SNAPSHOT, version, chunk_index,
+                num_of_chunks, data_len, ble_pid, to_ble_queue);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void set_scene_snapshot_to_ble(char *scene_name, uint32_t known_version,
+        uint8_t first_chunk, scene_mng *scene_mng_p, kernel_pid_t ble_pid,
+        cir_queue *to_ble_queue)
+{
+    const uint8_t records_per_chunk = (snapshot_max_data_len - ha_ns::SCENE_SNAPSHOT_HEADER_LEN)
+            / ha_ns::RULE_SNAPSHOT_RECORD_LEN;
+    uint8_t gff_frame[snapshot_max_data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    char scene_name2[scene_ns::scene_max_name_chars_wout_folders];
+    uint8_t num_of_chunks, data_len;
+    uint16_t count, num_rule, num_valid_rule, record;
+    uint32_t version;
+    scene_ns::rule_t a_rule;
+
+    memcpy(&gff_frame[ha_ns::GFF_DATA_POS + ha_ns::SNAPSHOT_HEADER_LEN], scene_name, 8);
+
+    /* scene name is mixed in, version known for a scene doesn't match other scenes */
+    version = snapshot_version(scene_mng_p->get_version())
+            ^ ((uint32_t)crc16_ccitt(crc16_ns::crc16_init, (uint8_t *)scene_name,
+                    strlen(scene_name)) << 16);
+    if (version == known_version && first_chunk == 0) {
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_SCENE_SNAPSHOT, version, 0,
+                ha_ns::SNAPSHOT_NOT_CHANGED, ha_ns::SCENE_SNAPSHOT_HEADER_LEN,
+                ble_pid, to_ble_queue);
+        return;
+    }
+
+    /* load scene_name to current running scene if needed */
+    scene_mng_p->get_user_scene(scene_name2);
+    if (strcmp(scene_name, scene_name2) != 0) {
+        scene_mng_p->set_user_scene(scene_name);
+        scene_mng_p->restore_user_scene();
+    }
+
+    /* only valid rules are in snapshot */
+    num_rule = scene_mng_p->get_user_scene_ptr()->get_cur_num_rules();
+    num_valid_rule = 0;
+    for (count = 0; count < num_rule; count++) {
+        scene_mng_p->get_user_scene_ptr()->get_rule_with_index(a_rule, count);
+        if (a_rule.is_valid) {
+            num_valid_rule++;
+        }
+    }
+
+    num_of_chunks = (num_valid_rule + records_per_chunk - 1) / records_per_chunk;
+    if (num_of_chunks == 0) {
+        num_of_chunks = 1; /* empty scene */
+    }
+
+    data_len = ha_ns::SCENE_SNAPSHOT_HEADER_LEN;
+    record = 0;
+    for (count = 0; count < num_rule; count++) {
+        scene_mng_p->get_user_scene_ptr()->get_rule_with_index(a_rule, count);
+        if (!a_rule.is_valid) {
+            continue;
+        }
+
+        if (record / records_per_chunk >= first_chunk) {
+            pack_rule(&gff_frame[ha_ns::GFF_DATA_POS + data_len], count, a_rule);
+            data_len += ha_ns::RULE_SNAPSHOT_RECORD_LEN;
+        }
+        record++;
+
+        /* chunk is full */
+        if (record % records_per_chunk == 0 && data_len > ha_ns::SCENE_SNAPSHOT_HEADER_LEN) {
+            set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_SCENE_SNAPSHOT, version,
+                    record / records_per_chunk - 1, num_of_chunks, data_len,
+                    ble_pid, to_ble_queue);
+            data_len = ha_ns::SCENE_SNAPSHOT_HEADER_LEN;
+        }
+    }
+
+    /* last chunk (or empty scene) */
+    if (data_len > ha_ns::SCENE_SNAPSHOT_HEADER_LEN || (num_valid_rule == 0 && first_chunk == 0)) {
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_SCENE_SNAPSHOT, version,
+                num_of_chunks - 1, num_of_chunks, data_len, ble_pid, to_ble_queue);
+    }
+
+    /* Restore old user scene */
+    if (strcmp(scene_name, scene_name2) != 0) {
+        scene_mng_p->set_user_scene(scene_name2);
+        scene_mng_p->restore_user_scene();
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void set_scene_dir_snapshot_to_ble(uint32_t known_version, uint8_t first_chunk,
+        scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
+{
+    const uint8_t records_per_chunk = (snapshot_max_data_len - ha_ns::SNAPSHOT_HEADER_LEN)
+            / ha_ns::SCENE_DIR_SNAPSHOT_RECORD_LEN;
+    uint8_t gff_frame[snapshot_max_data_len + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    char scene_name[scene_ns::scene_max_name_chars_wout_folders];
+    uint8_t chunk_index, num_of_chunks, data_len;
+    uint16_t count, num_of_records, num_of_active;
+    uint32_t version;
+
+    version = snapshot_version(scene_mng_p->get_version());
+    if (version == known_version && first_chunk == 0) {
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_SCENE_DIR_SNAPSHOT, version, 0,
+                ha_ns::SNAPSHOT_NOT_CHANGED, ha_ns::SNAPSHOT_HEADER_LEN, ble_pid, to_ble_queue);
+        return;
+    }
+
+    /* active scenes are the first records, then inactive scenes */
+    num_of_active = scene_mng_p->get_num_of_active_scenes();
+    num_of_records = num_of_active + scene_mng_p->get_num_of_inactive_scenes();
+    num_of_chunks = (num_of_records + records_per_chunk - 1) / records_per_chunk;
+
+    for (chunk_index = first_chunk; chunk_index < num_of_chunks; chunk_index++) {
+        data_len = ha_ns::SNAPSHOT_HEADER_LEN;
+
+        for (count = chunk_index * records_per_chunk;
+                count < num_of_records && count < (chunk_index + 1) * records_per_chunk;
+                count++) {
+            scene_name[0] = '\0';
+            if (count < num_of_active) {
+                scene_mng_p->get_active_scene_with_index(
+                        scene_mng_p->get_active_scene_index(count), scene_name);
+            }
+            else {
+                scene_mng_p->get_inactive_scene_with_index(count - num_of_active, scene_name);
+            }
+
+            gff_frame[ha_ns::GFF_DATA_POS + data_len] = (count < num_of_active) ? 1 : 0;
+            memcpy(&gff_frame[ha_ns::GFF_DATA_POS + data_len + 1], scene_name, 8);
+            data_len += ha_ns::SCENE_DIR_SNAPSHOT_RECORD_LEN;
+        }
+
+        set_snapshot_chunk_to_ble(gff_frame, ha_ns::SET_SCENE_DIR_SNAPSHOT, version,
+                chunk_index, num_of_chunks, data_len, ble_pid, to_ble_queue);
+    }
 }
 
 /*----------------------------------------------------------------------------*/
 static void process_scene_with_1sec(rtc_ns::time_t &cur_time,
         scene_mng *scene_mng_p)
 {
-    if (cur_time.sec == 0) {
-        HA_DEBUG("process_scene_with_1sec: processing scene triggered by time, %hu:%hu:%hu\n",
-                cur_time.hour, cur_time.min, cur_time.sec);
-        scene_mng_p->process(false, NULL);
-    }
+    /* only rules whose time conditions change at this second are processed */
+    scene_mng_p->process_time(MB1_rtc.time_to_packed(cur_time));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -1113,6 +1548,65 @@ static void new_scene_set_rule_1msTIM_ISR(void)
     }
 }
 
+/*----------------------------------------------------------------------------*/
+static void ble_dirty_flush_1msTIM_ISR(void)
+{
+    msg_t mesg;
+
+    if (ble_dirty_flush_count > 0) {
+        ble_dirty_flush_count--;
+        if (ble_dirty_flush_count == 0) {
+            mesg.type = ha_cc_ns::BLE_DIRTY_FLUSH;
+            msg_send_int(&mesg, controller_pid);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void ble_dirty_flush(ha_device_mng *dev_mng,
+        kernel_pid_t to_ble_pid, cir_queue *to_ble_queue)
+{
+    uint8_t set_dev_val_gff_frame[ha_ns::SET_DEV_VAL_DATA_LEN
+            + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
+    uint32_t device_id;
+    int16_t value;
+    uint16_t num_of_frames = 0;
+    msg_t mesg;
+
+    if (!ble_subscribed) {
+        return;
+    }
+
+    /* changed devices are left dirty when there is no room in ble queue */
+    while (to_ble_queue->get_free() >= (int32_t)sizeof(set_dev_val_gff_frame)) {
+        device_id = dev_mng->pop_dirty_device(ha_device_mng_ns::DIRTY_BLE, value);
+        if (device_id == ha_device_ns::no_device_id) {
+            break;
+        }
+
+        set_dev_val_gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_VAL_DATA_LEN;
+        uint162buf(ha_ns::SET_DEV_VAL, &set_dev_val_gff_frame[ha_ns::GFF_CMD_POS]);
+        uint322buf(device_id, &set_dev_val_gff_frame[ha_ns::GFF_DATA_POS]);
+        uint162buf((uint16_t) value, &set_dev_val_gff_frame[ha_ns::GFF_DATA_POS + 4]);
+
+        to_ble_queue->add_data(set_dev_val_gff_frame, sizeof(set_dev_val_gff_frame));
+        num_of_frames++;
+    }
+
+    if (num_of_frames > 0) {
+        mesg.type = ha_ns::GFF_PENDING;
+        mesg.content.ptr = (char *) to_ble_queue;
+        msg_send(&mesg, to_ble_pid, false);
+    }
+
+    /* try again in next window */
+    if (dev_mng->has_dirty_device(ha_device_mng_ns::DIRTY_BLE)) {
+        ble_dirty_flush_count = ble_dirty_flush_window_ms;
+    }
+
+    HA_DEBUG("ble_dirty_flush: %hu SET_DEV_VAL sent to ble\n", num_of_frames);
+}
+
 /*----------------------------------------------------------------------------*/
 static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_scene_state,
         scene_mng *scene_mng_p, kernel_pid_t ble_pid, cir_queue *to_ble_queue)
@@ -1157,6 +1651,7 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
             /* No invalid rule, save new scene and send new scene back to ble */
             new_scene_state = false;
             scene_mng_p->get_user_scene_ptr()->save();
+            scene_mng_p->scene_saved(scene_mng_p->get_user_scene_ptr());
             HA_DEBUG("new_scene_set_rule_timeout_handler: no invalid rule, "
                     "clear new scene state (%hu),"
                     "(%s) saved\n", new_scene_state, new_scene_name);
@@ -1190,6 +1685,7 @@ static void new_scene_set_rule_timeout_handler(uint8_t &resend_count, bool &new_
             /* No invalid rule, save new scene and send new scene back to ble */
             new_scene_state = false;
             scene_mng_p->get_user_scene_ptr()->save();
+            scene_mng_p->scene_saved(scene_mng_p->get_user_scene_ptr());
             HA_DEBUG("new_scene_set_rule_timeout_handler: no invalid rule, "
                     "clear new scene state (%hu),"
                     "(%s) saved\n", new_scene_state, new_scene_name);
@@ -1229,38 +1725,19 @@ static void set_zone_name_to_ble(uint8_t index,
 {
     char zone_name[zone_ns::zone_name_max_size];
     uint8_t zone_id;
-    FRESULT fres;
-    DIR dir;
-    FILINFO finfo;
+    uint8_t zone_ids[zone_ns::max_num_zones];
+    uint8_t num_zones, count;
     msg_t mesg;
     uint8_t set_zone_name_gff_frame[ha_ns::SET_ZONE_NAME_DATA_LEN
             + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
 
     if (index == 0xFF) {
-        /* Open zones folder to get all zone name */
-        fres = f_opendir(&dir, ZONES_FOLDER);
-        if (fres != FR_OK) {
-            print_ferr(fres);
-            return;
-        }
-
-        while (1) {
-            fres = f_readdir(&dir, &finfo);
-            if (fres != FR_OK) { /* error when read dir */
-                print_ferr(fres);
-                return;
-            }
-
-            if (finfo.fname[0] == 0) { /* end of dir */
-                break;
-            }
-
-            if (finfo.fname[0] == '.') {
-                continue;
-            }
+        /* get all zone ids from zones folder */
+        num_zones = zone_p->get_zone_ids(zone_ns::max_num_zones, zone_ids);
 
+        for (count = 0; count < num_zones; count++) {
             /* pack gff frame */
-            zone_id = (uint8_t)atoi(finfo.fname);
+            zone_id = zone_ids[count];
 
             set_zone_name_gff_frame[ha_ns::GFF_LEN_POS] = ha_ns::SET_ZONE_NAME_DATA_LEN;
             uint162buf(ha_ns::SET_ZONE_NAME, &set_zone_name_gff_frame[ha_ns::GFF_CMD_POS]);
@@ -1280,9 +1757,6 @@ static void set_zone_name_to_ble(uint8_t index,
             HA_DEBUG("ble_gff_handler: sent SET_ZONE_NAME (%hu, %s) to ble\n",
                    zone_id, zone_name);
         }
-
-        /* close dir */
-        f_closedir(&dir);
     }
 
     /* normal index */
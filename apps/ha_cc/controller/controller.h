@@ -22,13 +22,14 @@ extern "C" {
 }
 
 #include "cir_queue.h"
+#include "frame_ring.h"
 
 namespace controller_ns {
 
 extern kernel_pid_t controller_pid;
 
-/* Data cir_queue */
-extern cir_queue slp_to_controller_queue;
+/* Data queues, GFF frames from 6lowpan are parsed in place */
+extern frame_ring slp_to_controller_queue;
 extern cir_queue ble_to_controller_queue;
 
 }
@@ -19,6 +19,7 @@
 #include "ha_gff_misc.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
+#include "storage.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
@@ -31,16 +32,26 @@ static const char print_line_pattern[] = "| %-3d | %08lx | %-8d | %-3d | %-4d |
 
 /* save and restore */
 static const char devices_list_line_pattern[] = "%lx %d %d\n";
+static const char devices_list_gen_pattern[] = "G: %u\n"; /* journal generation */
 
 /*----------------------------------------------------------------------------*/
 ha_device_mng::ha_device_mng(ha_device *devices_buffer, uint16_t num_of_dev,
-        const char *devices_list_filename)
+        id_hash_index_ns::entry_t *index_buffer, uint16_t index_size,
+        timer_wheel_ns::node_t *ttl_nodes_buffer, uint32_t *dirty_bitmap_buffer,
+        journal *devices_journal, const char *devices_list_filename)
+    : devices_index(index_buffer, index_size),
+      ttl_wheel(ttl_nodes_buffer, num_of_dev)
 {
     cur_size = 0;
+    version = 0;
 
     max_num_of_dev = num_of_dev;
     this->devices_buffer = devices_buffer;
+    dirty_bitmap = dirty_bitmap_buffer;
+    dirty_bitmap_words = (num_of_dev + 31) / 32;
 
+    this->devices_journal = devices_journal;
+    need_full_save = false;
     devices_list_file = devices_list_filename;
 
     /* Clear all devices */
@@ -56,7 +67,11 @@ int8_t ha_device_mng::set_dev_val(uint32_t device_id, int16_t value)
     device_p = find_device(device_id);
 
     if (device_p != NULL) { /* device found */
-        device_p->set_value(value);
+        if (device_p->get_value() != value) {
+            device_p->set_value(value);
+            set_dirty((uint16_t)(device_p - devices_buffer));
+            version++;
+        }
         return 0;
     }
 
@@ -67,7 +82,9 @@ int8_t ha_device_mng::set_dev_val(uint32_t device_id, int16_t value)
     }
 
     device_p->set_value(value);
+    set_dirty((uint16_t)(device_p - devices_buffer));
     cur_size++;
+    version++;
     return 0;
 }
 
@@ -104,7 +121,7 @@ int16_t ha_device_mng::set_dev_ttl(uint32_t device_id, int16_t ttl)
         return -1;
     }
 
-    device_p->set_ttl(ttl);
+    ttl_wheel.start((uint16_t)(device_p - devices_buffer), (ttl < 0) ? 0 : ttl);
     return 0;
 }
 
@@ -118,7 +135,7 @@ int16_t ha_device_mng::get_dev_ttl(uint32_t device_id, int16_t &ttl)
         return -1;
     }
 
-    ttl = device_p->get_ttl();
+    ttl = get_ttl_with_pos((uint16_t)(device_p - devices_buffer));
     return 0;
 }
 
@@ -126,34 +143,93 @@ int16_t ha_device_mng::get_dev_ttl(uint32_t device_id, int16_t &ttl)
 int16_t ha_device_mng::chag_dev_ttl(uint32_t device_id, int16_t val)
 {
     ha_device *device_p;
+    uint16_t pos;
+    int32_t ttl;
 
     device_p = find_device(device_id);
     if (device_p == NULL) {
         return -1;
     }
 
-    device_p->set_ttl(device_p->get_ttl() + val);
-    if (device_p->get_ttl() == 0) {
+    pos = (uint16_t)(device_p - devices_buffer);
+    ttl = get_ttl_with_pos(pos) + val;
+    if (ttl > INT16_MAX) {
+        ttl = INT16_MAX;
+    }
+
+    if (ttl <= 0) {
+        /* will be removed on next ttl_tick */
+        ttl_wheel.start(pos, 0);
         return TTL_IS_ZERO;
     }
 
+    ttl_wheel.start(pos, (uint16_t)ttl);
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_device_mng::dec_all_devs_ttl(void)
+void ha_device_mng::ttl_tick(void)
 {
-    uint16_t count;
+    ttl_wheel.tick();
+}
 
-    for (count = 0; count < max_num_of_dev; count++) {
-        if (!devices_buffer[count].is_no_device()) {
-            devices_buffer[count].set_ttl(devices_buffer[count].get_ttl() - 1);
-            if (devices_buffer[count].get_ttl() == 0) {
-                devices_buffer[count].set_to_no_device();
-                cur_size--;
-            }
+/*----------------------------------------------------------------------------*/
+uint32_t ha_device_mng::pop_expired_device(void)
+{
+    uint16_t pos;
+    uint32_t device_id;
+
+    pos = ttl_wheel.get_expired();
+    if (pos == timer_wheel_ns::no_timer) {
+        return ha_device_ns::no_device_id;
+    }
+
+    device_id = remove_device_with_pos(pos);
+    journal_remove(device_id);
+
+    return device_id;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ha_device_mng::pop_dirty_device(dirty_set_e dirty_set, int16_t &value)
+{
+    uint32_t *bitmap = get_dirty_bitmap(dirty_set);
+    uint16_t word, pos;
+
+    for (word = 0; word < dirty_bitmap_words; word++) {
+        if (bitmap[word] == 0) {
+            continue;
+        }
+
+        pos = (word << 5) + __builtin_ctz(bitmap[word]);
+        bitmap[word] &= ~((uint32_t)1 << (pos & 31));
+
+        value = devices_buffer[pos].get_value();
+        return devices_buffer[pos].get_device_id();
+    }
+
+    return ha_device_ns::no_device_id;
+}
+
+/*----------------------------------------------------------------------------*/
+bool ha_device_mng::has_dirty_device(dirty_set_e dirty_set)
+{
+    uint32_t *bitmap = get_dirty_bitmap(dirty_set);
+    uint16_t word;
+
+    for (word = 0; word < dirty_bitmap_words; word++) {
+        if (bitmap[word] != 0) {
+            return true;
         }
     }
+
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::clear_dirty_devices(dirty_set_e dirty_set)
+{
+    memset(get_dirty_bitmap(dirty_set), 0, dirty_bitmap_words * sizeof(uint32_t));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -166,8 +242,9 @@ int8_t ha_device_mng::remove_device(uint32_t device_id)
         return -1;
     }
 
-    device_p->set_to_no_device();
-    cur_size--;
+    ttl_wheel.stop((uint16_t)(device_p - devices_buffer));
+    remove_device_with_pos((uint16_t)(device_p - devices_buffer));
+    journal_remove(device_id);
     return 0;
 }
 
@@ -176,7 +253,9 @@ void ha_device_mng::reorder(void)
 {
     ha_device *empty_dev_p = NULL;
     ha_device *last_dev_p = NULL;
-    uint16_t count;
+    uint16_t count, empty_pos;
+    uint32_t *bitmap;
+    uint8_t dirty_set;
 
     if (cur_size < 2) {
         return;
@@ -197,6 +276,19 @@ void ha_device_mng::reorder(void)
                 last_dev_p = &devices_buffer[count];
                 memcpy(empty_dev_p, last_dev_p, sizeof(ha_device));
                 last_dev_p->set_to_no_device();
+
+                /* device has been moved, update its position */
+                devices_index.insert(empty_dev_p->get_device_id(),
+                        (uint16_t)(empty_dev_p - devices_buffer));
+                empty_pos = (uint16_t)(empty_dev_p - devices_buffer);
+                ttl_wheel.move(count, empty_pos);
+                for (dirty_set = 0; dirty_set < NUM_DIRTY_SETS; dirty_set++) {
+                    bitmap = get_dirty_bitmap(dirty_set);
+                    if ((bitmap[count >> 5] >> (count & 31)) & 1) {
+                        bitmap[count >> 5] &= ~((uint32_t)1 << (count & 31));
+                        bitmap[empty_pos >> 5] |= (uint32_t)1 << (empty_pos & 31);
+                    }
+                }
                 break;
             }
         }
@@ -221,7 +313,7 @@ void ha_device_mng::print_all_devices(void)
                     devices_buffer[count].get_device_id(),
                     devices_buffer[count].get_value(),
                     devices_buffer[count].get_io_type(),
-                    devices_buffer[count].get_ttl(),
+                    get_ttl_with_pos(count),
                     device_type_to_name(devices_buffer[count].get_device_type()));
 
             num_of_dev_count++;
@@ -237,74 +329,244 @@ void ha_device_mng::print_all_devices(void)
 /*----------------------------------------------------------------------------*/
 void ha_device_mng::save(void)
 {
-    FIL file;
-    FRESULT fres;
-    uint16_t count;
-    uint16_t num_of_dev_count;
+    uint8_t record[jnl_dev_val_len];
+    uint32_t device_id;
+    int16_t value, ttl;
 
     if (devices_list_file == NULL) {
         return;
     }
 
-    /* open file */
-    fres = f_open(&file, devices_list_file, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("ha_dev_mng::save: Error when open file %s\n", devices_list_file);
-        print_ferr(fres);
+    /* compaction: whole list is written with new generation, old journal is not needed */
+    if (devices_journal == NULL || need_full_save || devices_journal->has_failed() ||
+            devices_journal->need_compaction(0)) {
+        if (save_all_devices() != 0) {
+            need_full_save = true;
+            return;
+        }
+        if (devices_journal != NULL) {
+            devices_journal->set_generation(devices_journal->get_generation() + 1);
+            devices_journal->clear();
+        }
+        clear_dirty_devices(DIRTY_SAVE);
+        need_full_save = false;
         return;
     }
-    f_sync(&file);
 
-    /* write data */
-    num_of_dev_count = 0;
-    for (count = 0; count < max_num_of_dev; count++) {
-        if (!devices_buffer[count].is_no_device()) {
-            f_printf(&file, devices_list_line_pattern,
-                    devices_buffer[count].get_device_id(),
-                    devices_buffer[count].get_value(),
-                    devices_buffer[count].get_ttl());
-            f_sync(&file);
+    /* append changed devices, removed devices have been appended already */
+    while (1) {
+        device_id = pop_dirty_device(DIRTY_SAVE, value);
+        if (device_id == ha_device_ns::no_device_id) {
+            break;
+        }
+        get_dev_ttl(device_id, ttl);
+
+        uint322buf(device_id, record);
+        uint162buf((uint16_t)value, &record[4]);
+        uint162buf((uint16_t)ttl, &record[6]);
+        if (devices_journal->append(JNL_DEV_VAL, record, jnl_dev_val_len) != 0) {
+            /* storage queue is full, try again next time */
+            set_dirty((uint16_t)(find_device(device_id) - devices_buffer));
+            break;
+        }
+    }
 
-            num_of_dev_count++;
-            if (num_of_dev_count == cur_size) {
-                f_close(&file);
-                return;
+    devices_journal->flush();
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::restore(void)
+{
+    if (devices_list_file == NULL) {
+        return;
+    }
+
+    storage_call(restore_file, this);
+
+    /* restored devices are the same as in file */
+    clear_dirty_devices(DIRTY_SAVE);
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t ha_device_mng::save_all_devices(void)
+{
+    char line[32];
+    uint16_t count;
+    uint16_t num_of_dev_count;
+    uint16_t pass, len = 0;
+
+    /* list is queued to storage thread as one WRITE request, its len is counted in
+     * the first pass */
+    for (pass = 0; pass < 2; pass++) {
+        if (pass == 1) {
+            if (storage_begin(storage_ns::WRITE, 0, devices_list_file, len,
+                    (devices_journal != NULL) ? journal::write_done : NULL,
+                    devices_journal) != 0) {
+                HA_DEBUG("ha_dev_mng::save: Storage queue is full\n");
+                return -1;
             }
-        }/* end not empty device */
-    }/* end for */
+        }
 
-    f_close(&file);
+        /* journal generation of this list */
+        if (devices_journal != NULL) {
+            snprintf(line, sizeof(line), devices_list_gen_pattern,
+                    (unsigned int)(uint16_t)(devices_journal->get_generation() + 1));
+            save_line(pass, line, len);
+        }
+
+        num_of_dev_count = 0;
+        for (count = 0; count < max_num_of_dev && num_of_dev_count < cur_size; count++) {
+            if (!devices_buffer[count].is_no_device()) {
+                snprintf(line, sizeof(line), devices_list_line_pattern,
+                        devices_buffer[count].get_device_id(),
+                        devices_buffer[count].get_value(),
+                        get_ttl_with_pos(count));
+                save_line(pass, line, len);
+                num_of_dev_count++;
+            }/* end not empty device */
+        }/* end for */
+    }
+
+    storage_end();
+
+    return 0;
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_device_mng::restore(void)
+void ha_device_mng::save_line(uint16_t pass, const char *line, uint16_t &len)
+{
+    if (pass == 0) {
+        len += strlen(line);
+    }
+    else {
+        storage_add_data(line, strlen(line));
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t ha_device_mng::restore_file(void *arg)
 {
+    ha_device_mng *dev_mng = (ha_device_mng *)arg;
     FIL file;
     FRESULT fres;
     uint32_t device_id;
     int value_i, ttl_i;
+    unsigned int gen_ui = 0;
     char line[32];
-
-    if (devices_list_file == NULL) {
-        return;
-    }
+    int16_t num_records;
 
     /* open file */
-    fres = f_open(&file, devices_list_file, FA_READ | FA_OPEN_ALWAYS);
+    fres = f_open(&file, dev_mng->devices_list_file, FA_READ | FA_OPEN_ALWAYS);
     if (fres != FR_OK) {
-        HA_DEBUG("ha_device_mng::restore: Error when open file %s\n", devices_list_file);
+        HA_DEBUG("ha_device_mng::restore: Error when open file %s\n",
+                dev_mng->devices_list_file);
         print_ferr(fres);
-        return;
+        return -1;
     }
 
     /* read list of devices */
     while( f_gets(line, sizeof(line), &file) ){
-        sscanf(line, devices_list_line_pattern, &device_id, &value_i, &ttl_i);
-        set_dev_val(device_id, (int16_t)value_i);
-        set_dev_ttl(device_id, (int8_t)ttl_i);
+        if (sscanf(line, devices_list_gen_pattern, &gen_ui) == 1) {
+            continue;
+        }
+        if (sscanf(line, devices_list_line_pattern, &device_id, &value_i, &ttl_i) != 3) {
+            continue;
+        }
+        dev_mng->set_dev_val(device_id, (int16_t)value_i);
+        dev_mng->set_dev_ttl(device_id, (int8_t)ttl_i);
     }
 
     f_close(&file);
+
+    /* changes after last save of whole list */
+    if (dev_mng->devices_journal != NULL) {
+        dev_mng->devices_journal->set_generation((uint16_t)gen_ui);
+        num_records = dev_mng->devices_journal->replay(replay_record, dev_mng);
+        HA_DEBUG("ha_device_mng::restore: %d journal records\n", num_records);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::replay_record(uint8_t type, uint8_t *data, uint8_t len, void *arg)
+{
+    ha_device_mng *dev_mng = (ha_device_mng *)arg;
+    ha_device *device_p;
+    uint32_t device_id;
+
+    switch (type) {
+    case JNL_DEV_VAL:
+        if (len != jnl_dev_val_len) {
+            break;
+        }
+        device_id = buf2uint32(data);
+        dev_mng->set_dev_val(device_id, (int16_t)buf2uint16(&data[4]));
+        dev_mng->set_dev_ttl(device_id, (int16_t)buf2uint16(&data[6]));
+        break;
+
+    case JNL_DEV_REMOVE:
+        if (len != jnl_dev_remove_len) {
+            break;
+        }
+        device_p = dev_mng->find_device(buf2uint32(data));
+        if (device_p != NULL) {
+            dev_mng->ttl_wheel.stop((uint16_t)(device_p - dev_mng->devices_buffer));
+            dev_mng->remove_device_with_pos((uint16_t)(device_p - dev_mng->devices_buffer));
+        }
+        break;
+
+    default:
+        HA_DEBUG("ha_device_mng::replay_record: Unknown record %hu\n", type);
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t ha_device_mng::remove_device_with_pos(uint16_t pos)
+{
+    uint32_t device_id;
+
+    device_id = devices_buffer[pos].get_device_id();
+    devices_index.remove(device_id);
+    devices_buffer[pos].set_to_no_device();
+    clear_dirty(pos);
+    cur_size--;
+    version++;
+
+    return device_id;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::journal_remove(uint32_t device_id)
+{
+    uint8_t record[jnl_dev_remove_len];
+
+    if (devices_journal == NULL || devices_list_file == NULL) {
+        return;
+    }
+
+    /* written with next save */
+    uint322buf(device_id, record);
+    if (devices_journal->append(JNL_DEV_REMOVE, record, jnl_dev_remove_len) != 0) {
+        need_full_save = true;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::set_dirty(uint16_t pos)
+{
+    for (uint8_t dirty_set = 0; dirty_set < NUM_DIRTY_SETS; dirty_set++) {
+        get_dirty_bitmap(dirty_set)[pos >> 5] |= (uint32_t)1 << (pos & 31);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_device_mng::clear_dirty(uint16_t pos)
+{
+    for (uint8_t dirty_set = 0; dirty_set < NUM_DIRTY_SETS; dirty_set++) {
+        get_dirty_bitmap(dirty_set)[pos >> 5] &= ~((uint32_t)1 << (pos & 31));
+    }
 }
 
 /*----------------------------------------------------------------------------*/
@@ -330,21 +592,32 @@ ha_device *ha_device_mng::find_an_empty_slot(void)
 /*----------------------------------------------------------------------------*/
 ha_device *ha_device_mng::find_device(uint32_t device_id)
 {
-    for (uint16_t count = 0; count < max_num_of_dev; count++) {
-        if (devices_buffer[count].get_device_id() == device_id) {
-            return &devices_buffer[count];
-        }
+    uint16_t pos;
+
+    pos = devices_index.find(device_id);
+    if (pos == id_hash_index_ns::no_value) {
+        return NULL;
     }
 
-    return NULL;
+    return &devices_buffer[pos];
 }
 
 /*----------------------------------------------------------------------------*/
 ha_device *ha_device_mng::add_device(uint32_t device_id)
 {
+    if (device_id == ha_device_ns::no_device_id) {
+        return NULL;
+    }
+
     for (uint16_t count = 0; count < max_num_of_dev; count++) {
         if (devices_buffer[count].is_no_device()) {
+            if (devices_index.insert(device_id, count) != 0) {
+                return NULL;
+            }
             devices_buffer[count].set_device_id(device_id);
+
+            /* TTL is zero until it is set */
+            ttl_wheel.start(count, 0);
             return &devices_buffer[count];
         }
     }
@@ -358,6 +631,19 @@ void ha_device_mng::clear_all_devices(void)
     for (uint16_t count = 0; count < max_num_of_dev; count++) {
         devices_buffer[count].set_to_no_device();
     }
+    devices_index.clear();
+    ttl_wheel.clear();
+    memset(dirty_bitmap, 0, NUM_DIRTY_SETS * dirty_bitmap_words * sizeof(uint32_t));
 
     cur_size = 0;
+    version++;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t ha_device_mng::get_ttl_with_pos(uint16_t pos)
+{
+    uint16_t ttl;
+
+    ttl = ttl_wheel.get_remaining(pos);
+    return (ttl > INT16_MAX) ? INT16_MAX : (int16_t)ttl;
 }
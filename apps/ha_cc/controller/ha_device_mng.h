@@ -17,6 +17,9 @@
 
 #include <cstdint>
 #include "ha_device.h"
+#include "id_hash_index.h"
+#include "timer_wheel.h"
+#include "journal.h"
 
 namespace ha_device_mng_ns {
 
@@ -26,21 +29,51 @@ enum errcode_e: int8_t {
     TTL_IS_ZERO,
 };
 
+/* Each dirty set is a bitmap of devices added or changed since it was popped/cleared */
+enum dirty_set_e: uint8_t {
+    DIRTY_BLE = 0,  /* to be sent to Mobile */
+    DIRTY_SAVE,     /* to be appended to journal */
+    NUM_DIRTY_SETS,
+};
+
+/* journal records */
+enum journal_record_e: uint8_t {
+    JNL_DEV_VAL = 0,    /* | id (4) | value (2) | ttl (2) | */
+    JNL_DEV_REMOVE,     /* | id (4) | */
+};
+
+const uint8_t jnl_dev_val_len = 8;
+const uint8_t jnl_dev_remove_len = 4;
+
 }
 
 class ha_device_mng {
 public:
     /**
      * @brief   constructor,
-     *          User must provide buffer to hold devices and size of this buffer.
+     *          User must provide buffer to hold devices and size of this buffer,
+     *          buffer for hash index of device ids (device id -> position in
+     *          devices buffer), buffer for TTL timers (one per device) and buffer for
+     *          dirty bitmaps (one bit per device for each dirty set).
      *          All devices in buffer will be clear with no_device ids.
      *
      * @param[in]   devices_buffer, pointer to buffer holding devices.
      * @param[in]   num_of_dev, number of devices in device_buffer
+     * @param[in]   index_buffer, pointer to buffer holding hash index entries.
+     * @param[in]   index_size, number of entries in index_buffer, MUST be a power of 2
+     *              and >= 2 * num_of_dev.
+     * @param[in]   ttl_nodes_buffer, pointer to buffer holding num_of_dev TTL timer nodes.
+     * @param[in]   dirty_bitmap_buffer, pointer to buffer holding
+     *              NUM_DIRTY_SETS * ((num_of_dev + 31) / 32) words of dirty bitmaps.
+     * @param[in]   devices_journal, journal of changes between two saves of devices list,
+     *              NULL to always save whole list.
      * @param[in]   devices_list_filename, file name will hold list of devices.
      *              NULL to disable save/restore operations.
      */
-    ha_device_mng(ha_device *devices_buffer, uint16_t num_of_dev, const char *devices_list_filename);
+    ha_device_mng(ha_device *devices_buffer, uint16_t num_of_dev,
+            id_hash_index_ns::entry_t *index_buffer, uint16_t index_size,
+            timer_wheel_ns::node_t *ttl_nodes_buffer, uint32_t *dirty_bitmap_buffer,
+            journal *devices_journal, const char *devices_list_filename);
     
     /**
      * @brief   Find a device with device_id and set its value. If this device id
@@ -106,9 +139,42 @@ public:
     int16_t chag_dev_ttl(uint32_t device_id, int16_t val);
 
     /**
-     * @brief   Decrease all device's ttls by one, and remove device(s) if TTL_IS_ZERO.
+     * @brief   Decrease all device's ttls by one (i.e. one second has passed).
+     *          Only devices whose TTL reaches zero are touched, they are kept in
+     *          buffer until pop_expired_device is called.
      */
-    void dec_all_devs_ttl(void);
+    void ttl_tick(void);
+
+    /**
+     * @brief   Remove a device whose TTL has reached zero from devices buffer.
+     *          Should be called until no_device_id is returned after ttl_tick.
+     *
+     * @return  device id of removed device, ha_device_ns::no_device_id if there
+     *          is no expired device.
+     */
+    uint32_t pop_expired_device(void);
+
+    /**
+     * @brief   Get a device which has been added or whose value has been changed since
+     *          it was popped last time from a dirty set (dirty device), and clear its
+     *          dirty bit in this set.
+     *
+     * @param[in]   dirty_set, DIRTY_BLE or DIRTY_SAVE.
+     * @param[out]  value, current value of the device.
+     *
+     * @return  device id, no_device_id if there is no dirty device.
+     */
+    uint32_t pop_dirty_device(ha_device_mng_ns::dirty_set_e dirty_set, int16_t &value);
+
+    /**
+     * @brief   Check if there is any dirty device in a dirty set.
+     */
+    bool has_dirty_device(ha_device_mng_ns::dirty_set_e dirty_set);
+
+    /**
+     * @brief   Clear dirty bits of all devices in a dirty set.
+     */
+    void clear_dirty_devices(ha_device_mng_ns::dirty_set_e dirty_set);
 
     /**
      * @brief   Remove a device from devices buffer. (i.e. set id to no device)
@@ -131,26 +197,38 @@ public:
      */
     uint16_t get_current_numofdev(void) {return cur_size;};
 
+    /**
+     * @brief   Get version of devices table. It's changed every time a device is added,
+     *          removed or its value is changed.
+     *
+     * @return  version.
+     */
+    uint32_t get_version(void) { return version; }
+
     /**
      * @brief   Print all device via HA_NOTIFY.
      */
     void print_all_devices(void);
 
     /**
-     * @brief   Save current list of devices to file.
+     * @brief   Save changes of devices list. Changed devices are appended to journal,
+     *          nothing is written if no device has been changed. Whole list is written
+     *          to file and journal is cleared when journal has grown too large (or there
+     *          is no journal). Writes are queued to storage thread.
      */
     void save(void);
 
     /**
-     * @brief   Read device list file and restore devices buffer.
+     * @brief   Read device list file, replay journal and restore devices buffer
+     *          (in storage thread, caller waits).
      */
     void restore(void);
 
 private:
     /*----------------------------- Methods ----------------------------------*/
     /**
-     * @brief   Find a device with device_id. NOTE: address of a device will be changed
-     *          after reorder method is called.
+     * @brief   Find a device with device_id using hash index.
+     *          NOTE: address of a device will be changed after reorder method is called.
      *
      * @param[in]   device_id.
      *
@@ -158,6 +236,43 @@ private:
      */
     ha_device *find_device(uint32_t device_id);
 
+    /**
+     * @brief   Remove device at a position in devices buffer, nothing is appended to
+     *          journal.
+     *
+     * @param[in]   pos, position in devices buffer.
+     *
+     * @return      device id of removed device.
+     */
+    uint32_t remove_device_with_pos(uint16_t pos);
+
+    /**
+     * @brief   Append a JNL_DEV_REMOVE record to journal (if any).
+     */
+    void journal_remove(uint32_t device_id);
+
+    /**
+     * @brief   Queue whole devices list to be written to file.
+     *
+     * @return      0 on success, -1 if storage queue is full.
+     */
+    int8_t save_all_devices(void);
+
+    /**
+     * @brief   Count len of a line (pass 0) or add it to storage request (pass 1).
+     */
+    void save_line(uint16_t pass, const char *line, uint16_t &len);
+
+    /**
+     * @brief   Read devices list file and replay journal, used as storage_ns::call_func_t.
+     */
+    static int8_t restore_file(void *arg);
+
+    /**
+     * @brief   Apply a journal record, used as journal_ns::replay_func_t.
+     */
+    static void replay_record(uint8_t type, uint8_t *data, uint8_t len, void *arg);
+
     /**
      * @brief   Find an empty slot in devices buffer.
      *
@@ -183,12 +298,43 @@ private:
      */
     void clear_all_devices(void);
 
+    /**
+     * @brief   Get TTL of device at a position in devices buffer.
+     *
+     * @param[in]   pos, position in devices buffer.
+     *
+     * @return      ttl (in seconds).
+     */
+    int16_t get_ttl_with_pos(uint16_t pos);
+
+    /**
+     * @brief   Set or clear dirty bits (in all dirty sets) of device at a position in
+     *          devices buffer.
+     */
+    void set_dirty(uint16_t pos);
+    void clear_dirty(uint16_t pos);
+
+    /**
+     * @brief   Get dirty bitmap of a dirty set.
+     */
+    uint32_t *get_dirty_bitmap(uint8_t dirty_set)
+        { return &dirty_bitmap[dirty_set * dirty_bitmap_words]; }
+
     /*----------------------------- Variables --------------------------------*/
     uint16_t cur_size;
+    uint32_t version;
 
     uint16_t max_num_of_dev;
     ha_device *devices_buffer;
 
+    id_hash_index devices_index; /* device id -> position in devices_buffer */
+    timer_wheel ttl_wheel; /* timer id == position in devices_buffer */
+    uint32_t *dirty_bitmap; /* NUM_DIRTY_SETS bitmaps, bit == position in devices_buffer */
+    uint16_t dirty_bitmap_words; /* of one dirty set */
+
+    journal *devices_journal;
+    bool need_full_save; /* a change couldn't be appended to journal */
+
     const char *devices_list_file;
 };
 
@@ -0,0 +1,213 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        journal.cpp
+ * @brief       Append-only journal file on FatFs.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#include <string.h>
+
+#include "journal.h"
+#include "crc16.h"
+#include "storage.h"
+#include "ff.h"
+#include "shell_cmds_fatfs.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace journal_ns;
+
+/*----------------------------------------------------------------------------*/
+journal::journal(uint8_t *buf, uint16_t buf_size, uint32_t compact_size, const char *filename)
+{
+    this->buf = buf;
+    this->buf_size = buf_size;
+    this->compact_size = compact_size;
+
+    name[0] = '\0';
+    buf_len = 0;
+    file_size = 0;
+    generation = 0;
+    failed = false;
+
+    if (filename != NULL) {
+        set_name(filename, NULL);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void journal::set_name(const char *filename, const char *ext)
+{
+    strncpy(name, filename, max_name_chars - 1);
+    name[max_name_chars - 1] = '\0';
+    if (ext != NULL) {
+        strncat(name, ext, max_name_chars - 1 - strlen(name));
+    }
+
+    buf_len = 0;
+    file_size = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t journal::append(uint8_t type, const void *data, uint8_t len)
+{
+    if (len > max_data_len || len + record_overhead > buf_size) {
+        return -1;
+    }
+
+    if (buf_len + len + record_overhead > buf_size) {
+        if (flush() != 0) {
+            return -1;
+        }
+    }
+
+    build_record(&buf[buf_len], type, (const uint8_t *)data, len);
+    buf_len += len + record_overhead;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t journal::flush(void)
+{
+    uint8_t gen_data[2] = { (uint8_t)generation, (uint8_t)(generation >> 8) };
+    uint8_t gen_record[sizeof(gen_data) + record_overhead];
+    uint16_t len;
+
+    if (buf_len == 0) {
+        return 0;
+    }
+
+    /* new journal file begins with generation record */
+    len = buf_len + ((file_size == 0) ? sizeof(gen_record) : 0);
+
+    if (storage_begin(storage_ns::APPEND, 0, name, len, write_done, this) != 0) {
+        HA_DEBUG("journal::flush: Storage queue is full, %s\n", name);
+        return -1;
+    }
+
+    if (file_size == 0) {
+        build_record(gen_record, generation_record, gen_data, sizeof(gen_data));
+        storage_add_data(gen_record, sizeof(gen_record));
+    }
+    storage_add_data(buf, buf_len);
+    storage_end();
+
+    file_size += len;
+    buf_len = 0;
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t journal::replay(replay_func_t replay_func, void *arg)
+{
+    FIL file;
+    FRESULT fres;
+    UINT bytes;
+    uint8_t record[max_data_len + record_overhead];
+    uint16_t crc;
+    uint32_t valid_size = 0;
+    int16_t num_records = 0;
+
+    fres = f_open(&file, name, FA_READ | FA_WRITE | FA_OPEN_EXISTING);
+    if (fres == FR_NO_FILE) {
+        file_size = 0;
+        return 0;
+    }
+    if (fres != FR_OK) {
+        HA_DEBUG("journal::replay: Error when open file %s\n", name);
+        print_ferr(fres);
+        return -1;
+    }
+
+    while (1) {
+        /* len and type */
+        fres = f_read(&file, record, 2, &bytes);
+        if (fres != FR_OK || bytes != 2 || record[0] > max_data_len) {
+            break;
+        }
+
+        /* data and crc */
+        fres = f_read(&file, &record[2], record[0] + 2, &bytes);
+        if (fres != FR_OK || bytes != (UINT)(record[0] + 2)) {
+            break;
+        }
+
+        crc = crc16_ccitt(crc16_ns::crc16_init, &record[1], record[0] + 1);
+        if (record[2 + record[0]] != (uint8_t)crc ||
+                record[3 + record[0]] != (uint8_t)(crc >> 8)) {
+            break;
+        }
+
+        if (valid_size == 0) {
+            /* generation record */
+            if (record[1] != generation_record || record[0] != 2 ||
+                    (record[2] | (record[3] << 8)) != generation) {
+                HA_NOTIFY("journal::replay: %s is older than its file\n", name);
+                break;
+            }
+        }
+        else {
+            replay_func(record[1], &record[2], record[0], arg);
+            num_records++;
+        }
+        valid_size += record[0] + record_overhead;
+    }
+
+    /* remove torn records, new records will be appended after valid ones */
+    if (valid_size < f_size(&file)) {
+        HA_NOTIFY("journal::replay: %s, %lu bytes dropped\n", name,
+                f_size(&file) - valid_size);
+        f_lseek(&file, valid_size);
+        f_truncate(&file);
+    }
+
+    file_size = valid_size;
+    f_close(&file);
+
+    return num_records;
+}
+
+/*----------------------------------------------------------------------------*/
+void journal::build_record(uint8_t *record, uint8_t type, const uint8_t *data, uint8_t len)
+{
+    uint16_t crc;
+
+    record[0] = len;
+    record[1] = type;
+    memcpy(&record[2], data, len);
+    crc = crc16_ccitt(crc16_ns::crc16_init, &record[1], len + 1);
+    record[2 + len] = (uint8_t)crc;
+    record[3 + len] = (uint8_t)(crc >> 8);
+}
+
+/*----------------------------------------------------------------------------*/
+void journal::clear(void)
+{
+    buf_len = 0;
+    file_size = 0;
+    failed = false;
+
+    /* journal is kept if owner's compacted file couldn't be written */
+    if (storage_request(storage_ns::UNLINK, storage_ns::AFTER_PREV_OK, name, NULL, 0,
+            write_done, this) != 0) {
+        failed = true;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void journal::write_done(void *arg, int8_t result)
+{
+    if (result != 0) {
+        ((journal *)arg)->failed = true;
+    }
+}
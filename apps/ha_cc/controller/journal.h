@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        journal.h
+ * @brief       Append-only journal file on FatFs.
+ *              Changes are appended as small records instead of rewriting the whole
+ *              file, owner folds them into its own file (compaction) and clears the
+ *              journal when the journal has grown to compact_size.
+ *
+ *              Record: | len (1) | type (1) | data (len) | crc16 (2) of type and data |
+ *
+ *              Records are buffered and queued to storage thread as one APPEND request on
+ *              flush (or when the buffer is full). A torn record at the end (e.g. power
+ *              loss) is dropped on replay.
+ *
+ *              The first record of a journal file is a generation record. Owner saves
+ *              generation + 1 in its compacted file before the journal is cleared, so a
+ *              journal left over by a power loss between the two steps is older than the
+ *              file and is not replayed.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef JOURNAL_H_
+#define JOURNAL_H_
+
+#include <stdint.h>
+
+namespace journal_ns {
+
+const uint8_t max_name_chars = 24;
+const uint8_t max_data_len = 64;
+const uint8_t record_overhead = 4; /* len + type + crc */
+
+const uint8_t generation_record = 0xFF; /* | generation (2) |, reserved type */
+
+/**
+ * @brief   Function applies a record on replay.
+ *
+ * @param[in]   type, type of the record.
+ * @param[in]   data, data of the record.
+ * @param[in]   len, len of data.
+ * @param[in]   arg, argument given to replay().
+ */
+typedef void (*replay_func_t)(uint8_t type, uint8_t *data, uint8_t len, void *arg);
+
+}
+
+class journal {
+public:
+    /**
+     * @brief   constructor, user must allocate buffer for records.
+     *
+     * @param[in]   buf, buffer holding records which haven't been written.
+     * @param[in]   buf_size, size of buf, MUST be >= record_overhead + max len of a record.
+     * @param[in]   compact_size, journal should be compacted after it has grown to this size.
+     * @param[in]   filename, name of journal file, NULL if it'll be set later.
+     */
+    journal(uint8_t *buf, uint16_t buf_size, uint32_t compact_size, const char *filename);
+
+    /**
+     * @brief   Set name of journal file. Buffered records are dropped.
+     *
+     * @param[in]   filename,
+     * @param[in]   ext, extension will be appended to filename (e.g. ".JNL"), can be NULL.
+     */
+    void set_name(const char *filename, const char *ext);
+
+    /**
+     * @brief   Add a record, it's written on next flush (or now if buffer is full).
+     *
+     * @param[in]   type, type of record.
+     * @param[in]   data,
+     * @param[in]   len, len of data (<= max_data_len).
+     *
+     * @return  -1 if error.
+     */
+    int8_t append(uint8_t type, const void *data, uint8_t len);
+
+    /**
+     * @brief   Queue buffered records to be appended to journal file (write-behind).
+     *          Nothing is written if there is no buffered record.
+     *
+     * @return  -1 if storage queue is full, records are kept in buffer.
+     */
+    int8_t flush(void);
+
+    /**
+     * @brief   Apply all records in journal file in order, torn or corrupted records at
+     *          the end are removed. Journal file of other generation is removed without
+     *          being applied.
+     *          Reads file directly, MUST be called in storage thread (storage_call).
+     *
+     * @param[in]   replay_func, function applies a record.
+     * @param[in]   arg, argument for replay_func.
+     *
+     * @return  number of records have been applied, -1 if error.
+     */
+    int16_t replay(journal_ns::replay_func_t replay_func, void *arg);
+
+    /**
+     * @brief   Drop buffered records and remove journal file (after owner's file has been
+     *          compacted). Journal file is not removed if the request queued right before
+     *          (writing owner's compacted file) fails.
+     */
+    void clear(void);
+
+    /**
+     * @brief   Check if a write of journal has failed since last clear(). Owner should
+     *          write its whole file when it has.
+     */
+    bool has_failed(void) { return failed; }
+
+    /**
+     * @brief   storage_ns::done_func_t for writes of journal, arg is the journal. Owner
+     *          uses it for write of its compacted file too.
+     */
+    static void write_done(void *arg, int8_t result);
+
+    /**
+     * @brief   Set generation of journal, it must be the one saved in owner's file before
+     *          replay() or clear() is called.
+     */
+    void set_generation(uint16_t generation) { this->generation = generation; }
+
+    /**
+     * @brief   Get generation of journal.
+     */
+    uint16_t get_generation(void) { return generation; }
+
+    /**
+     * @brief   Check if journal should be compacted, size of extra bytes can be given to
+     *          check before appending them.
+     */
+    bool need_compaction(uint32_t extra_bytes)
+        { return file_size + buf_len + extra_bytes >= compact_size; }
+
+private:
+    /**
+     * @brief   Build a record (record_overhead + len bytes).
+     */
+    void build_record(uint8_t *record, uint8_t type, const uint8_t *data, uint8_t len);
+
+    char name[journal_ns::max_name_chars];
+    uint8_t *buf;
+    uint16_t buf_size;
+    uint16_t buf_len;
+    uint32_t file_size;
+    uint32_t compact_size;
+    uint16_t generation;
+    volatile bool failed;
+};
+
+#endif // JOURNAL_H_
@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        rule_pool.cpp
+ * @brief       Pool of rules shared by all scenes.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#include <string.h>
+
+#include "rule_pool.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace rule_pool_ns;
+using namespace scene_ns;
+
+template<typename T> static void reverse(T *buf, uint32_t start, uint32_t end);
+
+/*----------------------------------------------------------------------------*/
+rule_pool::rule_pool(rule_t *rules, dev_rule_t *dev_rules, uint16_t *time_rules,
+        uint16_t num_rules, span_t *spans, uint8_t num_spans)
+{
+    this->rules = rules;
+    this->dev_rules = dev_rules;
+    this->time_rules = time_rules;
+    this->num_rules = num_rules;
+    this->spans = spans;
+    this->num_spans = num_spans;
+
+    num_used = 0;
+    for (uint8_t count = 0; count < num_spans; count++) {
+        spans[count].used = false;
+        spans[count].start = 0;
+        spans[count].size = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t rule_pool::alloc(uint16_t size)
+{
+    uint8_t span;
+    uint16_t top;
+
+    for (span = 0; span < num_spans; span++) {
+        if (!spans[span].used) {
+            break;
+        }
+    }
+    if (span == num_spans || size > get_num_free()) {
+        HA_DEBUG("rule_pool::alloc: no room for %hu rules\n", size);
+        return no_span;
+    }
+
+    top = get_top();
+    if (top + size > num_rules) {
+        compact(no_span);
+        top = get_top();
+    }
+
+    spans[span].used = true;
+    spans[span].start = top;
+    spans[span].size = size;
+    invalidate(top, top + size);
+    num_used += size;
+
+    return span;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t rule_pool::resize(uint8_t span, uint16_t size)
+{
+    uint16_t end, extra;
+
+    if (span >= num_spans || !spans[span].used) {
+        return -1;
+    }
+
+    if (size <= spans[span].size) {
+        num_used -= spans[span].size - size;
+        spans[span].size = size;
+        return 0;
+    }
+
+    extra = size - spans[span].size;
+    if (extra > get_num_free()) {
+        HA_DEBUG("rule_pool::resize: no room for %hu rules\n", extra);
+        return -1;
+    }
+
+    /* grow in place if rules after the span are free, otherwise it's moved to the end */
+    end = spans[span].start + spans[span].size;
+    if (end + extra > num_rules || !is_free(end, end + extra, span)) {
+        compact(span);
+        end = spans[span].start + spans[span].size;
+    }
+
+    invalidate(end, end + extra);
+    spans[span].size = size;
+    num_used += extra;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void rule_pool::free(uint8_t span)
+{
+    if (span >= num_spans || !spans[span].used) {
+        return;
+    }
+
+    num_used -= spans[span].size;
+    spans[span].used = false;
+    spans[span].start = 0;
+    spans[span].size = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+rule_t *rule_pool::get_rules(uint8_t span)
+{
+    if (span >= num_spans || !spans[span].used) {
+        return NULL;
+    }
+    return &rules[spans[span].start];
+}
+
+/*----------------------------------------------------------------------------*/
+dev_rule_t *rule_pool::get_dev_rules(uint8_t span)
+{
+    if (span >= num_spans || !spans[span].used) {
+        return NULL;
+    }
+    return &dev_rules[spans[span].start * rule_max_input];
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t *rule_pool::get_time_rules(uint8_t span)
+{
+    if (span >= num_spans || !spans[span].used) {
+        return NULL;
+    }
+    return &time_rules[spans[span].start];
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t rule_pool::get_span_size(uint8_t span)
+{
+    if (span >= num_spans || !spans[span].used) {
+        return 0;
+    }
+    return spans[span].size;
+}
+
+/*------------------------ Private methods -----------------------------------*/
+uint16_t rule_pool::get_top(void)
+{
+    uint16_t top = 0;
+
+    for (uint8_t count = 0; count < num_spans; count++) {
+        if (spans[count].used && spans[count].start + spans[count].size > top) {
+            top = spans[count].start + spans[count].size;
+        }
+    }
+
+    return top;
+}
+
+/*----------------------------------------------------------------------------*/
+bool rule_pool::is_free(uint16_t start, uint16_t end, uint8_t skip_span)
+{
+    for (uint8_t count = 0; count < num_spans; count++) {
+        if (count == skip_span || !spans[count].used) {
+            continue;
+        }
+
+        if (spans[count].start < end && start < spans[count].start + spans[count].size) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+void rule_pool::compact(uint8_t last_span)
+{
+    uint16_t cursor = 0, start, top;
+    uint8_t count, next;
+
+    /* empty spans take no room, they are placed at 0 */
+    for (count = 0; count < num_spans; count++) {
+        if (spans[count].used && spans[count].size == 0) {
+            spans[count].start = 0;
+        }
+    }
+
+    /* move spans down in order of start, spans not moved yet are all after cursor */
+    while (1) {
+        next = no_span;
+        for (count = 0; count < num_spans; count++) {
+            if (spans[count].used && spans[count].size > 0 && spans[count].start >= cursor &&
+                    (next == no_span || spans[count].start < spans[next].start)) {
+                next = count;
+            }
+        }
+
+        if (next == no_span) {
+            break;
+        }
+
+        if (spans[next].start != cursor) {
+            move_down(spans[next].start, spans[next].start + spans[next].size, cursor);
+            spans[next].start = cursor;
+        }
+        cursor += spans[next].size;
+    }
+
+    /* then last_span goes after all others, so it can grow */
+    if (last_span == no_span || spans[last_span].size == 0) {
+        if (last_span != no_span) {
+            spans[last_span].start = cursor;
+        }
+        return;
+    }
+
+    start = spans[last_span].start;
+    top = cursor;
+    if (start + spans[last_span].size == top) {
+        return;
+    }
+
+    rotate(start, start + spans[last_span].size, top);
+    for (count = 0; count < num_spans; count++) {
+        if (spans[count].used && spans[count].size > 0 && spans[count].start > start) {
+            spans[count].start -= spans[last_span].size;
+        }
+    }
+    spans[last_span].start = top - spans[last_span].size;
+}
+
+/*----------------------------------------------------------------------------*/
+void rule_pool::move_down(uint16_t start, uint16_t end, uint16_t new_start)
+{
+    memmove(&rules[new_start], &rules[start], (end - start) * sizeof(rule_t));
+    memmove(&dev_rules[new_start * rule_max_input], &dev_rules[start * rule_max_input],
+            (end - start) * rule_max_input * sizeof(dev_rule_t));
+    memmove(&time_rules[new_start], &time_rules[start], (end - start) * sizeof(uint16_t));
+}
+
+/*----------------------------------------------------------------------------*/
+void rule_pool::rotate(uint16_t start, uint16_t middle, uint16_t end)
+{
+    /* rotation by 3 reversals, in place */
+    reverse(rules, start, middle);
+    reverse(rules, middle, end);
+    reverse(rules, start, end);
+
+    reverse(dev_rules, start * rule_max_input, middle * rule_max_input);
+    reverse(dev_rules, middle * rule_max_input, end * rule_max_input);
+    reverse(dev_rules, start * rule_max_input, end * rule_max_input);
+
+    reverse(time_rules, start, middle);
+    reverse(time_rules, middle, end);
+    reverse(time_rules, start, end);
+}
+
+/*----------------------------------------------------------------------------*/
+void rule_pool::invalidate(uint16_t start, uint16_t end)
+{
+    for (uint16_t count = start; count < end; count++) {
+        rules[count].is_valid = false;
+        rules[count].is_active = false;
+        rules[count].num_in = 0;
+        rules[count].num_out = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+template<typename T> static void reverse(T *buf, uint32_t start, uint32_t end)
+{
+    T tmp;
+
+    while (start + 1 < end) {
+        end--;
+        tmp = buf[start];
+        buf[start] = buf[end];
+        buf[end] = tmp;
+        start++;
+    }
+}
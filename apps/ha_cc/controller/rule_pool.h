@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        rule_pool.h
+ * @brief       Pool of rules shared by all scenes.
+ *              Each scene owns a span (a contiguous range) of the pool which is as large
+ *              as its number of rules. Rule index of a span (device -> rules, time rules)
+ *              is kept in parallel buffers, rule_max_input device entries and one time
+ *              entry for each rule.
+ *
+ *              Spans are moved when the pool is compacted (a span can't grow in place),
+ *              so pointers returned by get_rules, get_dev_rules and get_time_rules are
+ *              only valid until next alloc or resize.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef RULE_POOL_H_
+#define RULE_POOL_H_
+
+#include <stdint.h>
+
+#include "scene_rule.h"
+
+namespace rule_pool_ns {
+
+const uint8_t no_span = 0xFF;
+
+typedef struct span_s {
+    bool used;
+    uint16_t start;
+    uint16_t size;
+} span_t;
+
+/* bytes of one rule in pool (rule and its index entries) */
+const uint16_t bytes_per_rule = sizeof(scene_ns::rule_t)
+        + scene_ns::rule_max_input * sizeof(scene_ns::dev_rule_t) + sizeof(uint16_t);
+
+}
+
+class rule_pool {
+public:
+    /**
+     * @brief   constructor, user must allocate buffers for rules, rule index and spans.
+     *
+     * @param[in]   rules, buffer of num_rules rules.
+     * @param[in]   dev_rules, buffer of num_rules * rule_max_input device index entries.
+     * @param[in]   time_rules, buffer of num_rules time index entries.
+     * @param[in]   num_rules, size of the pool in rules.
+     * @param[in]   spans, buffer of spans, one for each scene.
+     * @param[in]   num_spans, number of spans in the buffer (< no_span).
+     */
+    rule_pool(scene_ns::rule_t *rules, scene_ns::dev_rule_t *dev_rules, uint16_t *time_rules,
+            uint16_t num_rules, rule_pool_ns::span_t *spans, uint8_t num_spans);
+
+    /**
+     * @brief   Allocate a span, new rules are invalid.
+     *
+     * @param[in]   size, number of rules, can be 0.
+     *
+     * @return  span id, no_span if there is no free span or the pool is exhausted.
+     */
+    uint8_t alloc(uint16_t size);
+
+    /**
+     * @brief   Resize a span, rules in [0, min(old size, size)) are kept, new rules are
+     *          invalid. The pool is compacted if the span can't grow in place.
+     *
+     * @param[in]   span, span id.
+     * @param[in]   size, new number of rules.
+     *
+     * @return  0 on success, -1 if the pool is exhausted (span is not changed).
+     */
+    int8_t resize(uint8_t span, uint16_t size);
+
+    /**
+     * @brief   Free a span.
+     */
+    void free(uint8_t span);
+
+    /**
+     * @brief   Get rules of a span.
+     *
+     * @return  pointer to the first rule, NULL if span is not used.
+     */
+    scene_ns::rule_t *get_rules(uint8_t span);
+
+    /**
+     * @brief   Get device index entries of a span (size * rule_max_input entries).
+     */
+    scene_ns::dev_rule_t *get_dev_rules(uint8_t span);
+
+    /**
+     * @brief   Get time index entries of a span (size entries).
+     */
+    uint16_t *get_time_rules(uint8_t span);
+
+    /**
+     * @brief   Get number of rules of a span, 0 if span is not used.
+     */
+    uint16_t get_span_size(uint8_t span);
+
+    /**
+     * @brief   Memory accounting, in rules (rule_pool_ns::bytes_per_rule bytes each).
+     */
+    uint16_t get_size(void) { return num_rules; }
+    uint16_t get_num_used(void) { return num_used; }
+    uint16_t get_num_free(void) { return num_rules - num_used; }
+
+private:
+    /**
+     * @brief   Get end of the last span (first rule has never been used after it).
+     */
+    uint16_t get_top(void);
+
+    /**
+     * @brief   Check if rules in [start, end) are not used by any span except skip_span.
+     */
+    bool is_free(uint16_t start, uint16_t end, uint8_t skip_span);
+
+    /**
+     * @brief   Move all spans to the beginning of the pool (in their order), then move
+     *          last_span after all other spans.
+     */
+    void compact(uint8_t last_span);
+
+    /**
+     * @brief   Move rules in [start, end) to new_start (< start), their index too.
+     */
+    void move_down(uint16_t start, uint16_t end, uint16_t new_start);
+
+    /**
+     * @brief   Swap range [start, middle) and range [middle, end) (rotate), their index too.
+     */
+    void rotate(uint16_t start, uint16_t middle, uint16_t end);
+
+    /**
+     * @brief   Set rules in [start, end) to invalid.
+     */
+    void invalidate(uint16_t start, uint16_t end);
+
+    scene_ns::rule_t *rules;
+    scene_ns::dev_rule_t *dev_rules;
+    uint16_t *time_rules;
+    uint16_t num_rules;
+    uint16_t num_used;
+
+    rule_pool_ns::span_t *spans;
+    uint8_t num_spans;
+};
+
+#endif // RULE_POOL_H_
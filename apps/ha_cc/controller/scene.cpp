@@ -15,6 +15,9 @@
 #include <stdlib.h>
 
 #include "scene.h"
+#include "scene_file.h"
+#include "crc16.h"
+#include "storage.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
 #include "gff_mesg_id.h"
@@ -27,6 +30,7 @@
 
 using namespace scene_ns;
 
+/* old text format, only for reading */
 static const char save_line_rule[] = "R: %u %u %u %u\n"; /* is_valid, is_active, num_in, num_out */
 static const char save_line_i0[] = "I: %u\n";          /* cond */
 static const char save_line_i1_devval[] = "%lx %d\n"; /* device id, value */
@@ -34,14 +38,41 @@ static const char save_line_i1_time[] = "%lx %lx\n";  /* time start, time end */
 static const char save_line_o0[] = "O: %u\n";          /* action */
 static const char save_line_o1_devval[] = "%lx %d\n"; /* device id, value */
 
+static void restore_text(FIL *file, scene *scene_p);
+
 /*----------------------------------------------------------------------------*/
 scene::scene(void)
+    : rules_journal(journal_buf, sizeof(journal_buf), scene_file_ns::journal_compact_size, NULL)
 {
     cur_num_rules = 0;
     name[0] = '\0';
-    clear_all_rules();
+
+    pool = NULL;
+    span = rule_pool_ns::no_span;
 
     last_invalid_index = 0;
+
+    changed_rules = 0;
+    num_rules_changed = false;
+    need_full_save = true;
+
+    num_dev_rules = 0;
+    num_time_rules = 0;
+    rule_index_changed = true;
+    schedule_changed = true;
+    starting = true;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::set_rule_pool(rule_pool *pool)
+{
+    this->pool = pool;
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t scene::get_capacity(void)
+{
+    return (pool == NULL) ? 0 : pool->get_span_size(span);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -61,6 +92,10 @@ void scene::set_name(const char *new_name)
 {
     memcpy(name, new_name, scene_max_name_chars - 1);
     name[scene_max_name_chars - 1] = '\0';
+
+    /* journal of other scene file */
+    rules_journal.set_name(name, scene_file_ns::journal_ext);
+    need_full_save = true;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -70,29 +105,55 @@ uint16_t scene::get_cur_num_rules(void)
 }
 
 /*----------------------------------------------------------------------------*/
-void scene::set_cur_num_rules(uint16_t num_rules)
+int8_t scene::set_cur_num_rules(uint16_t num_rules)
 {
+    if (reserve_rules(num_rules) != 0) {
+        return -1;
+    }
+
+    /* rules after num_rules are given back to rule pool */
+    pool->resize(span, num_rules);
+
     cur_num_rules = num_rules;
+    num_rules_changed = true;
+    rule_index_changed = true;
+
+    return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 void scene::new_scene(void)
 {
     cur_num_rules = 0;
-    clear_all_rules();
+    if (pool != NULL) {
+        pool->free(span);
+    }
+    span = rule_pool_ns::no_span;
+
+    num_dev_rules = 0;
+    num_time_rules = 0;
+    rule_index_changed = true;
+    starting = true;
+    need_full_save = true;
 }
 
 /*----------------------------------------------------------------------------*/
 int8_t scene::add_rule_with_index(rule_t &rule, uint16_t index)
 {
-    if (index >= scene_max_rules) {
+    rule_t *rules_list;
+
+    if (index >= scene_max_rules || reserve_rules(index + 1) != 0) {
         return -1;
     }
 
+    rules_list = pool->get_rules(span);
     memcpy(&rules_list[index], &rule, sizeof(rule_t));
     if (index >= cur_num_rules) {
         cur_num_rules = index + 1;
+        num_rules_changed = true;
     }
+    changed_rules |= (uint32_t)1 << index;
+    rule_index_changed = true;
 
     return 0;
 }
@@ -104,7 +165,12 @@ int8_t scene::get_rule_with_index(rule_t &rule, uint16_t index)
         return -1;
     }
 
-    memcpy(&rule, &rules_list[index], sizeof(rule_t));
+    if (index >= get_capacity()) {
+        rule = rule_t();
+        return 0;
+    }
+
+    memcpy(&rule, &pool->get_rules(span)[index], sizeof(rule_t));
 
     return 0;
 }
@@ -112,16 +178,20 @@ int8_t scene::get_rule_with_index(rule_t &rule, uint16_t index)
 /*----------------------------------------------------------------------------*/
 void scene::remove_rule_with_index(uint16_t index)
 {
-    if (index >= scene_max_rules) {
+    if (index >= get_capacity()) {
         return;
     }
 
-    rules_list[index].is_valid = false;
+    pool->get_rules(span)[index].is_valid = false;
+    changed_rules |= (uint32_t)1 << index;
+    rule_index_changed = true;
 }
 
 /*----------------------------------------------------------------------------*/
 bool scene::find_invalid_rule(uint16_t &index, bool cont)
 {
+    rule_t *rules_list = (pool == NULL) ? NULL : pool->get_rules(span);
+
     if (!cont) {
         for(uint8_t count = 0; count < cur_num_rules; count++) {
             if (!rules_list[count].is_valid) {
@@ -147,75 +217,84 @@ bool scene::find_invalid_rule(uint16_t &index, bool cont)
 /*----------------------------------------------------------------------------*/
 int8_t scene::save(void)
 {
-    FIL file;
-    FRESULT fres;
-    uint8_t count_io, count_rule;
+    uint8_t record[scene_file_ns::jnl_rule_set_len];
+    uint16_t index, capacity;
+    uint32_t journal_bytes;
+    int8_t retval = 0;
 
     if(name == NULL) {
         return -1;
     }
 
-    /* open file */
-    fres = f_open(&file, name, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("scene::save: Error when open file %s\n", name);
-        print_ferr(fres);
-        return -1;
+    journal_bytes = __builtin_popcount(changed_rules) *
+            (scene_file_ns::jnl_rule_set_len + journal_ns::record_overhead);
+    if (need_full_save || rules_journal.has_failed() ||
+            rules_journal.need_compaction(journal_bytes)) {
+        return save_all_rules();
     }
-    f_sync(&file);
-
-    /* write data */
-    for (count_rule = 0; count_rule < cur_num_rules; count_rule++) {
-        /* Save rule */
-        f_printf(&file, save_line_rule,
-                rules_list[count_rule].is_valid, rules_list[count_rule].is_active,
-                rules_list[count_rule].num_in, rules_list[count_rule].num_out);
 
-        /* Save input */
-        for (count_io = 0; count_io < rules_list[count_rule].num_in; count_io++){
-            f_printf(&file, save_line_i0, rules_list[count_rule].inputs[count_io].cond);
+    /* append changed rules only, rules given back to rule pool are dropped by
+     * JNL_NUM_RULES */
+    capacity = get_capacity();
+    for (index = 0; index < capacity; index++) {
+        if ((changed_rules & ((uint32_t)1 << index)) == 0) {
+            continue;
+        }
 
-            if (rules_list[count_rule].inputs[count_io].cond == COND_IN_RANGE ||
-                    rules_list[count_rule].inputs[count_io].cond == COND_IN_RANGE_EVDAY) {
-                f_printf(&file, save_line_i1_time,
-                        rules_list[count_rule].inputs[count_io].time_range.start,
-                        rules_list[count_rule].inputs[count_io].time_range.end);
-            }
-            else {
-                f_printf(&file, save_line_i1_devval,
-                        rules_list[count_rule].inputs[count_io].dev_val.device_id,
-                        rules_list[count_rule].inputs[count_io].dev_val.value);
-            }
+        record[0] = (uint8_t)index;
+        memcpy(&record[1], &pool->get_rules(span)[index], sizeof(rule_t));
+        if (rules_journal.append(scene_file_ns::JNL_RULE_SET, record,
+                scene_file_ns::jnl_rule_set_len) != 0) {
+            retval = -1;
         }
+    }
 
-        /* Save output */
-        for (count_io = 0; count_io < rules_list[count_rule].num_out; count_io++) {
-            f_printf(&file, save_line_o0, rules_list[count_rule].outputs[count_io].action);
-            f_printf(&file, save_line_o1_devval,
-                    rules_list[count_rule].outputs[count_io].dev_val.device_id,
-                    rules_list[count_rule].outputs[count_io].dev_val.value);
+    if (num_rules_changed) {
+        uint162buf(cur_num_rules, record);
+        if (rules_journal.append(scene_file_ns::JNL_NUM_RULES, record,
+                scene_file_ns::jnl_num_rules_len) != 0) {
+            retval = -1;
         }
+    }
 
-        f_sync(&file);
+    if (rules_journal.flush() != 0) {
+        retval = -1;
     }
 
-    f_close(&file);
+    changed_rules = 0;
+    num_rules_changed = false;
 
-    return 0;
+    if (retval != 0) {
+        /* journal may miss changes, write whole scene next time */
+        HA_DEBUG("scene::save: Error when write journal of %s\n", name);
+        need_full_save = true;
+    }
+
+    return retval;
 }
 
 /*----------------------------------------------------------------------------*/
 int8_t scene::restore(void)
+{
+    return storage_call(restore_call, this);
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene::restore_call(void *arg)
+{
+    return ((scene *)arg)->restore_file();
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene::restore_file(void)
 {
     FIL file;
     FRESULT fres;
-    uint8_t count_io, count_rule;
-    TCHAR* ret;
-    char line[32];
-    rule_t read_rule;
-
-    unsigned int is_valid_ui, is_active_ui, num_in_ui, num_out_ui, condact_ui;
-    int value_i;
+    UINT bytes;
+    scene_file_ns::header_t header;
+    rule_t *rules_list;
+    int8_t retval = 0;
+    int16_t num_records;
 
     if (name == NULL) {
         return -1;
@@ -223,6 +302,7 @@ int8_t scene::restore(void)
 
     /* new scene */
     new_scene();
+    rules_journal.set_generation(0);
 
     /* open file */
     fres = f_open(&file, name, FA_READ | FA_OPEN_ALWAYS);
@@ -232,12 +312,167 @@ int8_t scene::restore(void)
         return -1;
     }
 
+    fres = f_read(&file, &header, sizeof(header), &bytes);
+    if (fres != FR_OK) {
+        print_ferr(fres);
+        retval = -1;
+    }
+    else if (bytes == sizeof(header) && header.magic == scene_file_ns::magic) {
+        /* binary scene file */
+        if (header.version != scene_file_ns::version || header.rule_size != sizeof(rule_t)
+                || header.num_rules > scene_max_rules) {
+            HA_NOTIFY("scene::restore: %s has unsupported format (v%hu, %hu bytes rule)\n",
+                    name, header.version, header.rule_size);
+            retval = -1;
+        }
+        else if (reserve_rules(header.num_rules) != 0) {
+            retval = -1;
+        }
+        else {
+            rules_list = pool->get_rules(span);
+            bytes = 0;
+            if (header.num_rules > 0) {
+                fres = f_read(&file, rules_list, header.num_rules * sizeof(rule_t), &bytes);
+            }
+            if (fres != FR_OK || bytes != header.num_rules * sizeof(rule_t) ||
+                    crc16_ccitt(crc16_ns::crc16_init, (uint8_t *)rules_list, bytes)
+                            != header.crc) {
+                HA_NOTIFY("scene::restore: %s is corrupted\n", name);
+                retval = -1;
+            }
+            else {
+                cur_num_rules = header.num_rules;
+                rules_journal.set_generation(header.journal_gen);
+            }
+        }
+    }
+    else if (f_size(&file) > 0) {
+        /* old text scene file, it will be saved in binary format */
+        f_lseek(&file, 0);
+        restore_text(&file, this);
+        f_close(&file);
+
+        HA_NOTIFY("scene::restore: %s converted to binary format\n", name);
+        save();
+        build_rule_index();
+        return 0;
+    }
+
+    /* close file */
+    f_close(&file);
+
+    if (retval != 0) {
+        new_scene();
+    }
+    else {
+        /* changes after last save of whole scene */
+        num_records = rules_journal.replay(replay_record, this);
+        HA_DEBUG("scene::restore: %s, %d journal records\n", name, num_records);
+
+        changed_rules = 0;
+        num_rules_changed = false;
+        need_full_save = false;
+    }
+
+    /* rebuild rule index for new rules */
+    rule_index_changed = true;
+    build_rule_index();
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene::save_all_rules(void)
+{
+    scene_file_ns::header_t header;
+    rule_t *rules_list = (pool == NULL) ? NULL : pool->get_rules(span);
+
+    header.magic = scene_file_ns::magic;
+    header.version = scene_file_ns::version;
+    header.rule_size = sizeof(rule_t);
+    header.num_rules = cur_num_rules;
+    header.crc = crc16_ccitt(crc16_ns::crc16_init, (uint8_t *)rules_list,
+            cur_num_rules * sizeof(rule_t));
+    header.journal_gen = rules_journal.get_generation() + 1;
+
+    /* header and rules are queued to storage thread, a failed write is reported to
+     * journal so the whole scene is written again */
+    if (storage_begin(storage_ns::WRITE, 0, name,
+            sizeof(header) + cur_num_rules * sizeof(rule_t),
+            journal::write_done, &rules_journal) != 0) {
+        HA_DEBUG("scene::save: Storage queue is full, %s\n", name);
+        need_full_save = true;
+        return -1;
+    }
+    storage_add_data(&header, sizeof(header));
+    if (cur_num_rules > 0) {
+        storage_add_data(rules_list, cur_num_rules * sizeof(rule_t));
+    }
+    storage_end();
+
+    /* journal of old generation is not needed anymore */
+    rules_journal.set_generation(header.journal_gen);
+    rules_journal.clear();
+
+    changed_rules = 0;
+    num_rules_changed = false;
+    need_full_save = false;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::replay_record(uint8_t type, uint8_t *data, uint8_t len, void *arg)
+{
+    scene *scene_p = (scene *)arg;
+    uint16_t num_rules;
+
+    switch (type) {
+    case scene_file_ns::JNL_RULE_SET:
+        if (len != scene_file_ns::jnl_rule_set_len || data[0] >= scene_max_rules ||
+                scene_p->reserve_rules(data[0] + 1) != 0) {
+            break;
+        }
+        memcpy(&scene_p->pool->get_rules(scene_p->span)[data[0]], &data[1], sizeof(rule_t));
+        break;
+
+    case scene_file_ns::JNL_NUM_RULES:
+        if (len != scene_file_ns::jnl_num_rules_len) {
+            break;
+        }
+        num_rules = buf2uint16(data);
+        if (num_rules > scene_max_rules) {
+            num_rules = scene_max_rules;
+        }
+        if (scene_p->reserve_rules(num_rules) != 0) {
+            num_rules = scene_p->get_capacity();
+        }
+        scene_p->cur_num_rules = num_rules;
+        break;
+
+    default:
+        HA_DEBUG("scene::replay_record: Unknown record %hu\n", type);
+        break;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static void restore_text(FIL *file, scene *scene_p)
+{
+    uint8_t count_io, count_rule;
+    TCHAR* ret;
+    char line[32];
+    rule_t read_rule;
+
+    unsigned int is_valid_ui, is_active_ui, num_in_ui, num_out_ui, condact_ui;
+    int value_i;
+
     /* Read file */
     count_rule = 0;
     while (1) {
 
         /* Read rule */
-        ret = f_gets(line, sizeof(line), &file);
+        ret = f_gets(line, sizeof(line), file);
         if (ret == 0) {
             break;
         }
@@ -251,7 +486,7 @@ int8_t scene::restore(void)
         for (count_io = 0; count_io < read_rule.num_in; count_io++) {
 
             /* get conditon */
-            ret = f_gets(line, sizeof(line), &file);
+            ret = f_gets(line, sizeof(line), file);
             if (ret == 0) {
                 break;
             }
@@ -259,7 +494,7 @@ int8_t scene::restore(void)
             read_rule.inputs[count_io].cond = (uint8_t)condact_ui;
 
             /* get input for condition */
-            ret = f_gets(line, sizeof(line), &file);
+            ret = f_gets(line, sizeof(line), file);
             if (ret == 0) {
                 break;
             }
@@ -283,7 +518,7 @@ int8_t scene::restore(void)
         for (count_io = 0; count_io < read_rule.num_out; count_io++) {
 
             /* get action */
-            ret = f_gets(line, sizeof(line), &file);
+            ret = f_gets(line, sizeof(line), file);
             if (ret == 0) {
                 break;
             }
@@ -291,7 +526,7 @@ int8_t scene::restore(void)
             read_rule.outputs[count_io].action = (uint8_t)condact_ui;
 
             /* get output for action */
-            ret = f_gets(line, sizeof(line), &file);
+            ret = f_gets(line, sizeof(line), file);
             if (ret == 0) {
                 break;
             }
@@ -303,265 +538,465 @@ int8_t scene::restore(void)
         }/* end read output */
 
         /* add rule to rules_list */
-        add_rule_with_index(read_rule, count_rule);
+        scene_p->add_rule_with_index(read_rule, count_rule);
         count_rule++;
     }/* end while */
-
-    /* close file */
-    f_close(&file);
-
-    return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 void scene::process(bool trigger_by_report,
         ha_device *device_rpt, ha_device_mng *cur_device_mng,
         rtc *rtc_obj,
-        cir_queue *out_queue, kernel_pid_t out_pid)
+        action_batch *out_batch)
 {
-    bool all_cond_satisfied, has_trigger_src;
-    uint16_t c_rule, c_in, c_out;
-    uint32_t cur_time;
-    int16_t value;
-    uint8_t act_gff[ha_ns::SET_DEV_VAL_DATA_LEN + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE];
-    msg_t mesg;
+    uint16_t pos, count;
+    uint32_t device_id, cur_time;
+    dev_rule_t *dev_rules_index;
+    uint16_t *time_rules_index;
 
-    for (c_rule = 0; c_rule < cur_num_rules; c_rule++) {
+    if (rule_index_changed) {
+        build_rule_index();
+    }
 
-        /* Check valid and active */
-        if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
-            HA_DEBUG("scene::process: Rule %hu is not valid or active\n", c_rule);
+    if (get_capacity() == 0) {
+        return;
+    }
+    dev_rules_index = pool->get_dev_rules(span);
+    time_rules_index = pool->get_time_rules(span);
+    cur_time = rtc_obj->get_time_packed();
+
+    if (trigger_by_report) {
+        /* only rules having a condition on the reporting device */
+        device_id = device_rpt->get_device_id();
+        for (pos = find_first_dev_rule(device_id);
+                (pos < num_dev_rules) && (dev_rules_index[pos].device_id == device_id);
+                pos++) {
+            process_rule(dev_rules_index[pos].rule_index, trigger_by_report,
+                    device_rpt, cur_device_mng, cur_time, out_batch, false);
+        }
+    }
+    else {
+        /* only rules having a time condition */
+        for (count = 0; count < num_time_rules; count++) {
+            process_rule(time_rules_index[count], trigger_by_report,
+                    device_rpt, cur_device_mng, cur_time, out_batch, false);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::process_expired(ha_device *device_exp, ha_device_mng *cur_device_mng,
+        rtc *rtc_obj, action_batch *out_batch)
+{
+    uint16_t pos;
+    uint32_t device_id, cur_time;
+    dev_rule_t *dev_rules_index;
+
+    if (rule_index_changed) {
+        build_rule_index();
+    }
+
+    if (get_capacity() == 0) {
+        return;
+    }
+    dev_rules_index = pool->get_dev_rules(span);
+    cur_time = rtc_obj->get_time_packed();
+
+    /* only rules having a condition on the expired device */
+    device_id = device_exp->get_device_id();
+    for (pos = find_first_dev_rule(device_id);
+            (pos < num_dev_rules) && (dev_rules_index[pos].device_id == device_id);
+            pos++) {
+        process_rule(dev_rules_index[pos].rule_index, true, device_exp, cur_device_mng,
+                cur_time, out_batch, true);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::schedule(time_sched *sched, uint8_t slot, uint32_t cur_time)
+{
+    bool evaluate_now;
+    uint16_t count;
+    uint16_t *time_rules_index;
+    time_sched_ns::entry_t entry;
+
+    if (rule_index_changed) {
+        build_rule_index();
+    }
+    schedule_changed = false;
+    evaluate_now = starting;
+    starting = false;
+
+    if (get_capacity() == 0) {
+        return;
+    }
+    time_rules_index = pool->get_time_rules(span);
+
+    entry.slot = slot;
+    for (count = 0; count < num_time_rules; count++) {
+        entry.rule_index = time_rules_index[count];
+        if (evaluate_now) {
+            /* evaluate all time rules now, next instants are pushed after that */
+            entry.instant = cur_time;
+            entry.edge = true;
+        }
+        else {
+            /* rules have been edited, others have been evaluated already, only wait for
+             * next edges */
+            entry.instant = get_next_time_event(entry.rule_index, cur_time, entry.edge);
+            if (entry.instant == time_sched_ns::never) {
+                continue;
+            }
+        }
+
+        if (sched->push(entry) < 0) {
+            HA_NOTIFY("scene %s: time schedule is full, %hu time rules are not scheduled\n",
+                    name, num_time_rules - count);
+            return;
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void scene::process_time_entry(time_sched *sched, time_sched_ns::entry_t &entry,
+        uint32_t cur_time, ha_device_mng *cur_device_mng, action_batch *out_batch)
+{
+    if (entry.rule_index >= get_capacity()) {
+        return;
+    }
+
+    if (entry.edge) {
+        process_rule(entry.rule_index, false, NULL, cur_device_mng, cur_time,
+                out_batch, false);
+    }
+
+    entry.instant = get_next_time_event(entry.rule_index, cur_time, entry.edge);
+    if (entry.instant == time_sched_ns::never) {
+        HA_DEBUG("scene::process_time_entry: rule %hu won't be triggered anymore\n",
+                entry.rule_index);
+        return;
+    }
+
+    if (sched->push(entry) < 0) {
+        HA_NOTIFY("scene %s: time schedule is full, rule %hu is not scheduled\n",
+                name, entry.rule_index);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t scene::get_next_time_event(uint16_t c_rule, uint32_t cur_time, bool &edge)
+{
+    uint16_t c_in;
+    uint32_t next = time_sched_ns::never, instant, start, end, cur_day;
+    bool instant_edge;
+    rule_t *rules_list = pool->get_rules(span);
+
+    edge = false;
+    for (c_in = 0; (c_in < rules_list[c_rule].num_in) && (c_in < rule_max_input); c_in++) {
+        input_t *input_p = &rules_list[c_rule].inputs[c_in];
+
+        switch (input_p->cond) {
+        case COND_IN_RANGE:
+            /* becomes true at start, false after end */
+            instant_edge = true;
+            if (cur_time < input_p->time_range.start) {
+                instant = input_p->time_range.start;
+            }
+            else if (cur_time <= input_p->time_range.end) {
+                instant = input_p->time_range.end + 1;
+            }
+            else {
+                instant = time_sched_ns::never;
+            }
+            break;
+
+        case COND_IN_RANGE_EVDAY:
+            /* same as COND_IN_RANGE in current day (hour, min, sec) */
+            start = input_p->time_range.start & 0xFFFF;
+            end = input_p->time_range.end & 0xFFFF;
+            cur_day = cur_time & 0xFFFF0000;
+            instant_edge = true;
+            if ((cur_time & 0xFFFF) < start) {
+                instant = cur_day | start;
+            }
+            else if ((cur_time & 0xFFFF) <= end) {
+                instant = cur_day | (end + 1);
+            }
+            else {
+                /* day field is the lowest field of date, next day is after this value */
+                instant = cur_day + 0x10000;
+                instant_edge = false;
+            }
+            break;
+
+        default:
             continue;
         }
 
-        /* process inputs */
-        all_cond_satisfied = true;
-        has_trigger_src = false;
-        for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
-            input_t *input_p = &rules_list[c_rule].inputs[c_in];
+        if (instant < next) {
+            next = instant;
+            edge = instant_edge;
+        }
+        else if (instant == next && instant_edge) {
+            edge = true;
+        }
+    }
+
+    return next;
+}
 
-            switch (input_p->cond) {
+/*----------------------------------------------------------------------------*/
+void scene::process_rule(uint16_t c_rule, bool trigger_by_report,
+        ha_device *device_rpt, ha_device_mng *cur_device_mng,
+        uint32_t cur_time,
+        action_batch *out_batch, bool dev_expired)
+{
+    bool all_cond_satisfied, has_trigger_src, cont_mult_vals;
+    uint16_t c_in, c_out, num_rules;
+    int16_t value;
+    rule_t *rules_list = pool->get_rules(span);
 
-            case COND_IN_RANGE:
-                HA_DEBUG("scene::process: COND_IN_RANGE\n");
+    /* Check valid and active */
+    if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
+        HA_DEBUG("scene::process: Rule %hu is not valid or active\n", c_rule);
+        return;
+    }
 
-                if (!trigger_by_report) {
-                    has_trigger_src = true;
-                }
+    /* process inputs */
+    all_cond_satisfied = true;
+    has_trigger_src = false;
+    for (c_in = 0; c_in < rules_list[c_rule].num_in; c_in++) {
+        input_t *input_p = &rules_list[c_rule].inputs[c_in];
 
-                cur_time = rtc_obj->get_time_packed();
-                if (cur_time < input_p->time_range.start ||
-                        cur_time > input_p->time_range.end) {
-                    all_cond_satisfied = false;
-                }
+        switch (input_p->cond) {
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
-                        all_cond_satisfied, has_trigger_src,
-                        cur_time, input_p->time_range.start, input_p->time_range.end);
-                break;
+        case COND_IN_RANGE:
+            HA_DEBUG("scene::process: COND_IN_RANGE\n");
 
-            case COND_IN_RANGE_EVDAY:
-                if (!trigger_by_report) {
-                    has_trigger_src = true;
-                }
+            if (!trigger_by_report) {
+                has_trigger_src = true;
+            }
 
-                HA_DEBUG("scene::process: COND_IN_RANGE_EVDAY\n");
+            if (cur_time < input_p->time_range.start ||
+                    cur_time > input_p->time_range.end) {
+                all_cond_satisfied = false;
+            }
 
-                cur_time = rtc_obj->get_time_packed();
-                cur_time = cur_time & 0xFFFF;
+            HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
+                    all_cond_satisfied, has_trigger_src,
+                    cur_time, input_p->time_range.start, input_p->time_range.end);
+            break;
 
-                /* only hour, min, sec will be cared */
-                if ( cur_time < (input_p->time_range.start & 0xFFFF) ||
-                        cur_time > (input_p->time_range.end & 0xFFFF)) {
-                    all_cond_satisfied = false;
-                }
+        case COND_IN_RANGE_EVDAY:
+            if (!trigger_by_report) {
+                has_trigger_src = true;
+            }
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
-                        all_cond_satisfied, has_trigger_src,
-                        cur_time,
-                        input_p->time_range.start & 0xFFFF, input_p->time_range.end & 0xFFFF);
-                break;
+            HA_DEBUG("scene::process: COND_IN_RANGE_EVDAY\n");
 
+            /* only hour, min, sec will be cared */
+            if ((cur_time & 0xFFFF) < (input_p->time_range.start & 0xFFFF) ||
+                    (cur_time & 0xFFFF) > (input_p->time_range.end & 0xFFFF)) {
+                all_cond_satisfied = false;
+            }
+
+            HA_DEBUG("scene::process: acs %hd, hts %hd, cur_time %lx, start %lx, end %lx\n",
+                    all_cond_satisfied, has_trigger_src,
+                    cur_time & 0xFFFF,
+                    input_p->time_range.start & 0xFFFF, input_p->time_range.end & 0xFFFF);
+            break;
+
+        case COND_EQUAL_THR:
+        case COND_LESS_THAN_THR:
+        case COND_LESS_OR_EQUAL_THR:
+        case COND_GREATER_THAN_THR:
+        case COND_GREATER_OR_EQUAL_THR:
+
+            switch (input_p->cond) {
             case COND_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_EQUAL_THR\n");
+                break;
             case COND_LESS_THAN_THR:
+                HA_DEBUG("scene::process: COND_LESS_THAN_THR\n");
+                break;
             case COND_LESS_OR_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_LESS_OR_EQUAL_THR\n");
+                break;
             case COND_GREATER_THAN_THR:
+                HA_DEBUG("scene::process: COND_GREATER_THAN_THR\n");
+                break;
             case COND_GREATER_OR_EQUAL_THR:
+                HA_DEBUG("scene::process: COND_GREATER_OR_EQUAL_THR\n");
+                break;
+            default:
+                break;
+            }
 
-                switch (input_p->cond) {
-                case COND_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_EQUAL_THR\n");
-                    break;
-                case COND_LESS_THAN_THR:
-                    HA_DEBUG("scene::process: COND_LESS_THAN_THR\n");
-                    break;
-                case COND_LESS_OR_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_LESS_OR_EQUAL_THR\n");
-                    break;
-                case COND_GREATER_THAN_THR:
-                    HA_DEBUG("scene::process: COND_GREATER_THAN_THR\n");
-                    break;
-                case COND_GREATER_OR_EQUAL_THR:
-                    HA_DEBUG("scene::process: COND_GREATER_OR_EQUAL_THR\n");
-                    break;
-                default:
+            if (trigger_by_report && dev_expired &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                /* expired device has no value */
+                all_cond_satisfied = false;
+                break;
+            }
+            else if (trigger_by_report &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                has_trigger_src = true;
+
+                /* check new status of this device */
+                value = device_rpt->get_value();
+            }
+            else {
+                /* check old status in cur_device_mng */
+                if (cur_device_mng->get_dev_val(input_p->dev_val.device_id, value) == -1) {
+                    HA_DEBUG("scene::process: can't find dev %lx -> false\n",
+                            input_p->dev_val.device_id);
+                    /* TODO: check again */
+                    all_cond_satisfied = false;
                     break;
                 }
+            }
 
-                if (trigger_by_report &&
-                    (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
-                    has_trigger_src = true;
+            /* compare value */
+            switch (input_p->cond) {
 
-                    /* check new status of this device */
-                    value = device_rpt->get_value();
-                }
-                else {
-                    /* check old status in cur_device_mng */
-                    if (cur_device_mng->get_dev_val(input_p->dev_val.device_id, value) == -1) {
-                        HA_DEBUG("scene::process: can't find dev %lx -> false\n",
-                                input_p->dev_val.device_id);
-                        /* TODO: check again */
-                        all_cond_satisfied = false;
-                        break;
-                    }
+            case COND_EQUAL_THR:
+                if (value != input_p->dev_val.value) {
+                    all_cond_satisfied = false;
                 }
+                break;
 
-                /* compare value */
-                switch (input_p->cond) {
-
-                case COND_EQUAL_THR:
-                    if (value != input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_LESS_THAN_THR:
-                    if (value >= input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
-
-                case COND_LESS_OR_EQUAL_THR:
-                    if (value > input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
+            case COND_LESS_THAN_THR:
+                if (value >= input_p->dev_val.value) {
+                    all_cond_satisfied = false;
+                }
+                break;
 
-                case COND_GREATER_THAN_THR:
-                    if (value <= input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
+            case COND_LESS_OR_EQUAL_THR:
+                if (value > input_p->dev_val.value) {
+                    all_cond_satisfied = false;
+                }
+                break;
 
-                case COND_GREATER_OR_EQUAL_THR:
-                    if (value < input_p->dev_val.value) {
-                        all_cond_satisfied = false;
-                    }
-                    break;
+            case COND_GREATER_THAN_THR:
+                if (value <= input_p->dev_val.value) {
+                    all_cond_satisfied = false;
+                }
+                break;
 
-                default:
-                    break;
+            case COND_GREATER_OR_EQUAL_THR:
+                if (value < input_p->dev_val.value) {
+                    all_cond_satisfied = false;
                 }
+                break;
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
-                        "dev_i %lx, thres %hd\n",
-                        all_cond_satisfied, has_trigger_src,
-                        device_rpt->get_device_id(), value,
-                        input_p->dev_val.device_id, input_p->dev_val.value);
+            default:
                 break;
+            }
+
+            HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
+                    "dev_i %lx, thres %hd\n",
+                    all_cond_satisfied, has_trigger_src,
+                    device_rpt->get_device_id(), value,
+                    input_p->dev_val.device_id, input_p->dev_val.value);
+            break;
 
+        case COND_CHANGE_VAL:
+        case COND_CHANGE_VAL_OVER_THR:
+            switch (input_p->cond) {
             case COND_CHANGE_VAL:
+                HA_DEBUG("scene::process: COND_CHANGE_VAL\n");
+                break;
             case COND_CHANGE_VAL_OVER_THR:
-                switch (input_p->cond) {
-                case COND_CHANGE_VAL:
-                    HA_DEBUG("scene::process: COND_CHANGE_VAL\n");
-                    break;
-                case COND_CHANGE_VAL_OVER_THR:
-                    HA_DEBUG("scene::process: COND_CHANGE_VAL_OVER_THR\n");
-                    break;
-                }
+                HA_DEBUG("scene::process: COND_CHANGE_VAL_OVER_THR\n");
+                break;
+            }
 
-                if (trigger_by_report &&
-                    (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
-                    has_trigger_src = true;
+            if (trigger_by_report &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                has_trigger_src = true;
 
-                    /* compare new value of this device with old value */
-                    if (cur_device_mng->get_dev_val(device_rpt->get_device_id(), value) == -1) {
-                        /* Can't find device */
-                        HA_DEBUG("scene::process: can't find dev %lx -> false\n",
-                                device_rpt->get_device_id());
-                        all_cond_satisfied = false;
-                    }
-                    else {
-                        /* Found device, evaluate new value with old value */
-                        switch (input_p->cond) {
-
-                        case COND_CHANGE_VAL:
-                            if (device_rpt->get_value() == value) {
-                                all_cond_satisfied = false;
-                            }
-                            break;
-
-                        case COND_CHANGE_VAL_OVER_THR:
-                            if (abs(device_rpt->get_value() - value) <= input_p->dev_val.value){
-                                /* change was not over threshold */
-                                all_cond_satisfied = false;
-                            }
-                            break;
-                        }
-                    }/* end evaluating new and old value */
-                }
-                else { /* the device was not changed */
+                /* compare new value of this device with old value */
+                if (cur_device_mng->get_dev_val(device_rpt->get_device_id(), value) == -1) {
+                    /* Can't find device */
+                    HA_DEBUG("scene::process: can't find dev %lx -> false\n",
+                            device_rpt->get_device_id());
                     all_cond_satisfied = false;
                 }
+                else {
+                    /* Found device, evaluate new value with old value */
+                    switch (input_p->cond) {
 
-                HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
-                        "dev_i %lx, thres %hd\n",
-                        all_cond_satisfied, has_trigger_src,
-                        device_rpt->get_device_id(), value,
-                        input_p->dev_val.device_id, input_p->dev_val.value);
+                    case COND_CHANGE_VAL:
+                        if (device_rpt->get_value() == value) {
+                            all_cond_satisfied = false;
+                        }
+                        break;
 
-                break;
+                    case COND_CHANGE_VAL_OVER_THR:
+                        if (abs(device_rpt->get_value() - value) <= input_p->dev_val.value){
+                            /* change was not over threshold */
+                            all_cond_satisfied = false;
+                        }
+                        break;
+                    }
+                }/* end evaluating new and old value */
+            }
+            else { /* the device was not changed */
+                all_cond_satisfied = false;
+            }
 
-            default:
-                break;
-            }/* end switch input's conditions*/
+            HA_DEBUG("scene::process: acs %hd, hts %hd, dev_rpt %lx, val %hd,"
+                    "dev_i %lx, thres %hd\n",
+                    all_cond_satisfied, has_trigger_src,
+                    device_rpt->get_device_id(), value,
+                    input_p->dev_val.device_id, input_p->dev_val.value);
 
-            if (!all_cond_satisfied) {
-                /* No need to check anymore */
-                break;
+            break;
+
+        case COND_EXPIRED:
+            HA_DEBUG("scene::process: COND_EXPIRED\n");
+
+            /* only satisfied by expiry event of this device */
+            if (trigger_by_report && dev_expired &&
+                (device_rpt->get_device_id() == input_p->dev_val.device_id)) {
+                has_trigger_src = true;
+            }
+            else {
+                all_cond_satisfied = false;
             }
+            break;
+
+        default:
+            break;
+        }/* end switch input's conditions*/
+
+        if (!all_cond_satisfied) {
+            /* No need to check anymore */
+            break;
         }
+    }
 
-        /* process outputs */
-        if (all_cond_satisfied && has_trigger_src) {
-            HA_DEBUG("scene::process: Processing output...\n");
+    /* process outputs */
+    if (all_cond_satisfied && has_trigger_src) {
+        HA_DEBUG("scene::process: Processing output...\n");
 
-            for (c_out = 0; c_out < rules_list[c_rule].num_out; c_out++) {
+        num_rules = (cur_num_rules > get_capacity()) ? get_capacity() : cur_num_rules;
+        do {
+            cont_mult_vals = false;
+            for (c_out = 0; (c_out < rules_list[c_rule].num_out) && (c_out < rule_max_output);
+                    c_out++) {
                 output_t *output_p = &rules_list[c_rule].outputs[c_out];
 
                 switch (output_p->action) {
                 case ACT_SET_DEV_VAL:
-                    HA_DEBUG("scene::process: ACT_SET_DEV_VAL, dev %lx, val %hd\n",
-                            output_p->dev_val.device_id, output_p->dev_val.value);
-
-                    /* pack gff frame */
-                    act_gff[ha_ns::GFF_LEN_POS] = ha_ns::SET_DEV_VAL_DATA_LEN;
-                    uint162buf(ha_ns::SET_DEV_VAL, &act_gff[ha_ns::GFF_CMD_POS]);
-                    uint322buf(output_p->dev_val.device_id, &act_gff[ha_ns::GFF_DATA_POS]);
-                    uint162buf((uint16_t)output_p->dev_val.value, &act_gff[ha_ns::GFF_DATA_POS + 4]);
-
-                    /* push to out_queue */
-                    out_queue->add_data(act_gff, ha_ns::SET_DEV_VAL_DATA_LEN +
-                            ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE);
-
-                    /* send GFF pending message */
-                    mesg.type = ha_ns::GFF_PENDING;
-                    mesg.content.ptr = (char *)out_queue;
-
-                    msg_send(&mesg, out_pid, false);
-
-                    HA_DEBUG("scene::process: Sent SET_DEV_VAL gff message\n");
+                case ACT_SET_DEV_MULT_VALS:
+                case ACT_SET_DEV_MULT_VALS_END:
+                    HA_DEBUG("scene::process: action %hu, dev %lx, val %hd\n",
+                            output_p->action, output_p->dev_val.device_id,
+                            output_p->dev_val.value);
+
+                    out_batch->add(output_p->dev_val.device_id, output_p->dev_val.value);
+                    cont_mult_vals = (output_p->action == ACT_SET_DEV_MULT_VALS);
                     break;
 
                 default:
@@ -569,15 +1004,18 @@ void scene::process(bool trigger_by_report,
                     break;
                 }
             }/* end for, all outputs processed */
-        }/* end if for outputs */
 
-    }/* end for, all rules processed */
+            /* multi-device command goes on with outputs of next rule */
+            c_rule++;
+        } while (cont_mult_vals && (c_rule < num_rules) && rules_list[c_rule].is_valid);
+    }/* end if for outputs */
 }
 
 /*----------------------------------------------------------------------------*/
 void scene::print(rtc *rtc_obj)
 {
     uint16_t c_rule, c_in, c_out;
+    rule_t *rules_list = (pool == NULL) ? NULL : pool->get_rules(span);
 
     HA_NOTIFY("Scene: %s\n"
             "---\n", name);
@@ -634,6 +1072,9 @@ void scene::print_input(input_t &input, rtc *rtc_obj)
     case COND_IN_RANGE_EVDAY:
         HA_NOTIFY("COND_IN_RANGE_EVDAY\n");
         break;
+    case COND_EXPIRED:
+        HA_NOTIFY("COND_EXPIRED\n");
+        break;
     default:
         HA_NOTIFY("cond: %hu\n", input.cond);
         break;
@@ -652,6 +1093,10 @@ void scene::print_input(input_t &input, rtc *rtc_obj)
                 input.dev_val.device_id, input.dev_val.value);
         break;
 
+    case COND_EXPIRED:
+        HA_NOTIFY("Device id: %lx\n", input.dev_val.device_id);
+        break;
+
     case COND_IN_RANGE:
         rtc_obj->packed_to_time(input.time_range.start, time);
         HA_NOTIFY("Start: %hu:%hu:%hu, %hu %hu %hu\n", time.hour, time.min, time.sec,
@@ -681,6 +1126,12 @@ void scene::print_output(output_t &output)
     case ACT_SET_DEV_VAL:
         HA_NOTIFY("ACT_SET_DEV_VAL\n");
         break;
+    case ACT_SET_DEV_MULT_VALS:
+        HA_NOTIFY("ACT_SET_DEV_MULT_VALS\n");
+        break;
+    case ACT_SET_DEV_MULT_VALS_END:
+        HA_NOTIFY("ACT_SET_DEV_MULT_VALS_END\n");
+        break;
     default:
         HA_NOTIFY("action: %hu\n", output.action);
         break;
@@ -689,6 +1140,8 @@ void scene::print_output(output_t &output)
     /* print parameters */
     switch (output.action) {
     case ACT_SET_DEV_VAL:
+    case ACT_SET_DEV_MULT_VALS:
+    case ACT_SET_DEV_MULT_VALS_END:
         HA_NOTIFY("Device id: %lx, value: %hd\n",
                 output.dev_val.device_id, output.dev_val.value);
         break;
@@ -699,10 +1152,135 @@ void scene::print_output(output_t &output)
 }
 
 /*----------------------------------------------------------------------------*/
-void scene::clear_all_rules(void)
+void scene::build_rule_index(void)
 {
-    uint16_t count;
-    for (count = 0; count < scene_max_rules; count++) {
-        rules_list[count].is_valid = false;
+    uint16_t c_rule, pos, num_rules;
+    uint8_t c_in;
+    bool has_time_cond;
+    input_t *input_p;
+    rule_t *rules_list;
+    dev_rule_t *dev_rules_index;
+    uint16_t *time_rules_index;
+
+    num_dev_rules = 0;
+    num_time_rules = 0;
+    rule_index_changed = false;
+    /* indexes of time rules in schedule are not valid anymore */
+    schedule_changed = true;
+
+    if (get_capacity() == 0) {
+        return;
+    }
+    rules_list = pool->get_rules(span);
+    dev_rules_index = pool->get_dev_rules(span);
+    time_rules_index = pool->get_time_rules(span);
+
+    num_rules = (cur_num_rules > get_capacity()) ? get_capacity() : cur_num_rules;
+    for (c_rule = 0; c_rule < num_rules; c_rule++) {
+        if (!rules_list[c_rule].is_valid || !rules_list[c_rule].is_active) {
+            continue;
+        }
+
+        has_time_cond = false;
+        for (c_in = 0; (c_in < rules_list[c_rule].num_in) && (c_in < rule_max_input); c_in++) {
+            input_p = &rules_list[c_rule].inputs[c_in];
+
+            switch (input_p->cond) {
+            case COND_IN_RANGE:
+            case COND_IN_RANGE_EVDAY:
+                has_time_cond = true;
+                break;
+
+            case COND_EQUAL_THR:
+            case COND_LESS_THAN_THR:
+            case COND_LESS_OR_EQUAL_THR:
+            case COND_GREATER_THAN_THR:
+            case COND_GREATER_OR_EQUAL_THR:
+            case COND_CHANGE_VAL:
+            case COND_CHANGE_VAL_OVER_THR:
+            case COND_EXPIRED:
+                /* insert after all entries with the same device id, rules are visited
+                 * in ascending order so entries of a device stay sorted by rule index */
+                pos = find_first_dev_rule(input_p->dev_val.device_id);
+                while ((pos < num_dev_rules) &&
+                        (dev_rules_index[pos].device_id == input_p->dev_val.device_id)) {
+                    pos++;
+                }
+
+                /* 2 inputs on the same device, rule has been added */
+                if ((pos > 0) && (dev_rules_index[pos - 1].device_id == input_p->dev_val.device_id)
+                        && (dev_rules_index[pos - 1].rule_index == c_rule)) {
+                    break;
+                }
+
+                memmove(&dev_rules_index[pos + 1], &dev_rules_index[pos],
+                        (num_dev_rules - pos) * sizeof(dev_rule_t));
+                dev_rules_index[pos].device_id = input_p->dev_val.device_id;
+                dev_rules_index[pos].rule_index = c_rule;
+                num_dev_rules++;
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (has_time_cond) {
+            time_rules_index[num_time_rules] = c_rule;
+            num_time_rules++;
+        }
     }
+
+    HA_DEBUG("scene::build_rule_index: %hu device entries, %hu time rules\n",
+            num_dev_rules, num_time_rules);
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t scene::find_first_dev_rule(uint32_t device_id)
+{
+    uint16_t low = 0, high = num_dev_rules, mid;
+    dev_rule_t *dev_rules_index = pool->get_dev_rules(span);
+
+    /* lower bound in sorted dev_rules_index */
+    while (low < high) {
+        mid = low + (high - low) / 2;
+        if (dev_rules_index[mid].device_id < device_id) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene::reserve_rules(uint16_t num_rules)
+{
+    if (num_rules > scene_max_rules) {
+        return -1;
+    }
+
+    if (num_rules <= get_capacity()) {
+        return 0;
+    }
+
+    if (pool == NULL) {
+        return -1;
+    }
+
+    if (span == rule_pool_ns::no_span) {
+        span = pool->alloc(num_rules);
+        if (span != rule_pool_ns::no_span) {
+            return 0;
+        }
+    }
+    else if (pool->resize(span, num_rules) == 0) {
+        return 0;
+    }
+
+    HA_NOTIFY("scene %s: rule pool is exhausted (%hu rules needed, %hu of %hu free)\n",
+            name, num_rules - get_capacity(), pool->get_num_free(), pool->get_size());
+    return -1;
 }
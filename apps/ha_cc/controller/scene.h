@@ -25,94 +25,12 @@ extern "C" {
 #include "cir_queue.h"
 #include "ha_device_mng.h"
 #include "MB1_rtc.h"
-
-namespace scene_ns {
-
-const uint8_t rule_max_input = 2;
-const uint8_t rule_max_output = 2;
-
-const uint8_t scene_max_name_chars = 20;
-const uint8_t scene_max_name_chars_wout_folders = 8 + 1;
-const uint16_t scene_max_rules = 25;
-
-/*-------------------------- CONDITION DEFINITIONS ---------------------------*/
-enum cond_e: uint8_t {
-    COND_EQUAL_THR = 0x00,          /* Condition: equal to threshold,
-                                    parameter: device id, threshold value */
-    COND_LESS_THAN_THR = 0x01,      /* Condition: less than threshold,
-                                    parameter: device id, threshold value */
-    COND_LESS_OR_EQUAL_THR = 0x02,  /* Condition: less than or equal to threshold,
-                                    device id, parameter: threshold value  */
-    COND_GREATER_THAN_THR = 0x03,   /* Condition: greater than threshold,
-                                    parameter: device id, threshold value */
-    COND_GREATER_OR_EQUAL_THR = 0x04, /* Condition: greater than or equal to threshold,
-                                    parameter: device id, threshold value */
-    COND_CHANGE_VAL = 0x05,         /* Condition: change value,
-                                    parameter: device id */
-    COND_CHANGE_VAL_OVER_THR = 0x08,    /* Condition: change value over a threshold,
-                                    parameter: device id, threshold value */
-    COND_IN_RANGE = 0x06,           /* Condition: in a time range,
-                                    parameter: time range (start time and end time)
-                                    Time is packed in 32bit following this format:
-                                    bit 0-4: second / 2.
-                                    bit 5-10: minute.
-                                    bit 11-15: hour.
-                                    bit 16-20: day in month.
-                                    bit 21-24: month.
-                                    bit 25-31: number of years from timebase.year. */
-    COND_IN_RANGE_EVDAY = 0x07,     /* Condition: in a time range of every day,
-                                    parameter: time range (start time and end time)
-                                    Time in packed format, only hour, min, sec will be
-                                    cared */
-};
-
-/*-------------------------- ACTION DEFINITIONS ------------------------------*/
-enum act_e: uint8_t {
-    ACT_SET_DEV_VAL = 0x00,         /* Set value for a device,
-                                    param: device_id, value */
-    ACT_SET_DEV_MULT_VALS = 0x01,   /* Set multiple value for a device, followed by
-                                    ACT_SET_DEV_MULT_VALS, and ended with ACT_SET_DEV_MULT_VALS_END.
-                                    param: device_id, value */ /* TODO: later */
-    ACT_SET_DEV_MULT_VALS_END = 0x02,   /* End value for ACT_SET_DEV_MULT_VALS,
-                                    param: device_id, value */ /* TODO: later */
-};
-
-typedef struct dev_val_s {
-    uint32_t device_id;
-    int16_t value;
-} dev_val_t;
-
-typedef struct time_range_s {
-    uint32_t start;
-    uint32_t end;
-} time_range_t;
-
-typedef struct input_s {
-    uint8_t cond;
-    union {
-        dev_val_t dev_val;
-        time_range_t time_range;
-    };
-} input_t;
-
-typedef struct output_s {
-    uint8_t action;
-    union {
-        dev_val_t dev_val;
-    };
-} output_t;
-
-typedef struct rule_s {
-    bool is_valid = false;
-
-    bool is_active = false;
-    uint8_t num_in = 0;
-    uint8_t num_out = 0;
-    input_t inputs[rule_max_input];
-    output_t outputs[rule_max_output];
-} rule_t;
-
-}
+#include "time_sched.h"
+#include "action_batch.h"
+#include "scene_rule.h"
+#include "scene_file.h"
+#include "journal.h"
+#include "rule_pool.h"
 
 using namespace scene_ns;
 
@@ -120,10 +38,23 @@ class scene {
 
 public:
     /**
-     * @brief   constructor.
+     * @brief   constructor, set_rule_pool MUST be called before rules are added.
      */
     scene(void);
 
+    /**
+     * @brief   Set pool holding rules of this scene. Scene takes a span of the pool as
+     *          large as its number of rules.
+     *
+     * @param[in]   pool,
+     */
+    void set_rule_pool(rule_pool *pool);
+
+    /**
+     * @brief   Get number of rules this scene takes from rule pool.
+     */
+    uint16_t get_capacity(void);
+
     /**
      * @brief   Get name of scene.
      *
@@ -153,14 +84,18 @@ public:
     uint16_t get_cur_num_rules(void);
 
     /**
-     * @brief   Set current number of rules.
+     * @brief   Set current number of rules, rules are taken from (or given back to) rule
+     *          pool.
      *
      * @param[in]   Current number of rules.
+     *
+     * @return      -1 if rule pool is exhausted.
      */
-    void set_cur_num_rules(uint16_t num_rules);
+    int8_t set_cur_num_rules(uint16_t num_rules);
 
     /**
-     * @brief   Clear cur_num_rules and set all rules to invalid.
+     * @brief   Clear cur_num_rules and give all rules back to rule pool. Time rules of
+     *          the new scene (or restored one) are evaluated at next schedule.
      */
     void new_scene(void);
 
@@ -170,12 +105,12 @@ public:
      * @param[in]   &rule, new rule to be added.
      * @param[in]   index.
      *
-     * @return      -1 if error.
+     * @return      -1 if error (index is out of range or rule pool is exhausted).
      */
     int8_t add_rule_with_index(rule_t &rule, uint16_t index);
 
     /**
-     * @brief   Get a rule in index position.
+     * @brief   Get a rule in index position, rules after the last one are invalid.
      *
      * @param[out]  &rule, a rule has been retrieved.
      * @param[in]   index.
@@ -205,7 +140,10 @@ public:
     bool find_invalid_rule(uint16_t &index, bool cont);
 
     /**
-     * @brief   Process rules and output action to out_queue (in SET_DEV_VAL GFF format).
+     * @brief   Process rules and add output actions to out_batch.
+     *          Only rules which have a condition on the reporting device (triggered by
+     *          report) or a time condition (triggered by time) will be evaluated,
+     *          using rule index built from rules_list.
      *
      * @param[in]   trigger_by_report, true if this process action was triggered by report,
      *              otherwise, it was triggered by time.
@@ -213,24 +151,74 @@ public:
      *              Will not be used when this process has been triggered by time.
      * @param[in]   *cur_device_mng, current devices' status. (hasn't not been applied new report).
      * @param[in]   *rtc_obj, rtc object.
-     * @param[out]  *out_queue, output action (SET_DEV_VAL) will be pushed to this queue.
-     * @param[in]   out_pid, GFF_PENDING message will be sent to this thread for
-     *              every output action.
+     * @param[out]  *out_batch, output actions (SET_DEV_VAL) will be added to this batch,
+     *              caller flushes it after all scenes have been processed.
      */
     void process(bool trigger_by_report,
             ha_device *a_device_rpt, ha_device_mng *cur_device_mng,
             rtc *rtc_obj,
-            cir_queue *out_queue, kernel_pid_t out_pid);
+            action_batch *out_batch);
 
     /**
-     * @brief   Save data to file.
+     * @brief   Process rules which have a condition on an expired device. Only
+     *          COND_EXPIRED inputs on it are satisfied, other inputs on it are false
+     *          (device has been removed from cur_device_mng).
+     *
+     * @param[in]   *device_exp, expired device (only device id is used).
+     * @param[in]   *cur_device_mng, *rtc_obj, *out_batch, refer to process.
+     */
+    void process_expired(ha_device *device_exp, ha_device_mng *cur_device_mng,
+            rtc *rtc_obj, action_batch *out_batch);
+
+    /**
+     * @brief   Push an entry for every time rule to time schedule. When the scene is
+     *          starting (restored, replaced or reschedule has been called) all time rules
+     *          are evaluated at cur_time, otherwise (only rules have been edited) the next
+     *          instants their time conditions change are pushed.
+     *          Entries of the slot MUST have been removed from the schedule.
+     *
+     * @param[in]   *sched, time schedule.
+     * @param[in]   slot, slot of this scene in scene_mng.
+     * @param[in]   cur_time, packed time.
+     */
+    void schedule(time_sched *sched, uint8_t slot, uint32_t cur_time);
+
+    /**
+     * @brief   Check if time rules have to be scheduled again (rules have been changed,
+     *          scene has been restored or reschedule has been called since last schedule).
+     */
+    bool is_schedule_changed(void) { return rule_index_changed || schedule_changed || starting; }
+
+    /**
+     * @brief   Force time rules to be scheduled and evaluated again (e.g. clock has been
+     *          set back).
+     */
+    void reschedule(void) { starting = true; }
+
+    /**
+     * @brief   Process a time rule popped from time schedule, then push its next entry.
+     *
+     * @param[in]   *sched, time schedule.
+     * @param[in]   &entry, popped entry.
+     * @param[in]   cur_time, packed time.
+     * @param[in]   *cur_device_mng, out_batch, refer to process.
+     */
+    void process_time_entry(time_sched *sched, time_sched_ns::entry_t &entry,
+            uint32_t cur_time, ha_device_mng *cur_device_mng,
+            action_batch *out_batch);
+
+    /**
+     * @brief   Save changes to file. Rules changed since last save are appended to
+     *          journal, whole scene is written (and journal is cleared) after new_scene,
+     *          set_name or when journal has grown too large.
      *
      * @return  0 if success, -1 on error.
      */
     int8_t save(void);
 
     /**
-     * @brief   Read data from file.
+     * @brief   Read data from file and replay its journal (in storage thread, caller
+     *          waits).
      *
      * @return  0 if success, -1 on error.
      */
@@ -246,9 +234,79 @@ public:
 private:
 
     /**
-     * @brief   Clear all rules to invalid.
+     * @brief   Make sure scene has at least num_rules rules in rule pool.
+     *
+     * @param[in]   num_rules, <= scene_max_rules.
+     *
+     * @return  0 if success, -1 if rule pool is exhausted.
+     */
+    int8_t reserve_rules(uint16_t num_rules);
+
+    /**
+     * @brief   Queue whole scene to be written to file with new journal generation and
+     *          clear journal.
+     *
+     * @return  0 if success, -1 if storage queue is full.
+     */
+    int8_t save_all_rules(void);
+
+    /**
+     * @brief   Read data from file and replay its journal, MUST be run in storage thread.
+     *
+     * @return  0 if success, -1 on error.
      */
-    void clear_all_rules(void);
+    int8_t restore_file(void);
+
+    /**
+     * @brief   restore_file as storage_ns::call_func_t.
+     */
+    static int8_t restore_call(void *arg);
+
+    /**
+     * @brief   Apply a journal record, used as journal_ns::replay_func_t.
+     */
+    static void replay_record(uint8_t type, uint8_t *data, uint8_t len, void *arg);
+
+    /**
+     * @brief   Rebuild device -> rules index and time rules list (in rule pool) from valid
+     *          and active rules in rules_list. Entries in device index are sorted by
+     *          device id, then by rule index.
+     */
+    void build_rule_index(void);
+
+    /**
+     * @brief   Find the first entry in device -> rules index for a device.
+     *
+     * @param[in]   device_id.
+     *
+     * @return  position of the first entry in dev_rules_index, num_dev_rules if not found.
+     */
+    uint16_t find_first_dev_rule(uint32_t device_id);
+
+    /**
+     * @brief   Process a rule and add output actions to out_batch. (refer to process)
+     *
+     * @param[in]   c_rule, index of the rule in rules_list.
+     * @param[in]   cur_time, packed time.
+     * @param[in]   dev_expired, true if device_rpt has expired (refer to process_expired).
+     */
+    void process_rule(uint16_t c_rule, bool trigger_by_report,
+            ha_device *device_rpt, ha_device_mng *cur_device_mng,
+            uint32_t cur_time,
+            action_batch *out_batch, bool dev_expired);
+
+    /**
+     * @brief   Get the first instant after cur_time at which a time condition of a rule
+     *          becomes true or false.
+     *
+     * @param[in]   c_rule, index of the rule in rules_list.
+     * @param[in]   cur_time, packed time.
+     * @param[out]  edge, false if the rule only needs to be scheduled again at the
+     *              instant (start of next day), true if it has to be evaluated.
+     *
+     * @return  packed time, time_sched_ns::never if conditions won't change anymore.
+     */
+    uint32_t get_next_time_event(uint16_t c_rule, uint32_t cur_time, bool &edge);
 
     /* @brief   Print input.
      *
@@ -266,9 +324,32 @@ private:
     char name[scene_max_name_chars];
 
     uint16_t cur_num_rules;
-    rule_t rules_list[scene_max_rules];
+
+    /* rules_list, dev_rules_index and time_rules_index are in a span of rule pool,
+     * they MUST be got again after the span has been resized */
+    rule_pool *pool;
+    uint8_t span;
 
     uint16_t last_invalid_index;
+
+    /* changes since last save */
+    uint32_t changed_rules; /* bit == index in rules_list */
+    bool num_rules_changed;
+    bool need_full_save;
+
+    uint8_t journal_buf[scene_file_ns::journal_buf_size];
+    journal rules_journal;
+
+    /* rule index, rebuilt before processing when rules_list has been changed */
+    bool rule_index_changed;
+    uint16_t num_dev_rules;
+    uint16_t num_time_rules;
+
+    /* time rules have to be pushed to time schedule again */
+    bool schedule_changed;
+
+    /* time rules have to be evaluated at next schedule (scene restored or replaced) */
+    bool starting;
 };
 
 #endif // SCENE_H_
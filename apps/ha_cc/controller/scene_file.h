@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        scene_file.h
+ * @brief       Binary scene file format.
+ *
+ *              | header (12) | rule_t records (num_rules * rule_size) |
+ *
+ *              Records are rules_list as it is in memory, so a scene is read with one
+ *              f_read. rule_size is checked so a file from a firmware with different
+ *              rule_t won't be loaded. crc is CRC-16/CCITT of all records.
+ *              Changes after a save are appended to NAME.JNL (see journal.h), journal_gen
+ *              is generation of the journal which can be replayed on top of this file.
+ *              Old text scene files (R:, I:, O: lines) have no magic, they are still read
+ *              and saved again in this format (see scene::restore, scene_conv tool).
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef SCENE_FILE_H_
+#define SCENE_FILE_H_
+
+#include <stdint.h>
+
+#include "scene_rule.h"
+#include "journal.h"
+
+namespace scene_file_ns {
+
+const uint32_t magic = 0x4E435348; /* "HSCN" */
+const uint8_t version = 1;
+
+typedef struct header_s {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t rule_size;      /* sizeof(scene_ns::rule_t) */
+    uint16_t num_rules;     /* cur_num_rules */
+    uint16_t crc;           /* of records */
+    uint16_t journal_gen;
+} header_t;
+
+static_assert(sizeof(header_t) == 12, "scene file header must be 12 bytes");
+static_assert(sizeof(scene_ns::rule_t) < 256, "rule_size doesn't fit in header");
+
+/* journal records */
+enum journal_record_e: uint8_t {
+    JNL_RULE_SET = 0,   /* | index (1) | rule_t | */
+    JNL_NUM_RULES,      /* | cur_num_rules (2) | */
+};
+
+const uint8_t jnl_rule_set_len = 1 + sizeof(scene_ns::rule_t);
+const uint8_t jnl_num_rules_len = 2;
+
+const uint16_t journal_buf_size = 2 * (jnl_rule_set_len + journal_ns::record_overhead);
+const uint32_t journal_compact_size = 2048; /* in bytes */
+const char journal_ext[] = ".JNL";
+
+static_assert(jnl_rule_set_len <= journal_ns::max_data_len, "rule doesn't fit in a record");
+static_assert(scene_ns::scene_max_rules <= 32, "changed rules bitmap is 32 bits");
+
+}
+
+#endif // SCENE_FILE_H_
@@ -17,6 +17,7 @@
 #include "scene_mng.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
+#include "storage.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
@@ -30,22 +31,29 @@ static const uint8_t user_scene_index = 1;
 #define ACTIVE_SCENE_FILE   "ACTSCENE"
 
 static const char scene_cmd_usage[] = "Usage:\n"
-        "scene -l, show current default scene and user active scene.\n"
-        "scene -l -s d|u, list default scene (d) or user active scene (u).\n"
-        "scene -s d|u -a index active(0|1) -i cond (dev(hex) val | start end) -o act dev val, "
-        "add a new rule to a scene.\n"
-        "scene -s d|u -d index, remove a rule from scene.\n"
-        "scene -s d|u -p, halt processing scene. Should be done before adding or removing rules.\n"
-        "scene -s d|u -r, restart scene.\n"
-        "scene -s d|u -v, save scene to file.\n"
-        "scene -s d|u -e, restore scene from file.\n"
+        "scene -l, show current default scene and all active scenes.\n"
+        "scene -l -s d|u|index, list default scene (d), user active scene (u) or "
+        "active scene with index (1-6).\n"
+        "scene -s d|u|index -a index active(0|1) -i cond (dev(hex) val | start end) "
+        "-o act dev val, add a new rule to a scene.\n"
+        "scene -s d|u|index -d index, remove a rule from scene.\n"
+        "scene -s d|u|index -p, halt processing scene. Should be done before adding or "
+        "removing rules.\n"
+        "scene -s d|u|index -r, restart scene.\n"
+        "scene -s d|u|index -v, save scene to file.\n"
+        "scene -s d|u|index -e, restore scene from file.\n"
+        "scene -A index [name], run scene with index (1-6) together with others, "
+        "stop it without name.\n"
+        "scene -m, show usage of rule pool.\n"
         "scene -n old_name new_name, rename scene.\n"
+        "scene -c, list inactive scenes with their num of rules and sizes.\n"
         "scene -h, get help.\n";
 
 enum scene_cmd_type_e: uint8_t {
     NO_SCENE,
     DEFAULT_SCENE,
     USER_SCENE,
+    ACTIVE_SCENE,
 };
 
 using namespace scene_ns;
@@ -53,32 +61,142 @@ using namespace scene_mng_ns;
 
 /*----------------------------------------------------------------------------*/
 scene_mng::scene_mng(ha_device_mng *cur_device_mng_p, rtc *rtc_obj_p,
-            kernel_pid_t *out_pid_p, cir_queue *out_cir_queue_p)
+            action_batch *action_batch_p, rule_pool *rule_pool_p,
+            time_sched *time_sched_p)
 {
     device_mng_p = cur_device_mng_p;
     rtc_p = rtc_obj_p;
-    this->out_pid_p = out_pid_p;
-    out_queue_p = out_cir_queue_p;
+    batch_p = action_batch_p;
+    pool_p = rule_pool_p;
+    version = 0;
+    sched_p = time_sched_p;
+    last_time = 0;
+    num_catalog = 0;
+    catalog_loaded = false;
+    inactive_gen = 1;
+    cursor_gen = 0;
+    cursor_index = 0;
+    cursor_pos = 0;
+
+    for (uint8_t count = 0; count < max_num_active_scenes; count++) {
+        active_scenes[count][0] = '\0';
+    }
 
-    /* set all scenes to invalid */
-    for (uint8_t count; count < max_num_scenes; count++) {
+    /* set all scenes to invalid, their rules are in rule pool */
+    for (uint8_t count = 0; count < max_num_scenes; count++) {
         scenes_list[count].valid = false;
+        scenes_list[count].scene_obj.set_rule_pool(rule_pool_p);
+        scheduled[count] = false;
     }
 }
 
 /*----------------------------------------------------------------------------*/
 void scene_mng::process(bool trigger_by_rpt, ha_device *a_device_rpt)
 {
+    if (!trigger_by_rpt) {
+        process_time(rtc_p->get_time_packed());
+        return;
+    }
+
+    /* priority of a scene is its slot, scenes override default scene */
     for (uint8_t count = 0; count < max_num_scenes; count++) {
         if (scenes_list[count].valid) {
             HA_DEBUG("scene_mng::process: scene %hu is valid\n", count);
+            batch_p->set_priority(count);
             scenes_list[count].scene_obj.process(trigger_by_rpt, a_device_rpt,
-                    device_mng_p, rtc_p, out_queue_p, *out_pid_p);
+                    device_mng_p, rtc_p, batch_p);
         }
         else {
             HA_DEBUG("scene_mng::process: scene %hu is NOT valid\n", count);
         }
     }
+
+    batch_p->flush();
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::process_expired(uint32_t device_id)
+{
+    ha_device device_exp;
+
+    device_exp.set_device_id(device_id);
+
+    /* priority of a scene is its slot, scenes override default scene */
+    for (uint8_t count = 0; count < max_num_scenes; count++) {
+        if (scenes_list[count].valid) {
+            batch_p->set_priority(count);
+            scenes_list[count].scene_obj.process_expired(&device_exp, device_mng_p, rtc_p,
+                    batch_p);
+        }
+    }
+
+    batch_p->flush();
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::process_time(uint32_t cur_time)
+{
+    uint8_t slot;
+    time_sched_ns::entry_t entry;
+    time_sched_ns::entry_t *top;
+
+    /* clock has been set back, instants in schedule are wrong */
+    if (cur_time < last_time) {
+        HA_DEBUG("scene_mng::process_time: time went back, reschedule all scenes\n");
+        for (slot = 0; slot < max_num_scenes; slot++) {
+            scenes_list[slot].scene_obj.reschedule();
+        }
+    }
+    last_time = cur_time;
+
+    /* schedule scenes which have been changed, started or halted */
+    for (slot = 0; slot < max_num_scenes; slot++) {
+        if (scenes_list[slot].valid == scheduled[slot] &&
+                (!scheduled[slot] || !scenes_list[slot].scene_obj.is_schedule_changed())) {
+            continue;
+        }
+
+        sched_p->remove_slot(slot);
+        scheduled[slot] = scenes_list[slot].valid;
+        if (scheduled[slot]) {
+            HA_DEBUG("scene_mng::process_time: schedule scene %hu\n", slot);
+            scenes_list[slot].scene_obj.schedule(sched_p, slot, cur_time);
+        }
+    }
+
+    /* rules whose time conditions have changed */
+    while ((top = sched_p->peek()) != NULL && top->instant <= cur_time) {
+        sched_p->pop(entry);
+        batch_p->set_priority(entry.slot);
+        scenes_list[entry.slot].scene_obj.process_time_entry(sched_p, entry, cur_time,
+                device_mng_p, batch_p);
+    }
+
+    batch_p->flush();
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::scene_saved(scene *scene_p)
+{
+    char name[scene_max_name_chars];
+    uint16_t num_rules;
+
+    scene_changed();
+
+    /* scenes saved before catalog is loaded will be read with it */
+    if (!catalog_loaded) {
+        return;
+    }
+
+    strcpy(name, scene_p->get_name());
+    not_dir(name);
+    if (strcmp(name, DEFAULT_SCENE_FILE) == 0) {
+        return;
+    }
+
+    /* size in binary format, changes appended to journal aren't counted */
+    num_rules = scene_p->get_cur_num_rules();
+    catalog_update(name, num_rules, sizeof(scene_file_ns::header_t) + num_rules * sizeof(rule_t));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -91,13 +209,33 @@ void scene_mng::save(void)
 void scene_mng::restore(void)
 {
     char user_active_name[scene_max_name_chars_wout_folders];
+    char name_with_folder[scene_max_name_chars];
 
     restore_default_scene();
 
     /* restore user active scene */
+    storage_call(read_active_scenes, active_scenes);
+    inactive_gen++;
     get_active_scene(user_active_name);
     set_user_scene(user_active_name);
     restore_user_scene();
+
+    /* and other active scenes */
+    for (uint8_t index = 1; index < max_num_active_scenes; index++) {
+        if (active_scenes[index][0] == '\0') {
+            continue;
+        }
+
+        strcpy(name_with_folder, SCENES_FOLDER "/");
+        strcat(name_with_folder, active_scenes[index]);
+        scenes_list[user_scene_index + index].scene_obj.set_name(name_with_folder);
+        restore_scene_with_index(user_scene_index + index);
+    }
+
+    /* scenes folder is read once here, catalog is kept up to date after that */
+    if (load_catalog() != 0) {
+        HA_NOTIFY("Failed to load scene catalog\n");
+    }
 }
 
 /*------------------------ Current running user's scene ----------------------*/
@@ -110,6 +248,7 @@ void scene_mng::set_user_scene(const char *name)
     strcat(name_with_folder, name);
 
     scenes_list[user_scene_index].scene_obj.set_name(name_with_folder);
+    inactive_gen++;
 }
 
 /*----------------------------------------------------------------------------*/
@@ -133,17 +272,7 @@ scene *scene_mng::get_user_scene_ptr(void)
 /*----------------------------------------------------------------------------*/
 void scene_mng::restore_user_scene(void)
 {
-    /* set name for default scene */
-    if (scenes_list[user_scene_index].scene_obj.restore() != 0) {
-        HA_NOTIFY("Failed to restore user scene (%s)\n",
-                scenes_list[user_scene_index].scene_obj.get_name());
-        scenes_list[user_scene_index].valid = false;
-    }
-    else {
-        HA_NOTIFY("User scene (%s) restored\n",
-                scenes_list[user_scene_index].scene_obj.get_name());
-        scenes_list[user_scene_index].valid = true;
-    }
+    restore_scene_with_index(user_scene_index);
 }
 
 /*----------------------------------------------------------------------------*/
@@ -166,167 +295,313 @@ void scene_mng::print_user_scene(void)
     }
 }
 
-/*------------------------ Active scene --------------------------------------*/
-void scene_mng::set_active_scene(const char *name)
+/*------------------------ Active scenes -------------------------------------*/
+int8_t scene_mng::set_active_scene_with_index(uint8_t index, const char *name)
 {
-    FIL file;
-    FRESULT fres;
+    char name_with_folder[scene_max_name_chars];
+    uint8_t slot;
 
-    fres = f_open(&file, ACTIVE_SCENE_FILE, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("scene_mng::set_active_scene: Error when open file %s\n", ACTIVE_SCENE_FILE);
-        print_ferr(fres);
-        return;
+    if (index >= max_num_active_scenes) {
+        return -1;
     }
-    f_sync(&file);
 
-    /* write data to file */
-    f_printf(&file, "%s\n", name);
+    /* a scene file is run by one scene object only */
+    for (uint8_t count = 0; count < max_num_active_scenes; count++) {
+        if (count != index && name[0] != '\0' &&
+                strncmp(active_scenes[count], name, scene_max_name_chars_wout_folders - 1) == 0) {
+            HA_NOTIFY("scene_mng: %s is active with index %hu\n", name, count);
+            return -1;
+        }
+    }
 
-    /* close file */
-    f_close(&file);
+    strncpy(active_scenes[index], name, scene_max_name_chars_wout_folders - 1);
+    active_scenes[index][scene_max_name_chars_wout_folders - 1] = '\0';
+    save_active_scenes();
+    scene_changed();
+    inactive_gen++;
+
+    if (index == 0) {
+        return 0;
+    }
+
+    slot = user_scene_index + index;
+    if (active_scenes[index][0] == '\0') {
+        /* stopped, its rules are given back to rule pool */
+        scenes_list[slot].valid = false;
+        scenes_list[slot].scene_obj.new_scene();
+        return 0;
+    }
+
+    strcpy(name_with_folder, SCENES_FOLDER "/");
+    strcat(name_with_folder, active_scenes[index]);
+    scenes_list[slot].scene_obj.set_name(name_with_folder);
+    restore_scene_with_index(slot);
+
+    return scenes_list[slot].valid ? 0 : -1;
 }
 
 /*----------------------------------------------------------------------------*/
-void scene_mng::get_active_scene(char *name)
+void scene_mng::get_active_scene_with_index(uint8_t index, char *name)
 {
-    FIL file;
-    FRESULT fres;
-    char line[16];
-    uint16_t count;
-
-    fres = f_open(&file, ACTIVE_SCENE_FILE, FA_READ | FA_OPEN_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("scene_mng::get_active_scene: Error when open file %s\n", ACTIVE_SCENE_FILE);
-        print_ferr(fres);
+    /* cached, they're read from file once in restore */
+    if (index >= max_num_active_scenes) {
+        name[0] = '\0';
         return;
     }
+    memcpy(name, active_scenes[index], scene_max_name_chars_wout_folders);
+}
 
-    /* read data from file */
-    f_gets(line, 16, &file);
+/*----------------------------------------------------------------------------*/
+scene *scene_mng::get_active_scene_ptr(uint8_t index)
+{
+    if (index >= max_num_active_scenes) {
+        return NULL;
+    }
+    return get_scene_ptr_with_index(user_scene_index + index);
+}
 
-    /* close file */
-    f_close(&file);
+/*----------------------------------------------------------------------------*/
+void scene_mng::set_active_scene_valid_status(uint8_t index, bool status)
+{
+    if (index >= max_num_active_scenes) {
+        return;
+    }
+    scenes_list[user_scene_index + index].valid = status;
+}
 
-    /* copy to name */
-    memcpy(name, line, scene_max_name_chars_wout_folders - 1);
-    name[scene_max_name_chars_wout_folders] = '\0';
+/*----------------------------------------------------------------------------*/
+uint8_t scene_mng::get_num_of_active_scenes(void)
+{
+    uint8_t num_scenes = 1; /* user scene */
 
-    /* remove ending '\n' */
-    for (count = 0; count < scene_max_name_chars_wout_folders; count++) {
-        if (name[count] == '\n') {
-            name[count] = '\0';
-            break;
+    for (uint8_t index = 1; index < max_num_active_scenes; index++) {
+        if (active_scenes[index][0] != '\0') {
+            num_scenes++;
         }
     }
+
+    return num_scenes;
 }
 
-/*------------------------ Inactive scene --------------------------------------*/
-uint8_t scene_mng::get_num_of_inactive_scenes(void)
+/*----------------------------------------------------------------------------*/
+uint8_t scene_mng::get_active_scene_index(uint8_t pos)
 {
-    DIR dir;
-    FRESULT fres;
-    FILINFO finfo;
-    uint8_t retval = 0;
-    char current_running_scene[scene_max_name_chars_wout_folders];
+    for (uint8_t index = 0; index < max_num_active_scenes; index++) {
+        if (index != 0 && active_scenes[index][0] == '\0') {
+            continue;
+        }
 
-    /* get current running scene name */
-    get_user_scene(current_running_scene);
+        if (pos == 0) {
+            return index;
+        }
+        pos--;
+    }
 
-    /* open dir */
-    fres = f_opendir(&dir, SCENES_FOLDER);
-    if (fres != FR_OK) {
-        print_ferr(fres);
-        return 0;
+    return no_active_index;
+}
+
+/*----------------------------------------------------------------------------*/
+bool scene_mng::is_active_scene(const char *name)
+{
+    for (uint8_t index = 0; index < max_num_active_scenes; index++) {
+        if (active_scenes[index][0] != '\0' &&
+                strncmp(active_scenes[index], name, scene_max_name_chars_wout_folders - 1) == 0) {
+            return true;
+        }
     }
 
-    /* read dir */
-    while (1) {
-        fres = f_readdir(&dir, &finfo);
-        if (fres != FR_OK) { /* error when read dir */
-            print_ferr(fres);
-            return 0;
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::print_active_scenes(void)
+{
+    uint8_t slot;
+
+    for (uint8_t index = 1; index < max_num_active_scenes; index++) {
+        if (active_scenes[index][0] == '\0') {
+            continue;
         }
 
-        if (finfo.fname[0] == 0) { /* end of dir */
-            break;
+        slot = user_scene_index + index;
+        if (scenes_list[slot].valid) {
+            HA_NOTIFY("Active scene %hu (%s):\n"
+                    "---\n", index, scenes_list[slot].scene_obj.get_name());
+            scenes_list[slot].scene_obj.print(rtc_p);
+        }
+        else {
+            HA_NOTIFY("Active scene %hu (%s): Invalid\n", index,
+                    scenes_list[slot].scene_obj.get_name());
         }
+    }
+}
 
-        /* compare with default scene name and .., ., and active scene name */
-        if (strcmp(finfo.fname, DEFAULT_SCENE_FILE) == 0 ||
-                strcmp(finfo.fname, current_running_scene) == 0 ||
-                finfo.fname[0] == '.') {
-            continue;
+/*----------------------------------------------------------------------------*/
+void scene_mng::print_rule_pool(void)
+{
+    HA_NOTIFY("Rule pool: %hu of %hu rules used, %hu bytes each\n",
+            pool_p->get_num_used(), pool_p->get_size(), rule_pool_ns::bytes_per_rule);
+
+    for (uint8_t slot = 0; slot < max_num_scenes; slot++) {
+        if (scenes_list[slot].scene_obj.get_capacity() > 0) {
+            HA_NOTIFY("%s: %hu rules\n", scenes_list[slot].scene_obj.get_name(),
+                    scenes_list[slot].scene_obj.get_capacity());
         }
+    }
+}
 
-        retval++;
+/*----------------------------------------------------------------------------*/
+void scene_mng::save_active_scenes(void)
+{
+    char lines[max_num_active_scenes * scene_max_name_chars_wout_folders];
+    uint8_t index, last_index = 0;
+    uint16_t len = 0;
+
+    /* one line for each index, up to the last active scene */
+    for (index = 0; index < max_num_active_scenes; index++) {
+        if (active_scenes[index][0] != '\0') {
+            last_index = index;
+        }
     }
 
-    /* close dir */
-    f_closedir(&dir);
+    for (index = 0; index <= last_index; index++) {
+        len += snprintf(&lines[len], sizeof(lines) - len, "%s\n", active_scenes[index]);
+    }
 
-    return retval;
+    /* write-behind */
+    if (storage_request(storage_ns::WRITE, 0, ACTIVE_SCENE_FILE, lines, len,
+            NULL, NULL) != 0) {
+        HA_DEBUG("scene_mng::save_active_scenes: Storage queue is full\n");
+    }
 }
 
 /*----------------------------------------------------------------------------*/
-void scene_mng::get_inactive_scene_with_index(uint8_t index, char *name)
+int8_t scene_mng::read_active_scenes(void *arg)
 {
-    DIR dir;
+    char (*names)[scene_max_name_chars_wout_folders] =
+            (char (*)[scene_max_name_chars_wout_folders])arg;
+    FIL file;
     FRESULT fres;
-    FILINFO finfo;
-    uint8_t count;
-    char current_running_scene[scene_max_name_chars_wout_folders];
-
-    /* get current running scene name */
-    get_user_scene(current_running_scene);
+    char line[16];
+    uint8_t index;
+    uint16_t count;
 
-    /* open dir */
-    fres = f_opendir(&dir, SCENES_FOLDER);
+    fres = f_open(&file, ACTIVE_SCENE_FILE, FA_READ | FA_OPEN_ALWAYS);
     if (fres != FR_OK) {
+        HA_DEBUG("scene_mng::read_active_scenes: Error when open file %s\n", ACTIVE_SCENE_FILE);
         print_ferr(fres);
-        return;
+        return -1;
     }
 
-    /* read dir */
-    count = 0;
-    while (1) {
-        fres = f_readdir(&dir, &finfo);
-        if (fres != FR_OK) { /* error when read dir */
-            print_ferr(fres);
-            return;
+    /* one name each line, line of index 0 is user scene */
+    for (index = 0; index < max_num_active_scenes; index++) {
+        line[0] = '\0';
+        if (f_gets(line, sizeof(line), &file) == NULL) {
+            line[0] = '\0';
         }
 
-        if (finfo.fname[0] == 0) { /* end of dir */
-            break;
-        }
+        /* copy to name */
+        memcpy(names[index], line, scene_max_name_chars_wout_folders - 1);
+        names[index][scene_max_name_chars_wout_folders - 1] = '\0';
 
-        /* compare with default scene name and .., . */
-        if (strcmp(finfo.fname, DEFAULT_SCENE_FILE) == 0 ||
-                strcmp(finfo.fname, current_running_scene) == 0 ||
-                finfo.fname[0] == '.') {
-            continue;
+        /* remove ending '\n' */
+        for (count = 0; count < scene_max_name_chars_wout_folders; count++) {
+            if (names[index][count] == '\n') {
+                names[index][count] = '\0';
+                break;
+            }
         }
+    }
 
-        /* an scene is here */
-        if (count == index) {
-            /* it's here */
-            memcpy(name, finfo.fname, scene_max_name_chars_wout_folders);
-            name[scene_max_name_chars_wout_folders-1] = '\0';
-            break;
+    /* close file */
+    f_close(&file);
+
+    return 0;
+}
+
+/*------------------------ Inactive scene --------------------------------------*/
+uint8_t scene_mng::get_num_of_inactive_scenes(void)
+{
+    char running_scene[scene_max_name_chars_wout_folders];
+    uint8_t pos, count = 0;
+
+    if (!catalog_loaded) {
+        load_catalog();
+    }
+
+    get_user_scene(running_scene);
+    for (pos = 0; pos < num_catalog; pos++) {
+        if (is_inactive_catalog_entry(pos, running_scene)) {
+            count++;
         }
+    }
 
-        count++;
+    return count;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::get_inactive_scene_with_index(uint8_t index, char *name)
+{
+    int16_t pos = find_inactive_pos(index);
+
+    if (pos < 0) {
+        name[0] = '\0';
+        return;
     }
+    memcpy(name, catalog[pos].name, scene_max_name_chars_wout_folders);
+}
 
-    /* close dir */
-    f_closedir(&dir);
+/*----------------------------------------------------------------------------*/
+int8_t scene_mng::get_inactive_scene_info(uint8_t index, catalog_entry_t &entry)
+{
+    int16_t pos = find_inactive_pos(index);
+
+    if (pos < 0) {
+        return -1;
+    }
+    entry = catalog[pos];
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::print_inactive_scenes(void)
+{
+    catalog_entry_t entry;
+    uint8_t index = 0;
+
+    while (get_inactive_scene_info(index, entry) == 0) {
+        HA_NOTIFY("Inactive scene %hu (%s): %hu rules, %lu bytes\n", index, entry.name,
+                entry.num_rules, entry.size);
+        index++;
+    }
+    HA_NOTIFY("%hu inactive scenes, %hu scenes in catalog (max %hu)\n", index, num_catalog,
+            max_num_catalog_scenes);
 }
 
 /*----------------------------------------------------------------------------*/
 int8_t scene_mng::remove_inactive_scene(const char *name)
 {
+    if (is_active_scene(name)) {
+        HA_NOTIFY("scene_mng: %s is active, not removed\n", name);
+        return -1;
+    }
+
+    if (storage_call(remove_scene_file, (void *)name) != 0) {
+        return -1;
+    }
+
+    catalog_remove(name);
+    scene_changed();
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene_mng::remove_scene_file(void *arg)
+{
+    const char *name = (const char *)arg;
     FRESULT fres;
-    char name_with_folder[scene_max_name_chars];
+    char name_with_folder[journal_ns::max_name_chars]; /* name and journal name */
 
     /* Build path name */
     strcpy(name_with_folder, SCENES_FOLDER "/");
@@ -339,22 +614,53 @@ int8_t scene_mng::remove_inactive_scene(const char *name)
         return -1;
     }
 
+    /* and its journal (if any) */
+    strcat(name_with_folder, scene_file_ns::journal_ext);
+    f_unlink(name_with_folder);
+
     return 0;
 }
 
 /*----------------------------------------------------------------------------*/
 int8_t scene_mng::rename_inactive_scene(const char *old_name, const char *new_name)
 {
+    const char *names[2] = { old_name, new_name };
+    int16_t pos;
+
+    if (is_active_scene(old_name)) {
+        HA_NOTIFY("scene_mng: %s is active, not renamed\n", old_name);
+        return -1;
+    }
+
+    if (storage_call(rename_scene_file, names) != 0) {
+        return -1;
+    }
+
+    pos = catalog_find(old_name);
+    if (pos >= 0) {
+        strncpy(catalog[pos].name, new_name, scene_max_name_chars_wout_folders - 1);
+        catalog[pos].name[scene_max_name_chars_wout_folders - 1] = '\0';
+        inactive_gen++;
+    }
+
+    scene_changed();
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene_mng::rename_scene_file(void *arg)
+{
+    const char **names = (const char **)arg;
     FRESULT fres;
-    char name_with_folder[scene_max_name_chars];
-    char name_with_folder_new[scene_max_name_chars];
+    char name_with_folder[journal_ns::max_name_chars];
+    char name_with_folder_new[journal_ns::max_name_chars];
 
     /* Build paths */
     strcpy(name_with_folder, SCENES_FOLDER "/");
-    strcat(name_with_folder, old_name);
+    strcat(name_with_folder, names[0]);
 
     strcpy(name_with_folder_new, SCENES_FOLDER "/");
-    strcat(name_with_folder_new, new_name);
+    strcat(name_with_folder_new, names[1]);
 
     /* rename */
     fres = f_rename(name_with_folder, name_with_folder_new);
@@ -364,6 +670,12 @@ int8_t scene_mng::rename_inactive_scene(const char *old_name, const char *new_na
         return -1;
     }
 
+    /* and its journal (if any) */
+    strcat(name_with_folder, scene_file_ns::journal_ext);
+    strcat(name_with_folder_new, scene_file_ns::journal_ext);
+    f_unlink(name_with_folder_new);
+    f_rename(name_with_folder, name_with_folder_new);
+
     return 0;
 }
 
@@ -425,6 +737,202 @@ scene *scene_mng::get_scene_ptr_with_index(uint8_t index)
     return &scenes_list[index].scene_obj;
 }
 
+/*----------------------------------------------------------------------------*/
+void scene_mng::restore_scene_with_index(uint8_t index)
+{
+    if (scenes_list[index].scene_obj.restore() != 0) {
+        HA_NOTIFY("Failed to restore scene (%s)\n", scenes_list[index].scene_obj.get_name());
+        scenes_list[index].valid = false;
+    }
+    else {
+        HA_NOTIFY("Scene (%s) restored\n", scenes_list[index].scene_obj.get_name());
+        scenes_list[index].valid = true;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene_mng::load_catalog(void)
+{
+    num_catalog = 0;
+    inactive_gen++;
+    catalog_loaded = (storage_call(read_catalog, this) == 0);
+
+    HA_DEBUG("scene_mng::load_catalog: %hu scenes\n", num_catalog);
+
+    return catalog_loaded ? 0 : -1;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t scene_mng::catalog_find(const char *name)
+{
+    for (uint8_t pos = 0; pos < num_catalog; pos++) {
+        if (strncmp(catalog[pos].name, name, scene_max_name_chars_wout_folders - 1) == 0) {
+            return pos;
+        }
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::catalog_update(const char *name, uint16_t num_rules, uint32_t size)
+{
+    int16_t pos = catalog_find(name);
+
+    if (pos < 0) {
+        if (num_catalog >= max_num_catalog_scenes) {
+            HA_NOTIFY("scene_mng: scene catalog is full, %s isn't listed\n", name);
+            return;
+        }
+        pos = num_catalog;
+        num_catalog++;
+        strncpy(catalog[pos].name, name, scene_max_name_chars_wout_folders - 1);
+        catalog[pos].name[scene_max_name_chars_wout_folders - 1] = '\0';
+        inactive_gen++;
+    }
+
+    catalog[pos].num_rules = num_rules;
+    catalog[pos].size = size;
+}
+
+/*----------------------------------------------------------------------------*/
+void scene_mng::catalog_remove(const char *name)
+{
+    int16_t pos = catalog_find(name);
+
+    if (pos < 0) {
+        return;
+    }
+
+    num_catalog--;
+    memmove(&catalog[pos], &catalog[pos + 1], (num_catalog - pos) * sizeof(catalog_entry_t));
+    inactive_gen++;
+}
+
+/*----------------------------------------------------------------------------*/
+bool scene_mng::is_inactive_catalog_entry(uint8_t pos, const char *running_scene)
+{
+    if (strcmp(catalog[pos].name, running_scene) == 0) {
+        return false;
+    }
+
+    for (uint8_t index = 1; index < max_num_active_scenes; index++) {
+        if (strcmp(catalog[pos].name, active_scenes[index]) == 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t scene_mng::find_inactive_pos(uint8_t index)
+{
+    char running_scene[scene_max_name_chars_wout_folders];
+    uint8_t pos = 0, count = 0;
+
+    if (!catalog_loaded) {
+        load_catalog();
+    }
+
+    /* continue from last found scene */
+    if (cursor_gen == inactive_gen && index >= cursor_index) {
+        if (index == cursor_index) {
+            return cursor_pos;
+        }
+        pos = cursor_pos + 1;
+        count = cursor_index + 1;
+    }
+
+    get_user_scene(running_scene);
+    for (; pos < num_catalog; pos++) {
+        if (!is_inactive_catalog_entry(pos, running_scene)) {
+            continue;
+        }
+
+        if (count == index) {
+            cursor_gen = inactive_gen;
+            cursor_index = index;
+            cursor_pos = pos;
+            return pos;
+        }
+        count++;
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t scene_mng::read_catalog(void *arg)
+{
+    scene_mng *mng = (scene_mng *)arg;
+    DIR dir;
+    FIL file;
+    FRESULT fres;
+    FILINFO finfo;
+    UINT bytes;
+    scene_file_ns::header_t header;
+    char name_with_folder[scene_max_name_chars];
+    catalog_entry_t *entry;
+
+    /* open dir */
+    fres = f_opendir(&dir, SCENES_FOLDER);
+    if (fres != FR_OK) {
+        print_ferr(fres);
+        return -1;
+    }
+
+    /* read dir */
+    while (1) {
+        fres = f_readdir(&dir, &finfo);
+        if (fres != FR_OK) { /* error when read dir */
+            print_ferr(fres);
+            f_closedir(&dir);
+            return -1;
+        }
+
+        if (finfo.fname[0] == 0) { /* end of dir */
+            break;
+        }
+
+        /* skip default scene, .., . and journals (scene names have no extension) */
+        if ((finfo.fattrib & AM_DIR) || strcmp(finfo.fname, DEFAULT_SCENE_FILE) == 0 ||
+                strchr(finfo.fname, '.') != NULL) {
+            continue;
+        }
+
+        if (mng->num_catalog >= max_num_catalog_scenes) {
+            HA_NOTIFY("scene_mng: scene catalog is full, %s and later scenes aren't listed\n",
+                    finfo.fname);
+            break;
+        }
+
+        entry = &mng->catalog[mng->num_catalog];
+        memcpy(entry->name, finfo.fname, scene_max_name_chars_wout_folders);
+        entry->name[scene_max_name_chars_wout_folders - 1] = '\0';
+        entry->size = finfo.fsize;
+        entry->num_rules = 0;
+
+        /* num of rules from header, old text scene files have none */
+        strcpy(name_with_folder, SCENES_FOLDER "/");
+        strcat(name_with_folder, entry->name);
+        if (f_open(&file, name_with_folder, FA_READ) == FR_OK) {
+            if (f_read(&file, &header, sizeof(header), &bytes) == FR_OK &&
+                    bytes == sizeof(header) && header.magic == scene_file_ns::magic) {
+                entry->num_rules = header.num_rules;
+            }
+            f_close(&file);
+        }
+
+        mng->num_catalog++;
+    }
+
+    /* close dir */
+    f_closedir(&dir);
+
+    return 0;
+}
+
 /*----------------------------------------------------------------------------*/
 void scene_mng::not_dir(char* path_name)
 {
@@ -451,7 +959,7 @@ void scene_mng::not_dir(char* path_name)
 /*----------------------------- Shell command --------------------------------*/
 void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv)
 {
-    uint8_t count, scene_type = NO_SCENE;
+    uint8_t count, scene_type = NO_SCENE, active_index = 0;
     scene *scene_p = NULL;
     scene_ns::rule_t rule;
     scene_ns::input_t input;
@@ -487,8 +995,17 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                     scene_type = USER_SCENE;
                     scene_p = scene_mng_obj.get_user_scene_ptr();
                 }
+                else if (argv[count][0] >= '1' && argv[count][0] <= '9') {
+                    active_index = atoi(argv[count]);
+                    scene_p = scene_mng_obj.get_active_scene_ptr(active_index);
+                    if (scene_p == NULL) {
+                        printf("Err: no active scene with index %hu\n", active_index);
+                        return;
+                    }
+                    scene_type = ACTIVE_SCENE;
+                }
                 else {
-                    printf("Err: should be d or u for option -s\n");
+                    printf("Err: should be d, u or index for option -s\n");
                     return;
                 }
                 break;
@@ -500,12 +1017,38 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 else if (scene_type == DEFAULT_SCENE) {
                     scene_mng_obj.print_default_scene();
                 }
+                else if (scene_type == ACTIVE_SCENE) {
+                    scene_p->print(&rtc_obj);
+                }
                 else {
                     scene_mng_obj.print_default_scene();
                     scene_mng_obj.print_user_scene();
+                    scene_mng_obj.print_active_scenes();
                 }
                 return;
 
+            case 'A':
+                if (count + 1 >= argc) {
+                    printf("Err: to few argument for option %s\n", argv[count]);
+                    return;
+                }
+
+                active_index = atoi(argv[count + 1]);
+                if (active_index == 0) {
+                    printf("Err: index of user scene can't be set with -A\n");
+                    return;
+                }
+
+                if (scene_mng_obj.set_active_scene_with_index(active_index,
+                        (count + 2 < argc) ? argv[count + 2] : "") != 0) {
+                    printf("Err: can't set active scene with index %hu\n", active_index);
+                }
+                return;
+
+            case 'm':
+                scene_mng_obj.print_rule_pool();
+                return;
+
             case 'a': /* add new rule to scene */
                 if (scene_type == NO_SCENE) {
                     printf("Err: scene type is not defined with -s\n");
@@ -575,6 +1118,7 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                     break;
 
                 case scene_ns::COND_CHANGE_VAL:
+                case scene_ns::COND_EXPIRED:
                     /* follow by device id only */
                     if (count + 1 >= argc) {
                         printf("Err: too few argument for this input, cond (%hu)\n",
@@ -674,6 +1218,8 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 output.action = atoi(argv[++count]);
                 switch(output.action) {
                 case scene_ns::ACT_SET_DEV_VAL:
+                case scene_ns::ACT_SET_DEV_MULT_VALS:
+                case scene_ns::ACT_SET_DEV_MULT_VALS_END:
                     /* follow by device id (hex) and value */
                     if (count + 2 >= argc) {
                         printf("Err: too few argument for this output, act (%hu)\n",
@@ -708,6 +1254,7 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 }
 
                 scene_p->remove_rule_with_index(atoi(argv[++count]));
+                scene_mng_obj.scene_changed();
                 printf("Rule %hu removed\n", atoi(argv[++count]));
                 break;
 
@@ -726,6 +1273,10 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                     printf("Halt processing user scene\n");
                     scene_mng_obj.set_user_scene_valid_status(false);
                 }
+                else if (scene_type == ACTIVE_SCENE) {
+                    printf("Halt processing active scene %hu\n", active_index);
+                    scene_mng_obj.set_active_scene_valid_status(active_index, false);
+                }
                 break;
 
             case 'r':
@@ -743,6 +1294,10 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                     printf("Restart processing user scene\n");
                     scene_mng_obj.set_user_scene_valid_status(true);
                 }
+                else if (scene_type == ACTIVE_SCENE) {
+                    printf("Restart processing active scene %hu\n", active_index);
+                    scene_mng_obj.set_active_scene_valid_status(active_index, true);
+                }
                 break;
 
             case 'v':
@@ -752,6 +1307,7 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 }
 
                 scene_p->save();
+                scene_mng_obj.scene_saved(scene_p);
                 break;
 
             case 'e':
@@ -761,6 +1317,7 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 }
 
                 scene_p->restore();
+                scene_mng_obj.scene_changed();
                 break;
 
             case 'n':
@@ -772,6 +1329,10 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
                 scene_mng_obj.rename_inactive_scene(argv[count+1], argv[count+2]);
                 return;
 
+            case 'c':
+                scene_mng_obj.print_inactive_scenes();
+                return;
+
             case 'h':
                 printf("%s", scene_cmd_usage);
                 break;
@@ -787,6 +1348,9 @@ void scene_mng_cmd(scene_mng &scene_mng_obj, rtc &rtc_obj, int argc, char **argv
         if (scene_p->add_rule_with_index(rule, index) == -1) {
             printf("Err: when adding rule to index %hu\n", index);
         }
+        else {
+            scene_mng_obj.scene_changed();
+        }
     }
 }
 
@@ -23,18 +23,34 @@ extern "C" {
 }
 
 #include "scene.h"
+#include "rule_pool.h"
+#include "time_sched.h"
+#include "action_batch.h"
 #include "cir_queue.h"
 #include "ha_device_mng.h"
 
 namespace scene_mng_ns {
 
-const uint8_t max_num_scenes = 2;
+const uint8_t max_num_scenes = 8; /* default scene and active scenes */
+
+/* active scenes run together with default scene, index 0 is user scene */
+const uint8_t max_num_active_scenes = max_num_scenes - 1;
+const uint8_t no_active_index = 0xFF;
 
 typedef struct scenes_list_obj_s {
     bool valid;
     scene scene_obj;
 } scenes_list_obj_t;
 
+/* scene catalog, all scene files in scenes folder other than default scene */
+const uint8_t max_num_catalog_scenes = 64;
+
+typedef struct catalog_entry_s {
+    char name[scene_ns::scene_max_name_chars_wout_folders];
+    uint16_t num_rules;     /* when it was last saved (journal isn't counted at boot) */
+    uint32_t size;          /* of scene file in bytes, journal isn't counted */
+} catalog_entry_t;
+
 }
 
 using namespace scene_ns;
@@ -49,21 +65,45 @@ public:
      *
      * @param[in]   cur_device_mng_p, pointer to a device manager object.
      * @param[in]   rtc_obj_p, pointer to a rtc object.
-     * @param[in]   out_pid_p, pointer to pid of thread will be sent messages to.
-     * @param[in]   out_cir_queue_p, pointer to cir_queue will be pushed actions into.
+     * @param[in]   action_batch_p, output stage, actions of all scenes in one pass are
+     *              collected and flushed together.
+     * @param[in]   rule_pool_p, pool holding rules of all scenes, it MUST have at least
+     *              max_num_scenes spans.
+     * @param[in]   time_sched_p, schedule of time rules of all scenes, it SHOULD have as
+     *              many entries as rule pool has rules.
      */
     scene_mng(ha_device_mng *cur_device_mng_p, rtc *rtc_obj_p,
-            kernel_pid_t *out_pid_p, cir_queue *out_cir_queue_p);
+            action_batch *action_batch_p, rule_pool *rule_pool_p,
+            time_sched *time_sched_p);
 
     /**
-     * @brief   Process default scenes and user's scene.
+     * @brief   Process default scene and all active scenes.
      *
      * @param[in]   trigger_by_rpt, true if this has been triggered by report.
-     *              false if this has been triggered by time.
+     *              false if this has been triggered by time (process_time with current
+     *              time of rtc).
      * @param[in]   &out_cir_queue, cir_queue will be pushed actions into.
      */
     void process(bool trigger_by_rpt, ha_device *a_device_rpt);
 
+    /**
+     * @brief   Process rules of default scene and all active scenes which have a
+     *          condition on an expired device (device expired event, see COND_EXPIRED).
+     *
+     * @param[in]   device_id, id of expired device.
+     */
+    void process_expired(uint32_t device_id);
+
+    /**
+     * @brief   Process time rules of default scene and all active scenes whose time
+     *          conditions have changed since last call (instants in time schedule <=
+     *          cur_time). Scenes which have been changed are scheduled again first.
+     *          SHOULD be called every second.
+     *
+     * @param[in]   cur_time, packed time.
+     */
+    void process_time(uint32_t cur_time);
+
     /**
      * @brief   Save all scenes.
      */
@@ -74,6 +114,27 @@ public:
      */
     void restore(void);
 
+    /**
+     * @brief   Get version of scenes. It's changed every time a scene is changed, saved,
+     *          renamed, removed or active scene is changed.
+     *
+     * @return  version.
+     */
+    uint32_t get_version(void) { return version; }
+
+    /**
+     * @brief   Change version of scenes (e.g. after a scene has been changed by its object).
+     */
+    void scene_changed(void) { version++; }
+
+    /**
+     * @brief   Change version of scenes and update scene catalog after a scene has been
+     *          saved by its object (a new scene is added to the catalog).
+     *
+     * @param[in]   scene_p, the scene has been saved.
+     */
+    void scene_saved(scene *scene_p);
+
     /*------------------------ Current running user's scene ------------------*/
     /**
      * @brief   Set current running user scene name.
@@ -113,52 +174,134 @@ public:
      */
     void print_user_scene(void);
 
-    /*------------------------ Active scene ----------------------------------*/
+    /*------------------------ Active scenes ---------------------------------*/
+    /**
+     * @brief   Save name of active scene 0 (user scene) in active scene file
+     *          (write-behind). User scene is restored by set_user_scene and
+     *          restore_user_scene.
+     *
+     * @param[in]   name, scene name.
+     *
+     * @return  -1 if the scene is active with other index.
+     */
+    int8_t set_active_scene(const char *name) { return set_active_scene_with_index(0, name); }
+
     /**
-     * @brief   Save active scene name in active scene file.
+     * @brief   Set active scene with index and save names of all active scenes in active
+     *          scene file (write-behind). Scene with index > 0 is restored and run with
+     *          others, an empty name stops it and gives its rules back to rule pool.
      *
+     * @param[in]   index, < max_num_active_scenes.
      * @param[in]   name, scene name.
+     *
+     * @return  -1 if index is out of range, the scene is active with other index or it
+     *          can't be restored (e.g. rule pool is exhausted).
+     */
+    int8_t set_active_scene_with_index(uint8_t index, const char *name);
+
+    /**
+     * @brief   Get name of active scene 0 (read from file in restore).
+     *
+     * @param[out]  name, scene name, size of the buffer for name MUST be >=
+     *              scene_ns::scene_max_name_chars_wout_folders.
      */
-    void set_active_scene(const char *name);
+    void get_active_scene(char *name) { get_active_scene_with_index(0, name); }
 
     /**
-     * @brief   Get active scene name from file.
+     * @brief   Get name of active scene with index, empty if there is no scene with index.
      *
+     * @param[in]   index.
      * @param[out]  name, scene name, size of the buffer for name MUST be >=
      *              scene_ns::scene_max_name_chars_wout_folders.
      */
-    void get_active_scene(char *name);
+    void get_active_scene_with_index(uint8_t index, char *name);
 
     /**
-     * @brief   Get number of active scene.
+     * @brief   Get active scene pointer, index 0 is user scene.
+     *
+     * @return  pointer to scene object, NULL if index is out of range.
+     */
+    scene *get_active_scene_ptr(uint8_t index);
+
+    /**
+     * @brief   Set valid status of active scene with index.
+     */
+    void set_active_scene_valid_status(uint8_t index, bool status);
+
+    /**
+     * @brief   Get number of active scenes, user scene (index 0) is always counted.
+     *
+     * @return  num of active scenes.
+     */
+    uint8_t get_num_of_active_scenes(void);
+
+    /**
+     * @brief   Get index of an active scene.
+     *
+     * @param[in]   pos, position in active scenes (< get_num_of_active_scenes()).
      *
-     * @return  always return 1.
+     * @return  index, no_active_index if pos is out of range.
      */
-    uint8_t get_num_of_active_scenes(void) { return 1; }
+    uint8_t get_active_scene_index(uint8_t pos);
+
+    /**
+     * @brief   Check if a scene is active with any index.
+     */
+    bool is_active_scene(const char *name);
+
+    /**
+     * @brief   Print active scenes other than user scene.
+     */
+    void print_active_scenes(void);
+
+    /**
+     * @brief   Print usage of rule pool.
+     */
+    void print_rule_pool(void);
 
     /*------------------------ Inactive scenes -------------------------------*/
     /**
-     * @brief   Get number of inactive scene.
+     * @brief   Get number of inactive scene. Inactive scenes are scenes in scene catalog
+     *          other than user scene and active scenes, scenes folder isn't read again
+     *          after the catalog has been loaded.
      *
      * @return  num of inactive scenes.
      */
     uint8_t get_num_of_inactive_scenes(void);
 
     /**
-     * @brief   Get inactive scene name with index.
+     * @brief   Get inactive scene name with index. Getting names with consecutive indexes
+     *          goes through scene catalog once.
      *
      * @param[in]   index.
      * @paran[out]  name, size of the buffer for name MUST be >=
-     *              scene_ns::scene_max_name_chars_wout_folders.
+     *              scene_ns::scene_max_name_chars_wout_folders. Empty if there is no
+     *              scene with index.
      */
     void get_inactive_scene_with_index(uint8_t index, char *name);
 
+    /**
+     * @brief   Get catalog entry (name, num of rules, file size) of inactive scene
+     *          with index.
+     *
+     * @param[in]   index.
+     * @param[out]  entry.
+     *
+     * @return  -1 if there is no scene with index.
+     */
+    int8_t get_inactive_scene_info(uint8_t index, catalog_entry_t &entry);
+
+    /**
+     * @brief   Print inactive scenes with their num of rules and file sizes.
+     */
+    void print_inactive_scenes(void);
+
     /**
      * @brief   Remove an inactive scene.
      *
      * @param[in]   name,
      *
-     * @return  -1 if error.
+     * @return  -1 if error or the scene is active.
      */
     int8_t remove_inactive_scene(const char *name);
 
@@ -168,7 +311,7 @@ public:
      * @param[in]   old name,
      * @param[in]   new_name,
      *
-     * @return  -1 if error.
+     * @return  -1 if error or the scene is active.
      */
     int8_t rename_inactive_scene(const char *old_name, const char *new_name);
 
@@ -212,12 +355,17 @@ private:
     scene *get_scene_ptr_with_index(uint8_t index);
 
     /**
-     * @brief   Restore scene with index.
+     * @brief   Restore scene with index, set valid status of the scene.
      *
      * @param[in]   index.
      */
     void restore_scene_with_index(uint8_t index);
 
+    /**
+     * @brief   Queue names of all active scenes to be written to active scene file.
+     */
+    void save_active_scenes(void);
+
     /**
      * @brief   Save scene with index.
      *
@@ -232,11 +380,82 @@ private:
      */
     void not_dir(char* path_name);
 
+    /*------------------------ Scene catalog ---------------------------------*/
+    /**
+     * @brief   Load scene catalog from scenes folder (one pass, done in restore or by the
+     *          first query if it has failed).
+     *
+     * @return  -1 if scenes folder can't be read.
+     */
+    int8_t load_catalog(void);
+
+    /**
+     * @brief   Find a scene in scene catalog.
+     *
+     * @return  position in catalog, -1 if it isn't there.
+     */
+    int16_t catalog_find(const char *name);
+
+    /**
+     * @brief   Add a scene to scene catalog or update its entry.
+     */
+    void catalog_update(const char *name, uint16_t num_rules, uint32_t size);
+
+    /**
+     * @brief   Remove a scene from scene catalog.
+     */
+    void catalog_remove(const char *name);
+
+    /**
+     * @brief   Check if a scene in catalog is inactive (not user scene nor active scene).
+     */
+    bool is_inactive_catalog_entry(uint8_t pos, const char *running_scene);
+
+    /**
+     * @brief   Get position in scene catalog of inactive scene with index.
+     *
+     * @return  position, -1 if there is no scene with index.
+     */
+    int16_t find_inactive_pos(uint8_t index);
+
+    /**
+     * @brief   File I/O run in storage thread (storage_ns::call_func_t).
+     *          read_active_scenes, arg: active_scenes.
+     *          read_catalog, arg: scene_mng object.
+     *          remove_scene_file, arg: name.
+     *          rename_scene_file, arg: { old name, new name }.
+     */
+    static int8_t read_active_scenes(void *arg);
+    static int8_t read_catalog(void *arg);
+    static int8_t remove_scene_file(void *arg);
+    static int8_t rename_scene_file(void *arg);
+
+    /* names of active scenes, cached, empty if there is no scene with index */
+    char active_scenes[max_num_active_scenes][scene_max_name_chars_wout_folders];
+
+    /* scene catalog, in order of scenes folder, new scenes are appended */
+    catalog_entry_t catalog[max_num_catalog_scenes];
+    uint8_t num_catalog;
+    bool catalog_loaded;
+
+    /* last found inactive scene, consecutive indexes continue from here. It's valid
+     * while inactive_gen isn't changed (catalog, user scene or active scenes changed) */
+    uint16_t inactive_gen;
+    uint16_t cursor_gen;
+    uint8_t cursor_index;
+    uint8_t cursor_pos;
+
     ha_device_mng *device_mng_p;
     rtc *rtc_p;
-    kernel_pid_t *out_pid_p;
-    cir_queue *out_queue_p;
+    action_batch *batch_p;
     scenes_list_obj_t scenes_list[max_num_scenes];
+    rule_pool *pool_p;
+    uint32_t version;
+
+    /* time schedule, a slot is scheduled when it's valid */
+    time_sched *sched_p;
+    bool scheduled[max_num_scenes];
+    uint32_t last_time;
 };
 
 /*----------------------------- Shell command --------------------------------*/
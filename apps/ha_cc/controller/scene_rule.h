@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        scene_rule.h
+ * @brief       Rule definitions of scenes (no dependency, also used by tools on PC).
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef SCENE_RULE_H_
+#define SCENE_RULE_H_
+
+#include <stdint.h>
+
+namespace scene_ns {
+
+const uint8_t rule_max_input = 2;
+const uint8_t rule_max_output = 2;
+
+const uint8_t scene_max_name_chars = 20;
+const uint8_t scene_max_name_chars_wout_folders = 8 + 1;
+const uint16_t scene_max_rules = 25;
+
+/*-------------------------- CONDITION DEFINITIONS ---------------------------*/
+enum cond_e: uint8_t {
+    COND_EQUAL_THR = 0x00,          /* Condition: equal to threshold,
+                                    parameter: device id, threshold value */
+    COND_LESS_THAN_THR = 0x01,      /* Condition: less than threshold,
+                                    parameter: device id, threshold value */
+    COND_LESS_OR_EQUAL_THR = 0x02,  /* Condition: less than or equal to threshold,
+                                    device id, parameter: threshold value  */
+    COND_GREATER_THAN_THR = 0x03,   /* Condition: greater than threshold,
+                                    parameter: device id, threshold value */
+    COND_GREATER_OR_EQUAL_THR = 0x04, /* Condition: greater than or equal to threshold,
+                                    parameter: device id, threshold value */
+    COND_CHANGE_VAL = 0x05,         /* Condition: change value,
+                                    parameter: device id */
+    COND_CHANGE_VAL_OVER_THR = 0x08,    /* Condition: change value over a threshold,
+                                    parameter: device id, threshold value */
+    COND_IN_RANGE = 0x06,           /* Condition: in a time range,
+                                    parameter: time range (start time and end time)
+                                    Time is packed in 32bit following this format:
+                                    bit 0-4: second / 2.
+                                    bit 5-10: minute.
+                                    bit 11-15: hour.
+                                    bit 16-20: day in month.
+                                    bit 21-24: month.
+                                    bit 25-31: number of years from timebase.year. */
+    COND_IN_RANGE_EVDAY = 0x07,     /* Condition: in a time range of every day,
+                                    parameter: time range (start time and end time)
+                                    Time in packed format, only hour, min, sec will be
+                                    cared */
+    COND_EXPIRED = 0x09,            /* Condition: device has expired (no report or ALIVE
+                                    during its TTL), parameter: device id */
+    COND_NONE = 0xFF,               /* No input (rule with num_in 0, e.g. continuation of
+                                    ACT_SET_DEV_MULT_VALS), only in BLE messages */
+};
+
+/*-------------------------- ACTION DEFINITIONS ------------------------------*/
+enum act_e: uint8_t {
+    ACT_SET_DEV_VAL = 0x00,         /* Set value for a device (or a group address,
+                                    see device_id.h), param: device_id, value */
+    ACT_SET_DEV_MULT_VALS = 0x01,   /* Set value for a device as a part of a multi-device
+                                    command, followed by ACT_SET_DEV_MULT_VALS, and ended
+                                    with ACT_SET_DEV_MULT_VALS_END. When it's the last
+                                    output of a rule, the command goes on with outputs
+                                    of next rule (its inputs aren't checked, it usually
+                                    has no input), so a command can have more than
+                                    rule_max_output values. Values to one node are sent
+                                    in one SET_DEV_MULT_VALS GFF frame.
+                                    param: device_id, value */
+    ACT_SET_DEV_MULT_VALS_END = 0x02,   /* End value for ACT_SET_DEV_MULT_VALS,
+                                    param: device_id, value */
+};
+
+typedef struct dev_val_s {
+    uint32_t device_id;
+    int16_t value;
+} dev_val_t;
+
+typedef struct time_range_s {
+    uint32_t start;
+    uint32_t end;
+} time_range_t;
+
+typedef struct input_s {
+    uint8_t cond;
+    union {
+        dev_val_t dev_val;
+        time_range_t time_range;
+    };
+} input_t;
+
+typedef struct output_s {
+    uint8_t action;
+    union {
+        dev_val_t dev_val;
+    };
+} output_t;
+
+typedef struct rule_s {
+    bool is_valid = false;
+
+    bool is_active = false;
+    uint8_t num_in = 0;
+    uint8_t num_out = 0;
+    input_t inputs[rule_max_input];
+    output_t outputs[rule_max_output];
+} rule_t;
+
+/*-------------------------- RULE INDEX DEFINITIONS --------------------------*/
+typedef struct dev_rule_s {
+    uint32_t device_id;
+    uint16_t rule_index;
+} dev_rule_t;
+
+}
+
+#endif // SCENE_RULE_H_
@@ -0,0 +1,111 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        time_sched.cpp
+ * @brief       Schedule of time conditions of scenes.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#include "time_sched.h"
+
+using namespace time_sched_ns;
+
+/*----------------------------------------------------------------------------*/
+time_sched::time_sched(entry_t *entries, uint16_t max_entries)
+{
+    this->entries = entries;
+    this->max_entries = max_entries;
+    num_entries = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t time_sched::push(entry_t &entry)
+{
+    if (num_entries >= max_entries) {
+        return -1;
+    }
+
+    entries[num_entries] = entry;
+    num_entries++;
+    sift_up(num_entries - 1);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t time_sched::pop(entry_t &entry)
+{
+    if (num_entries == 0) {
+        return -1;
+    }
+
+    entry = entries[0];
+    num_entries--;
+    if (num_entries > 0) {
+        entries[0] = entries[num_entries];
+        sift_down(0);
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void time_sched::remove_slot(uint8_t slot)
+{
+    uint16_t count, kept = 0;
+
+    for (count = 0; count < num_entries; count++) {
+        if (entries[count].slot != slot) {
+            entries[kept] = entries[count];
+            kept++;
+        }
+    }
+    num_entries = kept;
+
+    /* heapify */
+    for (count = num_entries / 2; count > 0; count--) {
+        sift_down(count - 1);
+    }
+}
+
+/*------------------------ Private methods -----------------------------------*/
+void time_sched::sift_up(uint16_t pos)
+{
+    entry_t entry = entries[pos];
+    uint16_t parent;
+
+    while (pos > 0) {
+        parent = (pos - 1) / 2;
+        if (entries[parent].instant <= entry.instant) {
+            break;
+        }
+        entries[pos] = entries[parent];
+        pos = parent;
+    }
+    entries[pos] = entry;
+}
+
+/*----------------------------------------------------------------------------*/
+void time_sched::sift_down(uint16_t pos)
+{
+    entry_t entry = entries[pos];
+    uint16_t child;
+
+    while ((child = 2 * pos + 1) < num_entries) {
+        if (child + 1 < num_entries && entries[child + 1].instant < entries[child].instant) {
+            child++;
+        }
+        if (entry.instant <= entries[child].instant) {
+            break;
+        }
+        entries[pos] = entries[child];
+        pos = child;
+    }
+    entries[pos] = entry;
+}
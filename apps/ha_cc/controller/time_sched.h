@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        time_sched.h
+ * @brief       Schedule of time conditions of scenes.
+ *              Min-heap of instants (packed time) at which time conditions of a rule
+ *              change their truth value (a time range opens or closes). Only the rules at
+ *              top of the heap are evaluated when their instant has come.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef TIME_SCHED_H_
+#define TIME_SCHED_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace time_sched_ns {
+
+const uint32_t never = 0xFFFFFFFF;
+
+typedef struct entry_s {
+    uint32_t instant;       /* packed time */
+    uint16_t rule_index;
+    uint8_t slot;           /* slot of scene in scene_mng */
+    bool edge;              /* false: only reschedule (e.g. next day), rule isn't evaluated */
+} entry_t;
+
+}
+
+class time_sched {
+public:
+    /**
+     * @brief   constructor, user must allocate buffer for entries.
+     *
+     * @param[in]   entries, buffer of entries.
+     * @param[in]   max_entries, number of entries in the buffer.
+     */
+    time_sched(time_sched_ns::entry_t *entries, uint16_t max_entries);
+
+    /**
+     * @brief   Add an entry, O(log n).
+     *
+     * @return  -1 if schedule is full.
+     */
+    int8_t push(time_sched_ns::entry_t &entry);
+
+    /**
+     * @brief   Get entry with the earliest instant.
+     *
+     * @return  pointer to the entry, NULL if schedule is empty.
+     */
+    time_sched_ns::entry_t *peek(void) { return (num_entries == 0) ? NULL : &entries[0]; }
+
+    /**
+     * @brief   Remove entry with the earliest instant, O(log n).
+     *
+     * @param[out]  entry, removed entry.
+     *
+     * @return  -1 if schedule is empty.
+     */
+    int8_t pop(time_sched_ns::entry_t &entry);
+
+    /**
+     * @brief   Remove all entries of a scene slot, O(n).
+     */
+    void remove_slot(uint8_t slot);
+
+    /**
+     * @brief   Remove all entries.
+     */
+    void clear(void) { num_entries = 0; }
+
+    /**
+     * @brief   Get number of entries.
+     */
+    uint16_t get_size(void) { return num_entries; }
+
+private:
+    /**
+     * @brief   Move entry at pos up/down to its place in heap.
+     */
+    void sift_up(uint16_t pos);
+    void sift_down(uint16_t pos);
+
+    time_sched_ns::entry_t *entries;
+    uint16_t max_entries;
+    uint16_t num_entries;
+};
+
+#endif // TIME_SCHED_H_
@@ -18,6 +18,7 @@
 #include "zone.h"
 #include "ff.h"
 #include "shell_cmds_fatfs.h"
+#include "storage.h"
 
 static const char zone_cmd_usage[] = "Usage:\n"
         "zone -s id(hex) name, set zone name\n"
@@ -40,46 +41,18 @@ zone::zone(void)
 /*----------------------------------------------------------------------------*/
 int8_t zone::set_zone_name(uint8_t zone_id, const char *zone_name)
 {
-    FIL file;
-    FRESULT fres, fres2;
-    FILINFO fno;
     char path[zone_file_max_path_size];
 
-    /* check directory existed or not */
-    fres = f_stat(ZONES_FOLDER, &fno);
-    if (fres == FR_NO_FILE) {
-        HA_DEBUG("zone::set_zone_name:" ZONES_FOLDER "is not exists, creating\n");
-        fres2 = f_mkdir(ZONES_FOLDER);
-        if (fres2 == FR_OK) {
-            HA_DEBUG("zone::set_zone_name:" ZONES_FOLDER "is created\n");
-        }
-        else {
-            print_ferr(fres);
-            return -1;
-        }
-    }
-    else if (fres != FR_OK) {
-        print_ferr(fres);
-        return -1;
-    }
-
     /* build path */
     snprintf(path, zone_file_max_path_size, ZONES_FOLDER "/%x", zone_id);
 
-    /* open zone file */
-    fres = f_open(&file, path, FA_WRITE | FA_CREATE_ALWAYS);
-    if (fres != FR_OK) {
-        HA_DEBUG("zone::set_zone_name: Error when open file %s\n", path);
-        print_ferr(fres);
+    /* write-behind, folder is created if it doesn't exist */
+    if (storage_request(storage_ns::MKDIR, 0, ZONES_FOLDER, NULL, 0, NULL, NULL) != 0 ||
+            storage_request(storage_ns::WRITE, storage_ns::AFTER_PREV_OK, path,
+                    zone_name, strlen(zone_name), NULL, NULL) != 0) {
+        HA_DEBUG("zone::set_zone_name: Storage queue is full\n");
         return -1;
     }
-    f_sync(&file);
-
-    /* write name to file */
-    f_printf(&file, "%s", zone_name);
-
-    /* close file */
-    f_close(&file);
 
     return 0;
 }
@@ -87,12 +60,46 @@ int8_t zone::set_zone_name(uint8_t zone_id, const char *zone_name)
 /*----------------------------------------------------------------------------*/
 int8_t zone::get_zone_name(uint8_t zone_id, uint8_t buf_size, char *zone_name)
 {
+    name_arg_t name_arg;
+
+    name_arg.zone_id = zone_id;
+    name_arg.buf_size = buf_size;
+    name_arg.zone_name = zone_name;
+
+    return storage_call(read_zone_name, &name_arg);
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t zone::get_zone_ids(uint8_t max_zones, uint8_t *zone_ids)
+{
+    ids_arg_t ids_arg;
+
+    ids_arg.max_zones = max_zones;
+    ids_arg.zone_ids = zone_ids;
+    ids_arg.num_zones = 0;
+
+    storage_call(read_zone_ids, &ids_arg);
+
+    return ids_arg.num_zones;
+}
+
+/*----------------------------------------------------------------------------*/
+void zone::get_zone_folder_name(uint8_t buf_size, char *zone_folder_name)
+{
+    strncpy(zone_folder_name, ZONES_FOLDER, buf_size);
+    zone_folder_name[buf_size] = '\0';
+}
+
+/*----------------------------- Private methods ------------------------------*/
+int8_t zone::read_zone_name(void *arg)
+{
+    name_arg_t *name_arg_p = (name_arg_t *)arg;
     FIL file;
     FRESULT fres;
     char path[zone_file_max_path_size];
 
     /* build path */
-    snprintf(path, zone_file_max_path_size, ZONES_FOLDER "/%x", zone_id);
+    snprintf(path, zone_file_max_path_size, ZONES_FOLDER "/%x", name_arg_p->zone_id);
 
     /* open file */
     fres = f_open(&file, path, FA_READ | FA_OPEN_ALWAYS);
@@ -103,8 +110,8 @@ int8_t zone::get_zone_name(uint8_t zone_id, uint8_t buf_size, char *zone_name)
     }
 
     /* get name */
-    memset(zone_name, '\0', buf_size);
-    f_gets(zone_name, buf_size, &file);
+    memset(name_arg_p->zone_name, '\0', name_arg_p->buf_size);
+    f_gets(name_arg_p->zone_name, name_arg_p->buf_size, &file);
 
     /* close file */
     f_close(&file);
@@ -113,10 +120,43 @@ int8_t zone::get_zone_name(uint8_t zone_id, uint8_t buf_size, char *zone_name)
 }
 
 /*----------------------------------------------------------------------------*/
-void zone::get_zone_folder_name(uint8_t buf_size, char *zone_folder_name)
+int8_t zone::read_zone_ids(void *arg)
 {
-    strncpy(zone_folder_name, ZONES_FOLDER, buf_size);
-    zone_folder_name[buf_size] = '\0';
+    ids_arg_t *ids_arg_p = (ids_arg_t *)arg;
+    FRESULT fres;
+    DIR dir;
+    FILINFO finfo;
+
+    /* Open zones folder to get all zone ids */
+    fres = f_opendir(&dir, ZONES_FOLDER);
+    if (fres != FR_OK) {
+        print_ferr(fres);
+        return -1;
+    }
+
+    while (ids_arg_p->num_zones < ids_arg_p->max_zones) {
+        fres = f_readdir(&dir, &finfo);
+        if (fres != FR_OK) { /* error when read dir */
+            print_ferr(fres);
+            break;
+        }
+
+        if (finfo.fname[0] == 0) { /* end of dir */
+            break;
+        }
+
+        if (finfo.fname[0] == '.') {
+            continue;
+        }
+
+        ids_arg_p->zone_ids[ids_arg_p->num_zones] = (uint8_t)atoi(finfo.fname);
+        ids_arg_p->num_zones++;
+    }
+
+    /* close dir */
+    f_closedir(&dir);
+
+    return 0;
 }
 
 /*----------------------------- Shell command --------------------------------*/
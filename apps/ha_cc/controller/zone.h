@@ -23,6 +23,7 @@ namespace zone_ns {
 const uint8_t zone_file_max_path_size = 16;
 const uint8_t zone_name_max_size = 16;
 const uint8_t zone_folder_name_max_size = 8 + 1;
+const uint8_t max_num_zones = 32;
 };
 
 class zone {
@@ -33,12 +34,12 @@ public:
     zone(void);
 
     /**
-     * @brief   Set zone name to file.
+     * @brief   Set zone name to file (write-behind).
      *
      * @param[in]   zone_id.
      * @param[in]   zone_name.
      *
-     * @return      0 on success, -1 if fail.
+     * @return      0 on success, -1 if storage queue is full.
      */
     int8_t set_zone_name(uint8_t zone_id, const char *zone_name);
 
@@ -53,6 +54,16 @@ public:
      */
     int8_t get_zone_name(uint8_t zone_id, uint8_t buf_size, char *zone_name);
 
+    /**
+     * @brief   Get ids of zones which have names.
+     *
+     * @param[in]   max_zones, size of zone_ids buffer.
+     * @param[out]  zone_ids,
+     *
+     * @return      number of zone ids.
+     */
+    uint8_t get_zone_ids(uint8_t max_zones, uint8_t *zone_ids);
+
     /**
      * @brief   Get zone folder name.
      *
@@ -64,6 +75,24 @@ public:
      */
     void get_zone_folder_name(uint8_t buf_size, char *zone_folder_name);
 private:
+    /* arguments of read_zone_name, read_zone_ids */
+    typedef struct name_arg_s {
+        uint8_t zone_id;
+        uint8_t buf_size;
+        char *zone_name;
+    } name_arg_t;
+
+    typedef struct ids_arg_s {
+        uint8_t max_zones;
+        uint8_t *zone_ids;
+        uint8_t num_zones;
+    } ids_arg_t;
+
+    /**
+     * @brief   File I/O run in storage thread (storage_ns::call_func_t).
+     */
+    static int8_t read_zone_name(void *arg);
+    static int8_t read_zone_ids(void *arg);
 };
 
 /*----------------------------- Shell command --------------------------------*/
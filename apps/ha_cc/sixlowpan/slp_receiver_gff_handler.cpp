@@ -25,10 +25,12 @@ void slp_received_GFF_handler(uint8_t *GFF_buffer)
 {
     HA_DEBUG("slp_received_GFF_handler, forward to controller\n");
 
-    /* Push data to queue */
-    controller_ns::slp_to_controller_queue.add_data(
-            GFF_buffer,
-            ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE + GFF_buffer[ha_ns::GFF_LEN_POS]);
+    /* Push frame to ring, controller parses it in place */
+    if (controller_ns::slp_to_controller_queue.add_frame(GFF_buffer,
+            ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE + GFF_buffer[ha_ns::GFF_LEN_POS]) < 0) {
+        HA_NOTIFY("slp_received_GFF_handler: queue to controller is full, frame dropped\n");
+        return;
+    }
     /* send message to controller */
     msg_t mesg;
     mesg.type = ha_cc_ns::SLP_GFF_PENDING;
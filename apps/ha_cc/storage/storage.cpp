@@ -0,0 +1,335 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        storage.cpp
+ * @brief       CC's storage thread.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#include <string.h>
+
+extern "C" {
+#include "thread.h"
+#include "msg.h"
+#include "mutex.h"
+}
+
+#include "storage.h"
+#include "cc_msg_id.h"
+#include "cir_queue.h"
+#include "ff.h"
+#include "shell_cmds_fatfs.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace storage_ns;
+
+kernel_pid_t storage_ns::storage_pid = KERNEL_PID_UNDEF;
+
+/* Storage thread message queue */
+static const uint16_t storage_message_queue_size = 16;
+static msg_t storage_message_queue[storage_message_queue_size];
+
+/* Storage thread stack */
+static const uint16_t storage_stack_size = 1536;
+static char storage_stack[storage_stack_size];
+/* lower than controller, SD card I/O never delays controller */
+static const char storage_prio = PRIORITY_MAIN + 1;
+
+/* Requests */
+static uint8_t storage_queue_buf[queue_size];
+static cir_queue storage_queue(storage_queue_buf, queue_size);
+static mutex_t storage_mutex = MUTEX_INIT;
+
+typedef struct call_s {
+    call_func_t call_func;
+    void *arg;
+} call_t;
+
+/* Prototypes */
+static void *storage_func(void *arg);
+static void process_requests(void);
+static int8_t do_request(request_t *request_p);
+static FRESULT write_data(FIL *file_p, uint16_t len);
+static void drop_data(uint16_t len);
+
+/*----------------------------------------------------------------------------*/
+void storage_start(void)
+{
+    storage_pid = thread_create(storage_stack, storage_stack_size, storage_prio,
+            CREATE_STACKTEST, storage_func, NULL, "CC_storage");
+    if (storage_pid > 0) {
+        HA_NOTIFY("CC Storage thread created.\n");
+    } else {
+        HA_NOTIFY("Can't create CC Storage thread.\n");
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t storage_begin(uint8_t op, uint8_t flags, const char *name, uint16_t len,
+        done_func_t done_func, void *done_arg)
+{
+    request_t request;
+
+    mutex_lock(&storage_mutex);
+
+    if (storage_queue.get_free() < (int32_t)(sizeof(request_t) + len)) {
+        mutex_unlock(&storage_mutex);
+        HA_DEBUG("storage_begin: No room for %s (%hu bytes)\n", name, len);
+        return -1;
+    }
+
+    memset(&request, 0, sizeof(request_t));
+    request.op = op;
+    request.flags = flags;
+    request.len = len;
+    strncpy(request.name, name, max_name_chars - 1);
+    request.done_func = done_func;
+    request.done_arg = done_arg;
+
+    storage_queue.add_data((uint8_t *)&request, sizeof(request_t));
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void storage_add_data(const void *data, uint16_t len)
+{
+    storage_queue.add_data((uint8_t *)data, len);
+}
+
+/*----------------------------------------------------------------------------*/
+void storage_end(void)
+{
+    msg_t mesg;
+
+    mutex_unlock(&storage_mutex);
+
+    mesg.type = ha_cc_ns::STORAGE_PENDING;
+    msg_send(&mesg, storage_pid, false);
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t storage_request(uint8_t op, uint8_t flags, const char *name,
+        const void *data, uint16_t len, done_func_t done_func, void *done_arg)
+{
+    if (storage_begin(op, flags, name, len, done_func, done_arg) != 0) {
+        return -1;
+    }
+
+    if (len > 0) {
+        storage_add_data(data, len);
+    }
+    storage_end();
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t storage_call(call_func_t call_func, void *arg)
+{
+    msg_t mesg, reply;
+    call_t call;
+
+    if (storage_pid == KERNEL_PID_UNDEF || thread_getpid() == storage_pid) {
+        return call_func(arg);
+    }
+
+    call.call_func = call_func;
+    call.arg = arg;
+
+    mesg.type = ha_cc_ns::STORAGE_CALL;
+    mesg.content.ptr = (char *)&call;
+    msg_send_receive(&mesg, &reply, storage_pid);
+
+    return (int8_t)reply.content.value;
+}
+
+/*----------------------------- Static functions -----------------------------*/
+static void *storage_func(void *)
+{
+    msg_t mesg, reply;
+    call_t *call_p;
+
+    /* Init message queue */
+    msg_init_queue(storage_message_queue, storage_message_queue_size);
+
+    /* requests queued before storage thread has been running */
+    process_requests();
+
+    while (1) {
+        msg_receive(&mesg);
+
+        switch (mesg.type) {
+        case ha_cc_ns::STORAGE_PENDING:
+            process_requests();
+            break;
+
+        case ha_cc_ns::STORAGE_CALL:
+            /* queued writes first, so the call reads what has been written */
+            process_requests();
+
+            call_p = (call_t *)mesg.content.ptr;
+            reply.content.value = (uint32_t)(int32_t)call_p->call_func(call_p->arg);
+            msg_reply(&mesg, &reply);
+            break;
+
+        default:
+            HA_DEBUG("storage: Unknown message %hu\n", mesg.type);
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+static void process_requests(void)
+{
+    static bool prev_failed = false;
+    request_t request;
+    int8_t result;
+
+    while (storage_queue.get_size() >= (int32_t)sizeof(request_t)) {
+        storage_queue.preview_data((uint8_t *)&request, 0, sizeof(request_t));
+        if (storage_queue.get_size() < (int32_t)(sizeof(request_t) + request.len)) {
+            /* data is being added, it'll be processed with STORAGE_PENDING of storage_end */
+            break;
+        }
+        storage_queue.get_data((uint8_t *)&request, sizeof(request_t));
+
+        if ((request.flags & AFTER_PREV_OK) && prev_failed) {
+            HA_NOTIFY("storage: %s dropped, previous request has failed\n", request.name);
+            drop_data(request.len);
+            result = -1;
+        }
+        else {
+            result = do_request(&request);
+        }
+        prev_failed = (result != 0);
+
+        if (request.done_func != NULL) {
+            request.done_func(request.done_arg, result);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+static int8_t do_request(request_t *request_p)
+{
+    FIL file;
+    FRESULT fres;
+    char new_name[max_name_chars];
+    uint16_t len;
+
+    switch (request_p->op) {
+    case WRITE:
+    case APPEND:
+        fres = f_open(&file, request_p->name, FA_WRITE |
+                ((request_p->op == WRITE) ? FA_CREATE_ALWAYS : FA_OPEN_ALWAYS));
+        if (fres != FR_OK) {
+            drop_data(request_p->len);
+            break;
+        }
+
+        if (request_p->op == APPEND) {
+            fres = f_lseek(&file, f_size(&file));
+        }
+        if (fres == FR_OK) {
+            fres = write_data(&file, request_p->len);
+        }
+        else {
+            drop_data(request_p->len);
+        }
+
+        /* file is synced once when it's closed */
+        if (f_close(&file) != FR_OK && fres == FR_OK) {
+            fres = FR_DISK_ERR;
+        }
+        break;
+
+    case UNLINK:
+        drop_data(request_p->len);
+        fres = f_unlink(request_p->name);
+        if (fres == FR_NO_FILE) {
+            fres = FR_OK;
+        }
+        break;
+
+    case RENAME:
+        len = (request_p->len < max_name_chars) ? request_p->len : max_name_chars - 1;
+        storage_queue.get_data((uint8_t *)new_name, len);
+        new_name[len] = '\0';
+        drop_data(request_p->len - len);
+
+        fres = f_rename(request_p->name, new_name);
+        break;
+
+    case MKDIR:
+        drop_data(request_p->len);
+        fres = f_mkdir(request_p->name);
+        if (fres == FR_EXIST) {
+            fres = FR_OK;
+        }
+        break;
+
+    default:
+        drop_data(request_p->len);
+        fres = FR_INVALID_PARAMETER;
+        break;
+    }
+
+    if (fres != FR_OK) {
+        HA_NOTIFY("storage: Request %hu on %s failed\n", request_p->op, request_p->name);
+        print_ferr(fres);
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static FRESULT write_data(FIL *file_p, uint16_t len)
+{
+    uint8_t chunk[64];
+    uint16_t chunk_len;
+    UINT bytes;
+    FRESULT fres = FR_OK;
+
+    /* data is always taken from queue, even after an error */
+    while (len > 0) {
+        chunk_len = (len > sizeof(chunk)) ? sizeof(chunk) : len;
+        storage_queue.get_data(chunk, chunk_len);
+        len -= chunk_len;
+
+        if (fres == FR_OK) {
+            fres = f_write(file_p, chunk, chunk_len, &bytes);
+            if (fres == FR_OK && bytes != chunk_len) {
+                fres = FR_DENIED; /* disk full */
+            }
+        }
+    }
+
+    return fres;
+}
+
+/*----------------------------------------------------------------------------*/
+static void drop_data(uint16_t len)
+{
+    uint8_t scratch[16];
+    uint16_t scratch_len;
+
+    while (len > 0) {
+        scratch_len = (len > sizeof(scratch)) ? sizeof(scratch) : len;
+        storage_queue.get_data(scratch, scratch_len);
+        len -= scratch_len;
+    }
+}
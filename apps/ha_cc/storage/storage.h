@@ -0,0 +1,131 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @file        storage.h
+ * @brief       CC's storage thread, the only thread doing FatFs I/O for controller.
+ *
+ *              Writes are queued (write-behind): a request and its data are copied to
+ *              storage queue and caller returns at once, storage thread writes them to
+ *              SD card in order. A done function can be given to be informed of result.
+ *              Reads are done with storage_call: the function runs in storage thread
+ *              after all queued writes, caller waits for its result.
+ *
+ *              Request in storage queue: | request_t | data (len bytes) |
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef STORAGE_H_
+#define STORAGE_H_
+
+#include <stdint.h>
+
+extern "C" {
+#include "thread.h"
+}
+
+namespace storage_ns {
+
+extern kernel_pid_t storage_pid;
+
+enum op_e: uint8_t {
+    WRITE = 0,  /* create (or truncate) file, write data */
+    APPEND,     /* append data to file, file is created if it doesn't exist */
+    UNLINK,     /* remove file, no error if it doesn't exist */
+    RENAME,     /* data: new name */
+    MKDIR,      /* no error if it exists */
+};
+
+enum flag_e: uint8_t {
+    AFTER_PREV_OK = 0x01, /* dropped (failed) if previous request has failed */
+};
+
+const uint8_t max_name_chars = 24;
+const uint16_t queue_size = 2048;
+
+/**
+ * @brief   Function informed of result of a request, it runs in storage thread so it
+ *          should only set a flag.
+ *
+ * @param[in]   arg, done_arg of request.
+ * @param[in]   result, 0 on success, -1 on error.
+ */
+typedef void (*done_func_t)(void *arg, int8_t result);
+
+/**
+ * @brief   Function run in storage thread by storage_call.
+ *
+ * @return  result returned to caller of storage_call.
+ */
+typedef int8_t (*call_func_t)(void *arg);
+
+typedef struct request_s {
+    uint8_t op;
+    uint8_t flags;
+    uint16_t len;   /* of data */
+    char name[max_name_chars];
+    done_func_t done_func;
+    void *done_arg;
+} request_t;
+
+}
+
+/**
+ * @brief   Create and start storage thread.
+ */
+void storage_start(void);
+
+/**
+ * @brief   Begin a request, data should be added with storage_add_data and the request
+ *          must be ended with storage_end (queue is locked until then).
+ *
+ * @param[in]   op, storage_ns::op_e.
+ * @param[in]   flags, storage_ns::flag_e.
+ * @param[in]   name, file name.
+ * @param[in]   len, total len of data will be added.
+ * @param[in]   done_func, NULL if result isn't needed.
+ * @param[in]   done_arg, argument for done_func.
+ *
+ * @return  0 on success, -1 if there is no room for the request in storage queue
+ *          (nothing needs to be ended).
+ */
+int8_t storage_begin(uint8_t op, uint8_t flags, const char *name, uint16_t len,
+        storage_ns::done_func_t done_func, void *done_arg);
+
+/**
+ * @brief   Add data to the request begun with storage_begin.
+ */
+void storage_add_data(const void *data, uint16_t len);
+
+/**
+ * @brief   End the request begun with storage_begin and wake storage thread up.
+ */
+void storage_end(void);
+
+/**
+ * @brief   Queue a request with data in one buffer (storage_begin, storage_add_data,
+ *          storage_end).
+ *
+ * @return  0 on success, -1 if there is no room for the request in storage queue.
+ */
+int8_t storage_request(uint8_t op, uint8_t flags, const char *name,
+        const void *data, uint16_t len,
+        storage_ns::done_func_t done_func, void *done_arg);
+
+/**
+ * @brief   Run a function in storage thread after all queued requests and wait for its
+ *          result. Function is run directly if caller is storage thread.
+ *
+ * @param[in]   call_func, function doing FatFs I/O.
+ * @param[in]   arg, argument for call_func.
+ *
+ * @return  result of call_func.
+ */
+int8_t storage_call(storage_ns::call_func_t call_func, void *arg);
+
+#endif // STORAGE_H_
@@ -8,11 +8,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <new>
+
 extern "C" {
 #include "msg.h"
 }
 
 #include "ha_device_handler.h"
+#include "ep_dispatcher.h"
 #include "ha_device_status.h"
 #include "ha_sixlowpan.h"
 #include "ha_gff_misc.h"
@@ -24,8 +27,6 @@ extern "C" {
 #define HA_DEBUG_EN (0)
 #include "ha_debug.h"
 
-static const uint8_t queue_handler_size = 16;
-
 /* common functions */
 /**
  * @brief Read configuration from EP-file into a string.
@@ -115,466 +116,697 @@ static bool sensor_read_equa_type_and_params(uint32_t dev_id,
         char* equa_type_buff, uint8_t e_type_buff_len, float* equa_params_buff,
         uint8_t e_params_buff_len);
 
+/* end points */
+typedef struct ep_state_s ep_state_t;
+
+/**
+ * @brief Handler of a kind of device. Device is run by events of its EP, handlers
+ * return after each event (no loop, EPs share dispatcher thread).
+ */
+typedef struct dev_handler_s {
+    bool (*start)(ep_state_t *ep); //create and configure device, send first value. false on error.
+    void (*on_event)(ep_state_t *ep, uint16_t type, uint32_t value); //SET_DEV_VAL, DEV_EVENT.
+    void (*stop)(ep_state_t *ep); //turn off and destroy device.
+} dev_handler_t;
+
+/* devices keeping values between events */
+typedef struct on_off_output_ctx_s {
+    on_off_output_instance on_off_dev;
+    uint8_t old_set_dev_val;
+} on_off_output_ctx_t;
+
+typedef struct level_bulb_ctx_s {
+    level_bulb_instance level_bulb;
+    uint8_t old_set_dev_val;
+} level_bulb_ctx_t;
+
+typedef struct rgb_led_ctx_s {
+    rgb_instance rgb_led;
+    uint8_t basic_color;
+} rgb_led_ctx_t;
+
+/* only used to get size of the largest device */
+union ep_storage_u {
+    button_switch_instance btn_sw;
+    on_off_output_ctx_t on_off_output;
+    dimmer_instance dimmer;
+    level_bulb_ctx_t level_bulb;
+    servo_sg90_instance sg90;
+    adc_sensor_instance adc_sensor;
+    sensor_event_instance sensor_event;
+    rgb_led_ctx_t rgb_led;
+};
+
+struct ep_state_s {
+    const dev_handler_t *handler; //NULL if there is no running device.
+    uint32_t dev_id;
+    uint16_t generation; //changed when a device is started, old DEV_EVENTs are dropped.
+    alignas(ep_storage_u) uint8_t storage[sizeof(ep_storage_u)]; //running device.
+};
+
+static ep_state_t ep_states[ha_host_ns::max_end_point];
+
+/**
+ * @brief Select handler from device ID, create and start device of an EP.
+ *
+ * @param[in] ep EP running device.
+ * @param[in] dev_id Device ID.
+ */
+static void start_device(ep_state_t *ep, uint32_t dev_id);
+
+/**
+ * @brief Turn off and destroy running device of an EP.
+ *
+ * @param[in] ep EP running device.
+ */
+static void stop_device(ep_state_t *ep);
+
+/**
+ * @brief Notify function of devices, post DEV_EVENT to EP of device. Called from
+ * tick worker or interrupts.
+ *
+ * @param[in] arg EP of device.
+ * @param[in] value New value of device.
+ */
+static void dev_notify_callback(void *arg, uint32_t value);
+
+/**
+ * @brief Check soft timer of a new device, devices without timer aren't run.
+ *
+ * @param[in] ep EP running device.
+ * @param[in] has_timer Result of has_timer() of device.
+ *
+ * @return has_timer.
+ */
+static bool check_dev_timer(ep_state_t *ep, bool has_timer);
+
+/* handlers of devices */
+static bool button_start(ep_state_t *ep);
+static void button_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void button_switch_stop(ep_state_t *ep);
+static bool switch_start(ep_state_t *ep);
+static void switch_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static bool on_off_output_start(ep_state_t *ep);
+static void on_off_output_on_event(ep_state_t *ep, uint16_t type,
+        uint32_t value);
+static void on_off_output_stop(ep_state_t *ep);
+static bool dimmer_start(ep_state_t *ep);
+static void dimmer_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void dimmer_stop(ep_state_t *ep);
+static bool level_bulb_start(ep_state_t *ep);
+static void level_bulb_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void level_bulb_stop(ep_state_t *ep);
+static bool servo_sg90_start(ep_state_t *ep);
+static void servo_sg90_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void servo_sg90_stop(ep_state_t *ep);
+static bool adc_sensor_start(ep_state_t *ep);
+static void adc_sensor_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void adc_sensor_stop(ep_state_t *ep);
+static bool event_sensor_start(ep_state_t *ep);
+static void event_sensor_on_event(ep_state_t *ep, uint16_t type,
+        uint32_t value);
+static void event_sensor_stop(ep_state_t *ep);
+static bool rgb_led_start(ep_state_t *ep);
+static void rgb_led_on_event(ep_state_t *ep, uint16_t type, uint32_t value);
+static void rgb_led_stop(ep_state_t *ep);
+
+static const dev_handler_t button_handler = { &button_start, &button_on_event,
+        &button_switch_stop };
+static const dev_handler_t switch_handler = { &switch_start, &switch_on_event,
+        &button_switch_stop };
+static const dev_handler_t on_off_output_handler = { &on_off_output_start,
+        &on_off_output_on_event, &on_off_output_stop };
+static const dev_handler_t dimmer_handler = { &dimmer_start, &dimmer_on_event,
+        &dimmer_stop };
+static const dev_handler_t level_bulb_handler = { &level_bulb_start,
+        &level_bulb_on_event, &level_bulb_stop };
+static const dev_handler_t servo_sg90_handler = { &servo_sg90_start,
+        &servo_sg90_on_event, &servo_sg90_stop };
+static const dev_handler_t adc_sensor_handler = { &adc_sensor_start,
+        &adc_sensor_on_event, &adc_sensor_stop };
+static const dev_handler_t event_sensor_handler = { &event_sensor_start,
+        &event_sensor_on_event, &event_sensor_stop };
+static const dev_handler_t rgb_led_handler = { &rgb_led_start,
+        &rgb_led_on_event, &rgb_led_stop };
+
 /*---------------------Implementation-----------------------*/
 
-void* end_point_handler(void* arg)
-{
-    msg_t msg_q[queue_handler_size];
-
-    /* Initialize msg queue */
-    msg_init_queue(msg_q, queue_handler_size);
-
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        if (msg.type == ha_host_ns::NEW_DEVICE) {
-            switch (get_dev_common_subtype(msg.content.value)) {
-            case ha_ns::ADC_SENSOR:
-                adc_sensor_handler(msg.content.value);
-                break;
-            case ha_ns::EVT_SENSOR:
-                event_sensor_handler(msg.content.value);
-                break;
-            case ha_ns::ON_OFF_OPUT:
-                on_off_output_handler(msg.content.value);
-                break;
-            default:
-                break;
-            }
-            switch (parse_devtype_deviceid(msg.content.value)) {
-            case ha_ns::NO_DEVICE:
-                HA_NOTIFY("-EP%d: No device!!.\n",
-                        (uint8_t )(msg.content.value >> 8));
-                break;
-            case ha_ns::SWITCH:
-                switch_handler(msg.content.value);
-                break;
-            case ha_ns::BUTTON:
-                button_handler(msg.content.value);
-                break;
-            case ha_ns::DIMMER:
-                dimmer_handler(msg.content.value);
-                break;
-            case ha_ns::LEVEL_BULB:
-                level_bulb_handler(msg.content.value);
-                break;
-            case ha_ns::RGB_LED:
-                rgb_led_handler(msg.content.value);
-                break;
-            case ha_ns::SERVO_SG90:
-                servo_sg90_handler(msg.content.value);
-                break;
-            default:
-                break;
-            }
+void end_point_event(uint8_t ep_id, uint16_t type, uint32_t value)
+{
+    if (ep_id == ep_dispatcher_ns::all_end_points) {
+        for (uint8_t count = 0; count < ha_host_ns::max_end_point; count++) {
+            end_point_event(count, type, value);
         }
+        return;
+    }
+    if (ep_id >= ha_host_ns::max_end_point) {
+        return;
     }
 
-    return NULL;
+    ep_state_t *ep = &ep_states[ep_id];
+    switch (type) {
+    case ha_host_ns::NEW_DEVICE:
+        stop_device(ep);
+        start_device(ep, value);
+        break;
+    case ha_host_ns::SEND_ALIVE:
+        if (ep->handler != NULL) {
+            forward_data_msg_to_6lowpan(ha_ns::ALIVE, ep->dev_id, 0);
+        }
+        break;
+    case ha_host_ns::DEV_EVENT:
+        /* drop values notified by a device removed before they are handled */
+        if (ep->handler != NULL && (uint16_t) (value >> 16) == ep->generation) {
+            ep->handler->on_event(ep, type, (uint16_t) value);
+        }
+        break;
+    case ha_ns::SET_DEV_VAL:
+        if (ep->handler != NULL) {
+            ep->handler->on_event(ep, type, value);
+        }
+        break;
+    default:
+        break;
+    }
 }
 
-void button_handler(uint32_t dev_id)
+static void start_device(ep_state_t *ep, uint32_t dev_id)
+{
+    const dev_handler_t *handler = NULL;
+
+    switch (get_dev_common_subtype(dev_id)) {
+    case ha_ns::ADC_SENSOR:
+        handler = &adc_sensor_handler;
+        break;
+    case ha_ns::EVT_SENSOR:
+        handler = &event_sensor_handler;
+        break;
+    case ha_ns::ON_OFF_OPUT:
+        handler = &on_off_output_handler;
+        break;
+    default:
+        break;
+    }
+    switch (parse_devtype_deviceid(dev_id)) {
+    case ha_ns::NO_DEVICE:
+        HA_NOTIFY("-EP%d: No device!!.\n", (uint8_t )(dev_id >> 8));
+        break;
+    case ha_ns::SWITCH:
+        handler = &switch_handler;
+        break;
+    case ha_ns::BUTTON:
+        handler = &button_handler;
+        break;
+    case ha_ns::DIMMER:
+        handler = &dimmer_handler;
+        break;
+    case ha_ns::LEVEL_BULB:
+        handler = &level_bulb_handler;
+        break;
+    case ha_ns::RGB_LED:
+        handler = &rgb_led_handler;
+        break;
+    case ha_ns::SERVO_SG90:
+        handler = &servo_sg90_handler;
+        break;
+    default:
+        break;
+    }
+    if (handler == NULL) {
+        return;
+    }
+
+    ep->dev_id = dev_id;
+    ep->generation = ep->generation + 1;
+    if (handler->start(ep)) {
+        ep->handler = handler;
+    }
+}
+
+static void stop_device(ep_state_t *ep)
+{
+    if (ep->handler == NULL) {
+        return;
+    }
+    ep->handler->stop(ep);
+    ep->handler = NULL;
+}
+
+static void dev_notify_callback(void *arg, uint32_t value)
+{
+    ep_state_t *ep = (ep_state_t *) arg;
+
+    ep_dispatcher_post((uint8_t) (ep - ep_states), ha_host_ns::DEV_EVENT,
+            ((uint32_t) ep->generation << 16) | (uint16_t) value);
+}
+
+static bool check_dev_timer(ep_state_t *ep, bool has_timer)
+{
+    if (!has_timer) {
+        HA_NOTIFY("-EP%d: No free soft timer for device.\n",
+                (uint8_t )(ep->dev_id >> 8));
+    }
+    return has_timer;
+}
+
+/* button */
+static bool button_start(ep_state_t *ep)
 {
     /* get button configuration */
     gpio_config_params_t gpio_params;
-    if (!gpio_common_get_config(dev_id, &gpio_params)) {
-        return;
+    if (!gpio_common_get_config(ep->dev_id, &gpio_params)) {
+        return false;
     }
 
     /* create and configure button instance */
-    button_switch_instance btn(btn_sw_ns::btn);
-    btn.device_configure(&gpio_params);
+    button_switch_instance *btn = new (ep->storage) button_switch_instance(
+            btn_sw_ns::btn);
+    if (!check_dev_timer(ep, btn->has_timer())) {
+        btn->~button_switch_instance();
+        return false;
+    }
+    btn->set_notify(&dev_notify_callback, ep);
+    btn->device_configure(&gpio_params);
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
             ha_ns::btn_no_pressed);
 
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case btn_sw_ns::BTN_SW_MSG:
-            if (msg.content.value == btn_sw_ns::btn_no_pressed) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::btn_no_pressed);
-            } else if (msg.content.value == btn_sw_ns::btn_pressed) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::btn_pressed);
-            } else if (msg.content.value == btn_sw_ns::btn_on_hold) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::btn_on_hold);
-            }
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    return true;
+}
+
+static void button_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    if (type != ha_host_ns::DEV_EVENT) {
+        return;
+    }
+    if (value == btn_sw_ns::btn_no_pressed) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::btn_no_pressed);
+    } else if (value == btn_sw_ns::btn_pressed) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::btn_pressed);
+    } else if (value == btn_sw_ns::btn_on_hold) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::btn_on_hold);
     }
 }
 
-void switch_handler(uint32_t dev_id)
+static void button_switch_stop(ep_state_t *ep)
+{
+    ((button_switch_instance *) ep->storage)->~button_switch_instance();
+}
+
+/* switch */
+static bool switch_start(ep_state_t *ep)
 {
     /* get switch configuration */
     gpio_config_params_t gpio_params;
-    if (!gpio_common_get_config(dev_id, &gpio_params)) {
-        return;
+    if (!gpio_common_get_config(ep->dev_id, &gpio_params)) {
+        return false;
     }
 
     /* create and configure switch instance */
-    button_switch_instance sw(btn_sw_ns::sw);
-    sw.device_configure(&gpio_params);
+    button_switch_instance *sw = new (ep->storage) button_switch_instance(
+            btn_sw_ns::sw);
+    if (!check_dev_timer(ep, sw->has_timer())) {
+        sw->~button_switch_instance();
+        return false;
+    }
+    sw->set_notify(&dev_notify_callback, ep);
+    sw->device_configure(&gpio_params);
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            sw.get_status() == btn_sw_ns::sw_on ?
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            sw->get_status() == btn_sw_ns::sw_on ?
                     ha_ns::switch_on : ha_ns::switch_off);
 
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case btn_sw_ns::BTN_SW_MSG:
-            if (msg.content.value == btn_sw_ns::sw_on) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::switch_on);
-            } else {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::switch_off);
-            }
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    return true;
+}
+
+static void switch_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    if (type != ha_host_ns::DEV_EVENT) {
+        return;
+    }
+    if (value == btn_sw_ns::sw_on) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::switch_on);
+    } else {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::switch_off);
     }
 }
 
-void on_off_output_handler(uint32_t dev_id)
+/* on-off output */
+static bool on_off_output_start(ep_state_t *ep)
 {
     /* get on-off bulb configuration */
     gpio_config_params_t gpio_params;
-    if (!gpio_common_get_config(dev_id, &gpio_params)) {
-        return;
+    if (!gpio_common_get_config(ep->dev_id, &gpio_params)) {
+        return false;
     }
 
     /* create and configure on-off bulb instance */
-    on_off_output_instance on_off_dev;
-    on_off_dev.device_configure(&gpio_params);
+    on_off_output_ctx_t *ctx = new (ep->storage) on_off_output_ctx_t;
+    if (!check_dev_timer(ep, ctx->on_off_dev.has_timer())) {
+        ctx->~on_off_output_ctx_t();
+        return false;
+    }
+    ctx->old_set_dev_val = 0;
+    ctx->on_off_dev.device_configure(&gpio_params);
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            (on_off_dev.dev_get_state() == on_off_dev_ns::dev_on) ?
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (ctx->on_off_dev.dev_get_state() == on_off_dev_ns::dev_on) ?
                     ha_ns::output_on : ha_ns::output_off);
 
-    uint8_t old_set_dev_val = 0;
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case ha_ns::SET_DEV_VAL:
-            if (get_dev_common_subtype(msg.content.value >> 16)
-                    == (uint8_t) ha_ns::ON_OFF_OPUT) {
-                if ((uint16_t) msg.content.value == ha_ns::output_on) {
-                    on_off_dev.dev_turn_on();
-                } else if ((uint16_t) msg.content.value == ha_ns::output_off) {
-                    on_off_dev.dev_turn_off();
-                } else if ((uint16_t) msg.content.value == ha_ns::toggle) {
-                    on_off_dev.dev_toggle();
-                } else if ((uint16_t) msg.content.value > 100) { //blink
-                    old_set_dev_val = (uint8_t) msg.content.value;
-                    on_off_dev.dev_blink(old_set_dev_val - 100);
-                }
-            }
-            /* feedback to CC */
-            if (on_off_dev.dev_get_state() == on_off_dev_ns::dev_blink) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        (uint16_t) old_set_dev_val);
-            } else {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        (on_off_dev.dev_get_state() == on_off_dev_ns::dev_on) ?
-                                ha_ns::output_on : ha_ns::output_off);
-            }
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            on_off_dev.dev_turn_off();
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
+    return true;
+}
+
+static void on_off_output_on_event(ep_state_t *ep, uint16_t type,
+        uint32_t value)
+{
+    on_off_output_ctx_t *ctx = (on_off_output_ctx_t *) ep->storage;
+
+    if (type != ha_ns::SET_DEV_VAL) {
+        return;
+    }
+    if (get_dev_common_subtype(value >> 16) == (uint8_t) ha_ns::ON_OFF_OPUT) {
+        if ((uint16_t) value == ha_ns::output_on) {
+            ctx->on_off_dev.dev_turn_on();
+        } else if ((uint16_t) value == ha_ns::output_off) {
+            ctx->on_off_dev.dev_turn_off();
+        } else if ((uint16_t) value == ha_ns::toggle) {
+            ctx->on_off_dev.dev_toggle();
+        } else if ((uint16_t) value > 100) { //blink
+            ctx->old_set_dev_val = (uint8_t) value;
+            ctx->on_off_dev.dev_blink(ctx->old_set_dev_val - 100);
         }
     }
+    /* feedback to CC */
+    if (ctx->on_off_dev.dev_get_state() == on_off_dev_ns::dev_blink) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (uint16_t) ctx->old_set_dev_val);
+    } else {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (ctx->on_off_dev.dev_get_state() == on_off_dev_ns::dev_on) ?
+                        ha_ns::output_on : ha_ns::output_off);
+    }
 }
 
-void dimmer_handler(uint32_t dev_id)
+static void on_off_output_stop(ep_state_t *ep)
+{
+    on_off_output_ctx_t *ctx = (on_off_output_ctx_t *) ep->storage;
+
+    ctx->on_off_dev.dev_turn_off();
+    ctx->~on_off_output_ctx_t();
+}
+
+/* dimmer */
+static bool dimmer_start(ep_state_t *ep)
 {
     /* get dimmer configuration */
     adc_config_params_t adc_params;
-    if (!adc_common_get_config(dev_id, &adc_params)) {
-        return;
+    if (!adc_common_get_config(ep->dev_id, &adc_params)) {
+        return false;
     }
 
-    /* create and configure dimmer instance */
-    dimmer_instance dimmer;
-    dimmer.device_configure(&adc_params);
-
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case dimmer_ns::DIMMER_MSG:
-            /* dimmer'll send first value to CC when it's started */
-            forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                    (uint16_t) msg.content.value);
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    /* create and configure dimmer instance,
+     * dimmer'll send first value to CC when it's started */
+    dimmer_instance *dimmer = new (ep->storage) dimmer_instance;
+    if (!check_dev_timer(ep, dimmer->has_timer())) {
+        dimmer->~dimmer_instance();
+        return false;
+    }
+    dimmer->set_notify(&dev_notify_callback, ep);
+    dimmer->device_configure(&adc_params);
+
+    return true;
+}
+
+static void dimmer_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    if (type == ha_host_ns::DEV_EVENT) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (uint16_t) value);
     }
 }
 
-void level_bulb_handler(uint32_t dev_id)
+static void dimmer_stop(ep_state_t *ep)
+{
+    ((dimmer_instance *) ep->storage)->~dimmer_instance();
+}
+
+/* level bulb */
+static bool level_bulb_start(ep_state_t *ep)
 {
     /* get level bulb configuration */
     pwm_config_params_t pwm_params;
-    if (!pwm_common_get_config(dev_id, &pwm_params)) {
-        return;
+    if (!pwm_common_get_config(ep->dev_id, &pwm_params)) {
+        return false;
     }
 
     /* create and configure level bulb instance */
-    level_bulb_instance level_bulb;
-    level_bulb.device_configure(&pwm_params);
+    level_bulb_ctx_t *ctx = new (ep->storage) level_bulb_ctx_t;
+    if (!check_dev_timer(ep, ctx->level_bulb.has_timer())) {
+        ctx->~level_bulb_ctx_t();
+        return false;
+    }
+    ctx->level_bulb.device_configure(&pwm_params);
 
     /* send first value to CC */
-    uint8_t old_set_dev_val = level_bulb.get_percent_intensity();
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            (uint16_t) old_set_dev_val);
-
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case ha_ns::SET_DEV_VAL:
-            if (check_dev_type_value(msg.content.value,
-                    (uint8_t) ha_ns::LEVEL_BULB)) {
-                old_set_dev_val = (uint8_t) msg.content.value;
-
-                if ((uint8_t) msg.content.value <= 100) { //set level intensity
-                    level_bulb.set_percent_intensity(old_set_dev_val);
-                } else { //blink
-                    level_bulb.blink(old_set_dev_val - 100);
-                }
-            }
-            /* feedback to CC */
-            if (level_bulb.bulb_is_blink()) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        (uint16_t) old_set_dev_val);
-            } else {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        (uint16_t) level_bulb.get_percent_intensity());
-            }
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            level_bulb.set_level_intensity(0); //turn off before removing device
-            level_bulb.stop();
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
+    ctx->old_set_dev_val = ctx->level_bulb.get_percent_intensity();
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (uint16_t) ctx->old_set_dev_val);
+
+    return true;
+}
+
+static void level_bulb_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    level_bulb_ctx_t *ctx = (level_bulb_ctx_t *) ep->storage;
+
+    if (type != ha_ns::SET_DEV_VAL) {
+        return;
+    }
+    if (check_dev_type_value(value, (uint8_t) ha_ns::LEVEL_BULB)) {
+        ctx->old_set_dev_val = (uint8_t) value;
+
+        if ((uint8_t) value <= 100) { //set level intensity
+            ctx->level_bulb.set_percent_intensity(ctx->old_set_dev_val);
+        } else { //blink
+            ctx->level_bulb.blink(ctx->old_set_dev_val - 100);
         }
     }
+    /* feedback to CC */
+    if (ctx->level_bulb.bulb_is_blink()) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (uint16_t) ctx->old_set_dev_val);
+    } else {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (uint16_t) ctx->level_bulb.get_percent_intensity());
+    }
+}
+
+static void level_bulb_stop(ep_state_t *ep)
+{
+    level_bulb_ctx_t *ctx = (level_bulb_ctx_t *) ep->storage;
+
+    ctx->level_bulb.set_level_intensity(0); //turn off before removing device
+    ctx->level_bulb.stop();
+    ctx->~level_bulb_ctx_t();
 }
 
-void servo_sg90_handler(uint32_t dev_id)
+/* servo SG90 */
+static bool servo_sg90_start(ep_state_t *ep)
 {
     /* get servo sg90 configuration */
     pwm_config_params_t pwm_params;
-    if (!pwm_common_get_config(dev_id, &pwm_params)) {
-        return;
+    if (!pwm_common_get_config(ep->dev_id, &pwm_params)) {
+        return false;
     }
 
     /* create and configure servo sg90 instance */
-    servo_sg90_instance sg90;
-    sg90.device_configure(&pwm_params);
+    servo_sg90_instance *sg90 = new (ep->storage) servo_sg90_instance;
+    sg90->device_configure(&pwm_params);
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            (uint16_t) sg90.get_angle());
-
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case ha_ns::SET_DEV_VAL:
-            if (check_dev_type_value(msg.content.value,
-                    (uint8_t) ha_ns::SERVO_SG90)) {
-                sg90.set_angle((uint8_t) (msg.content.value));
-            }
-            /* feedback to CC */
-            forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                    (uint16_t) sg90.get_angle());
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            sg90.stop();
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (uint16_t) sg90->get_angle());
+
+    return true;
+}
+
+static void servo_sg90_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    servo_sg90_instance *sg90 = (servo_sg90_instance *) ep->storage;
+
+    if (type != ha_ns::SET_DEV_VAL) {
+        return;
+    }
+    if (check_dev_type_value(value, (uint8_t) ha_ns::SERVO_SG90)) {
+        sg90->set_angle((uint8_t) value);
     }
+    /* feedback to CC */
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (uint16_t) sg90->get_angle());
+}
+
+static void servo_sg90_stop(ep_state_t *ep)
+{
+    servo_sg90_instance *sg90 = (servo_sg90_instance *) ep->storage;
+
+    sg90->stop();
+    sg90->~servo_sg90_instance();
 }
 
-void adc_sensor_handler(uint32_t dev_id)
+/* ADC sensor */
+static bool adc_sensor_start(ep_state_t *ep)
 {
     /* create and configure linear sensor instance */
-    adc_sensor_instance adc_sensor;
+    adc_sensor_instance *adc_sensor = new (ep->storage) adc_sensor_instance;
     uint16_t num_equation = 0;
     uint16_t num_params = 0;
-    if (!sensor_read_config(dev_id, &adc_sensor, &num_equation, &num_params)) {
-        return;
+    if (!check_dev_timer(ep, adc_sensor->has_timer())) {
+        adc_sensor->~adc_sensor_instance();
+        return false;
+    }
+    if (!adc_sensor->has_calibration()) {
+        HA_NOTIFY("-EP%d: No free calibration table for sensor.\n",
+                (uint8_t )(ep->dev_id >> 8));
+        adc_sensor->~adc_sensor_instance();
+        return false;
+    }
+    if (!sensor_read_config(ep->dev_id, adc_sensor, &num_equation,
+            &num_params)) {
+        adc_sensor->~adc_sensor_instance();
+        return false;
     }
 
+    /* equations are compiled into calibration table when sensor is started,
+     * buffers aren't used after that */
     char e_type[num_equation];
     float params[num_params];
-    sensor_read_equa_type_and_params(dev_id, e_type, num_equation, params,
+    sensor_read_equa_type_and_params(ep->dev_id, e_type, num_equation, params,
             num_params);
 
-    adc_sensor.set_equation_type(e_type, num_equation);
-    adc_sensor.set_equation_params(params, num_params);
+    adc_sensor->set_equation_type(e_type, num_equation);
+    adc_sensor->set_equation_params(params, num_params);
 
-    adc_sensor.start_sensor();
+    adc_sensor->set_notify(&dev_notify_callback, ep);
+    adc_sensor->start_sensor();
 
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case adc_sensor_ns::ADC_SENSOR_MSG:
-            printf("ss: %d\n", (uint16_t) msg.content.value);
-            forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                    (uint16_t) msg.content.value);
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    return true;
+}
+
+static void adc_sensor_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    if (type == ha_host_ns::DEV_EVENT) {
+        printf("ss: %d\n", (uint16_t) value);
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                (uint16_t) value);
     }
 }
 
-void event_sensor_handler(uint32_t dev_id)
+static void adc_sensor_stop(ep_state_t *ep)
+{
+    ((adc_sensor_instance *) ep->storage)->~adc_sensor_instance();
+}
+
+/* event sensor */
+static bool event_sensor_start(ep_state_t *ep)
 {
     /* get event sensor configuration */
     gpio_config_params_t gpio_params;
-    if (!gpio_common_get_config(dev_id, &gpio_params)) {
-        return;
+    if (!gpio_common_get_config(ep->dev_id, &gpio_params)) {
+        return false;
     }
 
-    /* create and configure on-off bulb instance */
-    sensor_event_instance sensor_event;
-    sensor_event.device_configure(&gpio_params);
+    /* create and configure event sensor instance */
+    sensor_event_instance *sensor_event = new (ep->storage)
+            sensor_event_instance;
+    sensor_event->set_notify(&dev_notify_callback, ep);
+    sensor_event->device_configure(&gpio_params);
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            sensor_event.is_detected() ? ha_ns::detected : ha_ns::no_detected);
-
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case sensor_event_ns::SEN_EVT_MSG:
-            if (msg.content.value == sensor_event_ns::high_level) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::detected);
-            } else if (msg.content.value == sensor_event_ns::low_level) {
-                forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                        ha_ns::no_detected);
-            }
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
-        }
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            sensor_event->is_detected() ? ha_ns::detected : ha_ns::no_detected);
+
+    return true;
+}
+
+static void event_sensor_on_event(ep_state_t *ep, uint16_t type,
+        uint32_t value)
+{
+    if (type != ha_host_ns::DEV_EVENT) {
+        return;
     }
+    if (value == sensor_event_ns::high_level) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::detected);
+    } else if (value == sensor_event_ns::low_level) {
+        forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+                ha_ns::no_detected);
+    }
+}
+
+static void event_sensor_stop(ep_state_t *ep)
+{
+    ((sensor_event_instance *) ep->storage)->~sensor_event_instance();
 }
 
-void rgb_led_handler(uint32_t dev_id)
+/* RGB-led */
+static bool rgb_led_start(ep_state_t *ep)
 {
     /* create and configure rgb-led instance */
-    rgb_instance rgb_led;
-    if (!rgb_get_config(dev_id, &rgb_led)) {
-        return;
+    rgb_led_ctx_t *ctx = new (ep->storage) rgb_led_ctx_t;
+    if (!check_dev_timer(ep, ctx->rgb_led.has_timer())) {
+        ctx->~rgb_led_ctx_t();
+        return false;
+    }
+    if (!rgb_get_config(ep->dev_id, &ctx->rgb_led)) {
+        ctx->~rgb_led_ctx_t();
+        return false;
     }
 
-    rgb_led.set_color_model(rgb_ns::model_16bits_555);
+    ctx->rgb_led.set_color_model(rgb_ns::model_16bits_555);
+    ctx->basic_color = (uint8_t) rgb_ns::white;
 
     /* send first value to CC */
-    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-            (uint16_t) rgb_led.get_current_color());
-
-    uint8_t basic_color = (uint8_t) rgb_ns::white;
-    msg_t msg;
-    while (1) {
-        msg_receive(&msg);
-        switch (msg.type) {
-        case ha_ns::SET_DEV_VAL:
-            if (check_dev_type_value(msg.content.value,
-                    (uint8_t) ha_ns::RGB_LED)) {
-                if (((uint16_t) msg.content.value) >> 15 == 0) {
-                    rgb_led.rgb_set_color((uint16_t) msg.content.value);
-                } else {
-                    basic_color = (basic_color + 1) % rgb_ns::max_basic_color;
-                    rgb_led.rgb_set_color((rgb_ns::basic_color_t) basic_color);
-                }
-            }
-            /* feedback to CC */
-            forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, dev_id,
-                    (uint16_t) rgb_led.get_current_color());
-            break;
-        case ha_host_ns::SEND_ALIVE:
-            forward_data_msg_to_6lowpan(ha_ns::ALIVE, dev_id, 0);
-            break;
-        case ha_host_ns::NEW_DEVICE:
-            rgb_led.rgb_set_color(0x0000);
-            rgb_led.stop();
-            msg_send_to_self(&msg);
-            return;
-        default:
-            break;
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (uint16_t) ctx->rgb_led.get_current_color());
+
+    return true;
+}
+
+static void rgb_led_on_event(ep_state_t *ep, uint16_t type, uint32_t value)
+{
+    rgb_led_ctx_t *ctx = (rgb_led_ctx_t *) ep->storage;
+
+    if (type != ha_ns::SET_DEV_VAL) {
+        return;
+    }
+    if (check_dev_type_value(value, (uint8_t) ha_ns::RGB_LED)) {
+        if (((uint16_t) value) >> 15 == 0) {
+            ctx->rgb_led.rgb_set_color((uint16_t) value);
+        } else {
+            ctx->basic_color = (ctx->basic_color + 1) % rgb_ns::max_basic_color;
+            ctx->rgb_led.rgb_set_color((rgb_ns::basic_color_t) ctx->basic_color);
         }
     }
+    /* feedback to CC */
+    forward_data_msg_to_6lowpan(ha_ns::SET_DEV_VAL, ep->dev_id,
+            (uint16_t) ctx->rgb_led.get_current_color());
+}
+
+static void rgb_led_stop(ep_state_t *ep)
+{
+    rgb_led_ctx_t *ctx = (rgb_led_ctx_t *) ep->storage;
+
+    ctx->rgb_led.rgb_set_color(0x0000);
+    ctx->rgb_led.stop();
+    ctx->~rgb_led_ctx_t();
 }
 
 int get_file_name_from_dev_id(uint32_t dev_id, char* file_name)
@@ -26,6 +26,10 @@ const char ha_dev_list_file_name[] = "dev_list";
 
 const char dev_list_pattern[] = "dID: 0x%lx\n";
 
+const char ha_group_list_file_name[] = "grp_list";
+
+const char group_list_pattern[] = "G: 0x%lx\n"; //bit (group id - 1) is set if EP is a member
+
 const char gpio_dev_config_pattern[] = "P%c%hu M:%c\n";
 
 const char adc_dev_config_pattern[] = "P%c%hu A%hu_IN%hu\n";
@@ -47,74 +51,16 @@ const char sensor_equa_params[] = "%g\n";
 }
 
 /**
- * @brief It's a callback function of EndPoint threads.
- *
- * @param[in] arg The pointer to argument passed into callback function.
- */
-void* end_point_handler(void* arg);
-
-/**
- * @brief The function manages button device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void button_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages switch device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void switch_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages On/Off Output device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void on_off_output_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages level bulb device. It's called by end_point_handler.
+ * @brief Handler of EP events, called by EP dispatcher thread (see ep_dispatcher.h).
+ * NEW_DEVICE starts the device of EP (value is device ID) after stopping the old one,
+ * SEND_ALIVE, SET_DEV_VAL and DEV_EVENT (value notified by device) are passed to
+ * running device.
  *
- * @param[in] dev_id Device ID.
- */
-void level_bulb_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages RGB-led device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void rgb_led_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages dimmer device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void dimmer_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages servo SG90 device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void servo_sg90_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages ADC sensor device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
- */
-void adc_sensor_handler(uint32_t dev_id);
-
-/**
- * @brief The function manages event sensor device. It's called by end_point_handler.
- *
- * @param[in] dev_id Device ID.
+ * @param[in] ep_id EP ID, ep_dispatcher_ns::all_end_points for every EP.
+ * @param[in] type Event type.
+ * @param[in] value Event value.
  */
-void event_sensor_handler(uint32_t dev_id);
+void end_point_event(uint8_t ep_id, uint16_t type, uint32_t value);
 
 /**
  * @brief Parse device ID to get EP ID. The EP ID is name of configuration file.
@@ -5,17 +5,18 @@
  * @date 11-Nov-2014
  * @brief This is source file for HA host initialization in HA system.
  *
- * (Pid table)
- * Initialize endpoint pid table.
+ * (EP tables)
+ * Initialize device id and group tables of endpoints.
+ *
+ * (EP dispatcher)
+ * Start dispatcher thread running all endpoints.
  *
  * (Timer6)
- * Assign callbacks into interrupt of tim6.
+ * Assign tick worker (bottom half of devices' callbacks) into interrupt of tim6.
  */
-extern "C" {
-#include "msg.h"
-#include "thread.h"
-}
 #include "ha_host.h"
+#include "tick_worker.h"
+#include "ep_dispatcher.h"
 #include "MB1_System.h"
 
 const ISRMgr_ns::ISR_t tim_isr_type = ISRMgr_ns::ISRMgr_TIM6;
@@ -24,12 +25,13 @@ const uint8_t rtc_period = 1; //sec
 const uint32_t send_alive_time_period = 60 / rtc_period; //send alive every 60s.
 
 uint32_t time_cycle_count = 0;
-kernel_pid_t ha_host_ns::end_point_pid[max_end_point];
+uint32_t ha_host_ns::end_point_dev_id[max_end_point];
+uint32_t ha_host_ns::end_point_groups[max_end_point];
 
 /**
- * @brief Initialize pid_table.
+ * @brief Initialize device id and group tables of endpoints.
  */
-static void endpoint_pid_table_init(void);
+static void endpoint_table_init(void);
 
 /**
  * @brief The callback function for sending alive.
@@ -38,31 +40,25 @@ static void send_alive_callback(void);
 
 void ha_host_init(void)
 {
-    endpoint_pid_table_init();
+    endpoint_table_init();
+
+    /* All EPs are run by dispatcher, events are posted by shell, 6lowpan, devices, RTC */
+    ep_dispatcher_start(&end_point_event);
 
     /* Assign send-alive callback function into interrupt timer */
     MB1_ISRs.subISR_assign(rtc_isr_type, &send_alive_callback);
 
-    /* Assign button & switch callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &btn_sw_callback_timer_isr);
-
-    /* Assign dimmer callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &dimmer_callback_timer_isr);
-
-    /* Assign ADC linear-sensor callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &adc_sensor_callback_timer_isr);
-
-    /* Assign On/Off bulb blink callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &on_off_blink_callback_timer_isr);
-
-    /* Assign level bulb blink callback function into interrupt timer */
-    MB1_ISRs.subISR_assign(tim_isr_type, &bulb_blink_callback_timer_isr);
+    /* Devices are processed in tick worker thread, TIM6 interrupt only queues ticks
+     * (ADC scan engine, soft timers of button & switch, dimmer, ADC sensor, blink) */
+    tick_worker_start();
+    MB1_ISRs.subISR_assign(tim_isr_type, &tick_worker_timer_isr);
 }
 
-static void endpoint_pid_table_init(void)
+static void endpoint_table_init(void)
 {
     for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        ha_host_ns::end_point_pid[i] = KERNEL_PID_UNDEF;
+        ha_host_ns::end_point_dev_id[i] = 0;
+        ha_host_ns::end_point_groups[i] = 0;
     }
 }
 
@@ -71,12 +67,6 @@ static void send_alive_callback(void)
     time_cycle_count = time_cycle_count + 1;
     if (time_cycle_count == send_alive_time_period) {
         time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (ha_host_ns::end_point_pid[i] != KERNEL_PID_UNDEF) {
-                msg_t msg;
-                msg.type = ha_host_ns::SEND_ALIVE;
-                msg_send(&msg, ha_host_ns::end_point_pid[i], false);
-            }
-        }
+        ep_dispatcher_post(ep_dispatcher_ns::all_end_points, ha_host_ns::SEND_ALIVE, 0);
     }
 }
@@ -8,13 +8,17 @@
 #ifndef __HA_HOST_GLB_H
 #define __HA_HOST_GLB_H
 
-extern "C" {
-#include "thread.h"
-}
+#include <stdint.h>
+#include "device_id.h"
 
 namespace ha_host_ns {
-const uint8_t max_end_point = 8;
-extern kernel_pid_t end_point_pid[max_end_point];
+const uint8_t max_end_point = ha_ns::max_end_points; //all EPs are run by one dispatcher thread (ep_dispatcher.h).
+
+/* device id running on each EP (0 if there is no device), used to expand group commands */
+extern uint32_t end_point_dev_id[max_end_point];
+
+/* explicit groups of each EP, bit (group id - 1) is set if EP is a member of the group */
+extern uint32_t end_point_groups[max_end_point];
 }
 
 #endif //__HA_HOST_GLB_H
@@ -16,7 +16,9 @@ namespace ha_host_ns {
 enum mesg_type_e
     : uint16_t { /* in GFF format */
         NEW_DEVICE = 0x0300,
-    SEND_ALIVE = 0x0201
+    SEND_ALIVE = 0x0201,
+    TICK_DUE = 0x0202, /* internal, TIM6 tick(s) queued for tick worker */
+    DEV_EVENT = 0x0203 /* internal, new value notified by device of EP */
 };
 
 }
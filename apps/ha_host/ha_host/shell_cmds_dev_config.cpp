@@ -16,6 +16,7 @@
 #include "ha_gff_misc.h"
 #include "ff.h"
 #include "device_id.h"
+#include "ep_dispatcher.h"
 
 const char gpio_usage[] = "Usage:\n"
         "%s -e [EP id] -e [EP id], set end point id.\n"
@@ -69,6 +70,14 @@ const char adc_sensor_usage[] = "Usage:\n"
         "senadc -h, get this help.\n"
         "Note: multiple options can be combined together.\n";
 
+const char group_usage[] = "Usage:\n"
+        "group -e [EP id] -a [group id], add end point to group.\n"
+        "group -e [EP id] -r [group id], remove end point from group.\n"
+        "group -e [EP id] -c, remove end point from all groups.\n"
+        "group -l, list groups of all end points.\n"
+        "group -h, get this help.\n"
+        "Note: group id is from 1 to 32.\n";
+
 /**
  * @brief configure pure GPIO devices (port/pin).
  *
@@ -121,6 +130,24 @@ static bool check_devid(uint32_t dev_id);
  */
 static void modify_dev_list_file(uint8_t ep_id, uint8_t dev_type);
 
+/**
+ * @brief Read group bitmasks of all EPs from grp_list file.
+ *
+ * @param[out] groups Group bitmasks, max_end_point elements.
+ *
+ * @return false if file can't be opened, otherwise true.
+ */
+static bool read_group_list_file(uint32_t *groups);
+
+/**
+ * @brief Write group bitmasks of all EPs to grp_list file.
+ *
+ * @param[in] groups Group bitmasks, max_end_point elements.
+ *
+ * @return false if file can't be written, otherwise true.
+ */
+static bool write_group_list_file(uint32_t *groups);
+
 /* ------Implementation------ */
 
 void stop_endpoint_callback(int argc, char** argv)
@@ -1358,6 +1385,148 @@ static void modify_dev_list_file(uint8_t ep_id, uint8_t dev_type)
     return;
 }
 
+static bool read_group_list_file(uint32_t *groups)
+{
+    FIL fil;
+    FRESULT f_res;
+    char line[24];
+
+    memset(groups, 0, ha_host_ns::max_end_point * sizeof(uint32_t));
+
+    f_res = f_open(&fil, ha_host_ns::ha_group_list_file_name,
+    FA_READ | FA_OPEN_ALWAYS);
+    if (f_res != FR_OK) {
+        print_ferr(f_res);
+        return false;
+    }
+
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        if (f_gets(line, sizeof(line), &fil)) {
+            sscanf(line, ha_host_ns::group_list_pattern, &groups[i]);
+        } else {
+            break;
+        }
+    }
+    f_close(&fil);
+
+    return true;
+}
+
+static bool write_group_list_file(uint32_t *groups)
+{
+    FIL fil;
+    FRESULT f_res;
+    char line[24];
+
+    f_res = f_open(&fil, ha_host_ns::ha_group_list_file_name,
+    FA_WRITE | FA_CREATE_ALWAYS);
+    if (f_res != FR_OK) {
+        print_ferr(f_res);
+        return false;
+    }
+
+    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+        snprintf(line, sizeof(line), ha_host_ns::group_list_pattern, groups[i]);
+        f_puts(line, &fil);
+    }
+    f_close(&fil);
+
+    return true;
+}
+
+void group_config(int argc, char** argv)
+{
+    uint32_t groups[ha_host_ns::max_end_point];
+    int8_t ep_id = -1;
+    int group_id;
+    bool changed = false;
+
+    if (argc <= 1) {
+        printf("ERR: too few argument. Try -h to get help.\n");
+        return;
+    }
+
+    if (!read_group_list_file(groups)) {
+        return;
+    }
+
+    for (uint8_t count = 1; count < argc; count++) {
+        if (argv[count][0] != '-') {
+            continue;
+        }
+        switch (argv[count][1]) {
+        case 'h': //get help
+            printf(group_usage);
+            return;
+        case 'l': //list groups
+            for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+                printf("-EP%d: dev 0x%lx, groups:", i, ha_host_ns::end_point_dev_id[i]);
+                for (uint8_t bit = 0; bit < ha_ns::group_max_id; bit++) {
+                    if (groups[i] & ((uint32_t)1 << bit)) {
+                        printf(" %d", bit + 1);
+                    }
+                }
+                printf("\n");
+            }
+            break;
+        case 'e': //set endpoint id
+            count++;
+            if (count >= argc) {
+                printf("ERR: too few argument. Try -h to get help.\n");
+                return;
+            }
+            ep_id = atoi(argv[count]);
+            if (ep_id < 0 || ep_id >= ha_host_ns::max_end_point) {
+                printf("ERR: invalid endpoint id value\n");
+                return;
+            }
+            break;
+        case 'a': //add to group
+        case 'r': //remove from group
+            if (ep_id < 0) {
+                printf("ERR: endpoint id must be set first (-e).\n");
+                return;
+            }
+            count++;
+            if (count >= argc) {
+                printf("ERR: too few argument. Try -h to get help.\n");
+                return;
+            }
+            group_id = atoi(argv[count]);
+            if (group_id <= ha_ns::group_no_group || group_id > ha_ns::group_max_id) {
+                printf("ERR: invalid group id value\n");
+                return;
+            }
+            if (argv[count - 1][1] == 'a') {
+                groups[ep_id] |= ((uint32_t)1 << (group_id - 1));
+            }
+            else {
+                groups[ep_id] &= ~((uint32_t)1 << (group_id - 1));
+            }
+            changed = true;
+            break;
+        case 'c': //clear groups
+            if (ep_id < 0) {
+                printf("ERR: endpoint id must be set first (-e).\n");
+                return;
+            }
+            groups[ep_id] = 0;
+            changed = true;
+            break;
+        default:
+            printf("ERR: unknown option %s. Try -h to get help.\n", argv[count]);
+            return;
+        }
+    }
+
+    if (changed && write_group_list_file(groups)) {
+        /* new groups take effect immediately */
+        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
+            ha_host_ns::end_point_groups[i] = groups[i];
+        }
+    }
+}
+
 static bool check_devid(uint32_t dev_id)
 {
     uint16_t node_id = dev_id >> 16;
@@ -1380,7 +1549,7 @@ void run_endpoint(int8_t ep_id)
 
     memset(dev_list, 0, sizeof(dev_list));
 
-    if (ep_id < 0 || ep_id > ha_host_ns::max_end_point) {
+    if (ep_id < 0 || ep_id >= ha_host_ns::max_end_point) {
         printf("ERR: invalid input endpoint id.\n");
         return;
     }
@@ -1402,12 +1571,23 @@ void run_endpoint(int8_t ep_id)
     f_close(&fil);
 
     if (!check_devid(dev_list[ep_id])) {
+        ha_host_ns::end_point_dev_id[ep_id] = 0;
         printf("-EP%d: No device!!\n", ep_id);
         return;
     }
 
-    msg_t msg;
-    msg.type = ha_host_ns::NEW_DEVICE;
-    msg.content.value = dev_list[ep_id];
-    msg_send(&msg, ha_host_ns::end_point_pid[ep_id], false);
+    /* device id and groups used to expand group commands */
+    if (parse_devtype_deviceid(dev_list[ep_id]) == ha_ns::NO_DEVICE) {
+        ha_host_ns::end_point_dev_id[ep_id] = 0;
+    }
+    else {
+        ha_host_ns::end_point_dev_id[ep_id] = dev_list[ep_id];
+    }
+
+    uint32_t groups[ha_host_ns::max_end_point];
+    if (read_group_list_file(groups)) {
+        ha_host_ns::end_point_groups[ep_id] = groups[ep_id];
+    }
+
+    ep_dispatcher_post(ep_id, ha_host_ns::NEW_DEVICE, dev_list[ep_id]);
 }
@@ -98,6 +98,14 @@ void rgb_led_config(int argc, char** argv);
  */
 void adc_sensor_config(int argc, char** argv);
 
+/**
+ * @brief Configure groups (see device_id.h) of the specified EndPoint.
+ *
+ * @param[in] argc Number of arguments.
+ * @param[in] argv Arguments.
+ */
+void group_config(int argc, char** argv);
+
 /**
  * @brief get dev_id in dev_list file and send to end point having id = ep_id.
  *
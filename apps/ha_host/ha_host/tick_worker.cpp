@@ -0,0 +1,122 @@
+/**
+ * @file tick_worker.cpp
+ * @author  Nguyen Van Hien  <nvhien1992@gmail.com>.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Bottom half of TIM6 (1ms) interrupt for devices.
+ */
+extern "C" {
+#include "msg.h"
+}
+#include "tick_worker.h"
+#include "ha_host_msg_id.h"
+#include "ha_device_handler.h"
+#include "cir_queue.h"
+#include "soft_timer.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+kernel_pid_t ha_host_ns::tick_worker_pid = KERNEL_PID_UNDEF;
+
+static const char tick_worker_prio = PRIORITY_MAIN - 3; //higher than EPs and 6LoWPAN.
+static const uint16_t tick_worker_stacksize = 800;
+static char tick_worker_stack[tick_worker_stacksize];
+
+static const char tick_worker_msgqueue_size = 4;
+static msg_t tick_worker_msgqueue[tick_worker_msgqueue_size];
+
+/* ring of tick counts, one uint32_t for each tick */
+static const uint8_t tick_size = sizeof(uint32_t);
+static const uint16_t tick_ring_size = 16 * tick_size;
+static uint8_t tick_ring_buffer[tick_ring_size];
+static cir_queue tick_ring(tick_ring_buffer, tick_ring_size);
+
+static const uint16_t max_catch_up_ticks = 100;
+
+static volatile uint32_t tick_count = 0;
+static volatile uint32_t overrun_count = 0;
+
+static void *tick_worker_func(void *arg);
+static void run_device_ticks(void);
+
+void tick_worker_start(void)
+{
+    ha_host_ns::tick_worker_pid = thread_create(tick_worker_stack,
+            tick_worker_stacksize, tick_worker_prio, CREATE_STACKTEST,
+            tick_worker_func, NULL, "tick_worker");
+    if (ha_host_ns::tick_worker_pid > 0) {
+        HA_NOTIFY("Tick worker thread created.\n");
+    } else {
+        HA_NOTIFY("Can't create tick worker thread.\n");
+    }
+}
+
+void tick_worker_timer_isr(void)
+{
+    uint32_t tick = tick_count + 1;
+    msg_t msg;
+
+    tick_count = tick;
+    if (ha_host_ns::tick_worker_pid == KERNEL_PID_UNDEF) {
+        return;
+    }
+
+    if (tick_ring.get_free() >= tick_size) {
+        tick_ring.add_data((uint8_t*) &tick, tick_size);
+    } else {
+        overrun_count = overrun_count + 1;
+    }
+
+    /* wake worker up, message is dropped if its queue is full (worker is already woken) */
+    msg.type = ha_host_ns::TICK_DUE;
+    msg_send(&msg, ha_host_ns::tick_worker_pid, false);
+}
+
+uint32_t tick_worker_get_overruns(void)
+{
+    return overrun_count;
+}
+
+static void *tick_worker_func(void *arg)
+{
+    msg_t msg;
+    uint32_t tick, last_tick = 0;
+    uint32_t due_ticks;
+
+    msg_init_queue(tick_worker_msgqueue, tick_worker_msgqueue_size);
+
+    while (1) {
+        msg_receive(&msg);
+        if (msg.type != ha_host_ns::TICK_DUE) {
+            continue;
+        }
+
+        while (tick_ring.get_size() >= tick_size) {
+            tick_ring.get_data((uint8_t*) &tick, tick_size);
+
+            /* ticks dropped when ring was full are run with the next queued tick */
+            due_ticks = (last_tick == 0) ? 1 : tick - last_tick;
+            last_tick = tick;
+            if (due_ticks > max_catch_up_ticks) {
+                HA_DEBUG("tick_worker: %lu ticks late, skipped\n", due_ticks);
+                due_ticks = max_catch_up_ticks;
+            }
+
+            while (due_ticks > 0) {
+                run_device_ticks();
+                due_ticks--;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void run_device_ticks(void)
+{
+    /* ADC filter before its users */
+    adc_scan_callback_timer_isr();
+    soft_timer_tick();
+}
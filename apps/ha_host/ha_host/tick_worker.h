@@ -0,0 +1,39 @@
+/**
+ * @file tick_worker.h
+ * @author  Nguyen Van Hien  <nvhien1992@gmail.com>.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Bottom half of TIM6 (1ms) interrupt for devices.
+ * The interrupt only puts the tick count into a lock-free ring and wakes the worker
+ * thread. Processing of devices (ADC filter, soft timers of buttons/switches, dimmers,
+ * ADC sensors, blinking outputs) runs in the worker, once for each tick. Worker has
+ * higher priority than EP dispatcher, so devices still see their callbacks as atomic. Ticks lost when
+ * ring is full are counted and caught up from the tick counts.
+ */
+#ifndef __HA_TICK_WORKER_H
+#define __HA_TICK_WORKER_H
+
+extern "C" {
+#include "thread.h"
+}
+
+namespace ha_host_ns {
+extern kernel_pid_t tick_worker_pid;
+}
+
+/**
+ * @brief Create and start tick worker thread.
+ */
+void tick_worker_start(void);
+
+/**
+ * @brief Queue a tick for the worker, called by interrupt timer (1ms).
+ */
+void tick_worker_timer_isr(void);
+
+/**
+ * @brief Get number of ticks that couldn't be queued because ring was full.
+ */
+uint32_t tick_worker_get_overruns(void);
+
+#endif //__HA_TICK_WORKER_H
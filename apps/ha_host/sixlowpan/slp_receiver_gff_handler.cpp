@@ -6,20 +6,18 @@
  * @brief This is source file for 6lowpan slp_received_GFF_handler function.
  */
 
-extern "C" {
-#include "thread.h"
-#include "msg.h"
-}
-
 #include "ha_sixlowpan.h"
 #include "gff_mesg_id.h"
 #include "ha_gff_misc.h"
 #include "ha_host_glb.h"
+#include "ep_dispatcher.h"
 
 #define HA_NOTIFICATION (1)
 #define HA_DEBUG_EN (0)
 #include "ha_debug.h"
 
+static void forward_to_end_point(uint32_t dev_id, uint16_t value);
+
 void slp_received_GFF_handler(uint8_t *GFF_buffer)
 {
     HA_DEBUG("slp_received_GFF_handler:\n");
@@ -28,28 +26,66 @@ void slp_received_GFF_handler(uint8_t *GFF_buffer)
         return;
     }
 
-    /* |1byte length|2byte cmd|4byte dev_id|2byte value| */
     uint16_t gff_msg_cmd = buf2uint16((GFF_buffer + ha_ns::GFF_CMD_POS));
-    uint32_t dev_id = buf2uint32((GFF_buffer + ha_ns::GFF_DATA_POS));
-    uint16_t value = buf2uint16((GFF_buffer + ha_ns::GFF_DATA_POS + 4));
 
-    if (gff_msg_cmd != ha_ns::SET_DEV_VAL) {
-        HA_NOTIFY("SET_DEV_VAL message only.\n");
+    switch (gff_msg_cmd) {
+    case ha_ns::SET_DEV_VAL:
+        /* |1byte length|2byte cmd|4byte dev_id|2byte value| */
+        forward_to_end_point(buf2uint32((GFF_buffer + ha_ns::GFF_DATA_POS)),
+                buf2uint16((GFF_buffer + ha_ns::GFF_DATA_POS + 4)));
+        break;
+    case ha_ns::SET_DEV_MULT_VALS: {
+        /* |1byte length|2byte cmd|1byte num of records|(4byte dev_id|2byte value) ...| */
+        uint8_t num_records = GFF_buffer[ha_ns::GFF_DATA_POS];
+        if (ha_ns::SET_DEV_MULT_VALS_HEADER_LEN
+                + num_records * ha_ns::SET_DEV_MULT_VALS_RECORD_LEN
+                > GFF_buffer[ha_ns::GFF_LEN_POS]) {
+            HA_NOTIFY("SET_DEV_MULT_VALS message is truncated.\n");
+            return;
+        }
+
+        uint8_t *record = GFF_buffer + ha_ns::GFF_DATA_POS + ha_ns::SET_DEV_MULT_VALS_HEADER_LEN;
+        for (uint8_t count = 0; count < num_records; count++) {
+            forward_to_end_point(buf2uint32(record), buf2uint16(record + 4));
+            record += ha_ns::SET_DEV_MULT_VALS_RECORD_LEN;
+        }
+        break;
+    }
+    default:
+        HA_NOTIFY("SET_DEV_VAL and SET_DEV_MULT_VALS messages only.\n");
+        break;
+    }
+
+    return;
+}
+
+/**
+ * @brief Post SET_DEV_VAL event to end point of a device. Command to a group
+ *        address (see device_id.h) is sent to every running end point in the group.
+ *
+ * @param[in] dev_id Device ID or group address.
+ * @param[in] value Device value.
+ */
+static void forward_to_end_point(uint32_t dev_id, uint16_t value)
+{
+    if (is_group_deviceid(dev_id)) {
+        for (uint8_t ep_id = 0; ep_id < ha_host_ns::max_end_point; ep_id++) {
+            uint32_t ep_dev_id = ha_host_ns::end_point_dev_id[ep_id];
+            if (ep_dev_id == 0
+                    || !match_group_deviceid(dev_id, ep_dev_id, ha_host_ns::end_point_groups[ep_id])) {
+                continue;
+            }
+            ep_dispatcher_post(ep_id, ha_ns::SET_DEV_VAL, (ep_dev_id << 16) | value);
+        }
         return;
     }
 
     uint8_t ep_id = parse_ep_deviceid(dev_id);
-    if (ep_id > ha_host_ns::max_end_point) {
+    if (ep_id >= ha_host_ns::max_end_point) {
         HA_NOTIFY("End point id is invalid.\n");
         return;
     }
     uint32_t data_send = (dev_id << 16) | value;
 
-    msg_t msg_to_endpoint;
-    msg_to_endpoint.type = gff_msg_cmd;
-    msg_to_endpoint.content.value = data_send;
-
-    msg_send(&msg_to_endpoint, ha_host_ns::end_point_pid[ep_id], false);
-
-    return;
+    ep_dispatcher_post(ep_id, ha_ns::SET_DEV_VAL, data_send);
 }
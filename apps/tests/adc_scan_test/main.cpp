@@ -0,0 +1,105 @@
+/**
+ * @file main.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @brief Test of ADC scan engine (adc_scan.h) with the fake sample source of native board.
+ * Channels shared by devices, filtered values, sequence changes and its limits are checked,
+ * then cost of one filter tick of a full sequence is measured (it doesn't depend on number
+ * of devices, ADC isn't configured again for each sample).
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "adc_scan.h"
+#include "adc_scan_hw.h"
+
+using namespace adc_scan_ns;
+
+static uint16_t num_of_failures = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+        num_of_failures++;
+    }
+}
+
+static void run_ticks(uint32_t ticks)
+{
+    for (uint32_t i = 0; i < ticks; i++) {
+        adc_scan_callback_timer_isr();
+    }
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+int main(void)
+{
+    timex_t start, end;
+    const uint32_t num_of_ticks = 100000;
+
+    /* two devices on channel 3, one on channel 5 */
+    adc_scan_fake_set_value(3, 1000);
+    adc_scan_fake_set_value(5, 4000);
+    check(adc_scan_add_channel(3) == 0, "add channel 3");
+    check(adc_scan_add_channel(3) == 0, "add channel 3 again");
+    check(adc_scan_add_channel(5) == 0, "add channel 5");
+    check(adc_scan_get_num_channels() == 2, "shared channel is scanned once");
+
+    run_ticks(1);
+    check(adc_scan_get_value(3) == 1000, "first sample is not ramped up");
+    check(adc_scan_get_value(5) == 4000, "value of channel 5");
+
+    /* step: filtered, then settled */
+    adc_scan_fake_set_value(3, 2000);
+    run_ticks(1);
+    check(adc_scan_get_value(3) > 1000 && adc_scan_get_value(3) < 2000, "step is filtered");
+    run_ticks(100);
+    check(adc_scan_get_value(3) == 2000, "step is settled");
+    check(adc_scan_get_value(5) == 4000, "other channel is not changed");
+
+    /* channel 3 is kept until its last device is removed */
+    adc_scan_remove_channel(3);
+    check(adc_scan_get_num_channels() == 2, "channel 3 is still used");
+    check(adc_scan_get_value(3) == 2000, "value of a still used channel");
+    adc_scan_remove_channel(3);
+    check(adc_scan_get_num_channels() == 1, "channel 3 removed");
+    check(adc_scan_get_value(3) == 0, "removed channel has no value");
+    run_ticks(1);
+    check(adc_scan_get_value(5) == 4000, "sequence after removing");
+
+    /* limits */
+    check(adc_scan_add_channel(num_adc_channels) == -1, "invalid channel");
+    for (uint8_t channel = 0; channel < num_adc_channels; channel++) {
+        adc_scan_fake_set_value(channel, channel * 100);
+        adc_scan_add_channel(channel);
+    }
+    check(adc_scan_get_num_channels() == max_scan_channels, "sequence is full");
+    run_ticks(1);
+    check(adc_scan_get_value(10) == 1000, "value in a full sequence");
+
+    /* cost of one tick for a full sequence */
+    vtimer_now(&start);
+    run_ticks(num_of_ticks);
+    vtimer_now(&end);
+    printf("filter tick, %hu channels: %lu ns\n", max_scan_channels,
+            elapsed_us(start, end) * 1000 / num_of_ticks);
+
+    if (num_of_failures == 0) {
+        printf("adc_scan_test: OK\n");
+    }
+    else {
+        printf("adc_scan_test: %hu FAILED\n", num_of_failures);
+    }
+
+    return 0;
+}
@@ -0,0 +1,262 @@
+/**
+ * @file main.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief Time to list all devices (SET_DEV_WITH_INDEX frames) to Mobile over BLE with
+ * a simulated Mobile peer (simulated time, 1 ms step).
+ * Old: one GFF frame per ATT write, wait for ACK (or 300/400 ms timeout) before the next one.
+ * New: frame_window, ble_tx_window packets in flight, frames packed up to ble_att_max_len,
+ * cumulative ACK and go-back-N retransmission after 300 ms.
+ * Peer: an ATT write takes one connection interval to reach Mobile, Mobile acknowledges the
+ * last in-order packet ack_delay_ms later. Packets and ACKs can be lost.
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+#include "stdlib.h"
+
+#include "cir_queue.h"
+#include "frame_window.h"
+
+/* same as ble_transaction.h */
+const uint8_t ble_msg_header_len = 3;
+const uint8_t ble_tx_window = 4;
+const uint8_t ble_att_max_len = 64;
+const uint16_t ble_ack_timeout_ms = 300;
+const uint8_t ble_max_retries = 5;
+
+const uint16_t num_of_devs = 64;
+const uint8_t dev_with_index_frame_size = 13; /* len + cmd + SET_DEVICE_WITH_INDEX data */
+
+const uint32_t conn_interval_ms = 30;
+const uint32_t ack_delay_ms = 60;
+
+/* simulated link */
+const uint8_t max_events = 64;
+typedef struct event_s {
+    uint32_t time;
+    bool to_mobile;
+    uint16_t index;
+    uint16_t frames;
+} event_t;
+
+static event_t events[max_events];
+static uint8_t num_of_events;
+static uint32_t now_ms;
+static uint32_t link_free_ms;
+static uint32_t loss_percent;
+
+/* simulated Mobile */
+static uint16_t mobile_next_index;
+static uint16_t mobile_frames;
+
+static void post_event(bool to_mobile, uint16_t index, uint16_t frames)
+{
+    if ((uint32_t)(rand() % 100) < loss_percent || num_of_events == max_events) {
+        return;
+    }
+
+    /* writes are serialized on the link, one per connection interval */
+    if (to_mobile) {
+        link_free_ms = (link_free_ms > now_ms ? link_free_ms : now_ms) + conn_interval_ms;
+        events[num_of_events].time = link_free_ms;
+    }
+    else {
+        events[num_of_events].time = now_ms + ack_delay_ms;
+    }
+    events[num_of_events].to_mobile = to_mobile;
+    events[num_of_events].index = index;
+    events[num_of_events].frames = frames;
+    num_of_events++;
+}
+
+/* returns index of an ACK which has arrived to CC, -1 if none */
+static int32_t run_link(void)
+{
+    uint8_t count;
+    int32_t ack_index = -1;
+
+    for (count = 0; count < num_of_events; ) {
+        if (events[count].time > now_ms) {
+            count++;
+            continue;
+        }
+
+        if (events[count].to_mobile) {
+            /* Mobile takes in-order packets only, acks the last in-order one */
+            if (events[count].index == mobile_next_index) {
+                mobile_next_index++;
+                mobile_frames += events[count].frames;
+            }
+            if (mobile_next_index > 0) {
+                post_event(false, mobile_next_index - 1, 0);
+            }
+        }
+        else {
+            ack_index = events[count].index;
+        }
+
+        events[count] = events[--num_of_events];
+    }
+
+    return ack_index;
+}
+
+static void reset_sim(uint32_t loss)
+{
+    num_of_events = 0;
+    now_ms = 0;
+    link_free_ms = 0;
+    loss_percent = loss;
+    mobile_next_index = 0;
+    mobile_frames = 0;
+    srand(1);
+}
+
+/*----------------------------- Old: stop and wait ---------------------------*/
+static uint32_t list_devices_stop_and_wait(uint32_t loss)
+{
+    uint16_t dev, index = 0;
+    uint32_t deadline;
+    int32_t ack_index;
+
+    reset_sim(loss);
+
+    for (dev = 0; dev < num_of_devs; dev++) {
+        post_event(true, index, 1);
+
+        /* wait_mobile_ack(300) */
+        deadline = now_ms + 300;
+        while (now_ms < deadline) {
+            now_ms++;
+            ack_index = run_link();
+            if (ack_index >= 0) {
+                break;
+            }
+        }
+        index++;
+    }
+
+    /* lost frames are never sent again */
+    return now_ms;
+}
+
+/*----------------------------- New: frame_window ----------------------------*/
+static uint16_t packets_sent;
+
+static void write_packet(uint16_t index, uint8_t *packet, uint16_t frames_len)
+{
+    post_event(true, index, frames_len / dev_with_index_frame_size);
+    packets_sent++;
+}
+
+static uint32_t list_devices_window(uint32_t loss)
+{
+    uint8_t queue_buf[1280];
+    cir_queue queue(queue_buf, sizeof(queue_buf));
+    uint16_t packet_sizes[ble_tx_window];
+    uint8_t packet_buf[ble_msg_header_len + 258];
+    frame_window window(&queue, packet_sizes, ble_tx_window, packet_buf, ble_att_max_len,
+            ble_msg_header_len, 3, ble_max_retries, write_packet);
+    uint8_t frame[dev_with_index_frame_size] = { dev_with_index_frame_size - 3 };
+    uint16_t dev;
+    uint32_t timer = 0;
+    int32_t ack_index;
+
+    reset_sim(loss);
+    packets_sent = 0;
+
+    /* controller puts all frames at once */
+    for (dev = 0; dev < num_of_devs; dev++) {
+        queue.add_data(frame, sizeof(frame));
+    }
+
+    window.send();
+    timer = ble_ack_timeout_ms;
+
+    while (queue.get_size() > 0 && now_ms < 600000) {
+        now_ms++;
+
+        ack_index = run_link();
+        if (ack_index >= 0 && window.ack(ack_index) > 0) {
+            timer = (window.get_in_flight() > 0) ? ble_ack_timeout_ms : 0;
+            if (window.send() > 0 && timer == 0) {
+                timer = ble_ack_timeout_ms;
+            }
+        }
+
+        if (timer > 0 && --timer == 0) {
+            if (window.resend() < 0) {
+                printf("packets dropped\n");
+            }
+            window.send();
+            timer = (window.get_in_flight() > 0) ? ble_ack_timeout_ms : 0;
+        }
+    }
+
+    if (mobile_frames != num_of_devs) {
+        printf("FAILED: mobile got %u frames\n", mobile_frames);
+    }
+
+    return now_ms;
+}
+
+/* Mobile repeating its last ACK mustn't postpone go-back-N forever */
+static void check_duplicated_ack(void)
+{
+    uint8_t queue_buf[256];
+    cir_queue queue(queue_buf, sizeof(queue_buf));
+    uint16_t packet_sizes[ble_tx_window];
+    uint8_t packet_buf[ble_msg_header_len + 258];
+    frame_window window(&queue, packet_sizes, ble_tx_window, packet_buf,
+            ble_msg_header_len + dev_with_index_frame_size, ble_msg_header_len, 3,
+            ble_max_retries, write_packet);
+    uint8_t frame[dev_with_index_frame_size] = { dev_with_index_frame_size - 3 };
+    uint8_t count;
+
+    reset_sim(0);
+    queue.add_data(frame, sizeof(frame));
+    queue.add_data(frame, sizeof(frame));
+    window.send();
+
+    if (window.ack(0) != 1) {
+        printf("FAILED: ack of packet 0\n");
+        return;
+    }
+    if (window.ack(0) != -1) {
+        printf("FAILED: duplicated ack of packet 0 has been accepted\n");
+        return;
+    }
+
+    /* duplicated acks between timeouts don't reset retries */
+    for (count = 0; count < ble_max_retries; count++) {
+        window.ack(0);
+        if (window.resend() < 0) {
+            printf("FAILED: packets dropped after %u retries\n", count);
+            return;
+        }
+    }
+    window.ack(0);
+    if (window.resend() >= 0) {
+        printf("FAILED: packets not dropped after %u retries\n", ble_max_retries);
+    }
+}
+
+int main(void)
+{
+    uint32_t loss, old_ms, new_ms;
+
+    check_duplicated_ack();
+
+    printf("List %u devices to Mobile, conn interval %lu ms, Mobile ACK delay %lu ms\n",
+            num_of_devs, conn_interval_ms, ack_delay_ms);
+
+    for (loss = 0; loss <= 20; loss += 10) {
+        old_ms = list_devices_stop_and_wait(loss);
+        new_ms = list_devices_window(loss);
+        printf("loss %2lu%%: stop-and-wait %6lu ms, window %6lu ms (%u ATT writes)\n", loss,
+                old_ms, new_ms, packets_sent);
+    }
+
+    return 0;
+}
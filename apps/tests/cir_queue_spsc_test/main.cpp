@@ -0,0 +1,116 @@
+/**
+ * @file main.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief Stress test for cir_queue single producer / single consumer.
+ * On native board, hwtimer callbacks run in signal handler (interrupt) context:
+ * producer pushes frames from hwtimer callback, consumer (main thread) drains them.
+ * Frames are | len | seq (4 bytes) | ~seq (4 bytes) |, a lost or corrupted frame breaks the sequence.
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "hwtimer.h"
+#include "vtimer.h"
+}
+
+#include "cir_queue.h"
+
+const uint16_t queue_size = 255; /* same as usart_queue */
+uint8_t queue_buffer[queue_size];
+cir_queue a_queue(queue_buffer, queue_size);
+
+const uint8_t frame_data_len = 8;
+const uint8_t frame_size = frame_data_len + 1;
+const uint8_t frames_per_int = 5;
+const uint32_t int_period_us = 100;
+const uint32_t test_time_s = 10;
+
+volatile uint32_t produced_frames = 0;
+volatile uint32_t dropped_frames = 0;
+volatile bool producer_stop = false;
+
+static void uint322buf(uint32_t val, uint8_t *buf)
+{
+    buf[0] = (uint8_t)(val >> 24);
+    buf[1] = (uint8_t)(val >> 16);
+    buf[2] = (uint8_t)(val >> 8);
+    buf[3] = (uint8_t)val;
+}
+
+static uint32_t buf2uint32(uint8_t *buf)
+{
+    return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+}
+
+static void producer_isr(void *)
+{
+    uint8_t frame[frame_size];
+    uint32_t seq;
+
+    for (uint8_t count = 0; count < frames_per_int; count++) {
+        if (a_queue.get_size() + frame_size > queue_size) {
+            /* full, same frame will be retried on next interrupt */
+            dropped_frames++;
+            break;
+        }
+
+        seq = produced_frames;
+        frame[0] = frame_data_len;
+        uint322buf(seq, &frame[1]);
+        uint322buf(~seq, &frame[5]);
+        a_queue.add_data(frame, frame_size);
+        produced_frames = seq + 1;
+    }
+
+    if (!producer_stop) {
+        hwtimer_set(HWTIMER_TICKS(int_period_us), producer_isr, NULL);
+    }
+}
+
+int main(void)
+{
+    uint8_t frame[frame_size];
+    uint32_t expected_seq = 0, errors = 0, seq;
+    timex_t start, now;
+
+    printf("cir_queue SPSC stress test, %lu s\n", test_time_s);
+
+    vtimer_now(&start);
+    hwtimer_set(HWTIMER_TICKS(int_period_us), producer_isr, NULL);
+
+    while (1) {
+        vtimer_now(&now);
+        if (now.seconds - start.seconds >= test_time_s) {
+            producer_stop = true;
+        }
+
+        if (a_queue.get_size() < frame_size) {
+            if (producer_stop && expected_seq == produced_frames) {
+                break;
+            }
+            continue;
+        }
+
+        /* preview len then get whole frame, as GFF consumers do */
+        if (a_queue.preview_data(false) != frame_data_len) {
+            errors++;
+        }
+        a_queue.get_data(frame, frame_size);
+
+        seq = buf2uint32(&frame[1]);
+        if (seq != expected_seq || buf2uint32(&frame[5]) != ~seq) {
+            errors++;
+            printf("frame %lu: got seq %lu\n", expected_seq, seq);
+        }
+        expected_seq = seq + 1;
+    }
+
+    printf("produced %lu, received %lu, full %lu times, errors %lu, overflowed %d\n",
+            produced_frames, expected_seq, dropped_frames, errors, a_queue.is_overflowed());
+    printf("%s\n", (errors == 0 && !a_queue.is_overflowed()) ? "PASSED" : "FAILED");
+
+    return 0;
+}
@@ -1,7 +1,13 @@
 #include "stdio.h"
 #include "stdint.h"
+#include "string.h"
+
+extern "C" {
+#include "vtimer.h"
+}
 
 #include "cir_queue.h"
+#include "frame_ring.h"
 
 const uint16_t queue_size = 33;
 uint8_t queue_buffer[queue_size];
@@ -11,21 +17,173 @@ uint8_t data_ret[data_size];
 
 cir_queue a_queue(queue_buffer, queue_size);
 
-int main(void) {
-    while (1) {
+/* Benchmark, GFF frames through a 1024 bytes queue */
+const uint16_t bench_queue_size = 1024;
+uint8_t bench_queue_buffer[bench_queue_size];
+const uint32_t bench_num_of_frames = 100000;
+const uint8_t bench_frames_per_burst = 8;
+
+const uint8_t gff_frame_size = 9; /* SET_DEV_VAL: len + cmd + device_id + value */
+const uint8_t big_frame_size = 64;
+uint8_t frame[big_frame_size];
+uint8_t frame_ret[big_frame_size];
+
+static bool check_cir_queue(void)
+{
+    for (uint16_t loop = 0; loop < 100; loop++) {
         /* add data */
         a_queue.add_data(data, data_size);
 
         /* get data */
         if (a_queue.get_size() != data_size) {
             printf("queue_size %lu != data_size %u\n", a_queue.get_size(), data_size);
-            break;
+            return false;
         }
 
         a_queue.get_data(data_ret, data_size);
-        for (int8_t count = 0; count < data_size; count++) {
-            printf("%d ", data_ret[count]);
+        if (memcmp(data, data_ret, data_size) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool check_frame_ring(void)
+{
+    frame_ring ring(bench_queue_buffer, 64);
+    uint16_t len, count;
+    uint8_t *frame_p;
+
+    for (count = 0; count < sizeof(frame); count++) {
+        frame[count] = count;
+    }
+
+    /* odd frame sizes to go through wrap around padding */
+    for (count = 0; count < 1000; count++) {
+        len = 1 + count % 29;
+        if (ring.add_frame(frame, len) == 0) {
+            continue;
+        }
+
+        /* full, consume all frames then the frame must fit */
+        while ((frame_p = ring.peek(len)) != NULL) {
+            if (memcmp(frame_p, frame, len) != 0) {
+                return false;
+            }
+            ring.release();
+        }
+
+        if (ring.add_frame(frame, 1 + count % 29) != 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+static void print_result(const char *name, uint8_t frame_size, timex_t &start, timex_t &end)
+{
+    uint32_t us = elapsed_us(start, end);
+
+    printf("%-24s %2u bytes/frame: %6lu KB/s\n", name, frame_size,
+            (uint32_t)((uint64_t)bench_num_of_frames * frame_size * 1000000 / (us ? us : 1) / 1024));
+}
+
+static void bench(uint8_t frame_size)
+{
+    cir_queue queue(bench_queue_buffer, bench_queue_size);
+    frame_ring ring(bench_queue_buffer, bench_queue_size);
+    timex_t start, end;
+    uint32_t count;
+    uint16_t len;
+    uint8_t burst, byte_count;
+    uint8_t *frame_p;
+
+    /* byte by byte cir_queue (how add_data/get_data used to work) */
+    vtimer_now(&start);
+    for (count = 0; count < bench_num_of_frames; count += bench_frames_per_burst) {
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            for (byte_count = 0; byte_count < frame_size; byte_count++) {
+                queue.add_data(frame[byte_count]);
+            }
+        }
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            len = queue.preview_data(false);
+            for (byte_count = 0; byte_count < frame_size; byte_count++) {
+                frame_ret[byte_count] = queue.get_data();
+            }
+        }
+    }
+    vtimer_now(&end);
+    print_result("cir_queue byte by byte", frame_size, start, end);
+
+    /* cir_queue bulk add/get */
+    vtimer_now(&start);
+    for (count = 0; count < bench_num_of_frames; count += bench_frames_per_burst) {
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            queue.add_data(frame, frame_size);
+        }
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            len = queue.preview_data(false);
+            queue.get_data(frame_ret, frame_size);
+        }
+    }
+    vtimer_now(&end);
+    print_result("cir_queue bulk", frame_size, start, end);
+
+    /* frame_ring copy in / copy out */
+    vtimer_now(&start);
+    for (count = 0; count < bench_num_of_frames; count += bench_frames_per_burst) {
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            ring.add_frame(frame, frame_size);
+        }
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            ring.get_frame(frame_ret, sizeof(frame_ret));
         }
-        printf("\n");
     }
+    vtimer_now(&end);
+    print_result("frame_ring add/get", frame_size, start, end);
+
+    /* frame_ring in place, producer writes into ring, consumer parses in ring */
+    vtimer_now(&start);
+    for (count = 0; count < bench_num_of_frames; count += bench_frames_per_burst) {
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            frame_p = ring.reserve(frame_size);
+            frame_p[0] = frame_size - 3;
+            frame_p[frame_size - 1] = (uint8_t)count;
+            ring.commit(frame_size);
+        }
+        for (burst = 0; burst < bench_frames_per_burst; burst++) {
+            frame_p = ring.peek(len);
+            frame_ret[0] = frame_p[0];
+            ring.release();
+        }
+    }
+    vtimer_now(&end);
+    print_result("frame_ring reserve/peek", frame_size, start, end);
+
+    if (queue.is_overflowed() || ring.is_overflowed()) {
+        printf("bench: overflowed\n");
+    }
+}
+
+int main(void)
+{
+    printf("cir_queue check: %s\n", check_cir_queue() ? "ok" : "FAILED");
+    printf("frame_ring check: %s\n", check_frame_ring() ? "ok" : "FAILED");
+
+    for (uint8_t count = 0; count < big_frame_size; count++) {
+        frame[count] = count;
+    }
+
+    bench(gff_frame_size);
+    bench(big_frame_size);
+
+    return 0;
 }
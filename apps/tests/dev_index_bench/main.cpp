@@ -0,0 +1,136 @@
+/**
+ * @file main.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief Micro-benchmark for device lookups: linear search (old ha_device_mng::find_device)
+ * and id_hash_index (current ha_device_mng::find_device). Run on native board.
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "ha_device.h"
+#include "id_hash_index.h"
+
+const uint16_t max_num_of_devs = 2048;
+const uint16_t index_size = 2 * max_num_of_devs;
+const uint32_t num_of_lookups = 200000;
+
+ha_device devs_buffer[max_num_of_devs];
+id_hash_index_ns::entry_t index_buffer[index_size];
+id_hash_index devs_index(index_buffer, index_size);
+
+static uint32_t make_device_id(uint16_t count)
+{
+    /* zone | node in zone | end point | device type */
+    return ((uint32_t)(count / 8 + 0x0101) << 16) | ((uint32_t)(count % 8) << 8) | 0x30;
+}
+
+static ha_device *linear_find(uint16_t num_of_devs, uint32_t device_id)
+{
+    for (uint16_t count = 0; count < num_of_devs; count++) {
+        if (devs_buffer[count].get_device_id() == device_id) {
+            return &devs_buffer[count];
+        }
+    }
+
+    return NULL;
+}
+
+static ha_device *hash_find(uint32_t device_id)
+{
+    uint16_t pos = devs_index.find(device_id);
+
+    return (pos == id_hash_index_ns::no_value) ? NULL : &devs_buffer[pos];
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+static void run_bench(uint16_t num_of_devs)
+{
+    timex_t start, end;
+    uint32_t count, found, linear_us, hash_us;
+
+    /* fill devices */
+    devs_index.clear();
+    for (count = 0; count < num_of_devs; count++) {
+        devs_buffer[count].set_device_id(make_device_id(count));
+        devs_index.insert(make_device_id(count), count);
+    }
+
+    /* linear */
+    found = 0;
+    vtimer_now(&start);
+    for (count = 0; count < num_of_lookups; count++) {
+        if (linear_find(num_of_devs, make_device_id(count % num_of_devs)) != NULL) {
+            found++;
+        }
+    }
+    vtimer_now(&end);
+    linear_us = elapsed_us(start, end);
+    if (found != num_of_lookups) {
+        printf("linear: found %lu != %lu\n", found, num_of_lookups);
+    }
+
+    /* hash */
+    found = 0;
+    vtimer_now(&start);
+    for (count = 0; count < num_of_lookups; count++) {
+        if (hash_find(make_device_id(count % num_of_devs)) != NULL) {
+            found++;
+        }
+    }
+    vtimer_now(&end);
+    hash_us = elapsed_us(start, end);
+    if (found != num_of_lookups) {
+        printf("hash: found %lu != %lu\n", found, num_of_lookups);
+    }
+
+    printf("%-5u devs | linear %8lu ns/lookup | hash %6lu ns/lookup\n", num_of_devs,
+            (uint32_t)((uint64_t)linear_us * 1000 / num_of_lookups),
+            (uint32_t)((uint64_t)hash_us * 1000 / num_of_lookups));
+}
+
+static bool check_remove(void)
+{
+    uint16_t count;
+
+    /* remove every 3rd device, others must still be found at right positions */
+    for (count = 0; count < max_num_of_devs; count += 3) {
+        devs_index.remove(make_device_id(count));
+    }
+
+    for (count = 0; count < max_num_of_devs; count++) {
+        if (count % 3 == 0) {
+            if (devs_index.find(make_device_id(count)) != id_hash_index_ns::no_value) {
+                return false;
+            }
+        }
+        else if (devs_index.find(make_device_id(count)) != count) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(void)
+{
+    printf("Device lookup benchmark (%lu lookups)\n", num_of_lookups);
+
+    run_bench(64);
+    run_bench(256);
+    run_bench(1024);
+    run_bench(2048);
+
+    printf("remove check: %s\n", check_remove() ? "ok" : "FAILED");
+
+    return 0;
+}
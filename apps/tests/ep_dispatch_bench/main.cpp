@@ -0,0 +1,187 @@
+/**
+ * @file main.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @brief Test of EP dispatcher (ep_dispatcher.h) and comparison with old model of ha_host
+ * (one thread for each EP, run on native board). Order of events, broadcast, full queue
+ * and events posted before dispatcher is started are checked, then RAM for EPs and
+ * latency from sending an event to its handler are compared.
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "thread.h"
+#include "msg.h"
+#include "tcb.h"
+#include "vtimer.h"
+}
+
+#include "ep_dispatcher.h"
+#include "sensor_cal.h"
+
+using namespace ep_dispatcher_ns;
+
+const uint8_t num_end_points = 32;
+const uint32_t num_of_events = 100000;
+
+/* old model of ha_host: stack for each EP thread (message queue is in stack) */
+const uint16_t ep_thread_stacksize = 1550;
+const uint16_t ep_thread_queue_size = 16;
+const uint8_t num_ep_threads = 8; //ha_host had 8 EPs, thread table of RIOT is limited.
+const uint16_t native_stacksize = KERNEL_CONF_STACKSIZE_DEFAULT;
+
+/* state of an EP in ha_host: handler, device ID, generation, device instance.
+ * sizeof(ep_state_t) of ha_device_handler.cpp measured for 32-bit target, the largest
+ * device is ADC sensor (80 bytes) without its calibration table. */
+const uint16_t ep_state_size = 92;
+
+/* calibration tables of ADC sensors, shared by all EPs (sensor_cal.h) */
+const uint16_t cal_pool_size = sensor_cal_ns::max_tables
+        * (sensor_cal_ns::num_segments + 1) * sizeof(int32_t);
+
+static char ep_thread_stack[num_ep_threads][native_stacksize];
+static kernel_pid_t ep_thread_pid[num_ep_threads];
+
+static uint16_t num_of_failures = 0;
+
+static uint32_t handled_count[num_end_points];
+static uint32_t last_value[num_end_points];
+static bool in_order = true;
+static volatile uint32_t thread_handled_count = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+        num_of_failures++;
+    }
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+static void count_event(uint8_t ep_id, uint16_t type, uint32_t value)
+{
+    if (ep_id >= num_end_points) {
+        return;
+    }
+    /* values of each EP are posted in increasing order */
+    if (handled_count[ep_id] > 0 && value <= last_value[ep_id] && type != 0) {
+        in_order = false;
+    }
+    last_value[ep_id] = value;
+    handled_count[ep_id]++;
+}
+
+static void event_handler(uint8_t ep_id, uint16_t type, uint32_t value)
+{
+    if (ep_id == all_end_points) {
+        for (uint8_t count = 0; count < num_end_points; count++) {
+            count_event(count, 0, value);
+        }
+        return;
+    }
+    count_event(ep_id, type, value);
+}
+
+static void *ep_thread_func(void *arg)
+{
+    msg_t msg_q[ep_thread_queue_size];
+    msg_t msg;
+
+    msg_init_queue(msg_q, ep_thread_queue_size);
+    while (1) {
+        msg_receive(&msg);
+        thread_handled_count = thread_handled_count + 1;
+    }
+
+    return NULL;
+}
+
+static uint32_t total_handled(void)
+{
+    uint32_t total = 0;
+
+    for (uint8_t count = 0; count < num_end_points; count++) {
+        total += handled_count[count];
+    }
+    return total;
+}
+
+int main(void)
+{
+    timex_t start, end;
+    msg_t msg;
+    uint32_t dispatcher_ns, thread_ns;
+
+    /* events posted before dispatcher is started, queue is full */
+    for (uint8_t count = 0; count < max_events; count++) {
+        check(ep_dispatcher_post(count % num_end_points, 1, count) == 0, "post");
+    }
+    check(ep_dispatcher_post(0, 1, 0xFFFF) == -1, "full queue");
+    check(ep_dispatcher_get_dropped() == 1, "dropped event is counted");
+
+    /* dispatcher has higher priority than main, it runs at once */
+    ep_dispatcher_start(&event_handler);
+    check(total_handled() == max_events, "events posted before start");
+    check(in_order, "order of events of an EP");
+
+    /* broadcast */
+    ep_dispatcher_post(all_end_points, 2, 0);
+    check(total_handled() == max_events + num_end_points, "broadcast");
+
+    /* latency, dispatcher: events to all EPs */
+    vtimer_now(&start);
+    for (uint32_t count = 0; count < num_of_events; count++) {
+        ep_dispatcher_post(count % num_end_points, 1, max_events + count);
+    }
+    vtimer_now(&end);
+    check(total_handled() == max_events + num_end_points + num_of_events,
+            "all events handled");
+    check(in_order, "order of events in bench");
+    check(ep_dispatcher_get_dropped() == 1, "no event dropped in bench");
+    dispatcher_ns = (uint32_t) ((uint64_t) elapsed_us(start, end) * 1000 / num_of_events);
+
+    /* latency, old model: a message to the thread of each EP */
+    for (uint8_t count = 0; count < num_ep_threads; count++) {
+        ep_thread_pid[count] = thread_create(ep_thread_stack[count], native_stacksize,
+                PRIORITY_MAIN - 1, CREATE_STACKTEST, ep_thread_func, NULL, "ep");
+    }
+    vtimer_now(&start);
+    for (uint32_t count = 0; count < num_of_events; count++) {
+        msg.type = 1;
+        msg.content.value = count;
+        msg_send(&msg, ep_thread_pid[count % num_ep_threads], false);
+    }
+    vtimer_now(&end);
+    check(thread_handled_count == num_of_events, "all messages handled");
+    thread_ns = (uint32_t) ((uint64_t) elapsed_us(start, end) * 1000 / num_of_events);
+
+    /* RAM for EPs of ha_host on board */
+    printf("RAM per EP: threads %u bytes (stack %u + tcb %u), dispatcher %u bytes\n",
+            ep_thread_stacksize + (unsigned) sizeof(tcb_t), ep_thread_stacksize,
+            (unsigned) sizeof(tcb_t), ep_state_size);
+    printf("RAM of %u EPs: threads %lu bytes, dispatcher %lu bytes "
+            "(states + calibration tables %u + queue %u + stack %u + tcb)\n",
+            num_end_points,
+            (uint32_t) num_end_points * (ep_thread_stacksize + sizeof(tcb_t)),
+            (uint32_t) (num_end_points * ep_state_size + cal_pool_size
+                    + sizeof(ep_event_t) * max_events + ep_thread_stacksize + sizeof(tcb_t)),
+            cal_pool_size, (unsigned) (sizeof(ep_event_t) * max_events),
+            ep_thread_stacksize);
+    printf("event -> handler: threads %lu ns, dispatcher %lu ns\n", thread_ns,
+            dispatcher_ns);
+
+    if (num_of_failures == 0) {
+        printf("ep_dispatch_bench: OK\n");
+    }
+    else {
+        printf("ep_dispatch_bench: %hu FAILED\n", num_of_failures);
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ * @file main.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @brief Accuracy and speed of sensor calibration: float chain of equations (old
+ * adc_sensor_instance::cal_iterative_equations, now sensor_cal_float_eval) and the
+ * compiled fixed-point table (sensor_cal, used by adc_sensor_instance). Run on native board.
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "sensor_cal.h"
+
+using namespace sensor_cal_ns;
+
+const uint16_t v_ref = 3300; //mV
+const uint16_t num_adc_values = 1 << adc_bits;
+const uint16_t num_of_rounds = 100;
+
+typedef struct sensor_case_s {
+    const char* name;
+    const char* equa_types;
+    uint8_t num_equation;
+    const float* params;
+    uint8_t num_params;
+    float max_error; //accepted error, in unit of sensor (0: only printed).
+} sensor_case_t;
+
+/* LM35, 10mV/C */
+const float lm35_params[] = { 100.0f, 0 };
+/* NTC 10k/3950 in a divider, 1/T = 1/T0 + ln(R/R0)/B approximated by a table */
+const float ntc_params[] = { 0.3f, 110.0f, 0.8f, 70.0f, 1.4f, 45.0f, 1.9f, 30.0f, 2.4f, 16.0f,
+        2.9f, 0.0f, 3.2f, -20.0f };
+/* LDR in a divider: R = 10k * V / (3.3 - V), lux = 1.25e7 * R^-1.405 */
+const float ldr_params[] = { -1.0f / 3.3f, 1.0f, -1.0f, 10000.0f, 0, 12518931.0f, -1.405f, 0 };
+/* soil moisture, % = 1/(a*V + b) + c */
+const float soil_params[] = { 0.02f, 0.005f, -10.0f };
+
+const sensor_case_t sensor_cases[] = {
+    { "linear (LM35)", "l", 1, lm35_params, 2, 0.01f },
+    { "table (NTC)", "t", 1, ntc_params, 14, 1.0f }, //corners between ADC grid points
+    { "r+l+p (LDR)", "rlp", 3, ldr_params, 8, 0 },
+    { "rational (soil)", "r", 1, soil_params, 3, 2.0f },
+};
+const uint8_t num_of_cases = sizeof(sensor_cases) / sizeof(sensor_cases[0]);
+
+volatile float float_sink;
+volatile int32_t fixed_sink;
+
+static uint16_t num_of_failures = 0;
+
+static float adc_to_volt(uint16_t adc_value)
+{
+    /* same as old adc_sensor_instance::get_voltage_value() */
+    return ((float) adc_value) * ((float) v_ref) / ((float) num_adc_values) / 1000.0f;
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+static void run_bench(const sensor_case_t *ss_case)
+{
+    sensor_cal calibration;
+    timex_t start, end;
+    uint32_t float_us, fixed_us;
+    float ref, diff, max_diff = 0, sum_diff = 0;
+    uint16_t num_in_range = 0;
+
+    calibration.compile(ss_case->equa_types, ss_case->num_equation, ss_case->params,
+            ss_case->num_params, v_ref);
+
+    /* accuracy, values out of range of table (e.g. near a pole) are not compared */
+    for (uint16_t adc_value = 0; adc_value < num_adc_values; adc_value++) {
+        ref = sensor_cal_float_eval(adc_to_volt(adc_value), ss_case->equa_types,
+                ss_case->num_equation, ss_case->params, ss_case->num_params);
+        if (!(ref > -65535.0f && ref < 65535.0f)) {
+            continue;
+        }
+        diff = ((float) calibration.get_value(adc_value)) / (float) (1 << value_frac_bits)
+                - ref;
+        diff = (diff < 0) ? -diff : diff;
+        if (diff > max_diff) {
+            max_diff = diff;
+        }
+        sum_diff += diff;
+        num_in_range++;
+    }
+
+    /* speed */
+    vtimer_now(&start);
+    for (uint16_t round = 0; round < num_of_rounds; round++) {
+        for (uint16_t adc_value = 0; adc_value < num_adc_values; adc_value++) {
+            float_sink = sensor_cal_float_eval(adc_to_volt(adc_value), ss_case->equa_types,
+                    ss_case->num_equation, ss_case->params, ss_case->num_params);
+        }
+    }
+    vtimer_now(&end);
+    float_us = elapsed_us(start, end);
+
+    vtimer_now(&start);
+    for (uint16_t round = 0; round < num_of_rounds; round++) {
+        for (uint16_t adc_value = 0; adc_value < num_adc_values; adc_value++) {
+            fixed_sink = calibration.get_value(adc_value);
+        }
+    }
+    vtimer_now(&end);
+    fixed_us = elapsed_us(start, end);
+
+    printf("%-16s | float %5lu ns | table %4lu ns | max err %9.3f | mean err %7.3f (%u values)\n",
+            ss_case->name,
+            (uint32_t) ((uint64_t) float_us * 1000 / ((uint32_t) num_of_rounds * num_adc_values)),
+            (uint32_t) ((uint64_t) fixed_us * 1000 / ((uint32_t) num_of_rounds * num_adc_values)),
+            max_diff, num_in_range ? sum_diff / num_in_range : 0, num_in_range);
+
+    if (ss_case->max_error > 0 && max_diff > ss_case->max_error) {
+        printf("FAILED: %s, error %.3f > %.3f\n", ss_case->name, max_diff, ss_case->max_error);
+        num_of_failures++;
+    }
+}
+
+int main(void)
+{
+    sensor_cal calibration;
+
+    printf("Sensor calibration benchmark (%u segments, Q.%u)\n", num_segments, value_frac_bits);
+
+    for (uint8_t count = 0; count < num_of_cases; count++) {
+        run_bench(&sensor_cases[count]);
+    }
+
+    /* no equation: value is 0, as the float path */
+    if (calibration.compile(NULL, 0, NULL, 0, v_ref) != -1 || calibration.get_value(2000) != 0) {
+        printf("FAILED: no equation\n");
+        num_of_failures++;
+    }
+
+    if (num_of_failures == 0) {
+        printf("sensor_cal_bench: OK\n");
+    }
+    else {
+        printf("sensor_cal_bench: %hu FAILED\n", num_of_failures);
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+/**
+ * @file main.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief Throughput benchmark of 6LoWPAN sender on native board.
+ * Old: socket per GFF frame + 10ms sleep (slp_sender before batching).
+ * New: long-lived socket, GFF frames to the same node packed into one datagram,
+ * token bucket pacing (slp_sender before reliable transport, see slp_reliable.h).
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+#include "string.h"
+
+extern "C" {
+#include "vtimer.h"
+#include "net_if.h"
+#include "rpl.h"
+#include "socket_base/socket.h"
+}
+
+const uint8_t interface = 0;
+const uint16_t node_id = 1;
+const uint16_t to_node_id = 2;
+const uint16_t receiving_port = 1001;
+const uint16_t payload_maxsize = 256;
+
+const uint32_t num_of_frames = 500;
+const uint8_t gff_frame_size = 9; /* SET_DEV_VAL: len + cmd + device_id + value */
+
+/* pacing */
+const uint8_t max_tokens = 4;
+const uint32_t token_period_us = 10000;
+uint8_t tokens = max_tokens;
+timex_t last_refill;
+
+sockaddr6_t saddr;
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+static void make_gff_frame(uint8_t *frame, uint32_t seq)
+{
+    frame[0] = gff_frame_size - 3;
+    frame[1] = 0; /* SET_DEV_VAL */
+    frame[2] = 0;
+    frame[3] = (uint8_t)(to_node_id >> 8);
+    frame[4] = (uint8_t)to_node_id;
+    frame[5] = 0;
+    frame[6] = 0x30;
+    frame[7] = (uint8_t)(seq >> 8);
+    frame[8] = (uint8_t)seq;
+}
+
+static void wait_for_send_token(void)
+{
+    timex_t now;
+    uint32_t elapsed, refill;
+
+    vtimer_now(&now);
+    elapsed = (now.seconds - last_refill.seconds > 1) ?
+            max_tokens * token_period_us : elapsed_us(last_refill, now);
+
+    refill = elapsed / token_period_us;
+    if (refill > 0) {
+        tokens = (tokens + refill > max_tokens) ? max_tokens : tokens + refill;
+        last_refill = now;
+        elapsed = 0;
+    }
+
+    if (tokens == 0) {
+        vtimer_usleep(token_period_us - elapsed);
+        vtimer_now(&last_refill);
+        tokens = 1;
+    }
+
+    tokens--;
+}
+
+static void bench_old(void)
+{
+    uint8_t payload[payload_maxsize];
+    timex_t start, end;
+    int sock;
+
+    vtimer_now(&start);
+    for (uint32_t count = 0; count < num_of_frames; count++) {
+        payload[0] = (uint8_t)(to_node_id >> 8);
+        payload[1] = (uint8_t)to_node_id;
+        make_gff_frame(&payload[2], count);
+
+        sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+        socket_base_sendto(sock, payload, gff_frame_size + 2, 0, &saddr, sizeof(saddr));
+        socket_base_close(sock);
+
+        vtimer_usleep(10000);
+    }
+    vtimer_now(&end);
+
+    printf("old (socket per frame + 10ms sleep): %lu frames/s, %lu datagrams\n",
+            (uint32_t)((uint64_t)num_of_frames * 1000000 / elapsed_us(start, end)),
+            num_of_frames);
+}
+
+static void bench_new(void)
+{
+    uint8_t payload[payload_maxsize];
+    uint16_t payload_len = 0;
+    uint32_t datagrams = 0;
+    timex_t start, end;
+    int sock;
+
+    sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+
+    vtimer_now(&start);
+    for (uint32_t count = 0; count < num_of_frames; count++) {
+        /* queue has backed up, pack frames to the same node */
+        if (payload_len + gff_frame_size > payload_maxsize) {
+            wait_for_send_token();
+            socket_base_sendto(sock, payload, payload_len, 0, &saddr, sizeof(saddr));
+            datagrams++;
+            payload_len = 0;
+        }
+
+        if (payload_len == 0) {
+            payload[0] = (uint8_t)(to_node_id >> 8);
+            payload[1] = (uint8_t)to_node_id;
+            payload_len = 2;
+        }
+
+        make_gff_frame(&payload[payload_len], count);
+        payload_len += gff_frame_size;
+    }
+
+    if (payload_len > 0) {
+        wait_for_send_token();
+        socket_base_sendto(sock, payload, payload_len, 0, &saddr, sizeof(saddr));
+        datagrams++;
+    }
+    vtimer_now(&end);
+
+    socket_base_close(sock);
+
+    printf("new (persistent socket + batching + pacing): %lu frames/s, %lu datagrams\n",
+            (uint32_t)((uint64_t)num_of_frames * 1000000 / elapsed_us(start, end)),
+            datagrams);
+}
+
+int main(void)
+{
+    ipv6_addr_t ipaddr;
+
+    /* init network stack (as ha_slp_init, root node) */
+    net_if_set_src_address_mode(interface, NET_IF_TRANS_ADDR_M_SHORT);
+    net_if_set_hardware_address(interface, (uint8_t)node_id);
+    if (rpl_init(interface) != SIXLOWERROR_SUCCESS) {
+        printf("Error initializing RPL\n");
+        return -1;
+    }
+    rpl_init_root();
+    ipv6_init_as_router();
+
+    /* multicast, as slp_sender */
+    ipv6_addr_set_all_nodes_addr(&ipaddr);
+    memset(&saddr, 0, sizeof(saddr));
+    saddr.sin6_family = AF_INET6;
+    memcpy(&saddr.sin6_addr, &ipaddr, 16);
+    saddr.sin6_port = HTONS(receiving_port);
+
+    printf("6LoWPAN sender benchmark, %lu GFF frames of %u bytes\n", num_of_frames, gff_frame_size);
+
+    bench_old();
+    bench_new();
+
+    return 0;
+}
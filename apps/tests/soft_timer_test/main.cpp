@@ -0,0 +1,146 @@
+/**
+ * @file main.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @brief Test of soft timers of devices (soft_timer.h). Periods, one-shot/periodic timers,
+ * stop/delete (also from callbacks) and limits are checked, then cost of a tick is
+ * measured with all timers running at slow rates (only due timers cost).
+ */
+
+#include "stdio.h"
+#include "stdint.h"
+
+extern "C" {
+#include "vtimer.h"
+}
+
+#include "soft_timer.h"
+
+using namespace soft_timer_ns;
+
+static uint16_t num_of_failures = 0;
+
+typedef struct counter_s {
+    uint32_t count;
+    uint32_t last_tick;
+    int8_t timer_id;
+    bool delete_itself;
+} counter_t;
+
+static uint32_t now = 0;
+
+static void check(bool cond, const char *what)
+{
+    if (!cond) {
+        printf("FAILED: %s\n", what);
+        num_of_failures++;
+    }
+}
+
+static void count_callback(void *arg)
+{
+    counter_t *counter = (counter_t *) arg;
+
+    counter->count++;
+    counter->last_tick = now;
+    if (counter->delete_itself) {
+        soft_timer_delete(counter->timer_id);
+    }
+}
+
+static void run_ticks(uint32_t ticks)
+{
+    for (uint32_t i = 0; i < ticks; i++) {
+        now++;
+        soft_timer_tick();
+    }
+}
+
+static uint32_t elapsed_us(timex_t &start, timex_t &end)
+{
+    return (end.seconds - start.seconds) * 1000000 + end.microseconds - start.microseconds;
+}
+
+int main(void)
+{
+    counter_t debounce = { 0, 0, -1, false };
+    counter_t sensor = { 0, 0, -1, false };
+    counter_t one_shot = { 0, 0, -1, false };
+    counter_t self_delete = { 0, 0, -1, true };
+    counter_t others[max_soft_timers];
+    timex_t start, end;
+    const uint32_t num_of_ticks = 100000;
+
+    /* independent rates */
+    debounce.timer_id = soft_timer_create(&count_callback, &debounce);
+    sensor.timer_id = soft_timer_create(&count_callback, &sensor);
+    check(debounce.timer_id >= 0 && sensor.timer_id >= 0, "create");
+    soft_timer_start(debounce.timer_id, 10, true);
+    soft_timer_start(sensor.timer_id, 1000, true);
+    run_ticks(5000);
+    check(debounce.count == 500, "10ms periodic");
+    check(sensor.count == 5, "1s periodic");
+    check(sensor.last_tick == 5000, "periodic doesn't drift");
+
+    /* long period, parked in level 1 of wheel */
+    soft_timer_start(sensor.timer_id, 15000, false);
+    run_ticks(14999);
+    check(sensor.count == 5, "15s one-shot not early");
+    run_ticks(1);
+    check(sensor.count == 6, "15s one-shot on time");
+    run_ticks(30000);
+    check(sensor.count == 6, "one-shot fires once");
+
+    /* stop and restart */
+    soft_timer_stop(debounce.timer_id);
+    debounce.count = 0;
+    run_ticks(100);
+    check(debounce.count == 0, "stopped timer");
+    soft_timer_start(debounce.timer_id, 10, true);
+    run_ticks(100);
+    check(debounce.count == 10, "restarted timer");
+
+    /* one-shot and a timer deleting itself in its callback */
+    one_shot.timer_id = soft_timer_create(&count_callback, &one_shot);
+    self_delete.timer_id = soft_timer_create(&count_callback, &self_delete);
+    soft_timer_start(one_shot.timer_id, 0, false);
+    soft_timer_start(self_delete.timer_id, 5, true);
+    run_ticks(50);
+    check(one_shot.count == 1, "0ms one-shot");
+    check(self_delete.count == 1, "deleted in callback");
+
+    /* limits: deleted timer is free again, no timer when all are used */
+    soft_timer_delete(debounce.timer_id);
+    soft_timer_delete(sensor.timer_id);
+    soft_timer_delete(one_shot.timer_id);
+    check(soft_timer_create(NULL, NULL) == -1, "NULL callback");
+    for (uint8_t i = 0; i < max_soft_timers; i++) {
+        others[i].count = 0;
+        others[i].delete_itself = false;
+        others[i].timer_id = soft_timer_create(&count_callback, &others[i]);
+        check(others[i].timer_id >= 0, "all timers");
+    }
+    check(soft_timer_create(&count_callback, &debounce) == -1, "no free timer");
+    soft_timer_start(-1, 10, true);
+    soft_timer_stop(max_soft_timers);
+
+    /* cost of a tick, all timers running at 1s */
+    for (uint8_t i = 0; i < max_soft_timers; i++) {
+        soft_timer_start(others[i].timer_id, 1000, true);
+    }
+    vtimer_now(&start);
+    run_ticks(num_of_ticks);
+    vtimer_now(&end);
+    check(others[0].count == num_of_ticks / 1000, "1s timers in bench");
+    printf("tick, %hu timers at 1s: %lu ns\n", max_soft_timers,
+            elapsed_us(start, end) * 1000 / num_of_ticks);
+
+    if (num_of_failures == 0) {
+        printf("soft_timer_test: OK\n");
+    }
+    else {
+        printf("soft_timer_test: %hu FAILED\n", num_of_failures);
+    }
+
+    return 0;
+}
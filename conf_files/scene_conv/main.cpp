@@ -0,0 +1,243 @@
+/**
+ * @file main.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief Convert old text scene files (R:, I:, O: lines) to binary scene format
+ * (scene_file.h) on PC, files are converted in place. Files which are already in binary
+ * format are checked and left untouched.
+ * NOTE: rule_t must have the same layout on PC and on the board (checked by CC with
+ * rule_size in header).
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "scene_rule.h"
+#include "scene_file.h"
+#include "crc16.h"
+
+using namespace scene_ns;
+
+static rule_t rules_list[scene_max_rules];
+
+/*----------------------------------------------------------------------------*/
+static int read_text(FILE *file, uint16_t &num_rules)
+{
+    char line[32];
+    unsigned int is_valid_ui, is_active_ui, num_in_ui, num_out_ui, condact_ui;
+    unsigned int id_ui, time_end_ui;
+    int value_i;
+    uint8_t count_io;
+    rule_t *rule;
+
+    num_rules = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "R: %u %u %u %u", &is_valid_ui, &is_active_ui, &num_in_ui,
+                &num_out_ui) != 4) {
+            continue;
+        }
+
+        if (num_rules >= scene_max_rules || num_in_ui > rule_max_input
+                || num_out_ui > rule_max_output) {
+            return -1;
+        }
+
+        rule = &rules_list[num_rules++];
+        rule->is_valid = is_valid_ui;
+        rule->is_active = is_active_ui;
+        rule->num_in = num_in_ui;
+        rule->num_out = num_out_ui;
+
+        for (count_io = 0; count_io < rule->num_in; count_io++) {
+            if (fgets(line, sizeof(line), file) == NULL
+                    || sscanf(line, "I: %u", &condact_ui) != 1) {
+                return -1;
+            }
+            rule->inputs[count_io].cond = condact_ui;
+
+            if (fgets(line, sizeof(line), file) == NULL) {
+                return -1;
+            }
+            if (condact_ui == COND_IN_RANGE || condact_ui == COND_IN_RANGE_EVDAY) {
+                sscanf(line, "%x %x", &id_ui, &time_end_ui);
+                rule->inputs[count_io].time_range.start = id_ui;
+                rule->inputs[count_io].time_range.end = time_end_ui;
+            }
+            else {
+                sscanf(line, "%x %d", &id_ui, &value_i);
+                rule->inputs[count_io].dev_val.device_id = id_ui;
+                rule->inputs[count_io].dev_val.value = value_i;
+            }
+        }
+
+        for (count_io = 0; count_io < rule->num_out; count_io++) {
+            if (fgets(line, sizeof(line), file) == NULL
+                    || sscanf(line, "O: %u", &condact_ui) != 1) {
+                return -1;
+            }
+            rule->outputs[count_io].action = condact_ui;
+
+            if (fgets(line, sizeof(line), file) == NULL) {
+                return -1;
+            }
+            sscanf(line, "%x %d", &id_ui, &value_i);
+            rule->outputs[count_io].dev_val.device_id = id_ui;
+            rule->outputs[count_io].dev_val.value = value_i;
+        }
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static int read_binary(FILE *file, scene_file_ns::header_t &header)
+{
+    size_t size;
+
+    if (header.version != scene_file_ns::version || header.rule_size != sizeof(rule_t)
+            || header.num_rules > scene_max_rules) {
+        return -1;
+    }
+
+    size = header.num_rules * sizeof(rule_t);
+    if (fread(rules_list, 1, size, file) != size
+            || crc16_ccitt(crc16_ns::crc16_init, (uint8_t *)rules_list, size) != header.crc) {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+static int write_binary(const char *path, uint16_t num_rules)
+{
+    scene_file_ns::header_t header;
+    FILE *file;
+    int retval = 0;
+
+    header.magic = scene_file_ns::magic;
+    header.version = scene_file_ns::version;
+    header.rule_size = sizeof(rule_t);
+    header.num_rules = num_rules;
+    header.crc = crc16_ccitt(crc16_ns::crc16_init, (uint8_t *)rules_list,
+            num_rules * sizeof(rule_t));
+    header.journal_gen = 0;
+
+    file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+            fwrite(rules_list, sizeof(rule_t), num_rules, file) != num_rules) {
+        retval = -1;
+    }
+
+    if (fclose(file) != 0) {
+        retval = -1;
+    }
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+static void list_rules(uint16_t num_rules)
+{
+    uint16_t count_rule;
+    uint8_t count_io;
+    rule_t *rule;
+
+    for (count_rule = 0; count_rule < num_rules; count_rule++) {
+        rule = &rules_list[count_rule];
+        printf("  rule %u: valid %u, active %u\n", count_rule, rule->is_valid, rule->is_active);
+
+        for (count_io = 0; count_io < rule->num_in; count_io++) {
+            if (rule->inputs[count_io].cond == COND_IN_RANGE
+                    || rule->inputs[count_io].cond == COND_IN_RANGE_EVDAY) {
+                printf("    in: cond %u, %08x - %08x\n", rule->inputs[count_io].cond,
+                        rule->inputs[count_io].time_range.start,
+                        rule->inputs[count_io].time_range.end);
+            }
+            else {
+                printf("    in: cond %u, dev %08x, val %d\n", rule->inputs[count_io].cond,
+                        rule->inputs[count_io].dev_val.device_id,
+                        rule->inputs[count_io].dev_val.value);
+            }
+        }
+
+        for (count_io = 0; count_io < rule->num_out; count_io++) {
+            printf("    out: act %u, dev %08x, val %d\n", rule->outputs[count_io].action,
+                    rule->outputs[count_io].dev_val.device_id,
+                    rule->outputs[count_io].dev_val.value);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    scene_file_ns::header_t header;
+    FILE *file;
+    uint16_t num_rules;
+    bool list_only = false, is_binary;
+    int count, err, errors = 0;
+
+    if (argc > 1 && strcmp(argv[1], "-l") == 0) {
+        list_only = true;
+    }
+
+    if (argc < (list_only ? 3 : 2)) {
+        printf("Usage: %s [-l] scene_file ...\n"
+                "Convert text scene files to binary format in place, -l: list rules only.\n",
+                argv[0]);
+        return 1;
+    }
+
+    for (count = list_only ? 2 : 1; count < argc; count++) {
+        file = fopen(argv[count], "rb");
+        if (file == NULL) {
+            printf("%s: can't open\n", argv[count]);
+            errors++;
+            continue;
+        }
+
+        memset((void *)rules_list, 0, sizeof(rules_list));
+        num_rules = 0;
+
+        is_binary = fread(&header, sizeof(header), 1, file) == 1
+                && header.magic == scene_file_ns::magic;
+        if (is_binary) {
+            err = read_binary(file, header);
+            num_rules = header.num_rules;
+        }
+        else {
+            rewind(file);
+            err = read_text(file, num_rules);
+        }
+        fclose(file);
+
+        if (err != 0) {
+            printf("%s: invalid %s scene file\n", argv[count], is_binary ? "binary" : "text");
+            errors++;
+            continue;
+        }
+
+        printf("%s: %s, %u rules\n", argv[count], is_binary ? "binary" : "text", num_rules);
+        if (list_only) {
+            list_rules(num_rules);
+            continue;
+        }
+
+        if (!is_binary) {
+            if (write_binary(argv[count], num_rules) != 0) {
+                printf("%s: failed to write\n", argv[count]);
+                errors++;
+                continue;
+            }
+            printf("%s: converted (%u bytes)\n", argv[count],
+                    (unsigned int)(sizeof(header) + num_rules * sizeof(rule_t)));
+        }
+    }
+
+    return (errors > 0) ? 1 : 0;
+}
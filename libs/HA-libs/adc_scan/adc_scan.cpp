@@ -0,0 +1,146 @@
+/**
+ * @file adc_scan.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief This is source file for ADC scan engine shared by all analog devices.
+ */
+extern "C" {
+#include "mutex.h"
+}
+
+#include "adc_scan.h"
+#include "adc_scan_hw.h"
+
+using namespace adc_scan_ns;
+
+/* regular sequence and its DMA buffer */
+static uint8_t seq_channels[max_scan_channels];
+static volatile uint16_t dma_buffer[max_scan_channels];
+static volatile uint8_t num_seq_channels = 0;
+
+/* per channel: number of devices using it and filter state (value << filter_shift) */
+static uint8_t channel_users[num_adc_channels];
+static volatile uint32_t filter_acc[num_adc_channels];
+static volatile bool filter_primed[num_adc_channels];
+
+/* set while sequence is being changed, timer isr skips filtering */
+static volatile bool seq_busy = false;
+static mutex_t adc_scan_mutex = MUTEX_INIT;
+
+/* internal function */
+static void restart_scan(void);
+
+int8_t adc_scan_add_channel(uint8_t channel)
+{
+    if (channel >= num_adc_channels) {
+        return -1;
+    }
+
+    mutex_lock(&adc_scan_mutex);
+
+    if (channel_users[channel] > 0) {
+        channel_users[channel]++;
+        mutex_unlock(&adc_scan_mutex);
+        return 0;
+    }
+
+    if (num_seq_channels >= max_scan_channels) {
+        mutex_unlock(&adc_scan_mutex);
+        return -1;
+    }
+
+    seq_busy = true;
+    channel_users[channel] = 1;
+    filter_primed[channel] = false;
+    filter_acc[channel] = 0;
+    seq_channels[num_seq_channels] = channel;
+    num_seq_channels++;
+    restart_scan();
+    seq_busy = false;
+
+    mutex_unlock(&adc_scan_mutex);
+
+    return 0;
+}
+
+void adc_scan_remove_channel(uint8_t channel)
+{
+    uint8_t i;
+
+    if (channel >= num_adc_channels) {
+        return;
+    }
+
+    mutex_lock(&adc_scan_mutex);
+
+    if (channel_users[channel] == 0 || --channel_users[channel] > 0) {
+        mutex_unlock(&adc_scan_mutex);
+        return;
+    }
+
+    seq_busy = true;
+    for (i = 0; i < num_seq_channels; i++) {
+        if (seq_channels[i] == channel) {
+            break;
+        }
+    }
+    num_seq_channels--;
+    for (; i < num_seq_channels; i++) {
+        seq_channels[i] = seq_channels[i + 1];
+    }
+    filter_primed[channel] = false;
+    filter_acc[channel] = 0;
+    restart_scan();
+    seq_busy = false;
+
+    mutex_unlock(&adc_scan_mutex);
+}
+
+uint16_t adc_scan_get_value(uint8_t channel)
+{
+    if (channel >= num_adc_channels) {
+        return 0;
+    }
+
+    return filter_acc[channel] >> filter_shift;
+}
+
+uint8_t adc_scan_get_num_channels(void)
+{
+    return num_seq_channels;
+}
+
+void adc_scan_callback_timer_isr(void)
+{
+    uint8_t channel;
+    uint16_t sample;
+
+    if (seq_busy || num_seq_channels == 0) {
+        return;
+    }
+
+    adc_scan_hw_refresh();
+
+    for (uint8_t i = 0; i < num_seq_channels; i++) {
+        channel = seq_channels[i];
+        sample = dma_buffer[i];
+        if (!filter_primed[channel]) {
+            /* first sample, don't ramp up from 0 */
+            filter_primed[channel] = true;
+            filter_acc[channel] = (uint32_t) sample << filter_shift;
+        } else {
+            /* acc = acc + sample - acc/2^shift, value = acc/2^shift */
+            filter_acc[channel] = filter_acc[channel] + sample
+                    - (filter_acc[channel] >> filter_shift);
+        }
+    }
+}
+
+static void restart_scan(void)
+{
+    adc_scan_hw_stop();
+    if (num_seq_channels > 0) {
+        adc_scan_hw_start(seq_channels, num_seq_channels, dma_buffer);
+    }
+}
@@ -0,0 +1,61 @@
+/**
+ * @file adc_scan.h
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief ADC scan engine shared by all analog devices (ADC sensors, dimmers).
+ * Channels used by devices are converted by one ADC in scan + continuous mode, DMA
+ * writes samples of all channels to a buffer without CPU (see adc_scan_hw.h).
+ * Every timer tick, samples are filtered (exponential moving average), devices read
+ * the latest filtered value of their channels. ADC is configured again only when
+ * the set of channels changes (a device is configured or removed).
+ * Channels 0->15 are on the same pins for ADC1/2/3, they are all converted by ADC1.
+ */
+#ifndef __HA_ADC_SCAN_H_
+#define __HA_ADC_SCAN_H_
+
+#include <stdint.h>
+
+namespace adc_scan_ns {
+const uint8_t num_adc_channels = 18; //channel 0->17 (16: temperature, 17: Vrefint).
+const uint8_t max_scan_channels = 16; //length of regular sequence.
+const uint8_t filter_shift = 3; //average of ~8 ticks (8ms).
+}
+
+/**
+ * @brief Add a channel to the scan sequence, a channel can be used by many devices.
+ * ADC is configured again if it's a new channel.
+ *
+ * @param[in] channel ADC channel.
+ *
+ * @return -1 if channel is invalid or sequence is full, otherwise 0.
+ */
+int8_t adc_scan_add_channel(uint8_t channel);
+
+/**
+ * @brief Remove a channel from the scan sequence when it's not used by any device.
+ *
+ * @param[in] channel ADC channel.
+ */
+void adc_scan_remove_channel(uint8_t channel);
+
+/**
+ * @brief Get the latest filtered value of a channel.
+ *
+ * @param[in] channel ADC channel.
+ *
+ * @return 12-bits value, 0 if channel isn't scanned or hasn't been sampled yet.
+ */
+uint16_t adc_scan_get_value(uint8_t channel);
+
+/**
+ * @brief Get number of channels in the scan sequence.
+ */
+uint8_t adc_scan_get_num_channels(void);
+
+/**
+ * @brief Filter samples in DMA buffer, called every timer tick (1ms), in ha_host by tick worker.
+ */
+void adc_scan_callback_timer_isr(void);
+
+#endif //__HA_ADC_SCAN_H_
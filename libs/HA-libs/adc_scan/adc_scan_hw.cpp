@@ -0,0 +1,117 @@
+/**
+ * @file adc_scan_hw.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief This is source file for hardware layer of ADC scan engine.
+ */
+#include "adc_scan_hw.h"
+#include "adc_scan.h"
+
+#ifdef BOARD_NATIVE
+
+static uint16_t fake_values[adc_scan_ns::num_adc_channels];
+static const uint8_t *seq_channels = 0;
+static uint8_t seq_num_channels = 0;
+static volatile uint16_t *dma_buffer = 0;
+
+void adc_scan_hw_start(const uint8_t *channels, uint8_t num_channels,
+        volatile uint16_t *buffer)
+{
+    seq_channels = channels;
+    seq_num_channels = num_channels;
+    dma_buffer = buffer;
+    adc_scan_hw_refresh();
+}
+
+void adc_scan_hw_stop(void)
+{
+    seq_num_channels = 0;
+}
+
+void adc_scan_hw_refresh(void)
+{
+    for (uint8_t i = 0; i < seq_num_channels; i++) {
+        dma_buffer[i] = fake_values[seq_channels[i]];
+    }
+}
+
+void adc_scan_fake_set_value(uint8_t channel, uint16_t value)
+{
+    if (channel < adc_scan_ns::num_adc_channels) {
+        fake_values[channel] = value;
+    }
+}
+
+#else //BOARD_NATIVE
+
+#include "stm32f10x.h"
+
+void adc_scan_hw_start(const uint8_t *channels, uint8_t num_channels,
+        volatile uint16_t *buffer)
+{
+    DMA_InitTypeDef dma_params;
+    ADC_InitTypeDef adc_params;
+
+    RCC_ADCCLKConfig(RCC_PCLK2_Div6); //12MHz
+    RCC_APB2PeriphClockCmd(RCC_APB2Periph_ADC1, ENABLE);
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    /* DMA1 channel 1 (ADC1), one sample of each channel, wraps around */
+    DMA_DeInit(DMA1_Channel1);
+    dma_params.DMA_PeripheralBaseAddr = (uint32_t) &ADC1->DR;
+    dma_params.DMA_MemoryBaseAddr = (uint32_t) buffer;
+    dma_params.DMA_DIR = DMA_DIR_PeripheralSRC;
+    dma_params.DMA_BufferSize = num_channels;
+    dma_params.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
+    dma_params.DMA_MemoryInc = DMA_MemoryInc_Enable;
+    dma_params.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
+    dma_params.DMA_MemoryDataSize = DMA_MemoryDataSize_HalfWord;
+    dma_params.DMA_Mode = DMA_Mode_Circular;
+    dma_params.DMA_Priority = DMA_Priority_High;
+    dma_params.DMA_M2M = DMA_M2M_Disable;
+    DMA_Init(DMA1_Channel1, &dma_params);
+    DMA_Cmd(DMA1_Channel1, ENABLE);
+
+    /* ADC1, scan + continuous mode, software started once */
+    ADC_DeInit(ADC1);
+    adc_params.ADC_Mode = ADC_Mode_Independent;
+    adc_params.ADC_ScanConvMode = ENABLE;
+    adc_params.ADC_ContinuousConvMode = ENABLE;
+    adc_params.ADC_ExternalTrigConv = ADC_ExternalTrigConv_None;
+    adc_params.ADC_DataAlign = ADC_DataAlign_Right;
+    adc_params.ADC_NbrOfChannel = num_channels;
+    ADC_Init(ADC1, &adc_params);
+
+    for (uint8_t i = 0; i < num_channels; i++) {
+        ADC_RegularChannelConfig(ADC1, channels[i], i + 1, ADC_SampleTime_239Cycles5);
+        if (channels[i] == ADC_Channel_TempSensor || channels[i] == ADC_Channel_Vrefint) {
+            ADC_TempSensorVrefintCmd(ENABLE);
+        }
+    }
+
+    ADC_DMACmd(ADC1, ENABLE);
+    ADC_Cmd(ADC1, ENABLE);
+
+    ADC_ResetCalibration(ADC1);
+    while (ADC_GetResetCalibrationStatus(ADC1));
+    ADC_StartCalibration(ADC1);
+    while (ADC_GetCalibrationStatus(ADC1));
+
+    ADC_SoftwareStartConvCmd(ADC1, ENABLE);
+}
+
+void adc_scan_hw_stop(void)
+{
+    ADC_SoftwareStartConvCmd(ADC1, DISABLE);
+    ADC_DMACmd(ADC1, DISABLE);
+    ADC_Cmd(ADC1, DISABLE);
+    DMA_Cmd(DMA1_Channel1, DISABLE);
+}
+
+void adc_scan_hw_refresh(void)
+{
+    /* written by DMA */
+}
+
+#endif //BOARD_NATIVE
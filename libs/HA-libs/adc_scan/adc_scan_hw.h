@@ -0,0 +1,47 @@
+/**
+ * @file adc_scan_hw.h
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Hardware layer of ADC scan engine (see adc_scan.h).
+ * MBoard-1: ADC1 in scan + continuous mode, DMA1 channel 1 in circular mode writes one
+ * sample of every channel in the sequence to the buffer.
+ * native: fake sample source, samples are set by adc_scan_fake_set_value and copied
+ * to the buffer by adc_scan_hw_refresh (as DMA would do).
+ */
+#ifndef __HA_ADC_SCAN_HW_H_
+#define __HA_ADC_SCAN_HW_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Configure ADC and DMA for the given regular sequence and start converting.
+ *
+ * @param[in] channels ADC channels in sequence order.
+ * @param[in] num_channels Number of channels in sequence (1->16).
+ * @param[out] buffer DMA buffer, num_channels samples in sequence order.
+ */
+void adc_scan_hw_start(const uint8_t *channels, uint8_t num_channels,
+        volatile uint16_t *buffer);
+
+/**
+ * @brief Stop converting, buffer isn't written after that.
+ */
+void adc_scan_hw_stop(void);
+
+/**
+ * @brief Bring buffer up to date before it's read. Nothing to do when DMA writes it.
+ */
+void adc_scan_hw_refresh(void);
+
+#ifdef BOARD_NATIVE
+/**
+ * @brief Set sample of a channel of the fake sample source.
+ *
+ * @param[in] channel ADC channel.
+ * @param[in] value 12-bits sample.
+ */
+void adc_scan_fake_set_value(uint8_t channel, uint16_t value);
+#endif //BOARD_NATIVE
+
+#endif //__HA_ADC_SCAN_HW_H_
@@ -17,6 +17,8 @@ enum common_msg_id: uint16_t {
 
     /* 6lowpan communications */
     SIXLOWPAN_RESTART,
+    SIXLOWPAN_ACKED,        /* receiver -> sender, window of a node has been opened */
+    SIXLOWPAN_RETX_TIMER,   /* retransmission timer of sender expired */
 
     /* this will be used to chain with other enum of CC and node */
     /* ALWAYS KEEP it at THE END */
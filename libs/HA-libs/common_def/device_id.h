@@ -14,6 +14,15 @@
  * MSB                                  LSB
  * 15            8                      0
  * |-- Zone id --|-- Node id in zone ---|
+ *
+ * Group address: device id of a group command, node id in zone is 0xFF.
+ * MSB                                                          LSB
+ * 31               24         16              8                0
+ * |-- Zone id/0xFF --|-- 0xFF --|-- Group id/0 --|-- Type/0 ------|
+ * Zone id 0xFF is all zones, group id 0 is no explicit group (group ids are
+ * configured on hosts for each end point), type 0 is all types (a common type
+ * matches all its subtypes). Group commands are sent once in a link-local multicast
+ * datagram, each host sends them to its matching end points.
  */
 
 #ifndef DEVICE_ID_H_
@@ -23,6 +32,13 @@
 
 namespace ha_ns {
 
+const uint8_t group_node_in_zone = 0xFF;
+const uint8_t group_all_zones = 0xFF;
+const uint8_t group_no_group = 0x00;
+const uint8_t group_all_types = 0x00;
+const uint8_t group_max_id = 32;    /* explicit groups 1..32 (bit group id - 1) */
+const uint8_t max_end_points = 32;  /* end points of a host, EP ids 0..31 */
+
 enum device_type_common_e
     : uint8_t {
         NO_DEVICE = 0x00,
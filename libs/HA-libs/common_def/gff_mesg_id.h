@@ -26,6 +26,10 @@ enum mesg_type_e: uint16_t { /* in GFF format */
     SET_NEW_SCENE = 0x0009,
     SET_REMOVE_SCENE = 0x000A,
     SET_RENAME_INACT_SCENE = 0x000B,
+    SET_DEV_SNAPSHOT = 0x000C,
+    SET_SCENE_SNAPSHOT = 0x000D,
+    SET_SCENE_DIR_SNAPSHOT = 0x000E,
+    SET_DEV_MULT_VALS = 0x000F,
 
     GET_DEV_VAL = 0x0100,
     GET_NUM_OF_DEVS = 0x0101,
@@ -36,8 +40,12 @@ enum mesg_type_e: uint16_t { /* in GFF format */
     GET_NUM_OF_RULES = 0x0106,
     GET_RULE_WITH_INDEXS = 0x0107,
     GET_ZONE_NAME = 0x0108,
+    GET_DEV_SNAPSHOT = 0x0109,
+    GET_SCENE_SNAPSHOT = 0x010A,
+    GET_SCENE_DIR_SNAPSHOT = 0x010B,
 
     ALIVE = 0x0200,
+    DEV_EXPIRED = 0x0201,
 };
 
 const uint16_t GFF_MAX_DATA_SIZE = 255;
@@ -51,7 +59,10 @@ const uint8_t GFF_DATA_POS = GFF_CMD_POS + GFF_CMD_SIZE;
 
 enum gff_data_len_e: uint8_t {
     SET_DEV_VAL_DATA_LEN = 6, /* device_id + value */
+    SET_DEV_MULT_VALS_HEADER_LEN = 1, /* num of records */
+    SET_DEV_MULT_VALS_RECORD_LEN = 6, /* device_id + value */
     ALIVE_DATA_LEN = 4, /* device_id */
+    DEV_EXPIRED_DATA_LEN = 4, /* device_id */
 
     SET_NUM_OF_DEVS_DATA_LEN = 4,
     SET_DEVICE_WITH_INDEX_DATA_LEN = 10,
@@ -73,10 +84,39 @@ enum gff_data_len_e: uint8_t {
     SET_NEW_SCENE_DATA_LEN = 8,
     SET_REMOVE_SCENE_DATA_LEN = 8,
     SET_RENAME_INACT_SCENE_DATA_LEN = 16,
+
+    GET_DEV_SNAPSHOT_DATA_LEN = 5, /* known version + first chunk */
+    GET_SCENE_SNAPSHOT_DATA_LEN = 13, /* scene name + known version + first chunk */
+    GET_SCENE_DIR_SNAPSHOT_DATA_LEN = 5, /* known version + first chunk */
+
+    SNAPSHOT_HEADER_LEN = 6, /* version + chunk index + num of chunks */
+    SCENE_SNAPSHOT_HEADER_LEN = 14, /* snapshot header + scene name */
+    DEV_SNAPSHOT_RECORD_LEN = 6, /* device_id + value */
+    RULE_SNAPSHOT_RECORD_LEN = 19, /* SET_RULE_WITH_INDEXS data without scene name */
+    SCENE_DIR_SNAPSHOT_RECORD_LEN = 9, /* active (1) or inactive (0) + scene name */
 };
 
 const uint32_t SET_DEV_WITH_INDEX_ALL_DEVS = 0xFFFFFFFF;
 
+/*
+ * Values for devices of one node in one frame:
+ * SET_DEV_MULT_VALS: | num of records (1) | device_id (4) | value (2) | ... |
+ * Receiving node handles records in order, as SET_DEV_VAL messages.
+ */
+const uint8_t SET_DEV_MULT_VALS_MAX_RECORDS = 32;
+
+/*
+ * Snapshots (whole devices table, whole scene or scenes directory):
+ * GET_xxx_SNAPSHOT: | (scene name (8)) | known version (4) | first chunk (1) |
+ * SET_xxx_SNAPSHOT: | version (4) | chunk index (1) | num of chunks (1) | (scene name (8)) |
+ *                   records ... |
+ * Each chunk fits one BLE packet. If known version is the current version and first chunk
+ * is 0, only one chunk with num of chunks = 0 is sent back (nothing has changed).
+ * If some chunks are missing, they can be requested again from first chunk with the same
+ * version, a chunk with other version means the snapshot must be fetched again from chunk 0.
+ */
+const uint8_t SNAPSHOT_NOT_CHANGED = 0; /* num of chunks */
+
 };
 
 #endif /* MESG_ID_H_ */
@@ -9,10 +9,11 @@
 #define __HA_ADC_DEVICE_H_
 
 #include "device_common.h"
+#include "adc_scan.h"
 
 using namespace dev_param_ns;
 
-class adc_dev_class: private adc, private gpio {
+class adc_dev_class: private gpio {
 protected:
     const uint16_t v_ref = 3300; //mV
     const uint16_t adc_value_max = 4096; //12-bits ADC
@@ -20,11 +21,12 @@ protected:
     adc_dev_class(void);
 
     /**
-     * @brief Initialize GPIO and ADC on the given port/pin.
+     * @brief Initialize GPIO on the given port/pin and add the channel to ADC scan
+     * engine (see adc_scan.h), ADC isn't configured again for each sample.
      *
      * @param[in] port      The port has a functional ADC.
      * @param[in] pin       The pin has a functional ADC.
-     * @param[in] adc_x     Chosen ADC (ADC1, ADC2 or ADC3).
+     * @param[in] adc_x     Chosen ADC (ADC1, ADC2 or ADC3), channels are scanned by ADC1.
      * @param[in] channel   The specified channel on the chosen ADC.
      */
     void adc_dev_configure(port_t port, uint8_t pin, adc_t adc_x,
@@ -38,12 +40,19 @@ protected:
     void adc_dev_sampling_time_setup(uint8_t sample_time);
 
     /**
-     * @brief Get converted adc value.
+     * @brief Get the latest filtered adc value of the channel.
      *
      * @return Converted ADC value.
      */
     uint16_t adc_dev_get_value(void);
+
+    /**
+     * @brief Remove the channel from ADC scan engine, called when device is removed.
+     */
+    void adc_dev_release(void);
 private:
+    uint8_t adc_channel;
+    bool is_configured;
 };
 
 #endif //__HA_ADC_DEVICE_H_
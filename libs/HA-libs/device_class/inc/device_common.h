@@ -34,6 +34,12 @@ typedef struct {
     pwm_timer_t timer_x;
     uint8_t pwm_channel;
 } pwm_config_params_t;
+
+/**
+ * @brief Function called with a new value of device (from timer callback or interrupt),
+ * arg is given by owner of device.
+ */
+typedef void (*dev_notify_t)(void *arg, uint32_t value);
 }
 
 #endif //__HA_DEVICE_COMMON_H_
@@ -9,7 +9,8 @@
 
 adc_dev_class::adc_dev_class(void)
 {
-
+    adc_channel = 0;
+    is_configured = false;
 }
 
 void adc_dev_class::adc_dev_configure(port_t port, uint8_t pin, adc_t adc_x,
@@ -22,18 +23,12 @@ void adc_dev_class::adc_dev_configure(port_t port, uint8_t pin, adc_t adc_x,
     gpio_params.mode = in_analog;
     gpio_init(&gpio_params);
 
-    adc_params_t adc_params;
-
-    adc_params.adc = adc_x;
-    adc_params.adc_channel = channel;
-    adc_params.adc_mode = independent;
-    adc_params.channel_type = regular_channel;
-    adc_params.conv_mode = continuous_mode;
-    adc_params.data_access = poll;
-    adc_params.option = no_option;
-    adc_params.adc_sample_time = ADC_SampleTime_28Cycles5;
-    adc_init(&adc_params);
-    adc_start();
+    /* a device is configured once, channel is converted by ADC scan engine */
+    adc_dev_release();
+    if (adc_scan_add_channel(channel) == 0) {
+        adc_channel = channel;
+        is_configured = true;
+    }
 }
 
 void adc_dev_class::adc_dev_sampling_time_setup(uint8_t sample_time)
@@ -43,5 +38,17 @@ void adc_dev_class::adc_dev_sampling_time_setup(uint8_t sample_time)
 
 uint16_t adc_dev_class::adc_dev_get_value(void)
 {
-    return adc_convert();
+    if (!is_configured) {
+        return 0;
+    }
+
+    return adc_scan_get_value(adc_channel);
+}
+
+void adc_dev_class::adc_dev_release(void)
+{
+    if (is_configured) {
+        is_configured = false;
+        adc_scan_remove_channel(adc_channel);
+    }
 }
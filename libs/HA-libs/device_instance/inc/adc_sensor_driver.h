@@ -13,17 +13,13 @@
 
 #if AUTO_UPDATE
 
-/* send updated value to its thread */
+/* notify owner of updated value */
 #define SND_MSG (1)
-#if SND_MSG
-extern "C" {
-#include "msg.h"
-#include "thread.h"
-}
-#endif //SND_MSG
+#include "soft_timer.h"
 #endif //AUTO_UPDATE
 
 #include "ADC_device.h"
+#include "sensor_cal.h"
 
 namespace adc_sensor_ns {
 typedef enum {
@@ -31,13 +27,6 @@ typedef enum {
     rational = 1,
     polynomial = 2
 } equation_t;
-
-#if SND_MSG
-enum
-    : uint16_t {
-        ADC_SENSOR_MSG
-};
-#endif //SND_MSG
 }
 
 class adc_sensor_instance: private adc_dev_class {
@@ -83,10 +72,19 @@ public:
     float get_sensor_value(void);
 
     /**
-     * @brief Start sensor.
+     * @brief Start sensor, the equations are compiled to a fixed-point table
+     * (see sensor_cal.h), buffers of equations aren't used after that.
      */
     void start_sensor(void);
 
+    /**
+     * @brief Check if calibration table of device was taken, tables are limited
+     * (sensor_cal.h).
+     *
+     * @return false if there was no free table, device can't convert its samples.
+     */
+    bool has_calibration(void);
+
 #if AUTO_UPDATE
     /**
      * @brief Set delta threshold to avoid noisy.
@@ -111,8 +109,10 @@ public:
 
     /**
      * @brief Process value of sensor when timer callback is called.
+     *
+     * @return value of sensor in Q.8 fixed-point.
      */
-    float adc_sensor_processing(void);
+    int32_t adc_sensor_processing(void);
 
     /**
      * @brief check whether value of sensor is over or under threshold.
@@ -120,20 +120,40 @@ public:
      * @retrun true if value of sensor is under or over threshold, otherwise false.
      */
     bool is_underlow_or_overflow(void);
+
+    /**
+     * @brief Check if sampling timer of device was created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer, device can't be sampled.
+     */
+    bool has_timer(void);
 #endif //AUTO_UPDATE
 
 #if SND_MSG
     /**
-     * @brief Get pid of thread that sensor was declared.
+     * @brief Set function called with new value of device.
      *
-     * @return pid of thread.
+     * @param[in] notify Called from sampling timer callback, NULL to stop notifying.
+     * @param[in] notify_arg Argument passed to notify.
      */
-    kernel_pid_t get_pid(void);
+    void set_notify(dev_notify_t notify, void *notify_arg);
+
+    /**
+     * @brief Call notify function of device if it's set.
+     */
+    void notify_owner(uint32_t value);
+
+    /**
+     * @brief Count samples, value is sent periodically even if it isn't changed.
+     *
+     * @return true if it's time to send value.
+     */
+    bool is_report_time(void);
 #endif //SND_MSG
 private:
-    float get_voltage_value(void);
-    float cal_iterative_equations(float first_value);
+    int32_t get_fixed_value(void);
 
+    sensor_cal calibration;
     float* equation_params_buffer = NULL;
     char* equation_type_buffer = NULL;
     uint8_t num_equation = 0;
@@ -147,34 +167,24 @@ private:
     int overflow_thres = 0;
     int underflow_thres = 0;
 
-    float old_sensor_value = 0;
+    int32_t old_sensor_value = 0; //Q.8
 
-    void assign_sensor(void);
-    void remove_sensor(void);
+    int8_t timer_id; //sampling timer.
 #endif //AUTO_UPDATE
 
 #if SND_MSG
-    kernel_pid_t thread_pid;
+    dev_notify_t notify = NULL;
+    void *notify_arg = NULL;
 
     /**/
     bool is_first_send = true;
 
-    double total_value = 0.0;
+    int32_t total_value = 0;
 
     uint16_t average_num = 0;
+
+    uint16_t report_count = 0;
 #endif //SND_MSG
 };
 
-#if AUTO_UPDATE
-void adc_sensor_callback_timer_isr(void);
-#endif //AUTO_UPDATE
-
-float linear_equation_calculate(float x_value, float a, float b); //y = ax+b;
-
-float rational_equation_calculate(float x_value, float a, float b, float c); //y = 1/(ax+b)+c;
-
-float polynomial_equation_calculate(float x_value, float a, float b, float c); //y = ax^b+c;
-
-float lookup_table(float value, float* defined_table, uint8_t table_size);
-
 #endif //__HA_ADC_SENSOR_DRIVER_H_
@@ -11,15 +11,8 @@
 /* 0 if you want to poll manually */
 #define SND_MSG (1)
 
-/* RIOT's include */
-#if SND_MSG
-extern "C" {
-#include "thread.h"
-#include "msg.h"
-}
-#endif //SND_MSG
-
 #include "GPIO_device.h"
+#include "soft_timer.h"
 
 namespace btn_sw_ns {
 typedef enum
@@ -37,13 +30,6 @@ typedef enum {
     btn,    //button
     sw      //switch
 } btn_or_sw_t;
-
-#if SND_MSG
-enum
-    : uint16_t {
-        BTN_SW_MSG
-};
-#endif //SND_MSG
 }
 
 class button_switch_instance: public gpio_dev_class {
@@ -68,8 +54,26 @@ public:
      */
     void btn_sw_processing(void);
 
+    /**
+     * @brief Check if sampling timer of device was created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer, device can't be sampled.
+     */
+    bool has_timer(void);
+
 #if SND_MSG
-    kernel_pid_t get_pid(void);
+    /**
+     * @brief Set function called with new status of device.
+     *
+     * @param[in] notify Called from sampling timer callback, NULL to stop notifying.
+     * @param[in] notify_arg Argument passed to notify.
+     */
+    void set_notify(dev_notify_t notify, void *notify_arg);
+
+    /**
+     * @brief Call notify function of device if it's set.
+     */
+    void notify_owner(uint32_t value);
 #endif //SND_MSG
 private:
     btn_sw_ns::btn_or_sw_t dev_type;
@@ -82,16 +86,15 @@ private:
 
     uint16_t hold_time_count; //button's var.
 
+    int8_t timer_id; //sampling timer.
+
 #if SND_MSG
-    kernel_pid_t thread_pid;
+    dev_notify_t notify = NULL;
+    void *notify_arg = NULL;
 #endif //SND_MSG
 
     void button_processing(void);
     void switch_processing(void);
-    void assign_btn_sw(void);
-    void remove_btn_sw(void);
 };
 
-void btn_sw_callback_timer_isr(void);
-
 #endif //__HA_BUTTON_SWITCH_DRIVER_H_
@@ -12,28 +12,14 @@
 #define AUTO_UPDATE (1)
 #if AUTO_UPDATE
 
-/* 1 if want to send msg to its thread */
+/* 1 if want to notify owner of new values */
 #define SND_MSG (1)
-#if SND_MSG
-extern "C" {
-#include "msg.h"
-#include "thread.h"
-}
-#endif //SND_MSG
 
+#include "soft_timer.h"
 #endif //AUTO_UPDATE
 
 #include "ADC_device.h"
 
-namespace dimmer_ns {
-#if SND_MSG
-enum
-    : uint16_t {
-        DIMMER_MSG
-};
-#endif
-}
-
 class dimmer_instance: private adc_dev_class {
 public:
     dimmer_instance(void);
@@ -51,10 +37,29 @@ public:
      *
      */
     bool is_over_delta_thres(void);
+
+    /**
+     * @brief Check if sampling timer of device was created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer, device can't be sampled.
+     */
+    bool has_timer(void);
 #endif
 
 #if SND_MSG
-    kernel_pid_t get_pid(void);
+    /**
+     * @brief Set function called with new value of device.
+     *
+     * @param[in] notify Called from sampling timer callback, NULL to stop notifying.
+     * @param[in] notify_arg Argument passed to notify.
+     */
+    void set_notify(dev_notify_t notify, void *notify_arg);
+
+    /**
+     * @brief Call notify function of device if it's set.
+     */
+    void notify_owner(uint32_t value);
+
     bool is_first_send = true;
 #endif
 private:
@@ -65,18 +70,13 @@ private:
     uint8_t new_value_3 = 0;
     uint8_t old_value;
     bool is_over_delta;
-
-    void assign_dimmer(void);
-    void remove_dimmer(void);
+    int8_t timer_id; //sampling timer.
 #endif
 
 #if SND_MSG
-    kernel_pid_t thread_pid;
+    dev_notify_t notify = NULL;
+    void *notify_arg = NULL;
 #endif
 };
 
-#if AUTO_UPDATE
-void dimmer_callback_timer_isr(void);
-#endif
-
 #endif //__HA_DIMMER_DRIVER_H_
@@ -9,6 +9,7 @@
 #define __HA_LEVEL_BULB_DRIVER_H_
 
 #include "PWM_device.h"
+#include "soft_timer.h"
 
 using namespace dev_param_ns;
 
@@ -30,11 +31,16 @@ public:
     bool bulb_is_blink(void);
     uint16_t get_level_intensity(void);
     uint8_t get_percent_intensity(void);
+
+    /**
+     * @brief Check if blink timer of device was created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer, device can't blink.
+     */
+    bool has_timer(void);
 private:
-    void assign_bulb(void);
-    void remove_bulb(void);
     uint16_t period_in_ms = 1000; //ms
-    uint16_t time_cycle_count = 0;
+    int8_t timer_id; //blink timer, toggles every half of period.
     bool is_on_in_blink = false;
 
     bool is_blink;
@@ -43,6 +49,4 @@ private:
     uint8_t active_level;
 };
 
-void bulb_blink_callback_timer_isr(void);
-
 #endif //__HA_LEVEL_BULB_DRIVER_H_
@@ -9,6 +9,7 @@
 #define __HA_ON_OFF_BULB_DRIVER_H_
 
 #include "GPIO_device.h"
+#include "soft_timer.h"
 
 using namespace dev_param_ns;
 
@@ -33,16 +34,19 @@ public:
     void blink_processing(void);
     void set_active_level(uint8_t active_level);
     on_off_dev_ns::on_off_dev_status_t dev_get_state(void);
+
+    /**
+     * @brief Check if blink timer of device was created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer, device can't blink.
+     */
+    bool has_timer(void);
 private:
-    void assign_dev(void);
-    void remove_dev(void);
     uint8_t active_level;
     uint16_t period_in_ms = 1000;
-    uint16_t time_cycle_count = 0;
+    int8_t timer_id; //blink timer, toggles every half of period.
     bool is_on_in_blink = false;
     on_off_dev_ns::on_off_dev_status_t dev_status;
 };
 
-void on_off_blink_callback_timer_isr(void);
-
 #endif //__HA_ON_OFF_BULB_DRIVER_H_
@@ -50,6 +50,13 @@ public:
     void rgb_set_color(uint8_t red_percent, uint8_t green_percent,
             uint8_t blue_percent);
     uint32_t get_current_color(void);
+
+    /**
+     * @brief Check if timers of all bulbs were created, timers are limited (soft_timer.h).
+     *
+     * @return false if there was no free timer for a bulb.
+     */
+    bool has_timer(void);
 private:
     uint8_t red_percent_wp;  //at white point
     uint8_t green_percent_wp;  //at white point
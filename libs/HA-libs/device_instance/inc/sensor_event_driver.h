@@ -8,15 +8,9 @@
 #ifndef __HA_SENSOR_EVENT_DRIVER_H_
 #define __HA_SENSOR_EVENT_DRIVER_H_
 
+/* 1 if want to notify owner of new events */
 #define SND_MSG (1)
 
-#if SND_MSG
-extern "C" {
-#include "msg.h"
-#include "thread.h"
-}
-#endif //SND_MSG
-
 #include "GPIO_device.h"
 
 namespace sensor_event_ns {
@@ -24,13 +18,6 @@ typedef enum : uint8_t {
     low_level = 0,
     high_level = 1
 } detect_level_t;
-
-#if SND_MSG
-enum
-    :uint16_t {
-        SEN_EVT_MSG
-};
-#endif //SND_MSG
 }
 
 class sensor_event_instance: private gpio_dev_class {
@@ -43,13 +30,25 @@ public:
     bool is_detected(void);
 
 #if SND_MSG
-    kernel_pid_t get_pid(void);
+    /**
+     * @brief Set function called with new level of device.
+     *
+     * @param[in] notify Called from interrupt of device, NULL to stop notifying.
+     * @param[in] notify_arg Argument passed to notify.
+     */
+    void set_notify(dev_notify_t notify, void *notify_arg);
+
+    /**
+     * @brief Call notify function of device if it's set.
+     */
+    void notify_owner(uint32_t value);
 #endif //SND_MSG
 private:
     uint8_t detective_level;
 
 #if SND_MSG
-    kernel_pid_t thread_pid;
+    dev_notify_t notify = NULL;
+    void *notify_arg = NULL;
 #endif //SND_MSG
 };
 
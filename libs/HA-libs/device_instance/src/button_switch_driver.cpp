@@ -6,24 +6,18 @@
  * @brief This is source file for button device instance in HA system.
  */
 #include "button_switch_driver.h"
-#include "ha_host_glb.h"
 
 using namespace btn_sw_ns;
 
 /* configurable variables */
 const uint8_t btn_sw_active_state = 0; //active low-level
-const static uint8_t timer_period = 1; //ms
-const uint8_t btn_sw_sampling_time_cycle = 10 / timer_period; //sampling every 10ms (tim6_period = 1ms)
-const uint16_t btn_hold_time = 1 * 1000 / btn_sw_sampling_time_cycle; //btn is on hold after holding 1s.
-
-button_switch_instance* btn_sw_table[ha_host_ns::max_end_point]; //button&switch table
-static uint8_t time_cycle_count = 0;
-static bool table_init = false;
+const uint8_t btn_sw_sampling_period = 10; //sampling every 10ms.
+const uint16_t btn_hold_time = 1 * 1000 / btn_sw_sampling_period; //btn is on hold after holding 1s.
 
 /**
- * @brief Initialize device table.
+ * @brief Sampling timer callback of a button/switch.
  */
-static void btn_sw_table_init(void);
+static void btn_sw_timer_callback(void *arg);
 
 button_switch_instance::button_switch_instance(btn_or_sw_t type) :
         gpio_dev_class(true)
@@ -45,19 +39,12 @@ button_switch_instance::button_switch_instance(btn_or_sw_t type) :
         this->old_status = sw_off;
     }
 
-    if (!table_init) {
-        table_init = true;
-        btn_sw_table_init();
-    }
-
-#if SND_MSG
-    this->thread_pid = thread_getpid();
-#endif //SND_MSG
+    this->timer_id = soft_timer_create(&btn_sw_timer_callback, this);
 }
 
 button_switch_instance::~button_switch_instance(void)
 {
-    this->remove_btn_sw();
+    soft_timer_delete(this->timer_id);
 }
 
 void button_switch_instance::device_configure(
@@ -66,7 +53,12 @@ void button_switch_instance::device_configure(
     gpio_dev_configure(gpio_config_params->device_port,
             gpio_config_params->device_pin, gpio_config_params->mode);
 
-    this->assign_btn_sw();
+    soft_timer_start(this->timer_id, btn_sw_sampling_period, true);
+}
+
+bool button_switch_instance::has_timer(void)
+{
+    return this->timer_id >= 0;
 }
 
 btn_sw_status_t button_switch_instance::get_status(void)
@@ -168,63 +160,29 @@ void button_switch_instance::switch_processing(void)
     } // end if()
 }
 
-void button_switch_instance::assign_btn_sw(void)
+static void btn_sw_timer_callback(void *arg)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (btn_sw_table[i] == NULL) {
-            btn_sw_table[i] = this;
-            return;
-        }
-    }
-}
+    button_switch_instance* btn_sw = (button_switch_instance*) arg;
 
-void button_switch_instance::remove_btn_sw(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (btn_sw_table[i] == this) {
-            btn_sw_table[i] = NULL;
-            return;
-        }
-    }
-}
-
-static void btn_sw_table_init(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        btn_sw_table[i] = NULL;
+    btn_sw->btn_sw_processing();
+#if SND_MSG
+    if (btn_sw->is_changed_status()) {
+        btn_sw->notify_owner((uint32_t) btn_sw->get_status());
     }
+#endif //SND_MSG
 }
 
-void btn_sw_callback_timer_isr(void)
-{
-    time_cycle_count = time_cycle_count + 1;
-
-    if (time_cycle_count == btn_sw_sampling_time_cycle) {
-        time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (btn_sw_table[i] != NULL) {
-                btn_sw_table[i]->btn_sw_processing();
 #if SND_MSG
-                if (btn_sw_table[i]->is_changed_status()) {
-                    msg_t msg;
-                    msg.type = BTN_SW_MSG;
-                    msg.content.value =
-                            (uint32_t) btn_sw_table[i]->get_status();
-                    kernel_pid_t pid = btn_sw_table[i]->get_pid();
-                    if (pid == KERNEL_PID_UNDEF) {
-                        return;
-                    }
-                    msg_send(&msg, pid, false);
-                }
-#endif //SND_MSG
-            }
-        } //end for()
-    } //end if()
+void button_switch_instance::set_notify(dev_notify_t notify, void *notify_arg)
+{
+    this->notify = notify;
+    this->notify_arg = notify_arg;
 }
 
-#if SND_MSG
-kernel_pid_t button_switch_instance::get_pid(void)
+void button_switch_instance::notify_owner(uint32_t value)
 {
-    return this->thread_pid;
+    if (this->notify != NULL) {
+        this->notify(this->notify_arg, value);
+    }
 }
 #endif //SND_MSG
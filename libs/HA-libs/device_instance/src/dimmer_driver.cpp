@@ -7,25 +7,14 @@
  */
 #include <string.h>
 #include "dimmer_driver.h"
-#if AUTO_UPDATE
-#include "ha_host_glb.h"
-#endif
-
-using namespace dimmer_ns;
 
 #if AUTO_UPDATE
 /* configurable variables */
 const static uint8_t delta_threshold = 3; //delta = 3%;
-const static uint8_t timer_period = 1; //ms
-const static uint16_t dimmer_sampling_time_cycle = 100 / timer_period; //sampling every 100ms (tim6_period = 1ms)
-
-/* internal variables */
-static bool table_init = false;
-static dimmer_instance* dimmer_table[ha_host_ns::max_end_point];
-static uint16_t time_cycle_count = 0;
+const static uint16_t dimmer_sampling_period = 100; //sampling every 100ms.
 
 /* internal function */
-static void dimmer_table_init(void);
+static void dimmer_timer_callback(void *arg);
 #endif //AUTO_UPDATE
 
 dimmer_instance::dimmer_instance(void)
@@ -33,22 +22,16 @@ dimmer_instance::dimmer_instance(void)
 #if AUTO_UPDATE
     this->is_over_delta = false;
     this->old_value = 0;
-    if (!table_init) {
-        table_init = true;
-        dimmer_table_init();
-    }
+    this->timer_id = soft_timer_create(&dimmer_timer_callback, this);
 #endif //AUTO_UPDATE
-
-#if SND_MSG
-    this->thread_pid = thread_getpid();
-#endif //SND_MSG
 }
 
 dimmer_instance::~dimmer_instance()
 {
 #if AUTO_UPDATE
-    this->remove_dimmer();
+    soft_timer_delete(this->timer_id);
 #endif //AUTO_UPDATE
+    adc_dev_release();
 }
 
 void dimmer_instance::device_configure(adc_config_params_t *adc_config_params)
@@ -59,7 +42,7 @@ void dimmer_instance::device_configure(adc_config_params_t *adc_config_params)
 
     memcpy(&adc_params, adc_config_params, sizeof(adc_config_params));
 #if AUTO_UPDATE
-    this->assign_dimmer();
+    soft_timer_start(this->timer_id, dimmer_sampling_period, true);
 #endif //AUTO_UPDATE
 }
 
@@ -67,19 +50,24 @@ uint8_t dimmer_instance::get_percent(void)
 {
     uint16_t adc_value;
 
-    adc_dev_configure(adc_params.device_port,
-                adc_params.device_pin, adc_params.adc_x,
-                adc_params.adc_channel);
-
+    /* latest filtered sample of ADC scan engine */
     adc_value = adc_dev_get_value();
 
     return adc_value * 100 / adc_value_max;
 }
 
 #if SND_MSG
-kernel_pid_t dimmer_instance::get_pid(void)
+void dimmer_instance::set_notify(dev_notify_t notify, void *notify_arg)
+{
+    this->notify = notify;
+    this->notify_arg = notify_arg;
+}
+
+void dimmer_instance::notify_owner(uint32_t value)
 {
-    return this->thread_pid;
+    if (this->notify != NULL) {
+        this->notify(this->notify_arg, value);
+    }
 }
 #endif //SND_MSG
 
@@ -114,57 +102,21 @@ bool dimmer_instance::is_over_delta_thres(void)
     return this->is_over_delta;
 }
 
-static void dimmer_table_init(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        dimmer_table[i] = NULL;
-    }
-}
-
-void dimmer_instance::assign_dimmer(void)
+bool dimmer_instance::has_timer(void)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (dimmer_table[i] == NULL) {
-            dimmer_table[i] = this;
-            return;
-        }
-    }
+    return this->timer_id >= 0;
 }
 
-void dimmer_instance::remove_dimmer(void)
+static void dimmer_timer_callback(void *arg)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (dimmer_table[i] == this) {
-            dimmer_table[i] = NULL;
-            return;
-        }
-    }
-}
-
-void dimmer_callback_timer_isr(void)
-{
-    time_cycle_count = time_cycle_count + 1;
+    dimmer_instance* dimmer = (dimmer_instance*) arg;
 
-    if (time_cycle_count == dimmer_sampling_time_cycle) {
-        time_cycle_count = 0;
-        for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-            if (dimmer_table[i] != NULL) {
-                uint8_t new_value = dimmer_table[i]->dimmer_processing();
+    uint8_t new_value = dimmer->dimmer_processing();
 #if SND_MSG
-                if (dimmer_table[i]->is_over_delta_thres() || dimmer_table[i]->is_first_send) {
-                    dimmer_table[i]->is_first_send = false;
-                    msg_t msg;
-                    msg.type = DIMMER_MSG;
-                    msg.content.value = new_value;
-                    kernel_pid_t pid = dimmer_table[i]->get_pid();
-                    if (pid == KERNEL_PID_UNDEF) {
-                        return;
-                    }
-                    msg_send(&msg, pid, false);
-                }
-#endif //SND_MSG
-            }
-        }
+    if (dimmer->is_over_delta_thres() || dimmer->is_first_send) {
+        dimmer->is_first_send = false;
+        dimmer->notify_owner(new_value);
     }
+#endif //SND_MSG
 }
 #endif //AUTO_UPDATE
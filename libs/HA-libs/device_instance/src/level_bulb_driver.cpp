@@ -6,17 +6,14 @@
  * @brief This is source file for multi-level bulb device instance for HA system.
  */
 #include "level_bulb_driver.h"
-#include "ha_host_glb.h"
 
 const static uint16_t max_level_intensity = 65535;
 const static uint32_t output_freq = 200; //Hz
 
-const static uint8_t timer_period = 1; //ms
-
-static bool table_init = false;
-static level_bulb_instance* table_bulb[ha_host_ns::max_end_point];
-
-static void bulb_table_init(void);
+/**
+ * @brief Blink timer callback of a bulb.
+ */
+static void bulb_blink_timer_callback(void *arg);
 
 level_bulb_instance::level_bulb_instance(void)
 {
@@ -25,17 +22,12 @@ level_bulb_instance::level_bulb_instance(void)
     this->active_level = 0;
     this->percent_intensity = 100;
     this->level_intensity = max_level_intensity;
-    if (!table_init) {
-        table_init = true;
-        bulb_table_init();
-    }
+    this->timer_id = soft_timer_create(&bulb_blink_timer_callback, this);
 }
 
 level_bulb_instance::~level_bulb_instance(void)
 {
-    if (is_blink) {
-        remove_bulb();
-    }
+    soft_timer_delete(this->timer_id);
 }
 
 void level_bulb_instance::device_configure(
@@ -63,7 +55,7 @@ void level_bulb_instance::set_max_level_intensity(uint16_t max_level_intensity)
 void level_bulb_instance::set_percent_intensity(uint8_t percent_intensity)
 {
     if (is_blink) {
-        remove_bulb();
+        soft_timer_stop(this->timer_id);
     }
     this->is_blink = false;
     this->percent_intensity = percent_intensity;
@@ -78,7 +70,7 @@ void level_bulb_instance::set_percent_intensity(uint8_t percent_intensity)
 void level_bulb_instance::set_level_intensity(uint16_t level_intensity)
 {
     if (is_blink) {
-        remove_bulb();
+        soft_timer_stop(this->timer_id);
     }
     this->is_blink = false;
     this->level_intensity = level_intensity;
@@ -103,51 +95,46 @@ void level_bulb_instance::restart(void)
 void level_bulb_instance::stop(void)
 {
     if (is_blink) {
-        remove_bulb();
+        soft_timer_stop(this->timer_id);
     }
     pwm_dev_start_stop(false);
 }
 
 void level_bulb_instance::blink(uint8_t freq_in_hz)
 {
-    remove_bulb();
-    this->time_cycle_count = 0;
+    soft_timer_stop(this->timer_id);
 
     this->period_in_ms = 1000 / freq_in_hz; //ms
-    if (this->period_in_ms < (2 * timer_period)) {
+    if (this->period_in_ms < (2 * soft_timer_ns::tick_period)) {
         return;
     }
     this->is_blink = true;
-    assign_bulb();
+    soft_timer_start(this->timer_id, this->period_in_ms / 2, true);
 }
 
 void level_bulb_instance::blink_processing(void)
 {
-    this->time_cycle_count++;
-    if (this->time_cycle_count == (period_in_ms / (2 * timer_period))) {
-        this->time_cycle_count = 0;
-        /* toggle */
-        if (is_on_in_blink) { //turn off
-            is_on_in_blink = false;
+    /* toggle */
+    if (is_on_in_blink) { //turn off
+        is_on_in_blink = false;
+        if (active_level == 0) {
+            pwm_dev_duty_cycle_setup(100);
+        } else {
+            pwm_dev_duty_cycle_setup(0);
+        }
+    } else { //turn on
+        is_on_in_blink = true;
+        if (this->percent_intensity == 0) {
             if (active_level == 0) {
-                pwm_dev_duty_cycle_setup(100);
-            } else {
                 pwm_dev_duty_cycle_setup(0);
+            } else {
+                pwm_dev_duty_cycle_setup(100);
             }
-        } else { //turn on
-            is_on_in_blink = true;
-            if (this->percent_intensity == 0) {
-                if (active_level == 0) {
-                    pwm_dev_duty_cycle_setup(0);
-                } else {
-                    pwm_dev_duty_cycle_setup(100);
-                }
+        } else {
+            if (active_level == 0) {
+                pwm_dev_duty_cycle_setup(100 - this->percent_intensity);
             } else {
-                if (active_level == 0) {
-                    pwm_dev_duty_cycle_setup(100 - this->percent_intensity);
-                } else {
-                    pwm_dev_duty_cycle_setup(this->percent_intensity);
-                }
+                pwm_dev_duty_cycle_setup(this->percent_intensity);
             }
         }
     }
@@ -158,6 +145,11 @@ bool level_bulb_instance::bulb_is_blink(void)
     return this->is_blink;
 }
 
+bool level_bulb_instance::has_timer(void)
+{
+    return this->timer_id >= 0;
+}
+
 uint16_t level_bulb_instance::get_level_intensity(void)
 {
     return this->level_intensity;
@@ -168,38 +160,7 @@ uint8_t level_bulb_instance::get_percent_intensity(void)
     return this->percent_intensity;
 }
 
-void level_bulb_instance::assign_bulb(void)
+static void bulb_blink_timer_callback(void *arg)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (table_bulb[i] == NULL) {
-            table_bulb[i] = this;
-            return;
-        }
-    }
-}
-
-void level_bulb_instance::remove_bulb(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (table_bulb[i] == this) {
-            table_bulb[i] = NULL;
-            return;
-        }
-    }
-}
-
-static void bulb_table_init(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        table_bulb[i] = NULL;
-    }
-}
-
-void bulb_blink_callback_timer_isr(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (table_bulb[i] != NULL) {
-            table_bulb[i]->blink_processing();
-        }
-    }
+    ((level_bulb_instance*) arg)->blink_processing();
 }
@@ -6,33 +6,25 @@
  * @brief This is source file for on-off bulb device instance for HA system.
  */
 #include "on_off_output_driver.h"
-#include "ha_host_glb.h"
 
 using namespace on_off_dev_ns;
 
-static const uint8_t timer_period = 1; //ms
-
-static on_off_output_instance* dev_table[ha_host_ns::max_end_point];
-
-bool table_init = false;
-static void dev_table_init(void);
+/**
+ * @brief Blink timer callback of an output.
+ */
+static void on_off_blink_timer_callback(void *arg);
 
 on_off_output_instance::on_off_output_instance(void) :
         gpio_dev_class(false)
 {
     this->active_level = 0;
     this->dev_status = on_off_dev_ns::dev_off;
-    if (!table_init) {
-        table_init = true;
-        dev_table_init();
-    }
+    this->timer_id = soft_timer_create(&on_off_blink_timer_callback, this);
 }
 
 on_off_output_instance::~on_off_output_instance(void)
 {
-    if (this->dev_status == on_off_dev_ns::dev_blink) {
-        remove_dev();
-    }
+    soft_timer_delete(this->timer_id);
 }
 
 void on_off_output_instance::device_configure(
@@ -51,7 +43,7 @@ void on_off_output_instance::set_active_level(uint8_t active_level)
 void on_off_output_instance::dev_turn_on(void)
 {
     if (this->dev_status == on_off_dev_ns::dev_blink) {
-        remove_dev();
+        soft_timer_stop(this->timer_id);
     }
     this->dev_status = on_off_dev_ns::dev_on;
     (active_level == 0) ? gpio_dev_off() : gpio_dev_on();
@@ -60,7 +52,7 @@ void on_off_output_instance::dev_turn_on(void)
 void on_off_output_instance::dev_turn_off(void)
 {
     if (this->dev_status == on_off_dev_ns::dev_blink) {
-        remove_dev();
+        soft_timer_stop(this->timer_id);
     }
     this->dev_status = on_off_dev_ns::dev_off;
     (active_level == 0) ? gpio_dev_on() : gpio_dev_off();
@@ -69,7 +61,7 @@ void on_off_output_instance::dev_turn_off(void)
 void on_off_output_instance::dev_toggle(void)
 {
     if (this->dev_status == on_off_dev_ns::dev_blink) {
-        remove_dev();
+        soft_timer_stop(this->timer_id);
     }
     if (this->dev_status == on_off_dev_ns::dev_on) {
         dev_turn_off();
@@ -80,29 +72,24 @@ void on_off_output_instance::dev_toggle(void)
 
 void on_off_output_instance::dev_blink(uint8_t freq_in_hz)
 {
-    remove_dev();
-    this->time_cycle_count = 0;
+    soft_timer_stop(this->timer_id);
     this->period_in_ms = 1000 / freq_in_hz; //ms
-    if (this->period_in_ms < (2 * timer_period)) { //can't blink with freq running faster than timer freq 2 times.
+    if (this->period_in_ms < (2 * soft_timer_ns::tick_period)) { //can't blink with freq running faster than timer freq 2 times.
         return;
     }
     this->dev_status = on_off_dev_ns::dev_blink;
-    assign_dev();
+    soft_timer_start(this->timer_id, this->period_in_ms / 2, true);
 }
 
 void on_off_output_instance::blink_processing(void)
 {
-    this->time_cycle_count++;
-    if (this->time_cycle_count == (this->period_in_ms / (2 * timer_period))) {
-        this->time_cycle_count = 0;
-        /* toggle */
-        if (this->is_on_in_blink) { //dev was turned on. -> turn off
-            this->is_on_in_blink = false;
-            (active_level == 0) ? gpio_dev_on() : gpio_dev_off();
-        } else {
-            this->is_on_in_blink = true;
-            (active_level == 0) ? gpio_dev_off() : gpio_dev_on();
-        }
+    /* toggle */
+    if (this->is_on_in_blink) { //dev was turned on. -> turn off
+        this->is_on_in_blink = false;
+        (active_level == 0) ? gpio_dev_on() : gpio_dev_off();
+    } else {
+        this->is_on_in_blink = true;
+        (active_level == 0) ? gpio_dev_off() : gpio_dev_on();
     }
 }
 
@@ -111,38 +98,12 @@ on_off_dev_status_t on_off_output_instance::dev_get_state(void)
     return this->dev_status;
 }
 
-void on_off_output_instance::assign_dev(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (dev_table[i] == NULL) {
-            dev_table[i] = this;
-            return;
-        }
-    }
-}
-
-void on_off_output_instance::remove_dev(void)
+bool on_off_output_instance::has_timer(void)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (dev_table[i] == this) {
-            dev_table[i] = NULL;
-            return;
-        }
-    }
+    return this->timer_id >= 0;
 }
 
-static void dev_table_init(void)
+static void on_off_blink_timer_callback(void *arg)
 {
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        dev_table[i] = NULL;
-    }
-}
-
-void on_off_blink_callback_timer_isr(void)
-{
-    for (uint8_t i = 0; i < ha_host_ns::max_end_point; i++) {
-        if (dev_table[i] != NULL) {
-            dev_table[i]->blink_processing();
-        }
-    }
+    ((on_off_output_instance*) arg)->blink_processing();
 }
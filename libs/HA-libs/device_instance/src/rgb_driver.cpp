@@ -152,3 +152,8 @@ uint32_t rgb_instance::get_current_color(void)
 {
     return this->current_color;
 }
+
+bool rgb_instance::has_timer(void)
+{
+    return red_bulb.has_timer() && green_bulb.has_timer() && blue_bulb.has_timer();
+}
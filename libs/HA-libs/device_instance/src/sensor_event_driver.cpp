@@ -16,9 +16,6 @@ sensor_event_instance::sensor_event_instance(void) :
 {
     /* activate in high level, default */
     this->detective_level = 1;
-#if SND_MSG
-    this->thread_pid = thread_getpid();
-#endif //SND_MSG
 }
 
 sensor_event_instance::~sensor_event_instance(void)
@@ -50,9 +47,17 @@ bool sensor_event_instance::is_detected(void)
 }
 
 #if SND_MSG
-kernel_pid_t sensor_event_instance::get_pid(void)
+void sensor_event_instance::set_notify(dev_notify_t notify, void *notify_arg)
+{
+    this->notify = notify;
+    this->notify_arg = notify_arg;
+}
+
+void sensor_event_instance::notify_owner(uint32_t value)
 {
-    return this->thread_pid;
+    if (this->notify != NULL) {
+        this->notify(this->notify_arg, value);
+    }
 }
 #endif //SND_MSG
 
@@ -61,19 +66,10 @@ static void sensor_callback(void *arg)
     sensor_event_instance * sensor = (sensor_event_instance*) arg;
 
 #if SND_MSG
-    msg_t msg;
-    msg.type = SEN_EVT_MSG;
     if (sensor->is_detected()) {
-        msg.content.value = sensor_event_ns::high_level;
+        sensor->notify_owner(sensor_event_ns::high_level);
     } else {
-        msg.content.value = sensor_event_ns::low_level;
-    }
-
-    /* check valid pid and send msg */
-    kernel_pid_t pid = sensor->get_pid();
-    if (pid == KERNEL_PID_UNDEF) {
-        return;
+        sensor->notify_owner(sensor_event_ns::low_level);
     }
-    msg_send(&msg, pid, false);
 #endif //SND_MSG
 }
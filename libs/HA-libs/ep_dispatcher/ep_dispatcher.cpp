@@ -0,0 +1,128 @@
+/**
+ * @file ep_dispatcher.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief This is source file for event dispatcher of end points.
+ */
+extern "C" {
+#include "thread.h"
+#include "msg.h"
+#include "irq.h"
+}
+
+#include <stddef.h>
+#include "ep_dispatcher.h"
+
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace ep_dispatcher_ns;
+
+static const char ep_dispatcher_prio = PRIORITY_MAIN - 1;
+static const uint16_t ep_dispatcher_stacksize = 1550; //config files are read in handlers.
+static char ep_dispatcher_stack[ep_dispatcher_stacksize];
+
+static const char ep_dispatcher_msgqueue_size = 2;
+static msg_t ep_dispatcher_msgqueue[ep_dispatcher_msgqueue_size];
+
+static const uint16_t events_pending_msg = 0xFFFF;
+
+/* event queue, producers are threads and interrupts, consumer is dispatcher thread */
+static ep_event_t events[max_events];
+static volatile uint8_t event_head = 0; //next free event.
+static volatile uint8_t event_tail = 0; //oldest event.
+static volatile uint32_t dropped_events = 0;
+
+static kernel_pid_t ep_dispatcher_pid = KERNEL_PID_UNDEF;
+static event_handler_t event_handler = NULL;
+
+static void *ep_dispatcher_func(void *arg);
+
+void ep_dispatcher_start(event_handler_t handler)
+{
+    event_handler = handler;
+
+    ep_dispatcher_pid = thread_create(ep_dispatcher_stack,
+            ep_dispatcher_stacksize, ep_dispatcher_prio, CREATE_STACKTEST,
+            ep_dispatcher_func, NULL, "ep_dispatcher");
+    if (ep_dispatcher_pid > 0) {
+        HA_NOTIFY("EP dispatcher thread created.\n");
+    } else {
+        HA_NOTIFY("Can't create EP dispatcher thread.\n");
+    }
+}
+
+int8_t ep_dispatcher_post(uint8_t ep_id, uint16_t type, uint32_t value)
+{
+    unsigned irq_state;
+    uint8_t head;
+    msg_t msg;
+
+    irq_state = disableIRQ();
+    head = event_head;
+    if ((uint8_t) (head - event_tail) >= max_events) {
+        dropped_events = dropped_events + 1;
+        restoreIRQ(irq_state);
+        return -1;
+    }
+    events[head % max_events].type = type;
+    events[head % max_events].ep_id = ep_id;
+    events[head % max_events].value = value;
+    event_head = head + 1;
+    restoreIRQ(irq_state);
+
+    /* wake dispatcher up, message is dropped if its queue is full (already woken) */
+    if (ep_dispatcher_pid != KERNEL_PID_UNDEF) {
+        msg.type = events_pending_msg;
+        msg_send(&msg, ep_dispatcher_pid, false);
+    }
+
+    return 0;
+}
+
+uint16_t ep_dispatcher_run(void)
+{
+    ep_event_t event;
+    uint16_t count = 0;
+
+    if (event_handler == NULL) {
+        return 0;
+    }
+
+    /* only dispatcher takes events, producers only move event_head */
+    while (event_tail != event_head) {
+        event = events[event_tail % max_events];
+        event_tail = event_tail + 1;
+
+        event_handler(event.ep_id, event.type, event.value);
+        count++;
+    }
+
+    return count;
+}
+
+uint32_t ep_dispatcher_get_dropped(void)
+{
+    return dropped_events;
+}
+
+static void *ep_dispatcher_func(void *arg)
+{
+    msg_t msg;
+
+    msg_init_queue(ep_dispatcher_msgqueue, ep_dispatcher_msgqueue_size);
+
+    /* events posted before dispatcher is started */
+    ep_dispatcher_run();
+
+    while (1) {
+        msg_receive(&msg);
+        if (msg.type == events_pending_msg) {
+            ep_dispatcher_run();
+        }
+    }
+
+    return NULL;
+}
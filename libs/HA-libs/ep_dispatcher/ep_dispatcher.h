@@ -0,0 +1,65 @@
+/**
+ * @file ep_dispatcher.h
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Event dispatcher of end points (EPs).
+ * All EPs of a node are run by one thread. Events to an EP (new device, send alive,
+ * SET_DEV_VAL, new value of device...) are put into a typed event queue, with the EP id,
+ * by threads or interrupts. The dispatcher thread takes events in order and calls the
+ * event handler, which runs the device of the EP and returns (no infinite loop, no
+ * thread and stack for each EP).
+ */
+#ifndef __HA_EP_DISPATCHER_H_
+#define __HA_EP_DISPATCHER_H_
+
+#include <stdint.h>
+
+namespace ep_dispatcher_ns {
+const uint8_t max_events = 64; //power of 2.
+const uint8_t all_end_points = 0xFF; //EP id of events to every EP.
+
+typedef struct ep_event_s {
+    uint16_t type;
+    uint8_t ep_id;
+    uint32_t value;
+} ep_event_t;
+
+/**
+ * @brief Handler of events, called by dispatcher thread.
+ */
+typedef void (*event_handler_t)(uint8_t ep_id, uint16_t type, uint32_t value);
+}
+
+/**
+ * @brief Create and start dispatcher thread.
+ *
+ * @param[in] handler Handler of events.
+ */
+void ep_dispatcher_start(ep_dispatcher_ns::event_handler_t handler);
+
+/**
+ * @brief Put an event into the queue and wake dispatcher up, called by threads or interrupts.
+ *
+ * @param[in] ep_id EP id, all_end_points for every EP.
+ * @param[in] type Event type.
+ * @param[in] value Event value.
+ *
+ * @return -1 if queue is full (event is dropped), otherwise 0.
+ */
+int8_t ep_dispatcher_post(uint8_t ep_id, uint16_t type, uint32_t value);
+
+/**
+ * @brief Handle all events in the queue, called by dispatcher thread (or directly when
+ * there is no dispatcher thread, e.g. in tests).
+ *
+ * @return number of handled events.
+ */
+uint16_t ep_dispatcher_run(void);
+
+/**
+ * @brief Get number of events dropped because queue was full.
+ */
+uint32_t ep_dispatcher_get_dropped(void);
+
+#endif //__HA_EP_DISPATCHER_H_
@@ -54,6 +54,7 @@ const shell_command_t shell_commands[] = {
     {"servo", "Configure servo device", servo_config},
     {"rgb", "Configure RGB-led device", rgb_led_config},
     {"senadc", "Configure ADC linear sensor device", adc_sensor_config},
+    {"group", "Configure groups of end points", group_config},
 #endif
 
 #ifdef HA_CC
@@ -30,6 +30,10 @@ uint16_t sixlowpan_node_id = 0;
 char sixlowpan_netdev_type = '0';
 }
 
+/* Node address cache */
+static ha_ns::slp_node_addr_t slp_node_cache[ha_ns::sixlowpan_node_cache_size];
+static uint32_t slp_node_cache_clock = 0;
+
 /*----------------------------------------------------------------------------*/
 int16_t ha_slp_readconfig(const char* path, const char* pattern, uint16_t pattern_size,
         uint16_t* prefixes_p, uint16_t &node_id, char &netdev_type, uint16_t &channel)
@@ -247,7 +251,71 @@ void ha_slp_start_on_reset(Button *btn_p, const char *btn_prompt)
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags, uint16_t index)
+void ha_slp_node_cache_update(uint16_t node_id, ipv6_addr_t *ipaddr_p)
+{
+    uint8_t count, pos;
+
+    if (node_id == 0) {
+        return;
+    }
+
+    /* find the node, otherwise least recently used (or empty) entry */
+    pos = 0;
+    for (count = 0; count < ha_ns::sixlowpan_node_cache_size; count++) {
+        if (slp_node_cache[count].node_id == node_id) {
+            pos = count;
+            break;
+        }
+
+        if (slp_node_cache[count].node_id == 0) {
+            if (slp_node_cache[pos].node_id != 0) {
+                pos = count;
+            }
+        }
+        else if (slp_node_cache[pos].node_id != 0
+                && slp_node_cache[count].last_used < slp_node_cache[pos].last_used) {
+            pos = count;
+        }
+    }
+
+    slp_node_cache[pos].node_id = node_id;
+    memcpy(&slp_node_cache[pos].ipaddr, ipaddr_p, sizeof(ipv6_addr_t));
+    slp_node_cache[pos].last_used = ++slp_node_cache_clock;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t ha_slp_node_cache_find(uint16_t node_id, ipv6_addr_t *ipaddr_p)
+{
+    uint8_t count;
+
+    if (node_id == 0) {
+        return -1;
+    }
+
+    for (count = 0; count < ha_ns::sixlowpan_node_cache_size; count++) {
+        if (slp_node_cache[count].node_id == node_id) {
+            memcpy(ipaddr_p, &slp_node_cache[count].ipaddr, sizeof(ipv6_addr_t));
+            slp_node_cache[count].last_used = ++slp_node_cache_clock;
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_slp_node_cache_clear(void)
+{
+    uint8_t count;
+
+    for (count = 0; count < ha_ns::sixlowpan_node_cache_size; count++) {
+        slp_node_cache[count].node_id = 0;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags, uint16_t index,
+        uint16_t from_node_id)
 {
     /* move data in payload */
     memmove(&payload[ha_ns::sixlowpan_header_len], payload, data_len);
@@ -256,15 +324,18 @@ void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags,
     payload[0] = data_len + ha_ns::sixlowpan_header_len;
     payload[1] = flags;
     uint162buf(index, &payload[2]);
+    uint162buf(from_node_id, &payload[4]);
 }
 
 /*----------------------------------------------------------------------------*/
-void ha_slp_parse_frame_header(uint8_t *frame, uint8_t &frame_len, uint8_t &flags, uint16_t &index)
+void ha_slp_parse_frame_header(uint8_t *frame, uint8_t &frame_len, uint8_t &flags, uint16_t &index,
+        uint16_t &from_node_id)
 {
     /* get header information */
     frame_len = frame[0];
     flags = frame[1];
     index = buf2uint16(&frame[2]);
+    from_node_id = buf2uint16(&frame[4]);
 
     /* remove header */
     memmove(frame, &frame[ha_ns::sixlowpan_header_len], frame_len - ha_ns::sixlowpan_header_len);
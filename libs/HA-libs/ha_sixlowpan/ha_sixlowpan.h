@@ -6,10 +6,19 @@
  * @brief This is header holds common function definitions for 6lowpan network
  * of home automation nodes and cc.
  *
- * Sixlowpan frame format with flow control: (for now, it will not be used)
- * | to node id (*) (2) | frame len (1) | flags (1) | index (2) | data |
- * (8) to node id: just a work around because without ND, we must send to multicast address.
- * flags: 0x00 if data, 0x01 if ack.
+ * Sixlowpan frame format with flow control:
+ * | to node id (*) (2) | frame len (1) | flags (1) | index (2) | from node id (2) | data |
+ * (*) to node id: just a work around because without ND, we must send to multicast address.
+ * flags: DATA (0x00) or ACK (0x01), SYN (0x02) is set on DATA frames until sender is
+ * acknowledged the first time (receiver will resynchronize its index with the sender).
+ * DATA: index is sequence number of the frame, data are GFF frames
+ *       | GFF frame | GFF frame | ... |, consecutive GFF frames to the same node are packed
+ *       in one datagram by the sender.
+ * ACK: index is the next sequence number receiver expects (all before it were received),
+ *      data is selective ack bitmap (2), bit i is set if index + 1 + i has been received.
+ * (see slp_reliable.h)
+ * Datagrams are sent to unicast address of a node if it's in node address cache
+ * (learnt from received datagrams), otherwise to all nodes multicast address.
  */
 
 #ifndef HA_SIXLOWPAN_H_
@@ -60,11 +69,23 @@ extern char sixlowpan_netdev_type;
 const uint16_t sixlowpan_payload_maxsize = 256;
 const uint16_t sixlowpan_receiving_port = 1001;
 
-/* Frame format (for now, it will not be used) */
-const uint8_t sixlowpan_header_len = 4;
+/* Node address cache (node id -> IPv6 address) */
+const uint8_t sixlowpan_node_cache_size = 32;
+
+typedef struct slp_node_addr_s {
+    uint16_t node_id;   /* 0 if this entry is empty */
+    ipv6_addr_t ipaddr;
+    uint32_t last_used;
+} slp_node_addr_t;
+
+/* Frame format */
+const uint8_t sixlowpan_header_len = 6;
+const uint8_t sixlowpan_sack_len = 2;
 enum sixlowpan_header_flags_e {
     DATA = 0,
     ACK = 1,
+    SYN = 2,
+    GROUP = 4,  /* to a group address (link-local multicast), not sequenced or acknowledged */
 };
 
 }
@@ -118,6 +139,32 @@ int16_t ha_slp_init(uint8_t interface, transceiver_type_t transceiver,
  */
 void ha_slp_start_on_reset(Button *btn_p, const char *btn_prompt);
 
+/**
+ * @brief   Add or refresh address of a node in node address cache.
+ *          Least recently used entry will be replaced if the cache is full.
+ *          NOTE: called by receiver thread, read by sender thread (same priority,
+ *          they don't preempt each other).
+ *
+ * @param[in]   node_id, node id (> 0).
+ * @param[in]   ipaddr_p, pointer to IPv6 address of the node.
+ */
+void ha_slp_node_cache_update(uint16_t node_id, ipv6_addr_t *ipaddr_p);
+
+/**
+ * @brief   Find address of a node in node address cache.
+ *
+ * @param[in]   node_id, node id.
+ * @param[out]  ipaddr_p, pointer to IPv6 address will be filled.
+ *
+ * @return      -1 if node is not in the cache.
+ */
+int16_t ha_slp_node_cache_find(uint16_t node_id, ipv6_addr_t *ipaddr_p);
+
+/**
+ * @brief   Remove all nodes from node address cache.
+ */
+void ha_slp_node_cache_clear(void);
+
 /**
  * @brief   Insert frame header to payload. Data in payload will move forward sixlowpan_header_len
  *          bytes to give the spaces for header.
@@ -125,10 +172,12 @@ void ha_slp_start_on_reset(Button *btn_p, const char *btn_prompt);
  * @param[in/out]   payload, buffer holding data payload. This is also used as a workspace
  *                  for frame.
  * @param[in]       data_len, len of the data in payload. Frame len = data_len + sixlowpan_header_len
- * @param[in]       flags, ACK or DATA.
+ * @param[in]       flags, ACK, DATA (| SYN) or GROUP.
  * @param[in]       index, frame index.
+ * @param[in]       from_node_id, node id of the sender.
  */
-void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags, uint16_t index);
+void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags, uint16_t index,
+        uint16_t from_node_id);
 
 /**
  * @brief   Remove frame header and retrieve payload. Data in payload will move backward
@@ -137,9 +186,11 @@ void ha_slp_add_frame_header(uint8_t *payload, uint8_t data_len, uint8_t flags,
  * @param[in/out]   frame, buffer holding frame. This is also used as a workspace
  *                  for payload.
  * @param[out]      frame_len, len of the frame. Data len = data_len - sixlowpan_header_len
- * @param[out]      flags, ACK or DATA.
+ * @param[out]      flags, ACK, DATA (| SYN) or GROUP.
  * @param[out]      index, frame index.
+ * @param[out]      from_node_id, node id of the sender.
  */
-void ha_slp_parse_frame_header(uint8_t *frame, uint8_t &frame_len, uint8_t &flags, uint16_t &index);
+void ha_slp_parse_frame_header(uint8_t *frame, uint8_t &frame_len, uint8_t &flags, uint16_t &index,
+        uint16_t &from_node_id);
 
 #endif /* HA_SIXLOWPAN_H_ */
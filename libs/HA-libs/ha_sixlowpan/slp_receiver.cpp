@@ -14,8 +14,10 @@ extern "C" {
 
 #include "ha_sixlowpan.h"
 #include "ha_gff_misc.h"
+#include "gff_mesg_id.h"
 
 #include "slp_receiver.h"
+#include "slp_reliable.h"
 
 /*--------------------- Global variable --------------------------------------*/
 namespace ha_ns {
@@ -58,6 +60,7 @@ void slp_receiver_start(void)
 /* Prototypes */
 static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t &recsize);
 static void start_receiver_loop(void);
+static void handle_gff_frames(uint8_t *gff_frames, uint16_t len);
 
 /**
  * @brief   6lowpan receiver thread's function.
@@ -95,8 +98,12 @@ static void start_receiver_loop(void)
     sockaddr6_t server_addr, from_addr;
     int32_t recsize;
     uint8_t payload_buffer[ha_ns::sixlowpan_payload_maxsize];
+    uint8_t ack_buffer[slp_rel_ns::ack_datagram_len];
     uint32_t from_len;
     uint16_t count;
+    uint8_t frame_len, flags;
+    uint16_t index, from_node_id;
+    msg_t mesg;
 #if HA_DEBUG_EN
     char addr_str[IPV6_MAX_ADDR_STR_LEN];
 #endif
@@ -132,8 +139,46 @@ static void start_receiver_loop(void)
             }
             HA_DEBUG("\n");
 
-            /* processing GFF message */
-            slp_received_GFF_handler(payload_buffer);
+            if (recsize < ha_ns::sixlowpan_header_len
+                    || payload_buffer[0] < ha_ns::sixlowpan_header_len
+                    || payload_buffer[0] > recsize) {
+                HA_DEBUG("start_receiver: invalid frame\n");
+                continue;
+            }
+
+            ha_slp_parse_frame_header(payload_buffer, frame_len, flags, index, from_node_id);
+            frame_len -= ha_ns::sixlowpan_header_len;
+
+            /* it's the shortest way back to the sender */
+            ha_slp_node_cache_update(from_node_id, &from_addr.sin6_addr);
+
+            /* group commands are not sequenced nor acknowledged */
+            if (flags & ha_ns::GROUP) {
+                if (from_node_id != ha_ns::sixlowpan_node_id) {
+                    handle_gff_frames(payload_buffer, frame_len);
+                }
+                continue;
+            }
+
+            if (flags & ha_ns::ACK) {
+                if (frame_len >= ha_ns::sixlowpan_sack_len
+                        && slp_rel_handle_ack(from_node_id, index, buf2uint16(payload_buffer)) > 0) {
+                    /* window has been opened, sender can continue */
+                    mesg.type = ha_ns::SIXLOWPAN_ACKED;
+                    msg_send(&mesg, ha_ns::sixlowpan_sender_pid, false);
+                }
+                continue;
+            }
+
+            if (slp_rel_handle_data(from_node_id, flags, index, payload_buffer, frame_len,
+                    handle_gff_frames, ack_buffer) < 0) {
+                continue;
+            }
+
+            /* ACK directly to the sender */
+            from_addr.sin6_port = HTONS(ha_ns::sixlowpan_receiving_port);
+            socket_base_sendto(sock, ack_buffer, slp_rel_ns::ack_datagram_len, 0,
+                    &from_addr, sizeof(from_addr));
         }
     }
 
@@ -148,6 +193,9 @@ static void start_receiver_loop(void)
  * @param[in/out]   payload_buffer,
  * @param[in/out]   recsize, received size before/after filtering.
  *
+ *          Message to a group address (see device_id.h) is accepted if the group matches
+ *          zone of this node.
+ *
  * @return  -1 if message is not for this node (recsize will be set to 0), 0 is successful.
  */
 static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t &recsize)
@@ -157,7 +205,8 @@ static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t
     /* get node_id */
     recv_node_id = buf2uint16(payload_buffer);
 
-    if (recv_node_id != node_id) {
+    if (recv_node_id != node_id
+            && !(is_group_nodeid(recv_node_id) && match_group_nodeid(recv_node_id, node_id))) {
         HA_DEBUG("filter_node_id: This message is not mine (my node_id %u, recv_node_id %u).\n",
                 node_id, recv_node_id);
         recsize = -1;
@@ -169,3 +218,28 @@ static int16_t filter_node_id(uint16_t node_id, uint8_t* payload_buffer, int32_t
 
     return 0;
 }
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Handle GFF frames of a datagram in order, a datagram can hold more than one GFF frame.
+ *
+ * @param[in]   gff_frames, buffer holding GFF frames.
+ * @param[in]   len, len of GFF frames.
+ */
+static void handle_gff_frames(uint8_t *gff_frames, uint16_t len)
+{
+    uint16_t frame_pos, frame_size;
+
+    frame_pos = 0;
+    while (frame_pos + ha_ns::GFF_DATA_POS <= len) {
+        frame_size = gff_frames[frame_pos + ha_ns::GFF_LEN_POS]
+                + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE;
+        if (frame_pos + frame_size > len) {
+            HA_DEBUG("handle_gff_frames: truncated GFF frame at %hu\n", frame_pos);
+            break;
+        }
+
+        slp_received_GFF_handler(&gff_frames[frame_pos]);
+        frame_pos += frame_size;
+    }
+}
@@ -0,0 +1,537 @@
+/**
+ * @file slp_reliable.cpp
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief This is source file for reliable delivery of 6lowpan datagrams between nodes.
+ */
+
+#include <string.h>
+
+extern "C" {
+#include "vtimer.h"
+#include "mutex.h"
+}
+
+#include "ha_sixlowpan.h"
+#include "ha_gff_misc.h"
+
+#include "slp_reliable.h"
+
+/*--------------------- Configurations ---------------------------------------*/
+#define HA_NOTIFICATION (1)
+#define HA_DEBUG_EN (0)
+#include "ha_debug.h"
+
+using namespace slp_rel_ns;
+
+static mutex_t slp_rel_mutex = MUTEX_INIT;
+
+static uint16_t slp_rel_my_node_id = 0;
+static peer_t slp_rel_peers[max_peers];
+static tx_slot_t slp_rel_tx_slots[tx_slots];
+static rx_slot_t slp_rel_rx_slots[rx_slots];
+static uint32_t slp_rel_clock = 0;
+
+/* Prototypes */
+static uint32_t now_ms(void);
+static peer_t *find_peer(uint16_t node_id, bool add);
+static void reset_peer_tx(peer_t *peer);
+static void update_rto(peer_t *peer, uint32_t rtt_ms);
+static uint16_t get_tx_span(peer_t *peer);
+static tx_slot_t *find_free_tx_slot(void);
+static rx_slot_t *find_rx_slot(uint16_t node_id, uint16_t seq);
+
+/*--------------------- Public functions -------------------------------------*/
+void slp_rel_init(uint16_t my_node_id)
+{
+    uint8_t count;
+
+    mutex_lock(&slp_rel_mutex);
+
+    slp_rel_my_node_id = my_node_id;
+
+    memset(slp_rel_peers, 0, sizeof(slp_rel_peers));
+    for (count = 0; count < tx_slots; count++) {
+        slp_rel_tx_slots[count].in_use = false;
+    }
+    for (count = 0; count < rx_slots; count++) {
+        slp_rel_rx_slots[count].in_use = false;
+    }
+
+    mutex_unlock(&slp_rel_mutex);
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_can_send(uint16_t node_id)
+{
+    peer_t *peer;
+    int16_t retval = 0;
+
+    mutex_lock(&slp_rel_mutex);
+
+    /* window is counted from the oldest unacknowledged datagram so receiver
+     * will never have to buffer more than tx_window - 1 datagrams */
+    peer = find_peer(node_id, true);
+    if (peer != NULL
+            && get_tx_span(peer) < (peer->tx_synced ? tx_window : 1)
+            && find_free_tx_slot() != NULL) {
+        retval = 1;
+    }
+
+    mutex_unlock(&slp_rel_mutex);
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_add_datagram(uint16_t node_id, uint8_t *gff_frames, uint16_t len,
+        uint8_t **datagram_pp, uint16_t &datagram_len)
+{
+    peer_t *peer;
+    tx_slot_t *slot;
+
+    if (len > max_gff_data_len) {
+        return -1;
+    }
+
+    mutex_lock(&slp_rel_mutex);
+
+    peer = find_peer(node_id, true);
+    slot = find_free_tx_slot();
+    if (peer == NULL || slot == NULL) {
+        mutex_unlock(&slp_rel_mutex);
+        return -1;
+    }
+
+    /* | to node id | header | GFF frames | */
+    uint162buf(node_id, slot->buf);
+    memcpy(&slot->buf[2], gff_frames, len);
+    ha_slp_add_frame_header(&slot->buf[2], len,
+            peer->tx_synced ? ha_ns::DATA : ha_ns::SYN, peer->tx_next_seq, slp_rel_my_node_id);
+
+    slot->in_use = true;
+    slot->node_id = node_id;
+    slot->seq = peer->tx_next_seq;
+    slot->retries = 0;
+    slot->sent_ms = now_ms();
+    slot->deadline_ms = slot->sent_ms + peer->rto_ms;
+    slot->len = 2 + ha_ns::sixlowpan_header_len + len;
+
+    peer->tx_next_seq++;
+    peer->tx_in_flight++;
+
+    *datagram_pp = slot->buf;
+    datagram_len = slot->len;
+
+    mutex_unlock(&slp_rel_mutex);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_get_retransmission(uint8_t **datagram_pp, uint16_t &datagram_len,
+        uint16_t &node_id)
+{
+    tx_slot_t *slot;
+    peer_t *peer;
+    uint32_t now = now_ms();
+    uint32_t rto;
+    uint8_t count;
+
+    mutex_lock(&slp_rel_mutex);
+
+    for (count = 0; count < tx_slots; count++) {
+        slot = &slp_rel_tx_slots[count];
+        if (!slot->in_use || (int32_t)(now - slot->deadline_ms) < 0) {
+            continue;
+        }
+
+        peer = find_peer(slot->node_id, false);
+        if (peer == NULL) {
+            slot->in_use = false;
+            continue;
+        }
+
+        if (slot->retries >= max_retries) {
+            HA_NOTIFY("slp_rel: node %hu doesn't respond, %hu datagrams dropped\n",
+                    slot->node_id, peer->tx_in_flight);
+            reset_peer_tx(peer);
+            continue;
+        }
+
+        /* exponential backoff */
+        slot->retries++;
+        rto = peer->rto_ms << slot->retries;
+        slot->deadline_ms = now + ((rto > rto_max_ms) ? rto_max_ms : rto);
+
+        HA_DEBUG("slp_rel: retransmit %hu to %hu (%hu), rto %lu\n",
+                slot->seq, slot->node_id, slot->retries, rto);
+
+        *datagram_pp = slot->buf;
+        datagram_len = slot->len;
+        node_id = slot->node_id;
+
+        mutex_unlock(&slp_rel_mutex);
+        return 1;
+    }
+
+    mutex_unlock(&slp_rel_mutex);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_get_next_timeout(uint32_t &timeout_ms)
+{
+    uint32_t now = now_ms();
+    int32_t remaining, min_remaining = -1;
+    uint8_t count;
+
+    mutex_lock(&slp_rel_mutex);
+
+    for (count = 0; count < tx_slots; count++) {
+        if (!slp_rel_tx_slots[count].in_use) {
+            continue;
+        }
+
+        remaining = (int32_t)(slp_rel_tx_slots[count].deadline_ms - now);
+        if (remaining < 0) {
+            remaining = 0;
+        }
+        if (min_remaining < 0 || remaining < min_remaining) {
+            min_remaining = remaining;
+        }
+    }
+
+    mutex_unlock(&slp_rel_mutex);
+
+    if (min_remaining < 0) {
+        return -1;
+    }
+
+    timeout_ms = min_remaining;
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_handle_ack(uint16_t from_node_id, uint16_t next_seq, uint16_t sack)
+{
+    tx_slot_t *slot;
+    peer_t *peer;
+    uint32_t now = now_ms();
+    int16_t diff, acked = 0;
+    uint8_t count;
+
+    mutex_lock(&slp_rel_mutex);
+
+    peer = find_peer(from_node_id, false);
+    if (peer == NULL) {
+        mutex_unlock(&slp_rel_mutex);
+        return 0;
+    }
+
+    for (count = 0; count < tx_slots; count++) {
+        slot = &slp_rel_tx_slots[count];
+        if (!slot->in_use || slot->node_id != from_node_id) {
+            continue;
+        }
+
+        /* seq < next_seq: received in order, next_seq < seq: check sack bitmap */
+        diff = (int16_t)(slot->seq - next_seq);
+        if (diff < 0 || (diff > 0 && diff <= rx_window && (sack & (1 << (diff - 1))))) {
+            /* Karn's algorithm: no RTT sample from retransmitted datagrams */
+            if (slot->retries == 0) {
+                update_rto(peer, now - slot->sent_ms);
+            }
+
+            slot->in_use = false;
+            peer->tx_in_flight--;
+            acked++;
+        }
+    }
+
+    /* receiver has synchronized with our sequence */
+    if (acked > 0) {
+        peer->tx_synced = true;
+    }
+
+    mutex_unlock(&slp_rel_mutex);
+
+    return acked;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t slp_rel_handle_data(uint16_t from_node_id, uint8_t flags, uint16_t seq,
+        uint8_t *gff_frames, uint16_t len, deliver_func_t deliver_func,
+        uint8_t *ack_buf)
+{
+    peer_t *peer;
+    rx_slot_t *slot;
+    int16_t diff;
+    uint16_t sack;
+    uint8_t count;
+
+    if (len > max_gff_data_len) {
+        return -1;
+    }
+
+    mutex_lock(&slp_rel_mutex);
+
+    peer = find_peer(from_node_id, true);
+    if (peer == NULL) {
+        mutex_unlock(&slp_rel_mutex);
+        return -1;
+    }
+
+    /*
+     * (re)synchronize, a SYN frame is always the first unacknowledged one of sender
+     * (sender has only one frame in flight until SYN is acked), so any SYN starts a new
+     * sequence except a retransmission of the SYN which started current one.
+     */
+    diff = (int16_t)(seq - peer->rx_next_seq);
+    if (!peer->rx_valid
+            || ((flags & ha_ns::SYN) && diff != 0 && seq != peer->rx_syn_seq)) {
+        HA_DEBUG("slp_rel: synchronize with %hu at %hu\n", from_node_id, seq);
+        for (count = 0; count < rx_slots; count++) {
+            if (slp_rel_rx_slots[count].node_id == from_node_id) {
+                slp_rel_rx_slots[count].in_use = false;
+            }
+        }
+        peer->rx_valid = true;
+        peer->rx_next_seq = seq;
+        peer->rx_syn_seq = seq;
+        diff = 0;
+    }
+
+    if (diff == 0) {
+        deliver_func(gff_frames, len);
+        peer->rx_next_seq++;
+
+        /* deliver buffered frames which are now in order */
+        while ((slot = find_rx_slot(from_node_id, peer->rx_next_seq)) != NULL) {
+            deliver_func(slot->buf, slot->len);
+            slot->in_use = false;
+            peer->rx_next_seq++;
+        }
+    }
+    else if (diff > 0 && diff <= rx_window) {
+        /* out of order, buffer it if there is space */
+        if (find_rx_slot(from_node_id, seq) == NULL) {
+            for (count = 0; count < rx_slots; count++) {
+                slot = &slp_rel_rx_slots[count];
+                if (!slot->in_use) {
+                    slot->in_use = true;
+                    slot->node_id = from_node_id;
+                    slot->seq = seq;
+                    slot->len = len;
+                    memcpy(slot->buf, gff_frames, len);
+                    break;
+                }
+            }
+            HA_DEBUG("slp_rel: %hu from %hu out of order (%s)\n", seq, from_node_id,
+                    count < rx_slots ? "buffered" : "dropped");
+        }
+    }
+    else if (diff > 0) {
+        /* beyond window, drop it */
+        mutex_unlock(&slp_rel_mutex);
+        return -1;
+    }
+    /* diff < 0: duplicated, ack again */
+
+    /* ACK: | to node id | header | sack | */
+    sack = 0;
+    for (count = 0; count < rx_slots; count++) {
+        slot = &slp_rel_rx_slots[count];
+        if (slot->in_use && slot->node_id == from_node_id) {
+            diff = (int16_t)(slot->seq - peer->rx_next_seq);
+            if (diff > 0 && diff <= rx_window) {
+                sack |= 1 << (diff - 1);
+            }
+        }
+    }
+
+    uint162buf(from_node_id, ack_buf);
+    uint162buf(sack, &ack_buf[2]);
+    ha_slp_add_frame_header(&ack_buf[2], ha_ns::sixlowpan_sack_len, ha_ns::ACK,
+            peer->rx_next_seq, slp_rel_my_node_id);
+
+    mutex_unlock(&slp_rel_mutex);
+
+    return 0;
+}
+
+/*--------------------- Static functions -------------------------------------*/
+static uint32_t now_ms(void)
+{
+    timex_t now;
+
+    vtimer_now(&now);
+
+    return now.seconds * 1000 + now.microseconds / 1000;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Find a peer, a new peer will be added (replacing least recently used one
+ *          which has nothing in flight) if add is true.
+ */
+static peer_t *find_peer(uint16_t node_id, bool add)
+{
+    peer_t *peer = NULL;
+    uint8_t count, buffered;
+
+    if (node_id == 0) {
+        return NULL;
+    }
+
+    for (count = 0; count < max_peers; count++) {
+        if (slp_rel_peers[count].node_id == node_id) {
+            slp_rel_peers[count].last_used = ++slp_rel_clock;
+            return &slp_rel_peers[count];
+        }
+
+        if (!add || slp_rel_peers[count].tx_in_flight > 0) {
+            continue;
+        }
+
+        if (slp_rel_peers[count].node_id == 0) {
+            if (peer == NULL || peer->node_id != 0) {
+                peer = &slp_rel_peers[count];
+            }
+        }
+        else if (peer == NULL
+                || (peer->node_id != 0 && slp_rel_peers[count].last_used < peer->last_used)) {
+            peer = &slp_rel_peers[count];
+        }
+    }
+
+    if (peer == NULL) {
+        return NULL;
+    }
+
+    /* replace old peer, drop its buffered frames */
+    if (peer->node_id != 0) {
+        for (buffered = 0; buffered < rx_slots; buffered++) {
+            if (slp_rel_rx_slots[buffered].node_id == peer->node_id) {
+                slp_rel_rx_slots[buffered].in_use = false;
+            }
+        }
+    }
+
+    peer->node_id = node_id;
+    peer->last_used = ++slp_rel_clock;
+    peer->srtt = 0;
+    peer->rttvar = 0;
+    peer->rx_valid = false;
+    reset_peer_tx(peer);
+
+    return peer;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Drop all unacknowledged datagrams to a peer and start a new sequence.
+ */
+static void reset_peer_tx(peer_t *peer)
+{
+    timex_t now;
+    uint8_t count;
+
+    for (count = 0; count < tx_slots; count++) {
+        if (slp_rel_tx_slots[count].node_id == peer->node_id) {
+            slp_rel_tx_slots[count].in_use = false;
+        }
+    }
+
+    /* random initial index so receiver will notice the new sequence */
+    vtimer_now(&now);
+    peer->tx_next_seq = (uint16_t)(now.microseconds ^ (now.microseconds >> 16)
+            ^ (peer->node_id * 40503));
+    peer->tx_in_flight = 0;
+    peer->tx_synced = false;
+    peer->rto_ms = (peer->srtt == 0) ? rto_init_ms : peer->rto_ms;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Update RTO with a RTT sample (RFC 6298, alpha = 1/8, beta = 1/4).
+ */
+static void update_rto(peer_t *peer, uint32_t rtt_ms)
+{
+    int32_t delta;
+    uint32_t rto;
+
+    if (peer->srtt == 0) {
+        peer->srtt = (rtt_ms << 3) + 1;
+        peer->rttvar = rtt_ms << 1;
+    }
+    else {
+        delta = (int32_t)rtt_ms - (int32_t)(peer->srtt >> 3);
+        peer->srtt += delta;
+        if (delta < 0) {
+            delta = -delta;
+        }
+        peer->rttvar += delta - (int32_t)(peer->rttvar >> 2);
+    }
+
+    rto = (peer->srtt >> 3) + peer->rttvar;
+    if (rto < rto_min_ms) {
+        rto = rto_min_ms;
+    }
+    else if (rto > rto_max_ms) {
+        rto = rto_max_ms;
+    }
+    peer->rto_ms = rto;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Get number of sequence numbers from the oldest unacknowledged datagram
+ *          of a peer to the next one will be sent.
+ */
+static uint16_t get_tx_span(peer_t *peer)
+{
+    uint16_t span, max_span = 0;
+    uint8_t count;
+
+    for (count = 0; count < tx_slots; count++) {
+        if (slp_rel_tx_slots[count].in_use && slp_rel_tx_slots[count].node_id == peer->node_id) {
+            span = peer->tx_next_seq - slp_rel_tx_slots[count].seq;
+            if (span > max_span) {
+                max_span = span;
+            }
+        }
+    }
+
+    return max_span;
+}
+
+/*----------------------------------------------------------------------------*/
+static tx_slot_t *find_free_tx_slot(void)
+{
+    uint8_t count;
+
+    for (count = 0; count < tx_slots; count++) {
+        if (!slp_rel_tx_slots[count].in_use) {
+            return &slp_rel_tx_slots[count];
+        }
+    }
+
+    return NULL;
+}
+
+/*----------------------------------------------------------------------------*/
+static rx_slot_t *find_rx_slot(uint16_t node_id, uint16_t seq)
+{
+    uint8_t count;
+
+    for (count = 0; count < rx_slots; count++) {
+        if (slp_rel_rx_slots[count].in_use && slp_rel_rx_slots[count].node_id == node_id
+                && slp_rel_rx_slots[count].seq == seq) {
+            return &slp_rel_rx_slots[count];
+        }
+    }
+
+    return NULL;
+}
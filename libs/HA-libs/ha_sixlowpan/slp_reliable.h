@@ -0,0 +1,172 @@
+/**
+ * @file slp_reliable.h
+ * @author  Pham Huu Dang Nhat  <phamhuudangnhat@gmail.com>.
+ * @version 1.0
+ * @brief This is header file for reliable delivery of 6lowpan datagrams between nodes
+ * (frame format is in ha_sixlowpan.h).
+ *
+ * - Each node pair has its own sequence numbers. Sender starts with a random index and sets
+ *   SYN flag (with window of 1) until it's acknowledged so receiver can resynchronize after
+ *   either side has been restarted.
+ * - Receiver delivers datagrams in order, out-of-order datagrams (inside rx window) are
+ *   buffered and selectively acknowledged.
+ * - Sender keeps datagrams in a window of tx_window sequence numbers per node, retransmits
+ *   them after RTO which is calculated from measured RTT (RFC 6298, Karn's algorithm,
+ *   exponential backoff).
+ *   After max_retries, all outstanding datagrams to the node are dropped and sequence
+ *   is resynchronized.
+ *
+ * NOTE: sender side functions are called by sender thread, receiver side functions
+ * (slp_rel_handle_data, slp_rel_handle_ack) by receiver thread, states are protected
+ * by a mutex.
+ */
+
+#ifndef SLP_RELIABLE_H_
+#define SLP_RELIABLE_H_
+
+#include <stdint.h>
+
+#include "ha_sixlowpan.h"
+
+namespace slp_rel_ns {
+
+const uint8_t max_peers = 16;       /* nodes this node is talking to */
+const uint8_t tx_slots = 8;         /* unacknowledged datagrams (all nodes) */
+const uint8_t rx_slots = 6;         /* out-of-order datagrams (all nodes) */
+const uint8_t tx_window = 4;        /* datagrams from the oldest unacknowledged one per node */
+const uint8_t rx_window = 16;       /* bits of selective ack bitmap */
+
+const uint32_t rto_init_ms = 300;
+const uint32_t rto_min_ms = 40;
+const uint32_t rto_max_ms = 3000;
+const uint8_t max_retries = 6;
+
+const uint16_t max_gff_data_len = ha_ns::sixlowpan_payload_maxsize - 2
+        - ha_ns::sixlowpan_header_len;
+const uint16_t ack_datagram_len = 2 + ha_ns::sixlowpan_header_len + ha_ns::sixlowpan_sack_len;
+
+typedef struct peer_s {
+    uint16_t node_id;       /* 0 if this entry is empty */
+    uint32_t last_used;
+
+    /* sender */
+    uint16_t tx_next_seq;
+    uint8_t tx_in_flight;
+    bool tx_synced;
+    uint32_t srtt;          /* ms x 8 */
+    uint32_t rttvar;        /* ms x 4 */
+    uint32_t rto_ms;
+
+    /* receiver */
+    bool rx_valid;
+    uint16_t rx_next_seq;
+    uint16_t rx_syn_seq;    /* SYN which started current sequence */
+} peer_t;
+
+typedef struct tx_slot_s {
+    bool in_use;
+    uint16_t node_id;
+    uint16_t seq;
+    uint8_t retries;
+    uint32_t sent_ms;
+    uint32_t deadline_ms;
+    uint16_t len;
+    uint8_t buf[ha_ns::sixlowpan_payload_maxsize];  /* whole datagram */
+} tx_slot_t;
+
+typedef struct rx_slot_s {
+    bool in_use;
+    uint16_t node_id;
+    uint16_t seq;
+    uint16_t len;
+    uint8_t buf[max_gff_data_len];                  /* GFF frames */
+} rx_slot_t;
+
+typedef void (*deliver_func_t)(uint8_t *gff_frames, uint16_t len);
+}
+
+/**
+ * @brief   Clear all states (on 6LoWPAN stack (re)start).
+ *
+ * @param[in]   my_node_id, node id of this node.
+ */
+void slp_rel_init(uint16_t my_node_id);
+
+/*------------------------------ Sender side ---------------------------------*/
+/**
+ * @brief   Check if a new datagram can be sent to a node (window and tx slots).
+ *
+ * @param[in]   node_id,
+ *
+ * @return      1 if a datagram can be sent, 0 if not.
+ */
+int16_t slp_rel_can_send(uint16_t node_id);
+
+/**
+ * @brief   Put GFF frames in a new datagram to a node and keep it until it's acknowledged.
+ *          slp_rel_can_send() must have returned 1 for the node.
+ *
+ * @param[in]   node_id,
+ * @param[in]   gff_frames, buffer holding GFF frames.
+ * @param[in]   len, len of GFF frames (<= max_gff_data_len).
+ * @param[out]  datagram_pp, will point to the datagram need to be sent.
+ * @param[out]  datagram_len,
+ *
+ * @return      -1 if error.
+ */
+int16_t slp_rel_add_datagram(uint16_t node_id, uint8_t *gff_frames, uint16_t len,
+        uint8_t **datagram_pp, uint16_t &datagram_len);
+
+/**
+ * @brief   Get a datagram whose RTO has expired, it should be sent again.
+ *          Datagrams which have reached max_retries will be dropped.
+ *
+ * @param[out]  datagram_pp, will point to the datagram need to be sent.
+ * @param[out]  datagram_len,
+ * @param[out]  node_id,
+ *
+ * @return      1 if there is a datagram need to be sent, 0 if not.
+ */
+int16_t slp_rel_get_retransmission(uint8_t **datagram_pp, uint16_t &datagram_len,
+        uint16_t &node_id);
+
+/**
+ * @brief   Get time until the earliest retransmission.
+ *
+ * @param[out]  timeout_ms,
+ *
+ * @return      -1 if there is no unacknowledged datagram.
+ */
+int16_t slp_rel_get_next_timeout(uint32_t &timeout_ms);
+
+/*------------------------------ Receiver side -------------------------------*/
+/**
+ * @brief   Handle an ACK frame from a node.
+ *
+ * @param[in]   from_node_id,
+ * @param[in]   next_seq, index of the ACK frame.
+ * @param[in]   sack, selective ack bitmap.
+ *
+ * @return      number of datagrams have been acknowledged.
+ */
+int16_t slp_rel_handle_ack(uint16_t from_node_id, uint16_t next_seq, uint16_t sack);
+
+/**
+ * @brief   Handle a DATA frame from a node. GFF frames will be delivered in order
+ *          (possibly with buffered frames) by deliver_func.
+ *
+ * @param[in]   from_node_id,
+ * @param[in]   flags, flags of the frame.
+ * @param[in]   seq, index of the frame.
+ * @param[in]   gff_frames, buffer holding GFF frames.
+ * @param[in]   len, len of GFF frames.
+ * @param[in]   deliver_func, function will be called for in order GFF frames.
+ * @param[out]  ack_buf, buffer will hold ACK datagram (ack_datagram_len bytes).
+ *
+ * @return      -1 if datagram was dropped (no ACK), otherwise ack datagram is in ack_buf.
+ */
+int16_t slp_rel_handle_data(uint16_t from_node_id, uint8_t flags, uint16_t seq,
+        uint8_t *gff_frames, uint16_t len, slp_rel_ns::deliver_func_t deliver_func,
+        uint8_t *ack_buf);
+
+#endif /* SLP_RELIABLE_H_ */
@@ -9,6 +9,7 @@
 extern "C" {
 #include "thread.h"
 #include "msg.h"
+#include "vtimer.h"
 #include "socket_base/socket.h"
 }
 
@@ -17,6 +18,7 @@ extern "C" {
 #include "gff_mesg_id.h"
 
 #include "slp_sender.h"
+#include "slp_reliable.h"
 
 #include "cir_queue.h"
 #include "ff.h"
@@ -53,6 +55,34 @@ static void *slp_sender_func(void *arg);
 static const char slp_sender_msgqueue_size = 32;
 static msg_t slp_sender_msgqueue[slp_sender_msgqueue_size];
 
+/* Long-lived socket for sending, opened when 6LoWPAN stack is (re)started */
+static int slp_sender_sock = -1;
+
+/* Queue which still has GFF frames waiting for window of a node to be opened */
+static cir_queue *slp_sender_pending_queue = NULL;
+
+/* Frames parked while window of their node is full, frames to other nodes aren't blocked */
+static const uint16_t slp_sender_parked_queue_size = 256;
+static uint8_t slp_sender_parked_queue_buf[slp_sender_parked_queue_size];
+static cir_queue slp_sender_parked_queue(slp_sender_parked_queue_buf,
+        slp_sender_parked_queue_size);
+
+/*
+ * Nodes having frames in parked queue (rebuilt by every send_data_gff), later frames
+ * to them are parked too to keep their order. All unicast frames are parked when
+ * the table has overflowed.
+ */
+static const uint8_t slp_sender_max_parked_nodes = 16;
+static uint16_t slp_sender_parked_nodes[slp_sender_max_parked_nodes];
+static uint8_t slp_sender_num_parked_nodes = 0;
+static bool slp_sender_parked_nodes_overflowed = false;
+
+/* Retransmission timer */
+static vtimer_t slp_sender_retx_timer;
+
+/* Datagram to a group address, it's not kept for retransmission */
+static uint8_t slp_sender_group_datagram[ha_ns::sixlowpan_payload_maxsize];
+
 /*--------------------- Public functions -------------------------------------*/
 /**
  * @brief   Create and start 6lowpan sender thread.
@@ -74,7 +104,17 @@ void slp_sender_start(void)
 /* Prototypes */
 static int16_t restart_sixlowpan(void);
 static int16_t send_data_gff(cir_queue *gff_cir_queue);
-static void insert_node_id(uint8_t* payload_buffer, uint16_t node_id);
+static int16_t send_gff_frames(cir_queue *gff_cir_queue, bool is_parked_queue);
+static void move_gff_frame(cir_queue *from_queue, cir_queue *to_queue, uint16_t frame_size);
+static bool is_node_parked(uint16_t node_id);
+static void set_node_parked(uint16_t node_id);
+static int16_t preview_gff_frame(cir_queue *gff_cir_queue, uint16_t &frame_size,
+        uint16_t &node_id);
+static int16_t send_datagram(uint16_t node_id, uint8_t *gff_frames, uint16_t len);
+static int16_t send_payload(uint8_t *payload_buffer, uint16_t payload_len, uint16_t node_id);
+static int16_t open_sender_socket(void);
+static void retransmit(void);
+static void set_retx_timer(void);
 
 /**
  * @brief   6lowpan sender thread's function.
@@ -100,7 +140,28 @@ static void *slp_sender_func(void *arg)
 
         case ha_ns::GFF_PENDING:
             HA_DEBUG("slp_sender: Received GFF_PENDING.\n");
-            send_data_gff((cir_queue*)mesg.content.ptr);
+            slp_sender_pending_queue = (cir_queue*)mesg.content.ptr;
+            send_data_gff(slp_sender_pending_queue);
+            set_retx_timer();
+            break;
+
+        case ha_ns::SIXLOWPAN_ACKED:
+            HA_DEBUG("slp_sender: Received SIXLOWPAN_ACKED.\n");
+            if (slp_sender_pending_queue != NULL
+                    || slp_sender_parked_queue.get_size() > 0) {
+                send_data_gff(slp_sender_pending_queue);
+            }
+            set_retx_timer();
+            break;
+
+        case ha_ns::SIXLOWPAN_RETX_TIMER:
+            retransmit();
+            /* windows could be opened when datagrams were dropped */
+            if (slp_sender_pending_queue != NULL
+                    || slp_sender_parked_queue.get_size() > 0) {
+                send_data_gff(slp_sender_pending_queue);
+            }
+            set_retx_timer();
             break;
 
         default:
@@ -158,108 +219,399 @@ static int16_t restart_sixlowpan(void)
 
     HA_NOTIFY("6LoWPAN stack restarted.\n");
 
-    return 0;
+    /* addresses of nodes will be learnt again, sequences will be resynchronized */
+    ha_slp_node_cache_clear();
+    vtimer_remove(&slp_sender_retx_timer);
+    slp_rel_init(node_id);
+
+    /* (re)open sending socket */
+    return open_sender_socket();
 }
 
 /*----------------------------------------------------------------------------*/
 /**
- * @brief   Send data in GFF format to 6lowpan.
- *          Using following global variables:
- *          - sixlowpan_payload_maxsize
- *          - sixlowpan_default_interface
- *          in ha_sixlowpan.h
+ * @brief   Send GFF frames pending in queue to 6lowpan. Consecutive frames to
+ *          the same node are packed in one reliable datagram (see slp_reliable.h).
+ *          Frames to a node whose window is full are parked, they're sent (in order)
+ *          when the node acknowledges, frames to other nodes are sent meanwhile.
+ *          Frames to a group address are sent once in a multicast datagram.
  *
- * @param[in]   gff_cir_queue, pointer to cir_queue object holding GFF frames.
+ * @param[in]   gff_cir_queue, pointer to cir_queue object holding GFF frames
+ *              (NULL if only parked frames are sent).
  *
  * @return  -1 if error.
  */
 static int16_t send_data_gff(cir_queue *gff_cir_queue)
 {
-    uint8_t payload_buffer[ha_ns::sixlowpan_payload_maxsize];
-    uint8_t gff_data_size;
-    uint16_t node_id, gff_cmd_id;
-    ipv6_addr_t ipaddr;
-    sockaddr6_t saddr;
-    int sock;
+    int16_t retval = 0;
 
-    int32_t bytes_sent;
+    /* parked frames first, they're older than frames in queue */
+    slp_sender_num_parked_nodes = 0;
+    slp_sender_parked_nodes_overflowed = false;
+    if (slp_sender_parked_queue.get_size() > 0) {
+        retval = send_gff_frames(&slp_sender_parked_queue, true);
+    }
 
-    /* get data from queue */
-    gff_data_size = gff_cir_queue->preview_data(false);
-    if (gff_cir_queue->get_size() < (gff_data_size + 2 + 1)) {
-        HA_DEBUG("send_data_gff: Size of GFF frame in queue(%ld) < gff_data_size(%hu) + 3\n",
-                gff_cir_queue->get_size(), gff_data_size);
-        return -1;
+    if (gff_cir_queue != NULL) {
+        if (send_gff_frames(gff_cir_queue, false) < 0) {
+            retval = -1;
+        }
     }
 
-    gff_cir_queue->get_data(payload_buffer, gff_data_size + 3);
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send GFF frames of a queue. Frame to a node whose window is full is moved
+ *          to the back of parked queue. Windows may be opened meanwhile (by ACKs or
+ *          retransmission timer), so the node is marked as parked and all its later
+ *          frames are parked too, their order is kept.
+ *
+ * @param[in]   gff_cir_queue, pointer to cir_queue object holding GFF frames.
+ * @param[in]   is_parked_queue, true if gff_cir_queue is parked queue, frames in it are
+ *              scanned once.
+ *
+ * @return  -1 if error.
+ */
+static int16_t send_gff_frames(cir_queue *gff_cir_queue, bool is_parked_queue)
+{
+    uint8_t gff_buffer[slp_rel_ns::max_gff_data_len];
+    uint16_t gff_len = 0;
+    uint16_t frame_size, node_id = 0, frame_node_id;
+    int16_t frame_status;
+    int16_t retval = 0;
+    int32_t remaining = gff_cir_queue->get_size();
+
+    while (!is_parked_queue || remaining > 0) {
+        frame_status = preview_gff_frame(gff_cir_queue, frame_size, frame_node_id);
+        if (frame_status == 0) {
+            /* no more frame */
+            break;
+        }
+        remaining -= frame_size;
+
+        if (frame_status < 0 || frame_size > slp_rel_ns::max_gff_data_len) {
+            /* drop this frame */
+            HA_DEBUG("send_data_gff: drop GFF frame (status %hd, size %hu)\n",
+                    frame_status, frame_size);
+            while (frame_size-- > 0) {
+                gff_cir_queue->get_data();
+            }
+            continue;
+        }
+
+        /* send current datagram if this frame can't be packed into it */
+        if (gff_len > 0
+                && (frame_node_id != node_id
+                        || gff_len + frame_size > slp_rel_ns::max_gff_data_len)) {
+            if (send_datagram(node_id, gff_buffer, gff_len) < 0) {
+                retval = -1;
+            }
+            gff_len = 0;
+        }
+
+        /* new datagram, park the frame if node has parked frames or window is full */
+        if (gff_len == 0) {
+            if (!is_group_nodeid(frame_node_id) && (is_node_parked(frame_node_id)
+                    || slp_rel_can_send(frame_node_id) == 0)) {
+                HA_DEBUG("send_data_gff: frame to %hu is parked\n", frame_node_id);
+                set_node_parked(frame_node_id);
+                if (is_parked_queue) {
+                    move_gff_frame(gff_cir_queue, gff_cir_queue, frame_size);
+                }
+                else if (slp_sender_parked_queue.get_free() >= frame_size) {
+                    move_gff_frame(gff_cir_queue, &slp_sender_parked_queue, frame_size);
+                }
+                else {
+                    HA_NOTIFY("send_data_gff: parked queue is full, drop frame to %hu\n",
+                            frame_node_id);
+                    while (frame_size-- > 0) {
+                        gff_cir_queue->get_data();
+                    }
+                }
+                continue;
+            }
+            node_id = frame_node_id;
+        }
+
+        gff_cir_queue->get_data(&gff_buffer[gff_len], frame_size);
+        gff_len += frame_size;
+    }
+
+    if (gff_len > 0) {
+        if (send_datagram(node_id, gff_buffer, gff_len) < 0) {
+            retval = -1;
+        }
+    }
+
+    if (!is_parked_queue) {
+        /* all frames have been sent or parked */
+        slp_sender_pending_queue = NULL;
+    }
+
+    return retval;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Move a GFF frame from tail of a queue to head of another (or the same) queue.
+ *
+ * @param[in]   from_queue, queue holding the frame at its tail.
+ * @param[in]   to_queue, queue the frame is added to, it must have space for the frame.
+ * @param[in]   frame_size, size of the frame.
+ */
+static void move_gff_frame(cir_queue *from_queue, cir_queue *to_queue, uint16_t frame_size)
+{
+    while (frame_size-- > 0) {
+        to_queue->add_data(from_queue->get_data());
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Check if a node has frames in parked queue.
+ */
+static bool is_node_parked(uint16_t node_id)
+{
+    uint8_t count;
+
+    if (slp_sender_parked_nodes_overflowed) {
+        return true;
+    }
+
+    for (count = 0; count < slp_sender_num_parked_nodes; count++) {
+        if (slp_sender_parked_nodes[count] == node_id) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Mark a node as having frames in parked queue.
+ */
+static void set_node_parked(uint16_t node_id)
+{
+    if (is_node_parked(node_id)) {
+        return;
+    }
+
+    if (slp_sender_num_parked_nodes < slp_sender_max_parked_nodes) {
+        slp_sender_parked_nodes[slp_sender_num_parked_nodes++] = node_id;
+    }
+    else {
+        slp_sender_parked_nodes_overflowed = true;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Preview GFF frame at tail of the queue and find node id it will be sent to.
+ *
+ * @param[in]   gff_cir_queue, pointer to cir_queue object holding GFF frames.
+ * @param[out]  frame_size, size of the frame (len + cmd + data).
+ * @param[out]  node_id, node id the frame will be sent to.
+ *
+ * @return  1 if a frame is ready, 0 if there is no complete frame in queue,
+ *          -1 if command id of the frame is unknown.
+ */
+static int16_t preview_gff_frame(cir_queue *gff_cir_queue, uint16_t &frame_size,
+        uint16_t &node_id)
+{
+    uint8_t header[ha_ns::GFF_DATA_POS + 5]; /* len, cmd, (num of records), device id */
+    uint16_t gff_cmd_id;
+    uint8_t count;
+
+    if (gff_cir_queue->get_size() < ha_ns::GFF_DATA_POS) {
+        return 0;
+    }
+
+    header[0] = gff_cir_queue->preview_data(false);
+    for (count = 1; count < ha_ns::GFF_DATA_POS + 4; count++) {
+        header[count] = gff_cir_queue->preview_data(true);
+    }
+
+    frame_size = header[ha_ns::GFF_LEN_POS] + ha_ns::GFF_CMD_SIZE + ha_ns::GFF_LEN_SIZE;
+    if (gff_cir_queue->get_size() < frame_size) {
+        HA_DEBUG("preview_gff_frame: Size of GFF frame in queue(%ld) < frame_size(%hu)\n",
+                gff_cir_queue->get_size(), frame_size);
+        return 0;
+    }
 
     /* check kind of message */
-    gff_cmd_id = buf2uint16(&payload_buffer[1]);
+    gff_cmd_id = buf2uint16(&header[ha_ns::GFF_CMD_POS]);
 
     switch (gff_cmd_id) {
     case ha_ns::SET_DEV_VAL:
-        HA_DEBUG("send_data_gff: SET_DEV_VAL message (%hu, %lx, %hd).\n",
-                payload_buffer[0], buf2uint32(&payload_buffer[3]),
-                (int16_t)buf2uint16(&payload_buffer[7]));
+        HA_DEBUG("preview_gff_frame: SET_DEV_VAL message (%hu, %lx).\n",
+                header[0], buf2uint32(&header[ha_ns::GFF_DATA_POS]));
 #ifdef HA_CC
-        node_id = parse_node_deviceid(buf2uint32(&payload_buffer[3]));
+        node_id = parse_node_deviceid(buf2uint32(&header[ha_ns::GFF_DATA_POS]));
+#endif
+#ifdef HA_HOST
+        node_id = ha_ns::sixlowpan_ha_cc_node_id;
+#endif
+        break;
+    case ha_ns::SET_DEV_MULT_VALS:
+        /* all records are for one node, the first one is after num of records */
+        header[ha_ns::GFF_DATA_POS + 4] = gff_cir_queue->preview_data(true);
+        HA_DEBUG("preview_gff_frame: SET_DEV_MULT_VALS message (%hu, %lx).\n",
+                header[ha_ns::GFF_DATA_POS], buf2uint32(&header[ha_ns::GFF_DATA_POS + 1]));
+#ifdef HA_CC
+        node_id = parse_node_deviceid(buf2uint32(&header[ha_ns::GFF_DATA_POS + 1]));
 #endif
 #ifdef HA_HOST
         node_id = ha_ns::sixlowpan_ha_cc_node_id;
 #endif
         break;
     case ha_ns::ALIVE:
-        HA_DEBUG("send_data_gff: ALIVE message.\n");
+        HA_DEBUG("preview_gff_frame: ALIVE message.\n");
         node_id = ha_ns::sixlowpan_ha_cc_node_id;
         break;
     default:
-        HA_DEBUG("send_data_gff: unknow GFF command id %x\n", gff_cmd_id);
+        HA_DEBUG("preview_gff_frame: unknow GFF command id %x\n", gff_cmd_id);
         return -1;
     }
 
-    /* insert node id */
-    insert_node_id(payload_buffer, node_id);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Make a datagram from GFF frames and send it. Datagram to a node is kept for
+ *          retransmission until it's acknowledged (see slp_reliable.h), datagram to a
+ *          group address is sent once.
+ *
+ * @param[in]   node_id, node id (or node id of a group address) the datagram will be
+ *              sent to.
+ * @param[in]   gff_frames, buffer holding GFF frames.
+ * @param[in]   len, len of GFF frames.
+ *
+ * @return  -1 if error.
+ */
+static int16_t send_datagram(uint16_t node_id, uint8_t *gff_frames, uint16_t len)
+{
+    uint8_t *datagram_p;
+    uint16_t datagram_len;
+
+    if (is_group_nodeid(node_id)) {
+        /* | group node id | header | GFF frames | */
+        uint162buf(node_id, slp_sender_group_datagram);
+        memcpy(&slp_sender_group_datagram[2], gff_frames, len);
+        ha_slp_add_frame_header(&slp_sender_group_datagram[2], len, ha_ns::GROUP, 0,
+                ha_ns::sixlowpan_node_id);
+        return send_payload(slp_sender_group_datagram, 2 + ha_ns::sixlowpan_header_len + len,
+                node_id);
+    }
+
+    slp_rel_add_datagram(node_id, gff_frames, len, &datagram_p, datagram_len);
+    return send_payload(datagram_p, datagram_len, node_id);
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send a datagram with the long-lived socket.
+ *          Datagram is sent to unicast address of the node if it's in node address cache,
+ *          otherwise (or to a group address) to all nodes multicast address.
+ *          Using following global variables:
+ *          - sixlowpan_receiving_port
+ *          in ha_sixlowpan.h
+ *
+ * @param[in]   payload_buffer, datagram (node id + header + GFF frames).
+ * @param[in]   payload_len, len of the datagram.
+ * @param[in]   node_id, node id the datagram will be sent to.
+ *
+ * @return  -1 if error.
+ */
+static int16_t send_payload(uint8_t *payload_buffer, uint16_t payload_len, uint16_t node_id)
+{
+    ipv6_addr_t ipaddr;
+    sockaddr6_t saddr;
+    int32_t bytes_sent;
+
+    if (slp_sender_sock < 0 && open_sender_socket() < 0) {
+        return -1;
+    }
 
     /* Set address to send data */
-    ipv6_addr_set_all_nodes_addr(&ipaddr);
+    if (is_group_nodeid(node_id) || ha_slp_node_cache_find(node_id, &ipaddr) < 0) {
+        HA_DEBUG("send_payload: node %hu is not in cache, multicast\n", node_id);
+        ipv6_addr_set_all_nodes_addr(&ipaddr);
+    }
 
-    /* open a socket and send data */
     memset(&saddr, 0, sizeof(saddr));
     saddr.sin6_family = AF_INET6;
     memcpy(&saddr.sin6_addr, &ipaddr, 16);
     saddr.sin6_port = HTONS(ha_ns::sixlowpan_receiving_port);
 
-    sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) {
-        HA_DEBUG("send_data_gff: Error Creating Socket.\n");
+    bytes_sent = socket_base_sendto(slp_sender_sock, payload_buffer, payload_len, 0,
+            &saddr, sizeof(saddr));
+    if (bytes_sent < 0) {
+        HA_NOTIFY("send_payload: Error when send data to %hu\n", node_id);
+
+        /* socket will be reopened on next datagram */
+        socket_base_close(slp_sender_sock);
+        slp_sender_sock = -1;
         return -1;
     }
 
-    bytes_sent = socket_base_sendto(sock, payload_buffer, gff_data_size + 3 + 2, 0,
-            &saddr, sizeof(saddr));
-    if (bytes_sent >= 0) {
-        HA_DEBUG("send_data_gff: %ld bytes sent to %hu\n", bytes_sent, node_id);
+    HA_DEBUG("send_payload: %ld bytes sent to %hu\n", bytes_sent, node_id);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Close old socket (if any) and open a new socket for sending.
+ *
+ * @return  -1 if error.
+ */
+static int16_t open_sender_socket(void)
+{
+    if (slp_sender_sock >= 0) {
+        socket_base_close(slp_sender_sock);
     }
-    else {
-        HA_NOTIFY("send_data_gff: Error when send data to %hu\n", node_id);
+
+    slp_sender_sock = socket_base_socket(PF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+    if (slp_sender_sock < 0) {
+        HA_DEBUG("open_sender_socket: Error Creating Socket.\n");
+        return -1;
     }
 
-    socket_base_close(sock);
+    return 0;
+}
 
-    /* WORKAROUND: sleep to 10ms so it will not make receiver buffer overflow
-     * TODO(later): apply CoAP with flow control will resolve this issue */
-    vtimer_usleep(10000);
+/*----------------------------------------------------------------------------*/
+/**
+ * @brief   Send again all datagrams whose RTO has expired.
+ */
+static void retransmit(void)
+{
+    uint8_t *datagram_p;
+    uint16_t datagram_len, node_id;
 
-    return 0;
+    while (slp_rel_get_retransmission(&datagram_p, datagram_len, node_id) == 1) {
+        send_payload(datagram_p, datagram_len, node_id);
+    }
 }
 
 /*----------------------------------------------------------------------------*/
-static void insert_node_id(uint8_t* payload_buffer, uint16_t node_id)
+/**
+ * @brief   (Re)arm retransmission timer for the earliest unacknowledged datagram.
+ */
+static void set_retx_timer(void)
 {
-    /* get node_id */
-    memmove(&payload_buffer[2], &payload_buffer[0], payload_buffer[0] + 3);
+    uint32_t timeout_ms;
+
+    vtimer_remove(&slp_sender_retx_timer);
+
+    if (slp_rel_get_next_timeout(timeout_ms) < 0) {
+        return;
+    }
 
-    payload_buffer[0] = (uint8_t)(node_id >> 8);
-    payload_buffer[1] = (uint8_t)(node_id);
+    vtimer_set_msg(&slp_sender_retx_timer,
+            timex_set(timeout_ms / 1000, (timeout_ms % 1000) * 1000),
+            ha_ns::sixlowpan_sender_pid, ha_ns::SIXLOWPAN_RETX_TIMER, NULL);
 }
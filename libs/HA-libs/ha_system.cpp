@@ -64,6 +64,7 @@ void ha_system_init(void)
 
 #ifdef HA_CC
     /* CC's specific initializations */
+    storage_start();
     controller_start();
     MB1_ISRs.subISR_assign(ISRMgr_ns::ISRMgr_RTC, second_int_callback);
 
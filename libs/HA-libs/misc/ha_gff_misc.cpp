@@ -75,6 +75,55 @@ uint8_t parse_devtype_deviceid(uint32_t device_id)
     return (uint8_t)(device_id);
 }
 
+/*----------------------------------------------------------------------------*/
+uint32_t make_group_deviceid(uint8_t zone_id, uint8_t group_id, uint8_t dev_type)
+{
+    return ((uint32_t)zone_id << 24) | ((uint32_t)ha_ns::group_node_in_zone << 16)
+            | ((uint32_t)group_id << 8) | (uint32_t)dev_type;
+}
+
+/*----------------------------------------------------------------------------*/
+bool is_group_nodeid(uint16_t node_id)
+{
+    return (uint8_t)node_id == ha_ns::group_node_in_zone;
+}
+
+/*----------------------------------------------------------------------------*/
+bool is_group_deviceid(uint32_t device_id)
+{
+    return is_group_nodeid(parse_node_deviceid(device_id));
+}
+
+/*----------------------------------------------------------------------------*/
+bool match_group_nodeid(uint16_t group_node_id, uint16_t node_id)
+{
+    uint8_t zone_id = (uint8_t)(group_node_id >> 8);
+
+    return zone_id == ha_ns::group_all_zones || zone_id == (uint8_t)(node_id >> 8);
+}
+
+/*----------------------------------------------------------------------------*/
+bool match_group_deviceid(uint32_t group_device_id, uint32_t device_id, uint32_t groups)
+{
+    uint8_t group_id = parse_ep_deviceid(group_device_id);
+    uint8_t dev_type = parse_devtype_deviceid(group_device_id);
+
+    if (!match_group_nodeid(parse_node_deviceid(group_device_id),
+            parse_node_deviceid(device_id))) {
+        return false;
+    }
+
+    if (group_id != ha_ns::group_no_group
+            && (group_id > ha_ns::group_max_id || (groups & (1UL << (group_id - 1))) == 0)) {
+        return false;
+    }
+
+    /* a common type matches all its subtypes */
+    return dev_type == ha_ns::group_all_types
+            || dev_type == parse_devtype_deviceid(device_id)
+            || dev_type == (parse_devtype_deviceid(device_id) & 0xF8);
+}
+
 uint8_t combine_dev_type(uint8_t dev_type_common, uint8_t sub_type)
 {
     return ((dev_type_common & 0xF8) | (sub_type & 0x07));
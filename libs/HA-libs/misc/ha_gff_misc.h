@@ -79,6 +79,44 @@ uint8_t parse_ep_deviceid(uint32_t device_id);
  */
 uint8_t parse_devtype_deviceid(uint32_t device_id);
 
+/**
+ * @brief   Make group address (see device_id.h).
+ *
+ * @param[in]   zone_id, group_all_zones for all zones.
+ * @param[in]   group_id, group_no_group if the group is not an explicit group.
+ * @param[in]   dev_type, group_all_types for all types.
+ *
+ * @return      device id of the group.
+ */
+uint32_t make_group_deviceid(uint8_t zone_id, uint8_t group_id, uint8_t dev_type);
+
+/**
+ * @brief   Check if a node id is node id of a group address.
+ */
+bool is_group_nodeid(uint16_t node_id);
+
+/**
+ * @brief   Check if a device id is a group address.
+ */
+bool is_group_deviceid(uint32_t device_id);
+
+/**
+ * @brief   Check if a node is addressed by node id of a group address (zone matches).
+ *
+ * @param[in]   group_node_id, node id of a group address.
+ * @param[in]   node_id, node id of the node.
+ */
+bool match_group_nodeid(uint16_t group_node_id, uint16_t node_id);
+
+/**
+ * @brief   Check if a device is addressed by a group address.
+ *
+ * @param[in]   group_device_id, group address.
+ * @param[in]   device_id, device id of the device.
+ * @param[in]   groups, explicit groups of the device (bit group id - 1).
+ */
+bool match_group_deviceid(uint32_t group_device_id, uint32_t device_id, uint32_t groups);
+
 /**
  * @brief   Get device type from common device type and sub type.
  *
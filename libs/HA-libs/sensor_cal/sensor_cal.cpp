@@ -0,0 +1,204 @@
+/**
+ * @file sensor_cal.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Calibration of ADC sensors.
+ */
+#include <math.h>
+#include <stddef.h>
+#include "sensor_cal.h"
+
+using namespace sensor_cal_ns;
+
+static int32_t tables[max_tables][num_segments + 1];
+static bool table_used[max_tables];
+
+sensor_cal::sensor_cal(void)
+{
+    table = NULL;
+    for (uint8_t t = 0; t < max_tables; t++) {
+        if (!table_used[t]) {
+            table_used[t] = true;
+            table = tables[t];
+            break;
+        }
+    }
+    if (table == NULL) {
+        return;
+    }
+
+    for (uint16_t i = 0; i <= num_segments; i++) {
+        table[i] = 0;
+    }
+}
+
+sensor_cal::~sensor_cal(void)
+{
+    if (table != NULL) {
+        table_used[(table - tables[0]) / (num_segments + 1)] = false;
+        table = NULL;
+    }
+}
+
+int8_t sensor_cal::compile(const char* equation_type_buff, uint8_t num_equation,
+        const float* equation_params_buff, uint8_t num_params, uint16_t v_ref)
+{
+    if (!table || !equation_type_buff || !equation_params_buff || num_equation == 0) {
+        return -1;
+    }
+
+    for (uint16_t i = 0; i <= num_segments; i++) {
+        /* input of the chain is in V */
+        float volt = ((float) (i << segment_shift)) * ((float) v_ref)
+                / ((float) (1 << adc_bits)) / 1000.0f;
+        float value = sensor_cal_float_eval(volt, equation_type_buff,
+                num_equation, equation_params_buff, num_params)
+                * (float) (1 << value_frac_bits);
+
+        /* NaN (e.g. negative base of pow()) and out of range values */
+        if (value != value) {
+            value = 0;
+        } else if (value > (float) value_max) {
+            value = (float) value_max;
+        } else if (value < (float) -value_max) {
+            value = (float) -value_max;
+        }
+        table[i] = (int32_t) (value >= 0 ? value + 0.5f : value - 0.5f);
+    }
+
+    return 0;
+}
+
+float sensor_cal_float_eval(float first_value, const char* equation_type_buff,
+        uint8_t num_equation, const float* equation_params_buff, uint8_t num_params)
+{
+    /* check parameters */
+    if (!equation_type_buff || !equation_params_buff) {
+        return 0;
+    }
+    uint8_t consumed_params = 0; // the number of params was consumed.
+    const float* param_ptr = equation_params_buff;
+
+    float retval = first_value;
+    for (uint8_t i = 0; i < num_equation; i++) {
+        switch (equation_type_buff[i]) {
+        case 'l': //linear
+            consumed_params += 2;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = linear_equation_calculate(retval, param_ptr[0],
+                    param_ptr[1]);
+            param_ptr += 2;
+            break;
+        case 'r': //rational
+            consumed_params += 3;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = rational_equation_calculate(retval, param_ptr[0],
+                    param_ptr[1], param_ptr[2]);
+            param_ptr += 3;
+            break;
+        case 'p': //polynomial
+            consumed_params += 3;
+            if (consumed_params > num_params) {
+                return retval;
+            }
+            retval = polynomial_equation_calculate(retval, param_ptr[0],
+                    param_ptr[1], param_ptr[2]);
+            param_ptr += 3;
+            break;
+        case 't': //table
+            return lookup_table(retval, param_ptr, num_params - consumed_params);
+        default:
+            break;
+        }
+    }
+
+    return retval;
+}
+
+float linear_equation_calculate(float x_value, float a_value, float b_value)
+{
+    /* y = a*x + b */
+    return x_value * a_value + b_value;
+}
+
+float rational_equation_calculate(float x_value, float a_value, float b_value,
+        float c_value)
+{
+    /* y = 1/(a*x +b) + c*/
+    return 1.0f / (x_value * a_value + b_value) + c_value;
+}
+
+float polynomial_equation_calculate(float x_value, float a_value, float b_value,
+        float c_value)
+{
+    /* y = a*x^b + c */
+    return a_value * pow(x_value, b_value) + c_value;
+}
+
+float lookup_table(float value, const float* defined_table, uint8_t table_size)
+{
+    if (!defined_table || (table_size % 2 != 0)) {
+        return value;
+    }
+
+    bool inc_seq = false;
+    if (defined_table[0] < defined_table[table_size - 2]) {
+        inc_seq = true;
+    }
+
+    float a_value = 0;
+    float b_value = 0;
+    /* find segment */
+    uint8_t index = 0;
+    while (index < table_size) {
+        if ((index % 2 == 0)) {
+            /* if finding out exact input value
+             * or input value is greater than max x_value in table,
+             * returning the y_value */
+            if (inc_seq) { //increasing sequence
+                if ((index == table_size - 2)
+                        && (value >= defined_table[index])) {
+                    return defined_table[index + 1];
+                }
+
+                /* x1 <= value <= x2 */
+                if (value >= defined_table[index]
+                        && value <= defined_table[index + 2]) {
+                    break;
+                }
+            } else { //decreasing sequence
+                if ((index == table_size - 2)
+                        && (value <= defined_table[index])) {
+                    return defined_table[index + 1];
+                }
+
+                /* x2 <= value <= x1 */
+                if (value <= defined_table[index]
+                        && value >= defined_table[index + 2]) {
+                    break;
+                }
+            }
+        }
+        index++;
+    }
+
+    /* input value is out of the first x_value, loop ends with index == table_size */
+    if (index >= table_size - 1) {
+        return defined_table[1];
+    }
+
+    /* cal the ref value by linearing input value in the found out segment */
+    a_value = (defined_table[index + 3] - defined_table[index + 1])
+            / (defined_table[index + 2] - defined_table[index]); //a = (y2-y1)/(x2-x1)
+    b_value = (defined_table[index + 1] * defined_table[index + 2]
+            - defined_table[index + 3] * defined_table[index])
+            / (defined_table[index + 2] - defined_table[index]); //b = (y1*x2 - y2*x1)/(x2-x1)
+
+    /* y = a*x + b */
+    return value * a_value + b_value;
+}
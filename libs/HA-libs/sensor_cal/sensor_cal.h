@@ -0,0 +1,117 @@
+/**
+ * @file sensor_cal.h
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Calibration of ADC sensors.
+ * The chain of equations of a sensor (l(linear), r(rational), p(polynomial), t(table))
+ * is evaluated once when sensor is started, for (num_segments + 1) ADC values spaced
+ * evenly on the 12-bits range. The result is a piecewise-linear table in fixed-point,
+ * converting a sample is one lookup and one multiply-add, no float, no pow().
+ * Equations are still evaluated in float (sensor_cal_float_eval) to build the table.
+ * Tables are taken from a small pool (max_tables) instead of being in each sensor, so
+ * EPs which aren't ADC sensors don't pay for them. Sensors are created and destroyed
+ * by one thread (EP dispatcher in ha_host), the pool isn't locked.
+ */
+#ifndef __HA_SENSOR_CAL_H_
+#define __HA_SENSOR_CAL_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+namespace sensor_cal_ns {
+const uint8_t adc_bits = 12;
+const uint8_t segment_shift = 6; //64 ADC values per segment.
+const uint16_t num_segments = (1 << (adc_bits - segment_shift));
+const uint8_t value_frac_bits = 8; //values are in Q.8 fixed-point.
+const int32_t value_max = (int32_t) 0xFFFFFF; //+-65535.99, values are sent in 16-bits,
+                                              //(y2-y1)*frac fits in 32-bits.
+const uint8_t max_tables = 8; //ADC sensors running at the same time.
+}
+
+class sensor_cal {
+public:
+    /**
+     * @brief Constructor, take a table from the pool. Converted value is 0 until a chain
+     * of equations is compiled.
+     */
+    sensor_cal(void);
+
+    /**
+     * @brief De-constructor, give the table back to the pool.
+     */
+    ~sensor_cal(void);
+
+    /**
+     * @brief Check if a table was taken from the pool.
+     *
+     * @return false if pool was exhausted, converted value is always 0.
+     */
+    bool has_table(void)
+    {
+        return table != NULL;
+    }
+
+    /**
+     * @brief Compile the chain of equations to the table.
+     *
+     * @param[in] equation_type_buff The buffer of equation types.
+     * @param[in] num_equation The number of equa-types in equation_type_buff.
+     * @param[in] equation_params_buff The buffer of parameters.
+     * @param[in] num_params The number of parameters in equation_params_buff.
+     * @param[in] v_ref Reference voltage of ADC in mV, input of the chain is in V.
+     *
+     * @return -1 if there is no equation or no table, otherwise 0.
+     */
+    int8_t compile(const char* equation_type_buff, uint8_t num_equation,
+            const float* equation_params_buff, uint8_t num_params, uint16_t v_ref);
+
+    /**
+     * @brief Convert an ADC value.
+     *
+     * @param[in] adc_value 12-bits ADC value.
+     *
+     * @return value of sensor in Q.8 fixed-point (value * 2^value_frac_bits).
+     */
+    int32_t get_value(uint16_t adc_value)
+    {
+        if (table == NULL) {
+            return 0;
+        }
+        if (adc_value >= (1 << sensor_cal_ns::adc_bits)) {
+            adc_value = (1 << sensor_cal_ns::adc_bits) - 1;
+        }
+        uint16_t index = adc_value >> sensor_cal_ns::segment_shift;
+        int32_t frac = adc_value & ((1 << sensor_cal_ns::segment_shift) - 1);
+
+        return table[index] + (((table[index + 1] - table[index]) * frac)
+                >> sensor_cal_ns::segment_shift);
+    }
+
+private:
+    int32_t *table; //from the pool, NULL if there was no free table.
+};
+
+/**
+ * @brief Evaluate a chain of equations in float.
+ *
+ * @param[in] first_value Input of the chain.
+ * @param[in] equation_type_buff The buffer of equation types.
+ * @param[in] num_equation The number of equa-types in equation_type_buff.
+ * @param[in] equation_params_buff The buffer of parameters.
+ * @param[in] num_params The number of parameters in equation_params_buff.
+ *
+ * @return output of the chain, 0 if a buffer is NULL.
+ */
+float sensor_cal_float_eval(float first_value, const char* equation_type_buff,
+        uint8_t num_equation, const float* equation_params_buff, uint8_t num_params);
+
+float linear_equation_calculate(float x_value, float a, float b); //y = ax+b;
+
+float rational_equation_calculate(float x_value, float a, float b, float c); //y = 1/(ax+b)+c;
+
+float polynomial_equation_calculate(float x_value, float a, float b, float c); //y = ax^b+c;
+
+float lookup_table(float value, const float* defined_table, uint8_t table_size);
+
+#endif //__HA_SENSOR_CAL_H_
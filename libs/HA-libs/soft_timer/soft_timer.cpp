@@ -0,0 +1,124 @@
+/**
+ * @file soft_timer.cpp
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief This is source file for soft timers of devices.
+ */
+extern "C" {
+#include "mutex.h"
+}
+
+#include <stddef.h>
+#include "soft_timer.h"
+#include "timer_wheel.h"
+
+using namespace soft_timer_ns;
+
+typedef struct soft_timer_s {
+    callback_t callback; //NULL if timer is free.
+    void *arg;
+    uint16_t period; //in ticks, 0 if one-shot.
+} soft_timer_t;
+
+static soft_timer_t timers[max_soft_timers];
+static timer_wheel_ns::node_t wheel_nodes[max_soft_timers];
+static timer_wheel wheel(wheel_nodes, max_soft_timers);
+static mutex_t soft_timer_mutex = MUTEX_INIT;
+
+static bool is_valid_timer(int8_t timer_id)
+{
+    return (timer_id >= 0) && (timer_id < max_soft_timers)
+            && (timers[timer_id].callback != NULL);
+}
+
+int8_t soft_timer_create(callback_t callback, void *arg)
+{
+    if (callback == NULL) {
+        return -1;
+    }
+
+    mutex_lock(&soft_timer_mutex);
+    for (uint8_t i = 0; i < max_soft_timers; i++) {
+        if (timers[i].callback == NULL) {
+            timers[i].callback = callback;
+            timers[i].arg = arg;
+            timers[i].period = 0;
+            mutex_unlock(&soft_timer_mutex);
+            return i;
+        }
+    }
+    mutex_unlock(&soft_timer_mutex);
+
+    return -1;
+}
+
+void soft_timer_start(int8_t timer_id, uint16_t period_in_ms, bool periodic)
+{
+    uint16_t period = period_in_ms / tick_period;
+
+    if (!is_valid_timer(timer_id)) {
+        return;
+    }
+    if (period == 0) {
+        period = 1;
+    }
+
+    mutex_lock(&soft_timer_mutex);
+    timers[timer_id].period = periodic ? period : 0;
+    wheel.start(timer_id, period);
+    mutex_unlock(&soft_timer_mutex);
+}
+
+void soft_timer_stop(int8_t timer_id)
+{
+    if (!is_valid_timer(timer_id)) {
+        return;
+    }
+
+    mutex_lock(&soft_timer_mutex);
+    wheel.stop(timer_id);
+    mutex_unlock(&soft_timer_mutex);
+}
+
+void soft_timer_delete(int8_t timer_id)
+{
+    if (!is_valid_timer(timer_id)) {
+        return;
+    }
+
+    mutex_lock(&soft_timer_mutex);
+    wheel.stop(timer_id);
+    timers[timer_id].callback = NULL;
+    timers[timer_id].arg = NULL;
+    mutex_unlock(&soft_timer_mutex);
+}
+
+void soft_timer_tick(void)
+{
+    uint16_t id;
+    callback_t callback;
+    void *arg;
+
+    mutex_lock(&soft_timer_mutex);
+    wheel.tick();
+    mutex_unlock(&soft_timer_mutex);
+
+    while (1) {
+        mutex_lock(&soft_timer_mutex);
+        id = wheel.get_expired();
+        if (id == timer_wheel_ns::no_timer) {
+            mutex_unlock(&soft_timer_mutex);
+            return;
+        }
+        callback = timers[id].callback;
+        arg = timers[id].arg;
+        if (timers[id].period != 0) {
+            /* restarted before callback, so callback can stop or delete it */
+            wheel.start(id, timers[id].period);
+        }
+        mutex_unlock(&soft_timer_mutex);
+
+        callback(arg);
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * @file soft_timer.h
+ * @author  Nguyen Van Hien <nvhien1992@gmail.com>, HLib MBoard team.
+ * @version 1.0
+ * @date 17-10-2026
+ * @brief Soft timers of devices (sampling, debouncing, blinking...).
+ * Each device instance creates its own timer with its own period, one-shot or periodic.
+ * Timers are kept in a timing wheel (timer_wheel.h), work per tick is proportional to the
+ * number of timers which expire, devices which are not running cost nothing.
+ * soft_timer_tick is called every timer tick (1ms), in ha_host by tick worker, callbacks
+ * are called from there.
+ */
+#ifndef __HA_SOFT_TIMER_H_
+#define __HA_SOFT_TIMER_H_
+
+#include <stdint.h>
+#include "device_id.h"
+
+namespace soft_timer_ns {
+const uint8_t timers_per_end_point = 3; //RGB-led: blink timer of each bulb.
+const uint8_t max_soft_timers = ha_ns::max_end_points * timers_per_end_point;
+const uint8_t tick_period = 1; //ms
+
+typedef void (*callback_t)(void *arg);
+}
+
+/**
+ * @brief Create a stopped timer.
+ *
+ * @param[in] callback Function called when timer expires.
+ * @param[in] arg Argument of callback (e.g. the device instance).
+ *
+ * @return -1 if there is no free timer, otherwise timer id.
+ */
+int8_t soft_timer_create(soft_timer_ns::callback_t callback, void *arg);
+
+/**
+ * @brief Start (or restart) a timer.
+ *
+ * @param[in] timer_id Timer id returned by soft_timer_create.
+ * @param[in] period_in_ms Timeout in ms (0 is treated as 1 tick).
+ * @param[in] periodic true if timer is restarted with the same period when it expires.
+ */
+void soft_timer_start(int8_t timer_id, uint16_t period_in_ms, bool periodic);
+
+/**
+ * @brief Stop a timer, its callback won't be called until it's started again.
+ *
+ * @param[in] timer_id Timer id returned by soft_timer_create.
+ */
+void soft_timer_stop(int8_t timer_id);
+
+/**
+ * @brief Stop and free a timer, called when device is removed.
+ *
+ * @param[in] timer_id Timer id returned by soft_timer_create.
+ */
+void soft_timer_delete(int8_t timer_id);
+
+/**
+ * @brief Advance timers by one tick and call callbacks of expired timers.
+ */
+void soft_timer_tick(void);
+
+#endif //__HA_SOFT_TIMER_H_
@@ -19,8 +19,17 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 #include "cir_queue.h"
 
+/* Indices run in [0, 2 * queue_size) so full (used == queue_size) and empty (used == 0)
+ * can be told apart without a shared flag.
+ * head is only written by producer, tail and preview_pos only by consumer.
+ * Data is written before head is published (release) and read after head is loaded (acquire),
+ * tail is published (release) after data has been read so producer can't overwrite it. */
+#define LOAD_ACQUIRE(var)           __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(var, val)     __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+
 /*----------------------------------------------------------------------------*/
 cir_queue::cir_queue(uint8_t *queue_p, uint16_t queue_size)
 {
@@ -28,8 +37,8 @@ cir_queue::cir_queue(uint8_t *queue_p, uint16_t queue_size)
     this->queue_size = queue_size;
 
     this->head = 0;
-    this->tail = -1;
-    this->preview_pos = this->tail;
+    this->tail = 0;
+    this->preview_pos = 0;
 
     overflowed = false;
 }
@@ -37,36 +46,48 @@ cir_queue::cir_queue(uint8_t *queue_p, uint16_t queue_size)
 /*----------------------------------------------------------------------------*/
 void cir_queue::add_data(uint8_t a_byte)
 {
-    int32_t old_head = head;
-
-    queue_p[head] = a_byte;
+    uint32_t cur_head = head;
 
-    if (tail == -1) { /* queue is empty */
-        tail = head;
+    /* check overflowed, new data will be dropped */
+    if (used(cur_head, LOAD_ACQUIRE(tail)) >= queue_size) {
+        overflowed = true;
+        return;
     }
 
-    head = (head + 1) % queue_size;
+    queue_p[pos(cur_head)] = a_byte;
 
-    /* check overflowed */
-    if ((old_head < tail) && (head >= tail)) {
-        overflowed = true;
-    }
+    STORE_RELEASE(head, advance(cur_head, 1));
 }
 
 /*----------------------------------------------------------------------------*/
 void cir_queue::add_data(uint8_t* buf, int32_t size)
 {
-    int32_t count;
+    uint32_t cur_head = head;
+    uint32_t start, first_seg;
 
     /* check size */
     if (size < 1) {
         return;
     }
 
-    /* copy data from buffer to queue */
-    for (count = 0; count < size; count++) {
-        this->add_data(buf[count]);
+    /* check overflowed, new data will be dropped as a whole (no partial frames) */
+    if ((uint32_t)size > queue_size - used(cur_head, LOAD_ACQUIRE(tail))) {
+        overflowed = true;
+        return;
+    }
+
+    /* copy data from buffer to queue, at most 2 segments */
+    start = pos(cur_head);
+    first_seg = queue_size - start;
+    if (first_seg >= (uint32_t)size) {
+        memcpy(&queue_p[start], buf, size);
     }
+    else {
+        memcpy(&queue_p[start], buf, first_seg);
+        memcpy(queue_p, &buf[first_seg], size - first_seg);
+    }
+
+    STORE_RELEASE(head, advance(cur_head, size));
 }
 
 /*----------------------------------------------------------------------------*/
@@ -74,7 +95,7 @@ uint8_t cir_queue::preview_data(bool cont)
 {
     uint8_t retval;
 
-    if (tail == -1) {
+    if (used(LOAD_ACQUIRE(head), tail) == 0) {
         return 0;
     }
 
@@ -82,28 +103,57 @@ uint8_t cir_queue::preview_data(bool cont)
         preview_pos = tail;
     }
 
-    retval = queue_p[preview_pos];
+    retval = queue_p[pos(preview_pos)];
 
-    preview_pos = (preview_pos + 1) % queue_size;
+    preview_pos = advance(preview_pos, 1);
 
     return retval;
 }
 
+/*----------------------------------------------------------------------------*/
+int32_t cir_queue::preview_data(uint8_t* buf, int32_t offset, int32_t size)
+{
+    uint32_t cur_tail = tail;
+    int32_t retsize;
+    uint32_t start, first_seg;
+
+    retsize = used(LOAD_ACQUIRE(head), cur_tail);
+    if (size < 1 || offset < 0 || offset >= retsize) {
+        return 0;
+    }
+
+    retsize -= offset;
+    if (retsize > size) {
+        retsize = size;
+    }
+
+    /* copy data from queue to buffer, at most 2 segments */
+    start = pos(advance(cur_tail, offset));
+    first_seg = queue_size - start;
+    if (first_seg >= (uint32_t)retsize) {
+        memcpy(buf, &queue_p[start], retsize);
+    }
+    else {
+        memcpy(buf, &queue_p[start], first_seg);
+        memcpy(&buf[first_seg], queue_p, retsize - first_seg);
+    }
+
+    return retsize;
+}
+
 /*----------------------------------------------------------------------------*/
 uint8_t cir_queue::get_data(void)
 {
+    uint32_t cur_tail = tail;
     uint8_t retdata;
 
-    if (this->tail == -1) {
+    if (used(LOAD_ACQUIRE(head), cur_tail) == 0) {
         return 0;
     }
 
-    retdata = queue_p[this->tail];
-    this->tail = (this->tail + 1) % queue_size;
+    retdata = queue_p[pos(cur_tail)];
 
-    if (this->tail == this->head) {
-        this->tail = -1;
-    }
+    STORE_RELEASE(tail, advance(cur_tail, 1));
 
     return retdata;
 }
@@ -111,36 +161,64 @@ uint8_t cir_queue::get_data(void)
 /*----------------------------------------------------------------------------*/
 int32_t cir_queue::get_data(uint8_t* buf, int32_t size)
 {
-    int32_t queue_size;
-    int32_t count;
+    uint32_t cur_tail = tail;
     int32_t retsize;
+    uint32_t start, first_seg;
 
     /* check size */
     if (size < 1) {
         return 0;
     }
 
-    queue_size = this->get_size();
-
-    if (queue_size > size) {
-        for (count = 0; count < size; count++) {
-            buf[count] = this->get_data();
-        }
-
+    retsize = used(LOAD_ACQUIRE(head), cur_tail);
+    if (retsize > size) {
         retsize = size;
-    } else {
-        for (count = 0; count < queue_size; count++) {
-            buf[count] = this->get_data();
-        }
+    }
 
-        retsize = queue_size;
+    if (retsize == 0) {
+        return 0;
     }
 
+    /* copy data from queue to buffer, at most 2 segments */
+    start = pos(cur_tail);
+    first_seg = queue_size - start;
+    if (first_seg >= (uint32_t)retsize) {
+        memcpy(buf, &queue_p[start], retsize);
+    }
+    else {
+        memcpy(buf, &queue_p[start], first_seg);
+        memcpy(&buf[first_seg], queue_p, retsize - first_seg);
+    }
+
+    STORE_RELEASE(tail, advance(cur_tail, retsize));
+
     return retsize;
 }
 
+/*----------------------------------------------------------------------------*/
 int32_t cir_queue::get_size(void)
 {
-    return (tail==-1) ? 0 : (head > tail ? head - tail : head + queue_size - tail);
+    return used(LOAD_ACQUIRE(head), LOAD_ACQUIRE(tail));
 }
 
+/*----------------------------------------------------------------------------*/
+int32_t cir_queue::get_tail(void)
+{
+    uint32_t cur_tail = LOAD_ACQUIRE(tail);
+
+    return (used(LOAD_ACQUIRE(head), cur_tail) == 0) ? -1 : (int32_t)pos(cur_tail);
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t cir_queue::used(uint32_t a_head, uint32_t a_tail)
+{
+    return (a_head >= a_tail) ? a_head - a_tail : a_head + 2 * (uint32_t)queue_size - a_tail;
+}
+
+/*----------------------------------------------------------------------------*/
+uint32_t cir_queue::advance(uint32_t index, uint32_t count)
+{
+    index += count;
+
+    return (index >= 2 * (uint32_t)queue_size) ? index - 2 * (uint32_t)queue_size : index;
+}
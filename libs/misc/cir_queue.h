@@ -22,12 +22,17 @@
 
 #include <cstdint>
 
+/*
+ * Lock-free for single producer / single consumer: one thread or ISR may add data
+ * while another thread gets (or previews) data without disabling interrupts.
+ * More than one producer or more than one consumer still need a lock.
+ */
 class cir_queue {
 public:
 
     /**
      * @brief   constructor, user must allocate data for the queue.
-     *          Init private (head = 0, tail = -1)
+     *          Init private (head = 0, tail = 0, empty)
      *
      * @param[in]   queue_p, pointer to buffer for queue.
      * @param[in]   queue_size, size of the buffer.
@@ -37,7 +42,8 @@ public:
     cir_queue(uint8_t *queue_p, uint16_t queue_size);
     
     /**
-     * @brief   add one byte to head of the circular queue.
+     * @brief   add one byte to head of the circular queue (producer).
+     *          Byte will be dropped if queue is full.
      *
      * @param [in]  a_byte
      *
@@ -46,7 +52,8 @@ public:
     void add_data(uint8_t a_byte);
     
     /**
-     * @brief   add a buffer of bytes to head of the circular queue.
+     * @brief   add a buffer of bytes to head of the circular queue (producer).
+     *          Whole buffer will be dropped if it doesn't fit in free space.
      *
      * @param [in]  buf, a buffer of bytes.
      * @param [in]  size, size of the buffer.
@@ -56,7 +63,7 @@ public:
     void add_data(uint8_t* buf, int32_t size);
     
     /**
-	 * @brief   preview one byte data from tail of the circular queue.
+	 * @brief   preview one byte data from tail of the circular queue (consumer).
 	 *
 	 * @param [in] cont, true if continue from previous point, otherwise, begin from tail.
 	 *
@@ -65,14 +72,26 @@ public:
 	uint8_t preview_data(bool cont);
 
     /**
-     * @brief   get one byte from tail of the circular queue.
+     * @brief   preview a buffer of bytes from an offset to tail of the circular queue
+     *          (consumer). Data are not removed from the queue.
+     *
+     * @param [out]  buf, a buffer of bytes.
+     * @param [in]  offset, number of bytes from tail will be skipped.
+     * @param [in]  size, size of the buffer.
+     *
+     * @return  actual number of byte has been copied (<= size).
+     */
+    int32_t preview_data(uint8_t* buf, int32_t offset, int32_t size);
+
+    /**
+     * @brief   get one byte from tail of the circular queue (consumer).
      *
      * @return  data of a byte (0 if queue is empty).
      */
     uint8_t get_data(void);
     
     /**
-     * @brief   get a buffer of bytes from tail of the circular queue.
+     * @brief   get a buffer of bytes from tail of the circular queue (consumer).
      *
      * @param [out]  buf, a buffer of bytes.
      * @param [in]  size, size of the buffer.
@@ -88,22 +107,29 @@ public:
      */
     int32_t get_size(void);
     
+    /**
+     * @brief   get free space of the circular queue (producer).
+     *
+     * @return  number of bytes can be added.
+     */
+    int32_t get_free(void) { return queue_size - get_size(); }
+
     /**
      * @brief   get head of the circular queue.
      *
      * @return  head
      */
-    int32_t get_head(void) { return head; }
+    int32_t get_head(void) { return pos(head); }
     
     /**
      * @brief   get tail of the circular queue.
      *
-     * @return  tail
+     * @return  tail, -1 if queue is empty.
      */
-    int32_t get_tail(void) { return tail; }
+    int32_t get_tail(void);
     
     /**
-     * @brief   check if queue has been overflowed or not.
+     * @brief   check if data has been dropped because queue was full.
      *
      * @return  true if overflowed. Otherwise, false.
      */
@@ -114,9 +140,25 @@ protected:
     uint16_t queue_size;
 
 private:
-    int32_t head; /* next pos for new data to be pushed to the queue*/
-    int32_t tail; /* next data to be pop from the queue */
-    int32_t preview_pos;
+    /**
+     * @brief   get number of bytes between tail and head.
+     */
+    uint32_t used(uint32_t a_head, uint32_t a_tail);
+
+    /**
+     * @brief   advance an index by count (count <= queue_size).
+     */
+    uint32_t advance(uint32_t index, uint32_t count);
+
+    /**
+     * @brief   get position in queue buffer of an index.
+     */
+    uint32_t pos(uint32_t index) { return (index >= queue_size) ? index - queue_size : index; }
+
+    /* indices in [0, 2 * queue_size), see cir_queue.cpp */
+    uint32_t head; /* next pos for new data to be pushed to the queue, written by producer */
+    uint32_t tail; /* next data to be pop from the queue, written by consumer */
+    uint32_t preview_pos;
     
     /* error indicators */
     bool overflowed;
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        crc16.cpp
+ * @brief       CRC-16/CCITT (poly 0x1021) for checking data in files.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include "crc16.h"
+
+/* crc of 4-bit values, table is small enough for flash */
+static const uint16_t crc16_nibble_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+/*----------------------------------------------------------------------------*/
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *buf, uint32_t size)
+{
+    uint32_t count;
+
+    for (count = 0; count < size; count++) {
+        crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (buf[count] >> 4)];
+        crc = (crc << 4) ^ crc16_nibble_table[(crc >> 12) ^ (buf[count] & 0x0F)];
+    }
+
+    return crc;
+}
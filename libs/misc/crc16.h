@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        crc16.h
+ * @brief       CRC-16/CCITT (poly 0x1021) for checking data in files.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <cstdint>
+
+namespace crc16_ns {
+
+const uint16_t crc16_init = 0xFFFF;
+
+}
+
+/**
+ * @brief   Calculate CRC-16/CCITT of a buffer, can be called many times for data in
+ *          many buffers.
+ *
+ * @param[in]   crc, crc16_init or crc of previous buffers.
+ * @param[in]   buf, pointer to data.
+ * @param[in]   size, size of data.
+ *
+ * @return  crc.
+ */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t *buf, uint32_t size);
+
+/** @} */
+#endif // CRC16_H_
@@ -0,0 +1,191 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        frame_ring.cpp
+ * @brief       Ring buffer of length-prefixed frames.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "frame_ring.h"
+
+using namespace frame_ring_ns;
+
+/* head is only written by producer, tail only by consumer. Frame is written before head
+ * is published (release) and read after head is loaded (acquire), tail is published
+ * (release) after frame has been read so producer can't overwrite it. */
+#define LOAD_ACQUIRE(var)           __atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#define STORE_RELEASE(var, val)     __atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+
+/*----------------------------------------------------------------------------*/
+frame_ring::frame_ring(uint8_t *buffer_p, uint16_t capacity)
+{
+    this->buffer_p = buffer_p;
+    this->capacity = capacity;
+    this->mask = capacity - 1;
+
+    head = 0;
+    tail = 0;
+
+    reserved_pad = 0;
+    reserved_len = 0;
+
+    overflowed = false;
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t *frame_ring::reserve(uint16_t max_len)
+{
+    uint16_t pos, contiguous, needed, free_size;
+
+    pos = head & mask;
+    contiguous = capacity - pos;
+    needed = header_size + max_len;
+    free_size = capacity - (uint16_t)(head - LOAD_ACQUIRE(tail));
+
+    reserved_len = 0;
+    reserved_pad = 0;
+
+    if (contiguous < needed) {
+        /* not enough space before end of buffer, frame will start at the beginning */
+        if ((uint32_t)contiguous + needed > free_size) {
+            overflowed = true;
+            return NULL;
+        }
+
+        if (contiguous >= header_size) {
+            buffer_p[pos] = (uint8_t)wrap_marker;
+            buffer_p[pos + 1] = (uint8_t)(wrap_marker >> 8);
+        }
+
+        reserved_pad = contiguous;
+        pos = 0;
+    }
+    else if (needed > free_size) {
+        overflowed = true;
+        return NULL;
+    }
+
+    reserved_len = max_len;
+
+    return &buffer_p[pos + header_size];
+}
+
+/*----------------------------------------------------------------------------*/
+void frame_ring::commit(uint16_t len)
+{
+    uint16_t pos;
+
+    if (len > reserved_len) {
+        len = reserved_len;
+    }
+
+    pos = (head + reserved_pad) & mask;
+    buffer_p[pos] = (uint8_t)len;
+    buffer_p[pos + 1] = (uint8_t)(len >> 8);
+
+    STORE_RELEASE(head, (uint16_t)(head + reserved_pad + header_size + len));
+
+    reserved_pad = 0;
+    reserved_len = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t *frame_ring::peek(uint16_t &len)
+{
+    uint16_t pos;
+
+    skip_padding();
+    if (LOAD_ACQUIRE(head) == tail) {
+        return NULL;
+    }
+
+    pos = tail & mask;
+    len = buffer_p[pos] | (buffer_p[pos + 1] << 8);
+
+    return &buffer_p[pos + header_size];
+}
+
+/*----------------------------------------------------------------------------*/
+void frame_ring::release(void)
+{
+    uint16_t pos, len;
+
+    skip_padding();
+    if (LOAD_ACQUIRE(head) == tail) {
+        return;
+    }
+
+    pos = tail & mask;
+    len = buffer_p[pos] | (buffer_p[pos + 1] << 8);
+
+    STORE_RELEASE(tail, (uint16_t)(tail + header_size + len));
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t frame_ring::add_frame(const uint8_t *buf, uint16_t len)
+{
+    uint8_t *frame_p;
+
+    frame_p = reserve(len);
+    if (frame_p == NULL) {
+        return -1;
+    }
+
+    memcpy(frame_p, buf, len);
+    commit(len);
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+int32_t frame_ring::get_frame(uint8_t *buf, uint16_t size)
+{
+    uint8_t *frame_p;
+    uint16_t len;
+
+    frame_p = peek(len);
+    if (frame_p == NULL) {
+        return -1;
+    }
+
+    if (len > size) {
+        len = size;
+    }
+
+    memcpy(buf, frame_p, len);
+    release();
+
+    return len;
+}
+
+/*----------------------------------------------------------------------------*/
+void frame_ring::skip_padding(void)
+{
+    uint16_t pos, contiguous;
+
+    if (LOAD_ACQUIRE(head) == tail) {
+        return;
+    }
+
+    pos = tail & mask;
+    contiguous = capacity - pos;
+
+    if (contiguous < header_size
+            || (buffer_p[pos] | (buffer_p[pos + 1] << 8)) == wrap_marker) {
+        STORE_RELEASE(tail, (uint16_t)(tail + contiguous));
+    }
+}
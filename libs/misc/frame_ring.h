@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        frame_ring.h
+ * @brief       Ring buffer of length-prefixed frames. Frames are always contiguous
+ *              in the buffer so they can be written and parsed in place.
+ *              One producer (reserve/commit, add_frame) and one consumer (peek/release,
+ *              get_frame) may run in different threads without locking.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef FRAME_RING_H_
+#define FRAME_RING_H_
+
+#include <cstdint>
+
+namespace frame_ring_ns {
+
+const uint16_t header_size = 2;         /* frame length, little endian */
+const uint16_t wrap_marker = 0xFFFF;    /* rest of the buffer is padding */
+
+}
+
+class frame_ring {
+public:
+
+    /**
+     * @brief   constructor, user must allocate data for the ring.
+     *          Each frame takes header_size more bytes in the ring, a frame which
+     *          doesn't fit before the end of the buffer starts again at the beginning.
+     *
+     * @param[in]   buffer_p, pointer to buffer for the ring.
+     * @param[in]   capacity, size of the buffer, MUST be a power of 2 (<= 32768).
+     */
+    frame_ring(uint8_t *buffer_p, uint16_t capacity);
+
+    /**
+     * @brief   Reserve contiguous space for a frame at head of the ring.
+     *          Frame is not visible to consumer until commit is called.
+     *
+     * @param[in]   max_len, max length of the frame.
+     *
+     * @return  pointer to space for frame data, NULL if there is not enough space.
+     */
+    uint8_t *reserve(uint16_t max_len);
+
+    /**
+     * @brief   Commit the frame written in reserved space.
+     *
+     * @param[in]   len, actual length of the frame, MUST be <= max_len of reserve.
+     */
+    void commit(uint16_t len);
+
+    /**
+     * @brief   Peek the frame at tail of the ring without copying it.
+     *
+     * @param[out]  len, length of the frame.
+     *
+     * @return  pointer to frame data, NULL if the ring is empty.
+     */
+    uint8_t *peek(uint16_t &len);
+
+    /**
+     * @brief   Release the frame at tail of the ring (after peek).
+     */
+    void release(void);
+
+    /**
+     * @brief   Copy a frame to head of the ring (reserve + memcpy + commit).
+     *
+     * @param[in]   buf, frame data.
+     * @param[in]   len, length of the frame.
+     *
+     * @return  0 on success, -1 if there was not enough space (frame was dropped).
+     */
+    int8_t add_frame(const uint8_t *buf, uint16_t len);
+
+    /**
+     * @brief   Copy the frame at tail of the ring to buf and release it (peek + memcpy + release).
+     *
+     * @param[out]  buf, buffer for frame data.
+     * @param[in]   size, size of buf, frame will be truncated if it is longer.
+     *
+     * @return  number of bytes copied to buf, -1 if the ring is empty.
+     */
+    int32_t get_frame(uint8_t *buf, uint16_t size);
+
+    /**
+     * @brief   Check if ring is empty.
+     *
+     * @return  true if there is no frame in the ring.
+     */
+    bool is_empty(void) { return head == tail; }
+
+    /**
+     * @brief   Get number of used bytes (frames, headers and padding).
+     *
+     * @return  used bytes.
+     */
+    uint16_t get_used(void) { return (uint16_t)(head - tail); }
+
+    /**
+     * @brief   Check if a frame has been dropped because the ring was full.
+     *
+     * @return  true if dropped. Otherwise, false.
+     */
+    bool is_overflowed(void) { return overflowed; }
+
+private:
+    /**
+     * @brief   Skip padding at tail of the ring if there is any.
+     */
+    void skip_padding(void);
+
+    uint8_t *buffer_p;
+    uint16_t capacity;
+    uint16_t mask;
+
+    /* free running, position in buffer is index & mask */
+    uint16_t head;
+    uint16_t tail;
+
+    uint16_t reserved_pad;  /* padding to skip before reserved frame */
+    uint16_t reserved_len;
+
+    bool overflowed;
+};
+
+/** @} */
+#endif // FRAME_RING_H_
@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        frame_window.cpp
+ * @brief       Sliding window (go-back-N) sender for frames held in a cir_queue.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <stddef.h>
+#include "frame_window.h"
+
+/*----------------------------------------------------------------------------*/
+frame_window::frame_window(cir_queue *queue_p, uint16_t *packet_sizes_p, uint8_t window_size,
+        uint8_t *packet_p, uint16_t max_packet_len, uint8_t header_len,
+        uint8_t frame_overhead, uint8_t max_retries, frame_window_ns::write_func_t write_func)
+{
+    this->queue_p = queue_p;
+    this->packet_sizes_p = packet_sizes_p;
+    this->window_size = window_size;
+    this->packet_p = packet_p;
+    this->max_packet_len = max_packet_len;
+    this->header_len = header_len;
+    this->frame_overhead = frame_overhead;
+    this->max_retries = max_retries;
+    this->write_func = write_func;
+
+    next_index = 0;
+    in_flight = 0;
+    in_flight_bytes = 0;
+    retries = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint8_t frame_window::send(void)
+{
+    uint16_t bytes;
+    uint8_t sent = 0;
+
+    while (in_flight < window_size) {
+        bytes = build_packet(in_flight_bytes, max_packet_len - header_len);
+        if (bytes == 0) {
+            break;
+        }
+
+        write_func(next_index, packet_p, bytes);
+
+        packet_sizes_p[next_index % window_size] = bytes;
+        in_flight_bytes += bytes;
+        in_flight++;
+        next_index++;
+        sent++;
+    }
+
+    return sent;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t frame_window::ack(uint16_t index)
+{
+    uint16_t oldest_index = next_index - in_flight;
+    uint16_t acked, count;
+
+    acked = (uint16_t)(index - oldest_index) + 1;
+    if (in_flight == 0 || acked == 0 || acked > in_flight) {
+        /* duplicated (index is oldest_index - 1) or unknown ack, retries aren't reset */
+        return -1;
+    }
+
+    for (count = 0; count < acked; count++) {
+        drop_bytes(packet_sizes_p[(oldest_index + count) % window_size]);
+        in_flight_bytes -= packet_sizes_p[(oldest_index + count) % window_size];
+    }
+    in_flight -= acked;
+    retries = 0;
+
+    return acked;
+}
+
+/*----------------------------------------------------------------------------*/
+int16_t frame_window::resend(void)
+{
+    uint16_t index = next_index - in_flight;
+    int32_t offset = 0;
+    uint16_t bytes;
+    uint8_t count;
+
+    if (in_flight == 0) {
+        return 0;
+    }
+
+    if (retries >= max_retries) {
+        reset(false);
+        return -1;
+    }
+    retries++;
+
+    /* go back N, packets are rebuilt with the same frames */
+    for (count = 0; count < in_flight; count++, index++) {
+        bytes = build_packet(offset, packet_sizes_p[index % window_size]);
+        write_func(index, packet_p, bytes);
+        offset += bytes;
+    }
+
+    return in_flight;
+}
+
+/*----------------------------------------------------------------------------*/
+void frame_window::reset(bool drop_queue)
+{
+    drop_bytes(drop_queue ? queue_p->get_size() : in_flight_bytes);
+
+    in_flight = 0;
+    in_flight_bytes = 0;
+    retries = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t frame_window::build_packet(int32_t offset, uint16_t max_bytes)
+{
+    uint8_t frame_len;
+    uint16_t frame_size, bytes = 0;
+    int32_t queue_size = queue_p->get_size();
+
+    while (offset + bytes < queue_size) {
+        if (queue_p->preview_data(&frame_len, offset + bytes, 1) != 1) {
+            break;
+        }
+
+        frame_size = frame_len + frame_overhead;
+        if (offset + bytes + frame_size > queue_size) {
+            /* incomplete frame */
+            break;
+        }
+
+        /* a frame bigger than max_bytes is sent alone */
+        if (bytes > 0 && bytes + frame_size > max_bytes) {
+            break;
+        }
+
+        queue_p->preview_data(&packet_p[header_len + bytes], offset + bytes, frame_size);
+        bytes += frame_size;
+    }
+
+    return bytes;
+}
+
+/*----------------------------------------------------------------------------*/
+void frame_window::drop_bytes(int32_t size)
+{
+    uint8_t scratch[16];
+
+    while (size > 0) {
+        size -= queue_p->get_data(scratch, (size > (int32_t)sizeof(scratch)) ?
+                (int32_t)sizeof(scratch) : size);
+        if (queue_p->get_size() == 0) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        frame_window.h
+ * @brief       Sliding window (go-back-N) sender for frames held in a cir_queue.
+ *              Small frames are packed in one packet, up to window_size packets can be
+ *              in flight, peer acknowledges cumulatively with packet index.
+ *              Frames stay in the queue until they're acknowledged, so no extra buffer
+ *              is needed for retransmission.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef FRAME_WINDOW_H_
+#define FRAME_WINDOW_H_
+
+#include <cstdint>
+
+#include "cir_queue.h"
+
+namespace frame_window_ns {
+
+/**
+ * @brief   Function writes a packet to peer.
+ *
+ * @param[in]   index, index of the packet.
+ * @param[in]   packet, header_len free bytes (for the header) followed by frames.
+ * @param[in]   frames_len, len of frames in the packet.
+ */
+typedef void (*write_func_t)(uint16_t index, uint8_t *packet, uint16_t frames_len);
+
+}
+
+class frame_window {
+public:
+
+    /**
+     * @brief   constructor, user must allocate buffers.
+     *          A frame is | len (1) | ... | and its size is len + frame_overhead.
+     *
+     * @param[in]   queue_p, queue holding frames (this object is its only consumer).
+     * @param[in]   packet_sizes_p, buffer holding number of queue bytes of each packet
+     *              in flight, window_size members.
+     * @param[in]   window_size, max number of packets in flight.
+     * @param[in]   packet_p, buffer for building a packet, its size MUST be at least
+     *              header_len + max size of a frame.
+     * @param[in]   max_packet_len, max len of a packet (header + frames), frames will be
+     *              packed up to it. A bigger frame will be sent alone.
+     * @param[in]   header_len, len of packet header.
+     * @param[in]   frame_overhead, size of a frame - its len.
+     * @param[in]   max_retries, number of retransmissions before packets in flight are dropped.
+     * @param[in]   write_func, function writes a packet to peer.
+     */
+    frame_window(cir_queue *queue_p, uint16_t *packet_sizes_p, uint8_t window_size,
+            uint8_t *packet_p, uint16_t max_packet_len, uint8_t header_len,
+            uint8_t frame_overhead, uint8_t max_retries, frame_window_ns::write_func_t write_func);
+
+    /**
+     * @brief   Send new packets while window is not full and there are frames in queue.
+     *
+     * @return  number of packets have been sent.
+     */
+    uint8_t send(void);
+
+    /**
+     * @brief   Cumulative acknowledgement, all packets up to index have been received.
+     *          Acknowledged frames are removed from the queue.
+     *
+     * @param[in]   index, index of the last received packet.
+     *
+     * @return  number of packets have been acknowledged, -1 if index is not in flight
+     *          (including a repeated ACK of the last acknowledged packet).
+     */
+    int16_t ack(uint16_t index);
+
+    /**
+     * @brief   Send again all packets in flight (on timeout). After max_retries, packets
+     *          in flight are dropped.
+     *
+     * @return  number of packets have been resent, -1 if packets have been dropped.
+     */
+    int16_t resend(void);
+
+    /**
+     * @brief   Drop packets in flight (e.g. peer is disconnected), next packet will continue
+     *          with the next index.
+     *
+     * @param[in]   drop_queue, true if all frames in queue will be dropped too.
+     */
+    void reset(bool drop_queue);
+
+    /**
+     * @brief   get number of packets in flight.
+     */
+    uint8_t get_in_flight(void) { return in_flight; }
+
+    /**
+     * @brief   get index of the next new packet.
+     */
+    uint16_t get_next_index(void) { return next_index; }
+
+private:
+    /**
+     * @brief   Build a packet from frames at offset of the queue.
+     *
+     * @return  number of queue bytes in the packet, 0 if there is no complete frame.
+     */
+    uint16_t build_packet(int32_t offset, uint16_t max_bytes);
+
+    /**
+     * @brief   Remove n bytes from tail of the queue.
+     */
+    void drop_bytes(int32_t size);
+
+    cir_queue *queue_p;
+    uint16_t *packet_sizes_p;   /* by index % window_size */
+    uint8_t window_size;
+    uint8_t *packet_p;
+    uint16_t max_packet_len;
+    uint8_t header_len;
+    uint8_t frame_overhead;
+    uint8_t max_retries;
+    frame_window_ns::write_func_t write_func;
+
+    uint16_t next_index;        /* index of the next new packet */
+    uint8_t in_flight;          /* packets from next_index - in_flight are in flight */
+    int32_t in_flight_bytes;
+    uint8_t retries;
+};
+
+/** @} */
+#endif // FRAME_WINDOW_H_
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        id_hash_index.cpp
+ * @brief       Open-addressing hash index, maps 32-bit ids to 16-bit positions.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <stddef.h>
+#include "id_hash_index.h"
+
+using namespace id_hash_index_ns;
+
+/*----------------------------------------------------------------------------*/
+id_hash_index::id_hash_index(entry_t *table_p, uint16_t table_size)
+{
+    this->table_p = table_p;
+    this->table_size = table_size;
+    this->mask = table_size - 1;
+
+    clear();
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t id_hash_index::find(uint32_t key)
+{
+    uint16_t pos;
+
+    pos = find_pos(key);
+    if (pos == table_size) {
+        return no_value;
+    }
+
+    return table_p[pos].value;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t id_hash_index::insert(uint32_t key, uint16_t value)
+{
+    uint16_t pos, count;
+
+    pos = hash(key);
+    for (count = 0; count < table_size; count++) {
+        if (table_p[pos].value == no_value) {
+            /* empty entry, key didn't exist */
+            table_p[pos].key = key;
+            table_p[pos].value = value;
+            size++;
+            return 0;
+        }
+
+        if (table_p[pos].key == key) {
+            table_p[pos].value = value;
+            return 0;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    /* full */
+    return -1;
+}
+
+/*----------------------------------------------------------------------------*/
+int8_t id_hash_index::remove(uint32_t key)
+{
+    uint16_t pos, next_pos, home_pos;
+
+    pos = find_pos(key);
+    if (pos == table_size) {
+        return -1;
+    }
+
+    /* shift back following entries which can't be found anymore with an empty entry at pos */
+    next_pos = pos;
+    while (1) {
+        next_pos = (next_pos + 1) & mask;
+        if (table_p[next_pos].value == no_value) {
+            break;
+        }
+
+        /* entry can stay if its home position is cyclically in (pos, next_pos] */
+        home_pos = hash(table_p[next_pos].key);
+        if (((next_pos - home_pos) & mask) < ((next_pos - pos) & mask)) {
+            continue;
+        }
+
+        table_p[pos] = table_p[next_pos];
+        pos = next_pos;
+    }
+
+    table_p[pos].value = no_value;
+    size--;
+
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void id_hash_index::clear(void)
+{
+    for (uint16_t count = 0; count < table_size; count++) {
+        table_p[count].value = no_value;
+    }
+
+    size = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t id_hash_index::hash(uint32_t key)
+{
+    /* Fibonacci hashing, mix high bits (node id) into low bits */
+    key = key * 2654435761UL;
+    key = key ^ (key >> 16);
+
+    return (uint16_t)key & mask;
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t id_hash_index::find_pos(uint32_t key)
+{
+    uint16_t pos, count;
+
+    pos = hash(key);
+    for (count = 0; count < table_size; count++) {
+        if (table_p[pos].value == no_value) {
+            return table_size;
+        }
+
+        if (table_p[pos].key == key) {
+            return pos;
+        }
+
+        pos = (pos + 1) & mask;
+    }
+
+    return table_size;
+}
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        id_hash_index.h
+ * @brief       Open-addressing hash index, maps 32-bit ids to 16-bit positions.
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef ID_HASH_INDEX_H_
+#define ID_HASH_INDEX_H_
+
+#include <cstdint>
+
+namespace id_hash_index_ns {
+
+const uint16_t no_value = 0xFFFF;
+
+typedef struct entry_s {
+    uint32_t key;
+    uint16_t value;     /* no_value if this entry is empty */
+} entry_t;
+
+}
+
+class id_hash_index {
+public:
+
+    /**
+     * @brief   constructor, user must allocate entries for the index.
+     *          Linear probing is used, table_size MUST be a power of 2 and should be
+     *          at least 2 times of the number of ids to keep probe sequences short.
+     *
+     * @param[in]   table_p, pointer to buffer of entries.
+     * @param[in]   table_size, number of entries in the buffer (power of 2).
+     */
+    id_hash_index(id_hash_index_ns::entry_t *table_p, uint16_t table_size);
+
+    /**
+     * @brief   Find value of a key.
+     *
+     * @param[in]   key.
+     *
+     * @return  value, id_hash_index_ns::no_value if key didn't exist.
+     */
+    uint16_t find(uint32_t key);
+
+    /**
+     * @brief   Insert a key with value, value of the key will be updated if key has existed.
+     *
+     * @param[in]   key.
+     * @param[in]   value, MUST NOT be id_hash_index_ns::no_value.
+     *
+     * @return  0 on success, -1 if the index was full.
+     */
+    int8_t insert(uint32_t key, uint16_t value);
+
+    /**
+     * @brief   Remove a key. Following entries in the probe sequence are shifted back
+     *          so no deleted marker is needed.
+     *
+     * @param[in]   key.
+     *
+     * @return  0 on success, -1 if key didn't exist.
+     */
+    int8_t remove(uint32_t key);
+
+    /**
+     * @brief   Remove all keys.
+     */
+    void clear(void);
+
+    /**
+     * @brief   Get number of keys in the index.
+     *
+     * @return  number of keys.
+     */
+    uint16_t get_size(void) { return size; }
+
+private:
+    /**
+     * @brief   Get home position of a key in table.
+     *
+     * @param[in]   key.
+     *
+     * @return  position.
+     */
+    uint16_t hash(uint32_t key);
+
+    /**
+     * @brief   Find position of a key in table.
+     *
+     * @param[in]   key.
+     *
+     * @return  position, table_size if key didn't exist.
+     */
+    uint16_t find_pos(uint32_t key);
+
+    id_hash_index_ns::entry_t *table_p;
+    uint16_t table_size;
+    uint16_t mask;
+    uint16_t size;
+};
+
+/** @} */
+#endif // ID_HASH_INDEX_H_
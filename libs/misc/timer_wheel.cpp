@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        timer_wheel.cpp
+ * @brief       Two-level hierarchical timing wheel for many coarse timers (e.g. TTLs).
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ * @}
+ */
+
+#include <stddef.h>
+#include "timer_wheel.h"
+
+using namespace timer_wheel_ns;
+
+/*----------------------------------------------------------------------------*/
+timer_wheel::timer_wheel(node_t *nodes_p, uint16_t num_of_nodes)
+{
+    this->nodes_p = nodes_p;
+    this->num_of_nodes = num_of_nodes;
+
+    clear();
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::start(uint16_t id, uint16_t timeout)
+{
+    if (id >= num_of_nodes) {
+        return;
+    }
+
+    if (timeout == 0) {
+        timeout = 1;
+    }
+
+    unlink(id);
+    nodes_p[id].expiry = now + timeout;
+    place(id);
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::stop(uint16_t id)
+{
+    if (id >= num_of_nodes) {
+        return;
+    }
+
+    unlink(id);
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t timer_wheel::get_remaining(uint16_t id)
+{
+    uint32_t remaining;
+
+    if (id >= num_of_nodes) {
+        return 0;
+    }
+
+    if (nodes_p[id].list == no_list || nodes_p[id].list == expired_list) {
+        return 0;
+    }
+
+    remaining = nodes_p[id].expiry - now;
+    return (remaining > 0xFFFF) ? 0xFFFF : (uint16_t)remaining;
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::move(uint16_t old_id, uint16_t new_id)
+{
+    uint8_t list;
+
+    if (old_id >= num_of_nodes || new_id >= num_of_nodes || old_id == new_id) {
+        return;
+    }
+
+    unlink(new_id);
+
+    list = nodes_p[old_id].list;
+    if (list == no_list) {
+        return;
+    }
+
+    nodes_p[new_id].expiry = nodes_p[old_id].expiry;
+    unlink(old_id);
+    link(new_id, list);
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::tick(void)
+{
+    uint16_t id, next_id;
+
+    now++;
+
+    /* cascade level 1 slot into level 0 at the start of every level 0 round */
+    if ((now & slot_mask) == 0) {
+        id = heads[slots_per_level + ((now >> slot_bits) & slot_mask)];
+        heads[slots_per_level + ((now >> slot_bits) & slot_mask)] = no_timer;
+
+        while (id != no_timer) {
+            next_id = nodes_p[id].next;
+            nodes_p[id].list = no_list;
+            place(id);
+            id = next_id;
+        }
+    }
+
+    /* every timer in current level 0 slot is due */
+    id = heads[now & slot_mask];
+    heads[now & slot_mask] = no_timer;
+
+    while (id != no_timer) {
+        next_id = nodes_p[id].next;
+        nodes_p[id].list = no_list;
+        link(id, expired_list);
+        id = next_id;
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+uint16_t timer_wheel::get_expired(void)
+{
+    uint16_t id;
+
+    id = heads[expired_list];
+    if (id != no_timer) {
+        unlink(id);
+    }
+
+    return id;
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::clear(void)
+{
+    uint16_t count;
+
+    for (count = 0; count < num_of_nodes; count++) {
+        nodes_p[count].list = no_list;
+    }
+
+    for (count = 0; count < sizeof(heads) / sizeof(heads[0]); count++) {
+        heads[count] = no_timer;
+    }
+
+    now = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::place(uint16_t id)
+{
+    uint32_t expiry = nodes_p[id].expiry;
+    uint32_t block_diff;
+
+    if (expiry - now < slots_per_level) {
+        link(id, (uint8_t)(expiry & slot_mask));
+        return;
+    }
+
+    block_diff = (expiry >> slot_bits) - (now >> slot_bits);
+    if (block_diff >= slots_per_level) {
+        /* too far, park in the last level 1 slot, will be re-placed on cascade */
+        block_diff = slots_per_level - 1;
+    }
+
+    link(id, (uint8_t)(slots_per_level + (((now >> slot_bits) + block_diff) & slot_mask)));
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::link(uint16_t id, uint8_t list)
+{
+    nodes_p[id].list = list;
+    nodes_p[id].prev = no_timer;
+    nodes_p[id].next = heads[list];
+
+    if (heads[list] != no_timer) {
+        nodes_p[heads[list]].prev = id;
+    }
+    heads[list] = id;
+}
+
+/*----------------------------------------------------------------------------*/
+void timer_wheel::unlink(uint16_t id)
+{
+    node_t *node_p = &nodes_p[id];
+
+    if (node_p->list == no_list) {
+        return;
+    }
+
+    if (node_p->prev != no_timer) {
+        nodes_p[node_p->prev].next = node_p->next;
+    }
+    else {
+        heads[node_p->list] = node_p->next;
+    }
+
+    if (node_p->next != no_timer) {
+        nodes_p[node_p->next].prev = node_p->prev;
+    }
+
+    node_p->list = no_list;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (C) 2014 Ho Chi Minh city University of Technology (HCMUT)
+ *
+ * This file is subject to the terms and conditions of the GNU Lesser General
+ * Public License.
+ */
+
+/**
+ * @defgroup
+ * @brief
+ * @ingroup     libraries
+ * @{
+ *
+ * @file        timer_wheel.h
+ * @brief       Two-level hierarchical timing wheel for many coarse timers (e.g. TTLs).
+ *
+ * @author      DangNhat Pham-Huu <51002279@stu.hcmut.edu.vn>
+ */
+
+#ifndef TIMER_WHEEL_H_
+#define TIMER_WHEEL_H_
+
+#include <cstdint>
+
+namespace timer_wheel_ns {
+
+const uint16_t no_timer = 0xFFFF;
+
+const uint8_t slot_bits = 6;
+const uint16_t slots_per_level = 1 << slot_bits;
+const uint16_t slot_mask = slots_per_level - 1;
+
+/* timeouts longer than this are parked in level 1 and re-cascaded until they are due */
+const uint16_t max_direct_timeout = (slots_per_level - 1) * slots_per_level;
+
+const uint8_t no_list = 0xFF;
+const uint8_t expired_list = 2 * slots_per_level;
+
+typedef struct node_s {
+    uint16_t next;
+    uint16_t prev;
+    uint32_t expiry;    /* absolute tick */
+    uint8_t list;       /* level 0 slots, level 1 slots, expired_list or no_list */
+} node_t;
+
+}
+
+class timer_wheel {
+public:
+
+    /**
+     * @brief   constructor, user must allocate one node for each timer id.
+     *          Timer ids are 0..num_of_nodes-1.
+     *
+     * @param[in]   nodes_p, pointer to buffer of nodes.
+     * @param[in]   num_of_nodes, number of nodes in the buffer.
+     */
+    timer_wheel(timer_wheel_ns::node_t *nodes_p, uint16_t num_of_nodes);
+
+    /**
+     * @brief   Start (or restart) a timer, O(1).
+     *
+     * @param[in]   id, timer id.
+     * @param[in]   timeout, in ticks, 0 will be treated as 1 (expire on next tick).
+     */
+    void start(uint16_t id, uint16_t timeout);
+
+    /**
+     * @brief   Stop a timer, O(1). Also remove it from expired list.
+     *
+     * @param[in]   id, timer id.
+     */
+    void stop(uint16_t id);
+
+    /**
+     * @brief   Get remaining ticks of a timer.
+     *
+     * @param[in]   id, timer id.
+     *
+     * @return  remaining ticks, 0 if timer was not running or has expired.
+     */
+    uint16_t get_remaining(uint16_t id);
+
+    /**
+     * @brief   Move a timer to another id (e.g. its owner has been moved in a buffer).
+     *          Timer of new_id MUST not be running.
+     *
+     * @param[in]   old_id.
+     * @param[in]   new_id.
+     */
+    void move(uint16_t old_id, uint16_t new_id);
+
+    /**
+     * @brief   Advance wheel by one tick. Timers which are due will be moved to expired list.
+     *          Cost is proportional to number of due timers (plus a cascade of level 1
+     *          every slots_per_level ticks).
+     */
+    void tick(void);
+
+    /**
+     * @brief   Pop a timer from expired list.
+     *
+     * @return  timer id, timer_wheel_ns::no_timer if there is no expired timer.
+     */
+    uint16_t get_expired(void);
+
+    /**
+     * @brief   Stop all timers.
+     */
+    void clear(void);
+
+private:
+    /**
+     * @brief   Put a node into slot of its expiry.
+     *
+     * @param[in]   id, timer id.
+     */
+    void place(uint16_t id);
+
+    /**
+     * @brief   Link a node to head of a list.
+     *
+     * @param[in]   id, timer id.
+     * @param[in]   list, list id.
+     */
+    void link(uint16_t id, uint8_t list);
+
+    /**
+     * @brief   Unlink a node from its list.
+     *
+     * @param[in]   id, timer id.
+     */
+    void unlink(uint16_t id);
+
+    timer_wheel_ns::node_t *nodes_p;
+    uint16_t num_of_nodes;
+    uint32_t now;
+    uint16_t heads[2 * timer_wheel_ns::slots_per_level + 1]; /* level 0, level 1, expired */
+};
+
+/** @} */
+#endif // TIMER_WHEEL_H_